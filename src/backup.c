@@ -2,17 +2,691 @@
 
 extern int handle_file_conflict(const char *dest, conflict_mode_t mode);
 
-int backup_file(const char *source, const char *dest, const backup_options_t *opts) {
+// 증분/차등 백업 중 변경 감지에 사용하는 기준 백업 인덱스
+static backup_index_t reference_index;
+static int reference_loaded = 0;
+static char reference_name[BACKUP_NAME_MAX];
+static char active_backup_root[MAX_PATH];
+
+// 중복 제거 모드에서 파일 데이터를 넣는 청크 저장소 (디렉토리 백업 중에만 열림)
+static chunk_store_t *active_chunk_store = NULL;
+
+// 델타 모드: 변경된 파일 중 이 크기 이상만 기준 버전 대비 델타로 저장
+#define DELTA_MIN_FILE_SIZE (1024 * 1024)
+static int delta_active = 0;
+static char active_chain[MAX_PATH];
+
+// 하위 트리 건너뛰기: 기준 백업의 디렉토리 항목(시간, 요약)으로 변경 없는 하위 트리를 stat 없이 이어받음
+static int subtree_skip_active = 0;
+static char subtree_changed[MAX_PATH];  // 마지막으로 찾은 바뀐 디렉토리 (상위 트리마다 다시 stat 하지 않도록)
+static const path_set_t *active_dirty_set = NULL;  // 변경 감시 모드: 바뀐 디렉토리와 그 상위 (watch.c)
+
+// 이번 실행에서 이어받은 하위 트리 (표본 검사가 어긋나면 백업을 마치기 전에 다시 걸음)
+typedef struct {
+    char *source;
+    char *dest;
+    size_t inherited;             // 이어받은 파일 수 (다시 걸을 때 통계에서 뺌)
+} skipped_subtree_t;
+
+static skipped_subtree_t *skipped_subtrees = NULL;
+static size_t skipped_subtree_count = 0;
+static size_t skipped_subtree_capacity = 0;
+static int subtree_recheck = 0;
+
+// 디렉토리 제외 패턴과 제외 파일(.backupignore)을 비교할 백업 원본 (절대 경로는 /proc 같은 패턴용)
+static char active_source[MAX_PATH];
+static size_t active_source_len = 0;
+static char active_source_abs[MAX_PATH];
+
+// --link-dest: 변경 없는 파일은 이전 스냅샷의 파일을 하드 링크 (배치로 모아 병렬 link)
+#define LINK_BATCH_SIZE 4096
+
+typedef struct {
+    char *from;                   // 이전 스냅샷의 파일 (압축 확장자 포함)
+    char *to;                     // 새 스냅샷의 파일 (압축 확장자 포함)
+    char *source;
+    char *dest;                   // 인덱스 기록용 (확장자 제외)
+    index_entry_t entry;
+    int error;
+} link_job_t;
+
+static int link_dest_active = 0;
+static int link_bypass = 0;       // 링크 실패 후 복사로 다시 처리하는 중
+static link_job_t *link_jobs = NULL;
+static size_t link_job_count = 0;
+static int link_flush_failed = 0;  // 배치 중간 처리에서 복사로 대신한 파일의 실패
+
+// 이동 감지: 기준 백업의 파일 항목을 inode와 크기로 찾는 표 (처음 새 파일을 만났을 때 만듦)
+typedef struct {
+    uint64_t key;
+    size_t pos;                   // 기준 인덱스 위치 + 1 (0 = 빈 칸)
+} move_slot_t;
+
+static move_slot_t *moves_by_inode = NULL;
+static move_slot_t *moves_by_size = NULL;   // 체크섬이 기록된 항목만
+static size_t move_capacity = 0;
+static int move_table_state = 0;  // 0 = 아직 없음, 1 = 사용 가능, -1 = 사용 안 함
+
+// 디렉토리 요약: 자식마다 (이름, 메타데이터, 하위 요약)의 해시를 더함 (readdir 순서와 무관)
+typedef struct {
+    uint64_t sum;
+    uint64_t count;
+} tree_summary_t;
+
+// 압축 확장자 제거
+static void strip_compression_extension(char *path, compression_type_t type) {
+    if (type == COMPRESS_NONE) {
+        return;
+    }
+
+    const char *ext = get_compression_extension(type);
+    size_t path_len = strlen(path);
+    size_t ext_len = strlen(ext);
+
+    if (path_len > ext_len && strcmp(path + path_len - ext_len, ext) == 0) {
+        path[path_len - ext_len] = '\0';
+    }
+}
+
+// 압축 확장자 추가 (이미 올바른 확장자가 있으면 그대로, 버퍼에 들어가지 않으면 ERROR_INVALID_PARAMS)
+static int append_compression_extension(char *path, size_t size, compression_type_t type) {
+    if (type == COMPRESS_NONE) {
+        return SUCCESS;
+    }
+
+    const char *ext = get_compression_extension(type);
+    size_t path_len = strlen(path);
+    size_t ext_len = strlen(ext);
+
+    if (path_len < ext_len || strcmp(path + path_len - ext_len, ext) != 0) {
+        if (path_len + ext_len >= size) {
+            return ERROR_INVALID_PARAMS;
+        }
+        memcpy(path + path_len, ext, ext_len + 1);
+    }
+    return SUCCESS;
+}
+
+// 기준 백업 인덱스에서 파일 항목 조회 (dest는 확장자 없는 백업 경로)
+static int find_reference_entry(const char *dest, index_entry_t *entry) {
+    size_t root_len = strlen(active_backup_root);
+
+    if (!reference_loaded || strncmp(dest, active_backup_root, root_len) != 0 || dest[root_len] != '/') {
+        return 0;
+    }
+
+    return backup_index_lookup(&reference_index, dest + root_len + 1, entry) &&
+           (entry->type == 'F' || entry->type == 'C' || entry->type == 'X');
+}
+
+// 크기, 수정 시간(ns), inode가 모두 같으면 변경 없음
+static int entry_unchanged(const index_entry_t *entry, const struct stat *st) {
+    return entry->size == (size_t)st->st_size &&
+           entry->mtime == st->st_mtime &&
+           entry->mtime_nsec == st->st_mtim.tv_nsec &&
+           (entry->inode == 0 || entry->inode == (uint64_t)st->st_ino);
+}
+
+// 기준 백업 항목을 이어받아 기록: 데이터는 기준 체인에 둠
+static void inherit_reference_entry(const char *dest, index_entry_t *entry, const backup_options_t *opts) {
+    checksum_type_t algorithm = opts->calculate_checksum ? opts->checksum_algorithm : CHECKSUM_NONE;
+    uint64_t t = metrics_now();
+
+    if (entry->origin[0] == '\0') {
+        snprintf(entry->origin, sizeof(entry->origin), "%s", reference_name);
+    }
+    // 알고리즘이 다르면 이어받은 체크섬은 이 인덱스 헤더와 맞지 않음
+    if (reference_index.checksum_type != algorithm) {
+        entry->checksum[0] = '\0';
+    }
+
+    backup_index_record(dest, entry);
+    metrics_lap(METRIC_METADATA, &t, 0);
+    metrics_count(METRIC_METADATA, 0, 1);
+}
+
+// 변경 없는 파일: 현재 메타데이터로 갱신해 이어받음
+static void record_unchanged_file(const char *dest, const index_entry_t *previous,
+                                  const struct stat *st, const backup_options_t *opts) {
+    index_entry_t entry = *previous;
+
+    entry.mtime = st->st_mtime;
+    entry.mtime_nsec = st->st_mtim.tv_nsec;
+    entry.inode = (uint64_t)st->st_ino;
+    entry.file_mode = (uint32_t)st->st_mode;
+    inherit_reference_entry(dest, &entry, opts);
+}
+
+static uint64_t timespec_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+static void summary_add(tree_summary_t *summary, const char *name, const struct stat *st, uint64_t child) {
+    uint64_t meta[6] = {
+        (uint64_t)st->st_mode, (uint64_t)st->st_size, (uint64_t)st->st_ino,
+        timespec_ns(&st->st_mtim), timespec_ns(&st->st_ctim), child
+    };
+
+    summary->sum += XXH3_64bits_withSeed(name, strlen(name), XXH3_64bits(meta, sizeof(meta)));
+    summary->count++;
+}
+
+static uint64_t summary_final(const tree_summary_t *summary) {
+    uint64_t value[2] = { summary->sum, summary->count };
+    uint64_t hash = XXH3_64bits(value, sizeof(value));
+
+    return hash ? hash : 1; // 0은 "요약 없음"
+}
+
+// 디렉토리 항목 기록 (st가 NULL이면 시간/요약 없이)
+static void record_directory(const char *dest, const struct stat *st, uint64_t summary) {
+    index_entry_t entry = { .type = 'D' };
+
+    if (st) {
+        entry.size = (size_t)timespec_ns(&st->st_ctim);
+        entry.mtime = st->st_mtime;
+        entry.mtime_nsec = st->st_mtim.tv_nsec;
+        entry.inode = (uint64_t)st->st_ino;
+        entry.file_mode = (uint32_t)st->st_mode;
+        entry.offset = summary;
+    }
+    backup_index_record(dest, &entry);
+}
+
+// 디렉토리의 mtime/ctime/inode가 기준 백업 항목과 같으면 그 안에서 항목이 생기거나 지워지거나
+// 이름이 바뀌지 않은 것 (파일을 제자리에서 고치는 것은 디렉토리 시간에 나타나지 않음)
+static int directory_unchanged(const index_entry_t *entry, const struct stat *st) {
+    return S_ISDIR(st->st_mode) &&
+           entry->mtime == st->st_mtime &&
+           entry->mtime_nsec == st->st_mtim.tv_nsec &&
+           (uint64_t)entry->size == timespec_ns(&st->st_ctim) &&
+           entry->inode == (uint64_t)st->st_ino;
+}
+
+static void link_job_run(void *ctx, size_t index) {
+    link_job_t *job = &((link_job_t *)ctx)[index];
+    uint64_t t = metrics_now();
+
+    if (link(job->from, job->to) != 0) {
+        job->error = errno;
+        return;
+    }
+    backup_index_record(job->dest, &job->entry);
+    metrics_lap(METRIC_METADATA, &t, 0);
+    metrics_count(METRIC_METADATA, 0, 1);
+}
+
+// 모인 링크를 병렬로 만들고, 실패한 파일(다른 파일시스템, 링크 수 한도 등)은 복사
+static int flush_link_batch(const backup_options_t *opts) {
+    size_t linked = 0;
+    int result = SUCCESS;
+
+    if (link_job_count == 0) {
+        return SUCCESS;
+    }
+
+    // link()는 대부분 메타데이터 I/O 대기이므로 CPU 수가 아니라 -j 만큼 동시에 실행
+    parallel_for(link_job_run, link_jobs, link_job_count, opts->threads);
+
+    for (size_t i = 0; i < link_job_count; i++) {
+        link_job_t *job = &link_jobs[i];
+
+        if (job->error == 0) {
+            linked++;
+        } else {
+            log_debug("하드 링크 실패, 복사합니다: %s (%s)", job->to, strerror(job->error));
+            link_bypass = 1;
+            if (backup_file(job->source, job->dest, opts) != SUCCESS) {
+                result = ERROR_FILE_WRITE;
+            }
+            link_bypass = 0;
+        }
+        free(job->from);
+        free(job->to);
+        free(job->source);
+        free(job->dest);
+    }
+    link_job_count = 0;
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.files_linked += linked;
+    pthread_mutex_unlock(&g_stats_mutex);
+    return result;
+}
+
+// 백업 중 계산한 원본 해시를 캐시에 기록 (읽는 동안 파일이 바뀌었으면 기록하지 않음)
+static void remember_source_hash(const char *source, const struct stat *before, checksum_type_t type,
+                                 const char *hex) {
+    struct stat after;
+
+    if (stat(source, &after) != 0 || after.st_size != before->st_size ||
+        after.st_mtim.tv_sec != before->st_mtim.tv_sec || after.st_mtim.tv_nsec != before->st_mtim.tv_nsec ||
+        after.st_ctim.tv_sec != before->st_ctim.tv_sec || after.st_ctim.tv_nsec != before->st_ctim.tv_nsec) {
+        return;
+    }
+    hash_cache_store(&after, type, hex);
+}
+
+// 링크 배치에 추가 (1): from은 이전 데이터 파일, entry는 새 백업에 기록할 항목
+static int queue_link(const char *from, const char *source, const char *dest, const index_entry_t *entry,
+                      const backup_options_t *opts) {
+    char to[MAX_PATH];
+    link_job_t *job;
+
+    // 경로가 너무 길거나 충돌이면 일반 복사 경로에서 처리
+    if ((size_t)snprintf(to, sizeof(to), "%s", dest) >= sizeof(to) ||
+        append_compression_extension(to, sizeof(to), opts->compression) != SUCCESS || file_exists(to)) {
+        return 0;
+    }
+
+    if (opts->dry_run) {
+        printf("DRY RUN: %s => %s (하드 링크)\n", from, to);
+        pthread_mutex_lock(&g_stats_mutex);
+        g_stats.files_linked++;
+        pthread_mutex_unlock(&g_stats_mutex);
+        return 1;
+    }
+
+    if (!link_jobs) {
+        link_jobs = malloc(LINK_BATCH_SIZE * sizeof(link_job_t));
+        if (!link_jobs) return 0;
+    }
+
+    job = &link_jobs[link_job_count];
+    memset(job, 0, sizeof(*job));
+    job->from = strdup(from);
+    job->to = strdup(to);
+    job->source = strdup(source);
+    job->dest = strdup(dest);
+    if (!job->from || !job->to || !job->source || !job->dest) {
+        free(job->from);
+        free(job->to);
+        free(job->source);
+        free(job->dest);
+        return 0;
+    }
+    job->entry = *entry;
+
+    if (++link_job_count == LINK_BATCH_SIZE && flush_link_batch(opts) != SUCCESS) {
+        link_flush_failed = 1;
+    }
+    return 1;
+}
+
+// 이전 항목을 현재 메타데이터로 갱신해 이 백업의 파일로 기록할 항목을 만듦 (데이터는 링크로 가져옴)
+static void linked_entry(index_entry_t *entry, const struct stat *st, const backup_options_t *opts) {
+    checksum_type_t algorithm = opts->calculate_checksum ? opts->checksum_algorithm : CHECKSUM_NONE;
+
+    entry->mtime = st->st_mtime;
+    entry->mtime_nsec = st->st_mtim.tv_nsec;
+    entry->inode = (uint64_t)st->st_ino;
+    entry->file_mode = (uint32_t)st->st_mode;
+    entry->origin[0] = '\0';
+    entry->offset = 0;
+    if (reference_index.checksum_type != algorithm) {
+        entry->checksum[0] = '\0';
+    }
+}
+
+// 이전 스냅샷에 같은 압축 형식으로 통째로 저장된, 내용과 권한이 같은 파일이면 링크 배치에 추가 (1)
+static int queue_link_file(const char *source, const char *dest, const struct stat *st,
+                           const backup_options_t *opts) {
+    size_t root_len = strlen(active_backup_root);
+    char from[MAX_PATH];
+    index_entry_t previous;
+
+    if (!find_reference_entry(dest, &previous) || previous.type != 'F' || previous.origin[0] != '\0' ||
+        previous.codec != (uint8_t)opts->compression || !entry_unchanged(&previous, st) ||
+        (previous.file_mode != 0 && previous.file_mode != (uint32_t)st->st_mode)) {
+        return 0;
+    }
+
+    if ((size_t)snprintf(from, sizeof(from), "%s/%s", opts->link_dest, dest + root_len + 1) >= sizeof(from) ||
+        append_compression_extension(from, sizeof(from), opts->compression) != SUCCESS) {
+        return 0;
+    }
+    linked_entry(&previous, st, opts);
+    return queue_link(from, source, dest, &previous, opts);
+}
+
+static uint64_t move_slot_hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static void move_table_insert(move_slot_t *table, uint64_t key, size_t pos) {
+    size_t mask = move_capacity - 1;
+    size_t i = (size_t)move_slot_hash(key) & mask;
+
+    while (table[i].pos != 0) {
+        i = (i + 1) & mask;
+    }
+    table[i].key = key;
+    table[i].pos = pos + 1;
+}
+
+// 기준 인덱스의 파일 항목 전체를 한 번 훑어 inode 표와 크기 표를 만듦
+static int build_move_tables(void) {
+    index_entry_t entry;
+    char path[MAX_PATH];
+
+    move_table_state = -1;
+    move_capacity = 16;
+    while (move_capacity < reference_index.count * 2) {
+        move_capacity <<= 1;
+    }
+    if (move_capacity * 2 * sizeof(move_slot_t) > memory_budget(MEMORY_SHARE_MOVES)) {
+        log_info("이동 감지 표가 메모리 예산을 넘어 사용하지 않습니다 (기준 항목 %zu개)", reference_index.count);
+        return 0;
+    }
+    moves_by_inode = calloc(move_capacity, sizeof(move_slot_t));
+    moves_by_size = calloc(move_capacity, sizeof(move_slot_t));
+    if (!moves_by_inode || !moves_by_size) {
+        log_warning("메모리 부족으로 이동 감지를 사용하지 않습니다");
+        return 0;
+    }
+
+    for (size_t pos = 0; pos < reference_index.count; pos++) {
+        if (!backup_index_get(&reference_index, pos, &entry, path, sizeof(path)) ||
+            (entry.type != 'F' && entry.type != 'C' && entry.type != 'X')) {
+            continue;
+        }
+        if (entry.inode != 0) {
+            move_table_insert(moves_by_inode, entry.inode, pos);
+        }
+        if (entry.checksum[0] != '\0') {
+            move_table_insert(moves_by_size, (uint64_t)entry.size, pos);
+        }
+    }
+
+    move_table_state = 1;
+    return 1;
+}
+
+static void free_move_tables(void) {
+    free(moves_by_inode);
+    free(moves_by_size);
+    moves_by_inode = NULL;
+    moves_by_size = NULL;
+    move_capacity = 0;
+    move_table_state = 0;
+}
+
+// 새 경로의 파일과 같은 데이터를 가진 기준 백업 항목 찾기:
+// 같은 inode + 크기 + 수정 시간(ns)이면 이름만 바뀐 파일, 아니면 같은 크기 후보가 있을 때만 내용 해시로 비교
+static int find_moved_entry(const char *source, const struct stat *st, const backup_options_t *opts,
+                            index_entry_t *found, char *path, size_t path_size) {
+    size_t mask, i;
+    int candidates = 0;
+    char hex[MAX_DIGEST_HEX];
+
+    if (move_table_state == 0) {
+        build_move_tables();
+    }
+    if (move_table_state != 1) {
+        return 0;
+    }
+    mask = move_capacity - 1;
+
+    for (i = (size_t)move_slot_hash((uint64_t)st->st_ino) & mask; moves_by_inode[i].pos != 0; i = (i + 1) & mask) {
+        if (moves_by_inode[i].key == (uint64_t)st->st_ino &&
+            backup_index_get(&reference_index, moves_by_inode[i].pos - 1, found, path, path_size) &&
+            entry_unchanged(found, st)) {
+            return 1;
+        }
+    }
+
+    // 내용 비교는 같은 알고리즘의 체크섬이 기록된 기준 백업에서만 (파일을 한 번 더 읽으므로 후보가 있을 때만)
+    if (!opts->calculate_checksum || reference_index.checksum_type != opts->checksum_algorithm ||
+        st->st_size == 0) {
+        return 0;
+    }
+    for (i = (size_t)move_slot_hash((uint64_t)st->st_size) & mask; moves_by_size[i].pos != 0; i = (i + 1) & mask) {
+        if (moves_by_size[i].key == (uint64_t)st->st_size) {
+            candidates++;
+        }
+    }
+    if (candidates == 0) {
+        return 0;
+    }
+
+    if (!hash_cache_lookup(st, opts->checksum_algorithm, hex)) {
+        if (checksum_file(source, COMPRESS_NONE, opts->checksum_algorithm, hex, NULL) != SUCCESS) {
+            return 0;
+        }
+        remember_source_hash(source, st, opts->checksum_algorithm, hex);
+    }
+
+    for (i = (size_t)move_slot_hash((uint64_t)st->st_size) & mask; moves_by_size[i].pos != 0; i = (i + 1) & mask) {
+        if (moves_by_size[i].key == (uint64_t)st->st_size &&
+            backup_index_get(&reference_index, moves_by_size[i].pos - 1, found, path, path_size) &&
+            found->size == (size_t)st->st_size && strcmp(found->checksum, hex) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 이름이 바뀌거나 옮겨진 파일: 기준 백업의 데이터를 다시 복사하지 않고 참조 (1)
+// 'C'/'X'는 경로와 무관한 저장 위치를 그대로 이어받고, 'F'는 이전 백업의 파일을 새 경로로 하드 링크
+static int backup_moved_file(const char *source, const char *dest, const struct stat *st,
+                             const backup_options_t *opts) {
+    char path[MAX_PATH];
+    char from[MAX_PATH];
+    index_entry_t found;
+
+    if (!find_moved_entry(source, st, opts, &found, path, sizeof(path))) {
+        return 0;
+    }
+
+    if (found.type == 'F') {
+        if (found.codec != (uint8_t)opts->compression || (link_dest_active && found.origin[0] != '\0')) {
+            return 0;
+        }
+        int len;
+
+        if (link_dest_active) {
+            len = snprintf(from, sizeof(from), "%s/%s", opts->link_dest, path);
+        } else {
+            len = snprintf(from, sizeof(from), "%s/%s/%s", active_chain,
+                           found.origin[0] ? found.origin : reference_name, path);
+        }
+        // 이전 데이터 경로가 너무 길면 옮겨진 파일로 다루지 않고 복사
+        if ((size_t)len >= sizeof(from) || append_compression_extension(from, sizeof(from), opts->compression) != SUCCESS) {
+            return 0;
+        }
+        linked_entry(&found, st, opts);
+        if (!queue_link(from, source, dest, &found, opts)) {
+            return 0;
+        }
+    } else {
+        // 청크 레시피와 델타 레코드는 체인 안에서만 찾을 수 있음
+        if (link_dest_active) {
+            return 0;
+        }
+        if (opts->dry_run) {
+            printf("DRY RUN: %s => %s (이동, 이전 데이터 재사용)\n", source, dest);
+        } else {
+            record_unchanged_file(dest, &found, st, opts);
+        }
+    }
+
+    log_debug("이동 감지: %s (이전 경로: %s)", source, path);
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.files_moved++;
+    g_stats.bytes_moved += (size_t)st->st_size;
+    pthread_mutex_unlock(&g_stats_mutex);
+    return 1;
+}
+
+// 중복 제거 모드: 파일을 청크 저장소에 넣고 레시피 위치를 인덱스에 기록 (백업 디렉토리에는 파일 없음)
+static int backup_file_chunked(const char *source, const char *dest, const struct stat *src_stat,
+                               const backup_options_t *opts) {
+    checksum_ctx_t hash;
+    checksum_ctx_t *hash_ptr = NULL;
+    index_entry_t index_entry;
+    uint64_t offset = 0, size = 0, stored = 0;
+    uint64_t t;
+    int result;
+
+    if (opts->verbose) {
+        printf("백업: %s -> %s (청크)\n", source, dest);
+    }
+
+    if (opts->calculate_checksum) {
+        checksum_init(&hash, opts->checksum_algorithm);
+        hash_ptr = &hash;
+    }
+
+    // 읽기/청킹/압축/쓰기가 한 흐름이므로 파일 전체를 압축 단계로 계산
+    t = metrics_now();
+    result = chunk_store_backup_file(active_chunk_store, source, hash_ptr, &offset, &size, &stored);
+    metrics_lap(METRIC_COMPRESS, &t, (size_t)size);
+    if (result != SUCCESS) {
+        log_error("파일 백업 실패: %s", source);
+        pthread_mutex_lock(&g_stats_mutex);
+        g_stats.files_failed++;
+        pthread_mutex_unlock(&g_stats_mutex);
+        return result;
+    }
+
+    memset(&index_entry, 0, sizeof(index_entry));
+    index_entry.type = 'C';
+    index_entry.size = (size_t)size;
+    index_entry.mtime = src_stat->st_mtime;
+    index_entry.mtime_nsec = src_stat->st_mtim.tv_nsec;
+    index_entry.inode = (uint64_t)src_stat->st_ino;
+    index_entry.file_mode = (uint32_t)src_stat->st_mode;
+    index_entry.codec = COMPRESS_NONE;   // 청크마다 codec을 따로 기록
+    index_entry.offset = offset;
+    if (hash_ptr) {
+        checksum_final_hex(&hash, index_entry.checksum);
+        remember_source_hash(source, src_stat, opts->checksum_algorithm, index_entry.checksum);
+    }
+    backup_index_record(dest, &index_entry);
+    metrics_lap(METRIC_METADATA, &t, 0);
+    metrics_count(METRIC_COMPRESS, 0, 1);
+    metrics_count(METRIC_METADATA, 0, 1);
+    metrics_codec(opts->compression, (size_t)size, (size_t)stored);
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.files_processed++;
+    g_stats.bytes_processed += size;
+    g_stats.bytes_compressed += stored;
+    pthread_mutex_unlock(&g_stats_mutex);
+
+    if (opts->progress) {
+        update_progress(g_stats.files_processed, g_stats.bytes_processed);
+    }
+
+    log_debug("파일 백업 완료: %s -> %s (청크 저장소)", source, dest);
+    return SUCCESS;
+}
+
+// 변경된 큰 파일: 기준 백업에 있는 이전 버전 대비 델타만 기록 (실패하거나 이득이 없으면 호출자가 전체 복사)
+static int backup_file_delta(const char *source, const char *dest, const struct stat *src_stat,
+                             const index_entry_t *previous, const backup_options_t *opts) {
+    const char *holder = previous->origin[0] ? previous->origin : reference_name;
+    const char *rel = dest + strlen(active_backup_root) + 1;
+    char base_name[BACKUP_NAME_MAX];
+    char base_path[MAX_PATH];
+    uint8_t base_codec;
+    checksum_ctx_t hash;
+    checksum_ctx_t *hash_ptr = NULL;
+    index_entry_t index_entry;
+    uint64_t offset = 0, size = 0, stored = 0;
+    uint64_t t;
+    int result;
+
+    if (previous->type == 'F') {
+        if ((size_t)snprintf(base_name, sizeof(base_name), "%s", holder) >= sizeof(base_name) ||
+            (size_t)snprintf(base_path, sizeof(base_path), "%s", rel) >= sizeof(base_path) ||
+            append_compression_extension(base_path, sizeof(base_path), (compression_type_t)previous->codec) != SUCCESS) {
+            return ERROR_INVALID_PARAMS;
+        }
+        base_codec = previous->codec;
+    } else if (previous->type == 'X') {
+        // 이전 버전도 델타면 같은 원본 기준을 사용 (복원은 항상 기준 + 델타 한 단계)
+        char holder_path[MAX_PATH];
+
+        if ((size_t)snprintf(holder_path, sizeof(holder_path), "%s/%s", active_chain, holder) >= sizeof(holder_path)) {
+            return ERROR_INVALID_PARAMS;
+        }
+        if (delta_record_base(holder_path, previous->offset, base_name, sizeof(base_name),
+                              base_path, sizeof(base_path), &base_codec) != SUCCESS) {
+            return ERROR_FILE_NOT_FOUND;
+        }
+    } else {
+        return ERROR_GENERAL;
+    }
+
+    if (opts->calculate_checksum) {
+        checksum_init(&hash, opts->checksum_algorithm);
+        hash_ptr = &hash;
+    }
+
+    t = metrics_now();
+    result = delta_backup_file(source, active_chain, base_name, base_path, (compression_type_t)base_codec,
+                               opts->threads, hash_ptr, &offset, &size, &stored);
+    metrics_lap(METRIC_COMPRESS, &t, (size_t)size);
+    if (result != SUCCESS) {
+        return result;
+    }
+
+    if (opts->verbose) {
+        printf("백업: %s -> %s (델타, 기준 %s, %llu bytes)\n", source, dest, base_name,
+               (unsigned long long)stored);
+    }
+
+    memset(&index_entry, 0, sizeof(index_entry));
+    index_entry.type = 'X';
+    index_entry.size = (size_t)size;
+    index_entry.mtime = src_stat->st_mtime;
+    index_entry.mtime_nsec = src_stat->st_mtim.tv_nsec;
+    index_entry.inode = (uint64_t)src_stat->st_ino;
+    index_entry.file_mode = (uint32_t)src_stat->st_mode;
+    index_entry.codec = COMPRESS_NONE;
+    index_entry.offset = offset;
+    if (hash_ptr) {
+        checksum_final_hex(&hash, index_entry.checksum);
+        remember_source_hash(source, src_stat, opts->checksum_algorithm, index_entry.checksum);
+    }
+    backup_index_record(dest, &index_entry);
+    metrics_lap(METRIC_METADATA, &t, 0);
+    metrics_count(METRIC_COMPRESS, 0, 1);
+    metrics_count(METRIC_METADATA, 0, 1);
+    metrics_codec(opts->compression, (size_t)size, (size_t)stored);
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.files_processed++;
+    g_stats.bytes_processed += size;
+    g_stats.bytes_compressed += stored;
+    pthread_mutex_unlock(&g_stats_mutex);
+
+    if (opts->progress) {
+        update_progress(g_stats.files_processed, g_stats.bytes_processed);
+    }
+
+    log_debug("파일 백업 완료: %s -> %s (델타)", source, dest);
+    return SUCCESS;
+}
+
+static int backup_one_file(const char *source, const char *dest, const backup_options_t *opts) {
     struct stat src_stat;
+    index_entry_t moved;
     char final_dest[MAX_PATH];
     int counter = 1;
+    uint64_t t = metrics_now();
     
     if (stat(source, &src_stat) != 0) {
         log_error("파일 정보를 가져올 수 없습니다: %s", source);
         return ERROR_FILE_OPEN;
     }
+    metrics_lap(METRIC_SCAN, &t, 0);
 
-    if (!should_include_file(source, opts)) {
+    if (!should_include_stat(source, &src_stat, opts)) {
         log_debug("파일 제외: %s", source);
         pthread_mutex_lock(&g_stats_mutex);
         g_stats.files_skipped++;
@@ -20,20 +694,51 @@ int backup_file(const char *source, const char *dest, const backup_options_t *op
         return SUCCESS;
     }
 
+    if (link_dest_active && !link_bypass && queue_link_file(source, dest, &src_stat, opts)) {
+        return SUCCESS;
+    }
+    if (link_dest_active && !link_bypass && !find_reference_entry(dest, &moved) &&
+        backup_moved_file(source, dest, &src_stat, opts)) {
+        return SUCCESS;
+    }
+
+    // 증분/차등 모드: 기준 백업 이후 바뀌지 않은 파일은 읽지 않고, 바뀐 큰 파일은 델타로 저장
+    if (reference_loaded && !link_dest_active) {
+        index_entry_t previous;
+
+        if (!find_reference_entry(dest, &previous)) {
+            // 새 경로: 다른 경로에서 옮겨 온 파일이면 이전 데이터를 재사용
+            if (!link_bypass && backup_moved_file(source, dest, &src_stat, opts)) {
+                return SUCCESS;
+            }
+        } else if (entry_unchanged(&previous, &src_stat)) {
+            log_debug("변경 없음: %s (%s)", source, previous.origin[0] ? previous.origin : reference_name);
+            if (!opts->dry_run) {
+                record_unchanged_file(dest, &previous, &src_stat, opts);
+            }
+            pthread_mutex_lock(&g_stats_mutex);
+            g_stats.files_unchanged++;
+            pthread_mutex_unlock(&g_stats_mutex);
+            return SUCCESS;
+        } else if (delta_active && !active_chunk_store && src_stat.st_size >= DELTA_MIN_FILE_SIZE) {
+            if (backup_file_delta(source, dest, &src_stat, &previous, opts) == SUCCESS) {
+                return SUCCESS;
+            }
+            log_debug("델타 대신 전체 복사: %s", source);
+        }
+    }
+
+    if (active_chunk_store) {
+        return backup_file_chunked(source, dest, &src_stat, opts);
+    }
+
     strncpy(final_dest, dest, sizeof(final_dest) - 1);
     final_dest[sizeof(final_dest) - 1] = '\0';
 
     // 압축 확장자 추가
-    if (opts->compression != COMPRESS_NONE) {
-        const char *ext = get_compression_extension(opts->compression);
-        
-        // 이미 올바른 확장자가 있는지 확인
-        size_t dest_len = strlen(final_dest);
-        size_t ext_len = strlen(ext);
-        
-        if (dest_len < ext_len || strcmp(final_dest + dest_len - ext_len, ext) != 0) {
-            strncat(final_dest, ext, sizeof(final_dest) - strlen(final_dest) - 1);
-        }
+    if (append_compression_extension(final_dest, sizeof(final_dest), opts->compression) != SUCCESS) {
+        log_error("경로가 너무 깁니다: %s", dest);
+        return ERROR_INVALID_PARAMS;
     }
 
     // 충돌 처리
@@ -90,12 +795,20 @@ int backup_file(const char *source, const char *dest, const backup_options_t *op
         printf("백업: %s -> %s\n", source, final_dest);
     }
 
-    // 실제 백업 수행
+    // 실제 백업 수행 (체크섬은 복사/압축 중 같은 읽기에서 계산)
     int result;
+    checksum_ctx_t hash;
+    checksum_ctx_t *hash_ptr = NULL;
+
+    if (opts->calculate_checksum) {
+        checksum_init(&hash, opts->checksum_algorithm);
+        hash_ptr = &hash;
+    }
+
     if (opts->compression != COMPRESS_NONE) {
-        result = compress_file(source, final_dest, opts->compression);
+        result = compress_file_ex(source, final_dest, opts->compression, hash_ptr);
     } else {
-        result = copy_file_simple(source, final_dest);
+        result = copy_file_hashed(source, final_dest, hash_ptr);
     }
 
     if (result != SUCCESS) {
@@ -107,23 +820,47 @@ int backup_file(const char *source, const char *dest, const backup_options_t *op
     }
 
     // 메타데이터 복사
+    t = metrics_now();
     if (opts->preserve_permissions || opts->preserve_timestamps) {
         copy_file_metadata(source, final_dest);
     }
 
+    // 인덱스 기록 (경로는 압축 확장자를 뺀 백업 경로)
+    char index_path[MAX_PATH];
+    index_entry_t index_entry;
+
+    memset(&index_entry, 0, sizeof(index_entry));
+    index_entry.type = 'F';
+    index_entry.size = src_stat.st_size;
+    index_entry.mtime = src_stat.st_mtime;
+    index_entry.mtime_nsec = src_stat.st_mtim.tv_nsec;
+    index_entry.inode = (uint64_t)src_stat.st_ino;
+    index_entry.file_mode = (uint32_t)src_stat.st_mode;
+    index_entry.codec = (uint8_t)opts->compression;
+
+    snprintf(index_path, sizeof(index_path), "%s", final_dest);
+    strip_compression_extension(index_path, opts->compression);
+    if (hash_ptr) {
+        index_entry.size = (size_t)hash.total_len;
+        checksum_final_hex(&hash, index_entry.checksum);
+        remember_source_hash(source, &src_stat, opts->checksum_algorithm, index_entry.checksum);
+    }
+    backup_index_record(index_path, &index_entry);
+    metrics_lap(METRIC_METADATA, &t, 0);
+    metrics_count(METRIC_METADATA, 0, 1);
+
     // 통계 업데이트
+    size_t stored = (size_t)src_stat.st_size;
+    if (opts->compression != COMPRESS_NONE) {
+        struct stat dest_stat;
+        stored = stat(final_dest, &dest_stat) == 0 ? (size_t)dest_stat.st_size : 0;
+    }
+    metrics_codec(opts->compression, (size_t)src_stat.st_size, stored);
+
     pthread_mutex_lock(&g_stats_mutex);
     g_stats.files_processed++;
     g_stats.bytes_processed += src_stat.st_size;
-    
-    if (opts->compression != COMPRESS_NONE) {
-        struct stat dest_stat;
-        if (stat(final_dest, &dest_stat) == 0) {
-            g_stats.bytes_compressed += dest_stat.st_size;
-        }
-    } else {
-        g_stats.bytes_compressed += src_stat.st_size;
-    }
+    g_stats.bytes_compressed += stored;
     pthread_mutex_unlock(&g_stats_mutex);
 
     // 진행률 업데이트
@@ -135,6 +872,16 @@ int backup_file(const char *source, const char *dest, const backup_options_t *op
     return SUCCESS;
 }
 
+// 파일 하나 백업: 단계 시간을 파일별 지연 히스토그램과 느린 파일 목록에 기록
+int backup_file(const char *source, const char *dest, const backup_options_t *opts) {
+    int result;
+
+    metrics_file_begin();
+    result = backup_one_file(source, dest, opts);
+    metrics_file_end(source);
+    return result;
+}
+
 int backup_directory(const char *source, const char *dest, const backup_options_t *opts) {
     // 대상 디렉토리 생성
     if (!file_exists(dest)) {
@@ -151,154 +898,1141 @@ int backup_directory(const char *source, const char *dest, const backup_options_
     return SUCCESS;
 }
 
-int backup_directory_recursive(const char *source, const char *dest, const backup_options_t *opts) {
+static int backup_tree(const char *source, const char *dest, const struct stat *dir_stat, int allow_skip,
+                       const backup_options_t *opts, uint64_t *summary);
+
+// 백업 원본 기준 상대 경로 (원본 자체는 "")
+static const char *source_rel(const char *src_path) {
+    if (strncmp(src_path, active_source, active_source_len) != 0 || src_path[active_source_len] == '\0') {
+        return "";
+    }
+    return src_path + active_source_len + (src_path[active_source_len] == '/');
+}
+
+static int walk_excluded(const char *rel, const char *name, int is_dir, const backup_options_t *opts) {
+    if (is_dir && is_excluded_directory(active_source_abs, rel, name, opts)) {
+        return 1;
+    }
+    return ignore_excluded(rel, name, is_dir);
+}
+
+// 하위 트리의 모든 디렉토리가 기준 백업과 같은지 (파일은 stat 하지 않음)
+static int subtree_directories_unchanged(const char *source, const char *rel, size_t first, size_t last) {
+    size_t rel_len = strlen(rel);
+
+    for (size_t pos = first; pos < last; pos++) {
+        index_entry_t entry;
+        char path[MAX_PATH];
+        char src_path[MAX_PATH];
+        struct stat st;
+
+        if (!backup_index_get(&reference_index, pos, &entry, path, sizeof(path))) {
+            return 0;
+        }
+        if (entry.type != 'D') {
+            continue;
+        }
+
+        snprintf(src_path, sizeof(src_path), "%s%s", source, path + rel_len);
+        if (stat(src_path, &st) != 0 || !directory_unchanged(&entry, &st)) {
+            log_debug("변경된 디렉토리: %s", src_path);
+            snprintf(subtree_changed, sizeof(subtree_changed), "%s", path);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 변경 감시 모드에서 바뀐 디렉토리 집합 지정 (NULL = 해제). 지정되면 집합에 없는 하위 트리는
+// 디렉토리 시간 확인 없이 기준 백업에서 이어받음
+void backup_set_dirty_set(const path_set_t *dirty) {
+    active_dirty_set = dirty;
+}
+
+// 이어받을 하위 트리를 목록에 추가 (메모리가 없으면 0: 호출자는 건너뛰지 않고 걸음)
+static int remember_skipped_subtree(const char *source, const char *dest) {
+    skipped_subtree_t *item;
+
+    if (skipped_subtree_count == skipped_subtree_capacity) {
+        size_t capacity = skipped_subtree_capacity ? skipped_subtree_capacity * 2 : 64;
+        skipped_subtree_t *grown = realloc(skipped_subtrees, capacity * sizeof(skipped_subtree_t));
+
+        if (!grown) return 0;
+        skipped_subtrees = grown;
+        skipped_subtree_capacity = capacity;
+    }
+
+    item = &skipped_subtrees[skipped_subtree_count];
+    item->source = strdup(source);
+    item->dest = strdup(dest);
+    item->inherited = 0;
+    if (!item->source || !item->dest) {
+        free(item->source);
+        free(item->dest);
+        return 0;
+    }
+    skipped_subtree_count++;
+    return 1;
+}
+
+static void forget_skipped_subtrees(void) {
+    for (size_t i = 0; i < skipped_subtree_count; i++) {
+        free(skipped_subtrees[i].source);
+        free(skipped_subtrees[i].dest);
+    }
+    free(skipped_subtrees);
+    skipped_subtrees = NULL;
+    skipped_subtree_count = 0;
+    skipped_subtree_capacity = 0;
+    subtree_recheck = 0;
+}
+
+// 변경 없는 하위 트리를 기준 백업에서 통째로 이어받음. 이어받았거나 표본 검사로 대신 백업했으면 1
+// (*summary, *result 채움), 건너뛸 수 없으면 0.
+// 조건: 기준 백업의 매니페스트에 이 디렉토리의 요약이 있고, 하위의 모든 디렉토리 시간이 같거나
+// 변경 감시 집합에 없을 것. 파일을 제자리에서 고치면 디렉토리 시간이 바뀌지 않으므로, 표본 모드는
+// 일부 하위 트리를 실제로 걸어 요약을 비교하고 다르면 이번 실행의 건너뛰기를 끔. 이미 이어받은
+// 하위 트리는 백업을 마치기 전에 다시 걷고 (recheck_skipped_subtrees), 그 상위 디렉토리 요약은
+// 이어받은 요약으로 계산됐으므로 매니페스트에 남기지 않습니다 (다음 실행은 전체를 걸음).
+static int try_skip_subtree(const char *source, const char *dest, const struct stat *st,
+                            const backup_options_t *opts, uint64_t *summary, int *result) {
+    size_t root_len = strlen(active_backup_root);
+    index_entry_t dir_entry;
+    const char *rel;
+    size_t rel_len, first, last;
+    size_t inherited = 0;
+    char pruned[MAX_PATH];
+    size_t pruned_len = 0;
+    int failed = SUCCESS;
+
+    if (!subtree_skip_active || strncmp(dest, active_backup_root, root_len) != 0 || dest[root_len] != '/') {
+        return 0;
+    }
+    rel = dest + root_len + 1;
+    rel_len = strlen(rel);
+
+    if (active_dirty_set) {
+        // 감시 이벤트가 있었던 디렉토리(또는 그 상위)만 걷고 나머지는 이어받음
+        if (path_set_contains(active_dirty_set, rel) ||
+            !backup_index_lookup(&reference_index, rel, &dir_entry) || dir_entry.type != 'D' ||
+            dir_entry.offset == 0 || !backup_index_subtree(&reference_index, rel, &first, &last)) {
+            return 0;
+        }
+    } else if (/* 상위 트리 검사에서 이 안의 바뀐 디렉토리를 이미 찾음 */
+               (strncmp(subtree_changed, rel, rel_len) == 0 &&
+                (subtree_changed[rel_len] == '\0' || subtree_changed[rel_len] == '/')) ||
+               !backup_index_lookup(&reference_index, rel, &dir_entry) || dir_entry.type != 'D' ||
+               dir_entry.offset == 0 || !directory_unchanged(&dir_entry, st) ||
+               !backup_index_subtree(&reference_index, rel, &first, &last) ||
+               !subtree_directories_unchanged(source, rel, first, last)) {
+        return 0;
+    }
+
+    if (!active_dirty_set && opts->skip_subtrees == SUBTREE_SKIP_SAMPLE &&
+        XXH3_64bits_withSeed(rel, rel_len, (uint64_t)g_stats.start_time) % 100 < (uint64_t)opts->skip_sample_percent) {
+        pthread_mutex_lock(&g_stats_mutex);
+        g_stats.subtrees_checked++;
+        pthread_mutex_unlock(&g_stats_mutex);
+
+        *result = backup_tree(source, dest, st, 0, opts, summary);
+        if (*result == SUCCESS && *summary != dir_entry.offset) {
+            log_warning("하위 트리 표본 검사 불일치: %s (디렉토리 시간으로 감지되지 않는 변경이 있어 이번 백업에서는 하위 트리를 건너뛰지 않습니다)",
+                        source);
+            subtree_skip_active = 0;
+
+            // 이미 이어받은 하위 트리도 같은 변경을 놓쳤을 수 있음: 끝에서 다시 걸음
+            subtree_recheck = skipped_subtree_count > 0;
+            log_warning("다음 백업은 하위 트리를 건너뛰지 않고 전체를 확인합니다");
+            backup_index_drop_summaries();
+        }
+        return 1;
+    }
+
+    if (backup_directory(source, dest, opts) != SUCCESS || !remember_skipped_subtree(source, dest)) {
+        return 0;
+    }
+
+    for (size_t pos = first; pos < last; pos++) {
+        index_entry_t entry;
+        char path[MAX_PATH];
+        char src_path[MAX_PATH];
+        char backup_path[MAX_PATH];
+        const char *name;
+
+        if (!backup_index_get(&reference_index, pos, &entry, path, sizeof(path))) {
+            continue;
+        }
+        if (pruned_len && strncmp(path, pruned, pruned_len) == 0 && path[pruned_len] == '/') {
+            continue;
+        }
+        if ((size_t)snprintf(src_path, sizeof(src_path), "%s%s", source, path + rel_len) >= sizeof(src_path) ||
+            (size_t)snprintf(backup_path, sizeof(backup_path), "%s/%s", active_backup_root, path) >= sizeof(backup_path)) {
+            log_error("경로가 너무 깁니다: %s/%s", active_backup_root, path);
+            failed = ERROR_INVALID_PARAMS;
+            continue;
+        }
+        name = strrchr(path, '/');
+        name = name ? name + 1 : path;
+
+        // 기준 백업 뒤에 추가된 제외 디렉토리/상위 제외 파일 규칙 (하위 트리 안의 제외 파일은 기준 백업에 이미 반영됨)
+        if (walk_excluded(path, name, entry.type == 'D', opts)) {
+            log_debug("제외 (하위 트리 포함): %s", src_path);
+            if (entry.type == 'D') {
+                snprintf(pruned, sizeof(pruned), "%s", path);
+                pruned_len = strlen(pruned);
+            }
+            continue;
+        }
+
+        if (entry.type == 'D') {
+            backup_directory(src_path, backup_path, opts);
+            backup_index_record(backup_path, &entry);
+        } else if (is_excluded_path(src_path, opts) || entry.size > opts->max_file_size) {
+            log_debug("파일 제외: %s", src_path);
+        } else {
+            inherit_reference_entry(backup_path, &entry, opts);
+            inherited++;
+        }
+    }
+    backup_index_record(dest, &dir_entry);
+    skipped_subtrees[skipped_subtree_count - 1].inherited = inherited;
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.files_unchanged += inherited;
+    g_stats.subtrees_skipped++;
+    pthread_mutex_unlock(&g_stats_mutex);
+
+    log_debug("변경 없는 하위 트리: %s (파일 %zu개)", source, inherited);
+    *summary = dir_entry.offset;
+    *result = failed;
+    return 1;
+}
+
+// 순회 중인 디렉토리마다의 백업 상태 (walk_data)
+typedef struct {
+    tree_summary_t children;
+    struct stat st;
+    int has_stat;
+    int result;
+    int ignoring;                 // 이 디렉토리의 제외 파일을 스택에 올렸는지
+    size_t total_files;           // 진행률 표시용
+    size_t current_file;
+} backup_frame_t;
+
+// 진행률 표시용으로 디렉토리 바로 아래 파일 수와 크기 계산
+static size_t count_progress_files(const char *source, const backup_options_t *opts) {
     DIR *dir;
     struct dirent *entry;
     char src_path[MAX_PATH];
-    char dest_path[MAX_PATH];
-    int result = SUCCESS;
     size_t total_files = 0;
     size_t total_bytes = 0;
 
-    // 먼저 전체 파일 수와 크기 계산 (진행률 표시용)
-    if (opts->progress) {
-        log_info("파일 스캔 중...");
-        
-        // 간단한 파일 카운팅
-        dir = opendir(source);
-        if (dir) {
-            while ((entry = readdir(dir)) != NULL) {
-                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-                    continue;
-                }
-                
-                snprintf(src_path, sizeof(src_path), "%s/%s", source, entry->d_name);
-                
-                if (should_include_file(src_path, opts)) {
-                    struct stat st;
-                    if (stat(src_path, &st) == 0 && S_ISREG(st.st_mode)) {
-                        total_files++;
-                        total_bytes += st.st_size;
-                    }
-                }
-            }
-            closedir(dir);
-            
-            log_info("총 %zu개 파일, %zu bytes", total_files, total_bytes);
-            init_progress(total_files, total_bytes);
+    log_info("파일 스캔 중...");
+
+    dir = opendir(source);
+    if (!dir) {
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        snprintf(src_path, sizeof(src_path), "%s/%s", source, entry->d_name);
+        if (stat(src_path, &st) == 0 && S_ISREG(st.st_mode) && should_include_stat(src_path, &st, opts)) {
+            total_files++;
+            total_bytes += st.st_size;
         }
     }
+    closedir(dir);
 
-    // 대상 디렉토리 생성
-    if (backup_directory(source, dest, opts) != SUCCESS) {
+    log_info("총 %zu개 파일, %zu bytes", total_files, total_bytes);
+    init_progress(total_files, total_bytes);
+    return total_files;
+}
+
+// 현재 경로의 디렉토리에 들어감: 대상 디렉토리를 만들고 항목을 읽어 스택에 올림
+static int backup_enter(dir_walk_t *walk, const struct stat *dir_stat, const backup_options_t *opts) {
+    backup_frame_t *frame;
+    size_t total_files = 0;
+
+    if (opts->progress) {
+        total_files = count_progress_files(walk->src.buf, opts);
+    }
+
+    if (backup_directory(walk->src.buf, walk->dst.buf, opts) != SUCCESS) {
         return ERROR_FILE_WRITE;
     }
 
-    // 소스 디렉토리 열기
-    dir = opendir(source);
-    if (!dir) {
-        log_error("디렉토리 열기 실패: %s", source);
+    if (walk_enter(walk) != SUCCESS) {
+        log_error("디렉토리 열기 실패: %s", walk->src.buf);
+        record_directory(walk->dst.buf, NULL, 0);
         return ERROR_FILE_OPEN;
     }
 
-    size_t current_file = 0;
-    
-    // 디렉토리 내용 순회
-    while ((entry = readdir(dir)) != NULL) {
-        // . 및 .. 건너뛰기
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+    frame = walk_data(walk);
+    if (dir_stat) {
+        frame->st = *dir_stat;
+        frame->has_stat = 1;
+    }
+    frame->total_files = total_files;
+    frame->ignoring = ignore_push(walk->src.buf, source_rel(walk->src.buf), opts);
+    return SUCCESS;
+}
+
+// 하위 디렉토리 하나를 마쳤을 때 상위 디렉토리 요약에 더함 (경로는 그 하위 디렉토리를 가리킴)
+static void backup_child_done(dir_walk_t *walk, const struct stat *st, int result, uint64_t child_summary) {
+    backup_frame_t *frame = walk_data(walk);
+
+    if (result != SUCCESS) {
+        log_warning("하위 디렉토리 백업 실패: %s", walk->src.buf);
+        frame->result = result;
+    }
+    summary_add(&frame->children, walk_name(walk), st, child_summary);
+}
+
+// 디렉토리 트리 백업. *summary에 이 디렉토리의 요약을 돌려주고 인덱스의 디렉토리 항목에도 기록
+// 재귀 대신 walk.c 의 명시적 스택으로 순회하고, 디렉토리 요약은 나올 때 상위에 더함
+static int backup_tree(const char *source, const char *dest, const struct stat *dir_stat, int allow_skip,
+                       const backup_options_t *opts, uint64_t *summary) {
+    dir_walk_t walk;
+    int result;
+
+    *summary = 0;
+
+    if (walk_init(&walk, source, dest, sizeof(backup_frame_t)) != SUCCESS) {
+        return ERROR_MEMORY;
+    }
+    result = backup_enter(&walk, dir_stat, opts);
+
+    while (result == SUCCESS && walk.depth > 0) {
+        backup_frame_t *frame = walk_data(&walk);
+        const char *name = walk_next(&walk);
+        struct stat st;
+
+        if (!name) {
+            // 디렉토리 끝: 실패한 항목이 있으면 요약을 남기지 않아 다음 백업이 이 트리를 건너뛰지 않게 함
+            uint64_t dir_summary = 0;
+            int dir_result = frame->result;
+            struct stat own = frame->st;
+            int has_stat = frame->has_stat;
+
+            if (frame->ignoring) {
+                ignore_pop();
+            }
+            if (dir_result == SUCCESS) {
+                dir_summary = summary_final(&frame->children);
+            }
+            record_directory(walk.dst.buf, has_stat ? &own : NULL, dir_summary);
+
+            if (opts->progress) {
+                printf("\n"); // 진행률 출력 후 줄바꿈
+                finish_progress();
+            }
+
+            walk_leave(&walk);
+            if (walk.depth == 0) {
+                *summary = dir_summary;
+                result = dir_result;
+                break;
+            }
+            backup_child_done(&walk, &own, dir_result, dir_summary);
             continue;
         }
 
-        // 전체 경로 생성
-        snprintf(src_path, sizeof(src_path), "%s/%s", source, entry->d_name);
-        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest, entry->d_name);
+        // 제외 디렉토리와 제외 파일 규칙은 종류만 알면 되므로 d_type 이 있으면 stat 전에 확인
+        int typed = walk.d_type != DT_UNKNOWN && walk.d_type != DT_LNK;
+        if (typed && walk_excluded(source_rel(walk.src.buf), name, walk.d_type == DT_DIR, opts)) {
+            log_debug("제외 (하위 트리 포함): %s", walk.src.buf);
+            continue;
+        }
 
-        // 제외 패턴 확인
-        if (!should_include_file(src_path, opts)) {
-            log_debug("파일 제외: %s", src_path);
+        if (stat(walk.src.buf, &st) != 0) {
+            if (!is_excluded_path(walk.src.buf, opts)) {
+                log_warning("파일 정보 가져오기 실패: %s", walk.src.buf);
+            }
             continue;
         }
 
-        struct stat st;
-        if (stat(src_path, &st) != 0) {
-            log_warning("파일 정보 가져오기 실패: %s", src_path);
+        if (!typed && walk_excluded(source_rel(walk.src.buf), name, S_ISDIR(st.st_mode), opts)) {
+            log_debug("제외 (하위 트리 포함): %s", walk.src.buf);
+            continue;
+        }
+
+        // 제외 패턴, 크기 제한 확인 (방금 한 stat 재사용)
+        if (!should_include_stat(walk.src.buf, &st, opts)) {
+            log_debug("파일 제외: %s", walk.src.buf);
             continue;
         }
 
         if (S_ISDIR(st.st_mode)) {
-            // 하위 디렉토리 재귀 처리
-            log_debug("하위 디렉토리 처리: %s", src_path);
-            int backup_result = backup_directory_recursive(src_path, dest_path, opts);
-            if (backup_result != SUCCESS) {
-                log_warning("하위 디렉토리 백업 실패: %s", src_path);
-                result = backup_result;
+            // 하위 디렉토리: 건너뛸 수 없으면 스택에 올려 이어서 순회
+            uint64_t child_summary = 0;
+            int child_result;
+
+            if (allow_skip &&
+                try_skip_subtree(walk.src.buf, walk.dst.buf, &st, opts, &child_summary, &child_result)) {
+                backup_child_done(&walk, &st, child_result, child_summary);
+                continue;
+            }
+            log_debug("하위 디렉토리 처리: %s", walk.src.buf);
+            child_result = backup_enter(&walk, &st, opts);
+            if (child_result == ERROR_MEMORY) {
+                result = child_result;
+            } else if (child_result != SUCCESS) {
+                backup_child_done(&walk, &st, child_result, 0);
             }
         } else if (S_ISREG(st.st_mode)) {
             // 일반 파일 백업
-            current_file++;
-            
-            if (opts->progress && total_files > 0) {
-                int percentage = (int)((current_file * 100) / total_files);
-                printf("진행률: %zu/%zu 파일 (%d%%)\r", current_file, total_files, percentage);
+            frame->current_file++;
+
+            if (opts->progress && frame->total_files > 0) {
+                int percentage = (int)((frame->current_file * 100) / frame->total_files);
+                printf("진행률: %zu/%zu 파일 (%d%%)\r", frame->current_file, frame->total_files, percentage);
                 fflush(stdout);
             }
-            
-            int backup_result = backup_file(src_path, dest_path, opts);
+
+            int backup_result = backup_file(walk.src.buf, walk.dst.buf, opts);
             if (backup_result != SUCCESS) {
-                log_warning("파일 백업 실패: %s", src_path);
-                result = backup_result;
+                log_warning("파일 백업 실패: %s", walk.src.buf);
+                frame->result = backup_result;
             }
+            summary_add(&frame->children, name, &st, 0);
         } else {
-            log_debug("특수 파일 건너뛰기: %s", src_path);
+            log_debug("특수 파일 건너뛰기: %s", walk.src.buf);
         }
     }
 
-    closedir(dir);
+    // 메모리 부족으로 중단하면 열린 디렉토리의 제외 파일 규칙을 모두 내림
+    while (walk.depth > 0) {
+        if (((backup_frame_t *)walk_data(&walk))->ignoring) {
+            ignore_pop();
+        }
+        walk_leave(&walk);
+    }
+    walk_free(&walk);
+    return result;
+}
 
-    if (opts->progress) {
-        printf("\n"); // 진행률 출력 후 줄바꿈
-        finish_progress();
+static void release_reference_index(void) {
+    if (reference_loaded) {
+        backup_index_free(&reference_index);
+        reference_loaded = 0;
     }
+    free_move_tables();
+    link_dest_active = 0;
+}
 
+// 표본 검사가 어긋난 실행: 이미 이어받은 하위 트리를 건너뛰지 않고 다시 걸어 바뀐 파일을 백업
+// (인덱스와 매니페스트 모두 같은 경로는 마지막 기록을 쓰므로 다시 기록한 항목이 이어받은 항목을 대신함)
+static int recheck_skipped_subtrees(const backup_options_t *opts) {
+    int result = SUCCESS;
+
+    log_warning("이번 백업에서 이미 이어받은 하위 트리 %zu개를 다시 확인합니다", skipped_subtree_count);
+    for (size_t i = 0; i < skipped_subtree_count; i++) {
+        const skipped_subtree_t *item = &skipped_subtrees[i];
+        struct stat st;
+        uint64_t summary = 0;
+        int tree_result;
+
+        pthread_mutex_lock(&g_stats_mutex);
+        g_stats.files_unchanged -= item->inherited;
+        g_stats.subtrees_skipped--;
+        pthread_mutex_unlock(&g_stats_mutex);
+
+        if (stat(item->source, &st) != 0) {
+            log_error("하위 트리 다시 확인 실패: %s", item->source);
+            result = ERROR_FILE_OPEN;
+            continue;
+        }
+        tree_result = backup_tree(item->source, item->dest, &st, 0, opts, &summary);
+        if (tree_result != SUCCESS && result == SUCCESS) {
+            result = tree_result;
+        }
+    }
     return result;
 }
 
+// 증분/차등 백업 준비: <dest>/full 이 있는 체인에서 기준 백업을 고르고 새 백업 디렉토리 이름을 정함
+//   차등 = 마지막 전체 백업 이후 변경분, 증분 = 체인의 가장 최근 백업 이후 변경분
+static int prepare_backup_chain(const char *chain, const backup_options_t *opts,
+                                char *target, size_t target_size) {
+    char suffix[32];
+    char reference_path[MAX_PATH];
+    char name[BACKUP_NAME_MAX];
+    const char *prefix = opts->mode == BACKUP_INCREMENTAL ? "incr" : "diff";
+    struct tm *tm_info = localtime(&g_stats.start_time);
+    int counter = 0;
+
+    if (verify_backup_chain(chain) != SUCCESS) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    if (opts->mode == BACKUP_INCREMENTAL) {
+        if (find_latest_backup(chain, reference_name, sizeof(reference_name)) != SUCCESS) {
+            return ERROR_FILE_NOT_FOUND;
+        }
+    } else {
+        snprintf(reference_name, sizeof(reference_name), "%s", BACKUP_CHAIN_FULL);
+    }
+
+    snprintf(reference_path, sizeof(reference_path), "%s/%s", chain, reference_name);
+    reference_loaded = backup_index_load(reference_path, &reference_index) == SUCCESS;
+    if (!reference_loaded) {
+        log_warning("기준 백업 인덱스가 없어 모든 파일을 복사합니다: %s", reference_path);
+    }
+
+    // 같은 초에 여러 번 실행되면 번호를 붙여 이름 순서 = 시간 순서를 유지
+    strftime(suffix, sizeof(suffix), "%Y%m%d-%H%M%S", tm_info);
+    for (;;) {
+        char incr_path[MAX_PATH], diff_path[MAX_PATH];
+
+        if (counter == 0) {
+            snprintf(name, sizeof(name), "%s", suffix);
+        } else {
+            snprintf(name, sizeof(name), "%s-%02d", suffix, counter);
+        }
+        snprintf(incr_path, sizeof(incr_path), "%s/incr-%s", chain, name);
+        snprintf(diff_path, sizeof(diff_path), "%s/diff-%s", chain, name);
+        if (!file_exists(incr_path) && !file_exists(diff_path)) {
+            break;
+        }
+        counter++;
+    }
+
+    snprintf(target, target_size, "%s/%s-%s", chain, prefix, name);
+    log_info("%s 백업: %s (기준: %s)", get_backup_mode_name(opts->mode), target, reference_name);
+    return SUCCESS;
+}
+
+// 중복 제거 백업 준비: 청크 저장소(기본: 백업 디렉토리 상위의 .chunks)와 이 백업의 레시피 파일을 엶
+// 레시피에는 기본 위치면 백업 루트 기준 상대 경로를 기록해 체인 디렉토리를 옮겨도 찾을 수 있게 함
+static int open_chunk_store(const char *target, const backup_options_t *opts) {
+    char store_path[MAX_PATH];
+    char recorded[MAX_PATH];
+
+    if (opts->chunk_store[0]) {
+        snprintf(store_path, sizeof(store_path), "%s", opts->chunk_store);
+    } else {
+        char parent[MAX_PATH];
+        char *slash;
+        size_t len;
+
+        snprintf(parent, sizeof(parent), "%s", target);
+        len = strlen(parent);
+        while (len > 1 && parent[len - 1] == '/') {
+            parent[--len] = '\0';
+        }
+        slash = strrchr(parent, '/');
+        if (!slash) {
+            snprintf(parent, sizeof(parent), ".");
+        } else if (slash == parent) {
+            parent[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+        snprintf(store_path, sizeof(store_path), "%s/%s", parent, BACKUP_CHUNK_DIR);
+    }
+
+    active_chunk_store = chunk_store_open(store_path, opts);
+    if (!active_chunk_store) {
+        return ERROR_FILE_WRITE;
+    }
+
+    if (!opts->chunk_store[0]) {
+        snprintf(recorded, sizeof(recorded), "../%s", BACKUP_CHUNK_DIR);
+    } else if (!realpath(store_path, recorded)) {
+        snprintf(recorded, sizeof(recorded), "%s", store_path);
+    }
+
+    if (recipe_file_open(target, recorded) != SUCCESS) {
+        chunk_store_close(active_chunk_store);
+        active_chunk_store = NULL;
+        return ERROR_FILE_WRITE;
+    }
+
+    log_info("중복 제거 백업: 청크 저장소 %s", store_path);
+    return SUCCESS;
+}
+
+static int close_chunk_store(void) {
+    int result;
+
+    if (!active_chunk_store) {
+        return SUCCESS;
+    }
+
+    result = recipe_file_close();
+    chunk_store_close(active_chunk_store);
+    active_chunk_store = NULL;
+    return result;
+}
+
+// 디렉토리 백업 진입점: 백업 루트에 .backup_index를 만들고 트리 전체를 기록
+// 증분/차등 모드에서는 dest가 체인 디렉토리이고 실제 백업은 그 아래 새 디렉토리에 만듦
+int backup_directory_recursive(const char *source, const char *dest, const backup_options_t *opts) {
+    char target[MAX_PATH];
+    struct stat root_stat;
+    uint64_t summary;
+    int result;
+    int index_open = 0;
+
+    if (opts->mode != BACKUP_FULL) {
+        result = prepare_backup_chain(dest, opts, target, sizeof(target));
+        if (result != SUCCESS) {
+            return result;
+        }
+        snprintf(active_chain, sizeof(active_chain), "%s", dest);
+        if (opts->link_dest[0]) {
+            log_warning("--link-dest 는 전체 백업에서만 사용합니다 (증분/차등은 체인의 기준 백업을 사용)");
+        }
+    } else {
+        snprintf(target, sizeof(target), "%s", dest);
+        if (opts->link_dest[0] && opts->dedup) {
+            log_warning("중복 제거 백업에서는 --link-dest 를 사용하지 않습니다");
+        } else if (opts->link_dest[0]) {
+            // 이전 스냅샷의 매니페스트로 변경 없는 파일을 찾아 하드 링크
+            reference_loaded = backup_index_load(opts->link_dest, &reference_index) == SUCCESS;
+            if (reference_loaded) {
+                // 체인 밖 스냅샷이라 기준 백업 이름(origin)은 쓰지 않음: 경로는 opts->link_dest
+                reference_name[0] = '\0';
+                link_dest_active = 1;
+                link_flush_failed = 0;
+                log_info("변경 없는 파일은 이전 스냅샷에서 하드 링크: %s", opts->link_dest);
+            } else {
+                log_warning("이전 스냅샷 인덱스가 없어 모든 파일을 복사합니다: %s", opts->link_dest);
+            }
+        }
+        if (opts->delta) {
+            log_warning("델타 저장은 증분/차등 백업에서만 사용합니다");
+        }
+        if (opts->skip_subtrees != SUBTREE_SKIP_OFF) {
+            log_warning("하위 트리 건너뛰기는 증분/차등 백업에서만 사용합니다");
+        }
+    }
+    snprintf(active_backup_root, sizeof(active_backup_root), "%s", target);
+    snprintf(active_source, sizeof(active_source), "%s", source);
+    active_source_len = strlen(active_source);
+    if (!realpath(source, active_source_abs)) {
+        snprintf(active_source_abs, sizeof(active_source_abs), "%s", source);
+    }
+    ignore_reset();
+
+    if (!opts->dry_run) {
+        if (!file_exists(target) && create_directory_recursive(target) != SUCCESS) {
+            log_error("디렉토리 생성 실패: %s", target);
+            release_reference_index();
+            return ERROR_FILE_WRITE;
+        }
+
+        index_open = backup_index_open(target, opts, opts->mode != BACKUP_FULL ? reference_name : NULL) == SUCCESS;
+        if (!index_open && opts->dedup) {
+            // 중복 제거 백업은 인덱스가 파일 데이터를 찾는 유일한 경로
+            log_error("백업 인덱스를 만들 수 없어 중복 제거 백업을 중단합니다: %s", target);
+            release_reference_index();
+            return ERROR_FILE_WRITE;
+        }
+        if (!index_open) {
+            log_warning("백업 인덱스 없이 계속합니다: %s", target);
+        }
+
+        if (opts->dedup && open_chunk_store(target, opts) != SUCCESS) {
+            backup_index_close();
+            release_reference_index();
+            return ERROR_FILE_WRITE;
+        }
+
+        if (opts->delta && opts->mode != BACKUP_FULL && reference_loaded && index_open && !opts->dedup) {
+            delta_active = delta_pack_open(target) == SUCCESS;
+        }
+    }
+
+    subtree_changed[0] = '\0';
+    subtree_skip_active = reference_loaded && opts->mode != BACKUP_FULL &&
+                          (opts->skip_subtrees != SUBTREE_SKIP_OFF || active_dirty_set);
+    if (subtree_skip_active && !reference_index.map) {
+        log_warning("기준 백업에 매니페스트가 없어 하위 트리를 건너뛰지 않습니다: %s", reference_name);
+        subtree_skip_active = 0;
+    }
+
+    result = backup_tree(source, target, stat(source, &root_stat) == 0 ? &root_stat : NULL, 1, opts, &summary);
+    subtree_skip_active = 0;
+    if (subtree_recheck) {
+        int recheck_result = recheck_skipped_subtrees(opts);
+
+        if (result == SUCCESS) {
+            result = recheck_result;
+        }
+    }
+    forget_skipped_subtrees();
+
+    // 링크 배치는 --link-dest 와 옮겨진 파일 모두에서 사용
+    if ((flush_link_batch(opts) != SUCCESS || link_flush_failed) && result == SUCCESS) {
+        result = ERROR_FILE_WRITE;
+    }
+    link_flush_failed = 0;
+    free(link_jobs);
+    link_jobs = NULL;
+    if (link_dest_active) {
+        log_info("하드 링크 %zu개, 복사 %zu개", g_stats.files_linked, g_stats.files_processed);
+    }
+    if (g_stats.files_moved > 0) {
+        log_info("옮겨진 파일 %zu개 감지, %zu bytes 복사 생략", g_stats.files_moved, g_stats.bytes_moved);
+    }
+
+    if (delta_active) {
+        delta_active = 0;
+        if (delta_pack_close() != SUCCESS && result == SUCCESS) {
+            result = ERROR_FILE_WRITE;
+        }
+    }
+
+    if (close_chunk_store() != SUCCESS && result == SUCCESS) {
+        result = ERROR_FILE_WRITE;
+    }
+
+    if (index_open && backup_index_close() != SUCCESS && result == SUCCESS) {
+        result = ERROR_FILE_WRITE;
+    }
+
+    if (opts->mode != BACKUP_FULL) {
+        log_info("변경된 파일 %zu개 복사, 변경 없는 파일 %zu개",
+                 g_stats.files_processed, g_stats.files_unchanged);
+        if (opts->skip_subtrees != SUBTREE_SKIP_OFF || active_dirty_set) {
+            log_info("변경 없는 하위 트리 %zu개 건너뜀 (표본 검사 %zu개)",
+                     g_stats.subtrees_skipped, g_stats.subtrees_checked);
+        }
+    }
+
+    release_reference_index();
+    return result;
+}
+
+// 스트림에서 len 바이트를 채우거나 끝에 도달할 때까지 읽기
+static ssize_t read_stream_full(decompress_stream_t *stream, unsigned char *buf, size_t len) {
+    size_t total = 0;
+
+    while (total < len) {
+        ssize_t n = decompress_stream_read(stream, buf + total, len - total);
+        if (n < 0) return -1;
+        if (n == 0) break;
+        total += (size_t)n;
+    }
+
+    return (ssize_t)total;
+}
+
+// 원본과 백업을 블록 단위로 메모리에서 비교 (압축 백업은 해제 스트림을 직접 비교, 임시 파일 없음)
+static int verify_file_streaming(const char *source, const char *backup, compression_type_t type) {
+    unsigned char *src_buf = NULL, *bak_buf = NULL;
+    decompress_stream_t *stream;
+    int src_fd;
+    int result = SUCCESS;
+
+    src_fd = open(source, O_RDONLY);
+    if (src_fd < 0) {
+        log_error("파일 열기 실패: %s", source);
+        return ERROR_FILE_OPEN;
+    }
+
+    stream = decompress_stream_open(backup, type);
+    if (!stream) {
+        close(src_fd);
+        return ERROR_FILE_OPEN;
+    }
+
+    src_buf = io_buffer_get();
+    bak_buf = io_buffer_get();
+    if (!src_buf || !bak_buf) {
+        result = ERROR_MEMORY;
+        goto done;
+    }
+
+    for (;;) {
+        ssize_t n1 = read_full(src_fd, src_buf, IO_BUFFER_SIZE);
+        ssize_t n2 = read_stream_full(stream, bak_buf, n1 > 0 ? (size_t)n1 : 1);
+
+        if (n2 < 0) {
+            log_error("백업 데이터 읽기 실패 (손상 가능): %s", backup);
+            result = ERROR_COMPRESSION;
+            break;
+        }
+
+        if (n1 <= 0) {
+            if (n1 < 0) {
+                result = ERROR_FILE_READ;
+            } else if (n2 > 0) {
+                log_debug("백업이 원본보다 큼: %s", backup);
+                result = ERROR_CHECKSUM;
+            }
+            break;
+        }
+
+        if (n2 != n1 || memcmp(src_buf, bak_buf, (size_t)n1) != 0) {
+            log_debug("파일 내용 다름: %s vs %s", source, backup);
+            result = ERROR_CHECKSUM;
+            break;
+        }
+        metrics_count(METRIC_VERIFY, (size_t)n1, 0);
+    }
+
+done:
+    io_buffer_put(src_buf);
+    io_buffer_put(bak_buf);
+    decompress_stream_close(stream);
+    close(src_fd);
+    return result;
+}
+
+// 원본-백업 검증 작업 문맥 (index는 체크섬이 있는 백업 인덱스, 없으면 NULL)
+typedef struct {
+    const backup_options_t *opts;
+    const backup_index_t *index;
+    const char *backup_root;
+} verify_ctx_t;
+
+// 원본 해시가 캐시에 있고 인덱스 체크섬과 같으면 원본은 읽지 않고 백업 데이터만 확인 (처리했으면 1)
+static int verify_with_cached_hash(const verify_ctx_t *vctx, const char *source, const char *backup,
+                                   int *result) {
+    size_t root_len = strlen(vctx->backup_root);
+    char rel[MAX_PATH];
+    char source_hex[MAX_DIGEST_HEX];
+    char backup_hex[MAX_DIGEST_HEX];
+    index_entry_t entry;
+    struct stat st;
+    uint64_t size = 0;
+
+    if (strncmp(backup, vctx->backup_root, root_len) != 0 || backup[root_len] != '/') {
+        return 0;
+    }
+    snprintf(rel, sizeof(rel), "%s", backup + root_len + 1);
+    strip_compression_extension(rel, vctx->opts->compression);
+
+    if (!backup_index_lookup(vctx->index, rel, &entry) || entry.type != 'F' || entry.checksum[0] == '\0' ||
+        stat(source, &st) != 0 || !hash_cache_lookup(&st, vctx->index->checksum_type, source_hex) ||
+        strcmp(source_hex, entry.checksum) != 0) {
+        return 0;
+    }
+
+    *result = checksum_file(backup, vctx->opts->compression, vctx->index->checksum_type, backup_hex, &size);
+    metrics_count(METRIC_VERIFY, (size_t)size, 0);
+    if (*result == SUCCESS && (size != entry.size || strcmp(backup_hex, entry.checksum) != 0)) {
+        log_debug("백업 체크섬 불일치: %s", backup);
+        *result = ERROR_CHECKSUM;
+    }
+    return 1;
+}
+
+static int verify_file_handler(const char *source, const char *backup, void *ctx) {
+    const verify_ctx_t *vctx = (const verify_ctx_t *)ctx;
+    uint64_t t = metrics_now();
+    int result;
+
+    if (!vctx->index || !verify_with_cached_hash(vctx, source, backup, &result)) {
+        result = verify_file_streaming(source, backup, vctx->opts->compression);
+    }
+    metrics_lap(METRIC_VERIFY, &t, 0);
+    metrics_count(METRIC_VERIFY, 0, 1);
+
+    if (result != SUCCESS) {
+        log_error("백업 검증 실패: %s", source);
+    } else {
+        log_debug("백업 검증 성공: %s", source);
+    }
+    return result;
+}
+
+// 원본 트리를 순회하며 파일별 검증 작업을 스레드 풀에 등록
+// changed_only: 증분/차등 백업처럼 이번에 복사한 파일만 있는 경우 백업에 없는 파일은 건너뜀
+static size_t enqueue_verify_directory(const char *source, const char *backup,
+                                       const backup_options_t *opts, thread_pool_t *pool,
+                                       int changed_only) {
+    dir_walk_t walk;
+    char bak_path[MAX_PATH];
+    size_t queued = 0;
+
+    if (walk_init(&walk, source, backup, 0) != SUCCESS) {
+        return 0;
+    }
+    if (walk_enter(&walk) != SUCCESS) {
+        log_error("디렉토리 열기 실패: %s", source);
+        walk_free(&walk);
+        return 0;
+    }
+
+    while (walk.depth > 0) {
+        struct stat st;
+
+        if (!walk_next(&walk)) {
+            walk_leave(&walk);
+            continue;
+        }
+        if (stat(walk.src.buf, &st) != 0 || !should_include_stat(walk.src.buf, &st, opts)) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (walk_enter(&walk) != SUCCESS) {
+                log_error("디렉토리 열기 실패: %s", walk.src.buf);
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            snprintf(bak_path, sizeof(bak_path), "%s", walk.dst.buf);
+            append_compression_extension(bak_path, sizeof(bak_path), opts->compression);
+            if (changed_only && !file_exists(bak_path)) {
+                continue;
+            }
+            if (add_work_item(pool, walk.src.buf, bak_path) == SUCCESS) {
+                queued++;
+            }
+        }
+    }
+
+    walk_free(&walk);
+    return queued;
+}
+
 int verify_backup_integrity(const char *source, const char *backup, const backup_options_t *opts) {
     if (!opts->verify) {
         return SUCCESS; // 검증 비활성화
     }
-    
-    if (opts->compression != COMPRESS_NONE) {
-        // 압축 파일의 실제 경로 생성 (확장자 추가)
+
+    if (!is_directory(source)) {
         char actual_backup[MAX_PATH];
-        const char *ext = get_compression_extension(opts->compression);
-        snprintf(actual_backup, sizeof(actual_backup), "%s%s", backup, ext);
-        
-        // 압축된 파일은 압축 해제 후 비교
-        char temp_file[MAX_PATH];
-        snprintf(temp_file, sizeof(temp_file), "/tmp/backup_verify_%d", getpid());
-        
-        if (decompress_file(actual_backup, temp_file, opts->compression) != SUCCESS) {
-            log_error("검증을 위한 압축 해제 실패: %s", actual_backup);
-            return ERROR_COMPRESSION;
-        }
-        
-        int result = compare_files(source, temp_file);
-        unlink(temp_file);
-        
-        if (!result) {
-            log_error("백업 검증 실패 (압축): %s", source);
-            return ERROR_CHECKSUM;
+
+        snprintf(actual_backup, sizeof(actual_backup), "%s", backup);
+        append_compression_extension(actual_backup, sizeof(actual_backup), opts->compression);
+        verify_ctx_t file_ctx = { opts, NULL, backup };
+        return verify_file_handler(source, actual_backup, &file_ctx);
+    }
+
+    // 증분/차등: 체인에서 방금 만든 백업의 복사된 파일만 검증
+    char chain_backup[MAX_PATH];
+    int changed_only = opts->mode != BACKUP_FULL;
+
+    if (changed_only) {
+        char latest[BACKUP_NAME_MAX];
+
+        if (find_latest_backup(backup, latest, sizeof(latest)) != SUCCESS) {
+            return ERROR_FILE_NOT_FOUND;
+        }
+        snprintf(chain_backup, sizeof(chain_backup), "%s/%s", backup, latest);
+        backup = chain_backup;
+    }
+
+    // 중복 제거 백업은 백업 디렉토리에 파일이 없으므로 청크 해시와 인덱스 체크섬으로 검증
+    if (opts->dedup) {
+        return verify_backup_checksums(backup, opts);
+    }
+
+    // 디렉토리: 파일별로 병렬 검증 (인덱스에 체크섬이 있으면 해시 캐시로 원본 읽기를 생략)
+    backup_index_t index;
+    verify_ctx_t ctx = { opts, NULL, backup };
+    thread_pool_t pool;
+
+    if (backup_index_load(backup, &index) == SUCCESS) {
+        if (index.checksum_type != CHECKSUM_NONE) {
+            ctx.index = &index;
+        } else {
+            backup_index_free(&index);
         }
+    }
+
+    if (init_thread_pool(&pool, opts->threads, verify_file_handler, &ctx) != SUCCESS) {
+        log_error("검증 스레드 풀 생성 실패");
+        if (ctx.index) backup_index_free(&index);
+        return ERROR_THREAD;
+    }
+
+    size_t queued = enqueue_verify_directory(source, backup, opts, &pool, changed_only);
+    size_t failures = wait_thread_pool(&pool);
+    destroy_thread_pool(&pool);
+    if (ctx.index) {
+        backup_index_free(&index);
+    }
+
+    if (failures > 0) {
+        log_error("백업 검증 실패: %zu/%zu개 파일", failures, queued);
+        return ERROR_CHECKSUM;
+    }
+
+    log_info("백업 검증 완료: %zu개 파일", queued);
+
+    // 델타로 저장한 파일은 백업 디렉토리에 없으므로 기준 + 델타 재구성으로 따로 검증
+    if (changed_only && opts->delta) {
+        int result = verify_backup_checksums(backup, opts);
+        return result == ERROR_FILE_NOT_FOUND ? SUCCESS : result;
+    }
+    return SUCCESS;
+}
+
+// 인덱스 기반 체크섬 검증 (원본 없이 백업만으로 무결성 확인)
+typedef struct {
+    const backup_index_t *index;
+    const char *backup_path;
+} checksum_verify_ctx_t;
+
+// 청크 저장소/델타 파일: 데이터를 재구성해 (청크 해시와) 크기, 파일 체크섬 확인
+static int verify_rebuilt_entry(const checksum_verify_ctx_t *vctx, const index_entry_t *entry,
+                                const char *rel_path) {
+    checksum_ctx_t hash;
+    checksum_ctx_t *hash_ptr = NULL;
+    char hex[MAX_DIGEST_HEX];
+    uint64_t size = 0;
+    int result;
+
+    if (vctx->index->checksum_type != CHECKSUM_NONE && entry->checksum[0] != '\0') {
+        checksum_init(&hash, vctx->index->checksum_type);
+        hash_ptr = &hash;
+    }
+
+    // 파일 단위로 이미 병렬 검증 중이므로 청크 읽기는 단일 스레드
+    if (entry->type == 'X') {
+        result = delta_restore_file(vctx->backup_path, entry->offset, NULL, hash_ptr, &size);
     } else {
-        // 압축되지 않은 파일 직접 비교
-        if (!compare_files(source, backup)) {
-            log_error("백업 검증 실패: %s", source);
+        result = chunk_store_restore_file(vctx->backup_path, entry->offset, NULL, hash_ptr, 1, &size);
+    }
+    if (result != SUCCESS) {
+        log_error("%s 데이터 손상 또는 누락: %s", entry->type == 'X' ? "델타" : "청크", rel_path);
+        return result;
+    }
+
+    if (size != entry->size) {
+        log_error("크기 불일치: %s (기록: %zu, 실제: %llu)", rel_path, entry->size, (unsigned long long)size);
+        return ERROR_CHECKSUM;
+    }
+
+    if (hash_ptr) {
+        checksum_final_hex(&hash, hex);
+        if (strcmp(hex, entry->checksum) != 0) {
+            log_error("체크섬 불일치: %s (기록: %s, 실제: %s)", rel_path, entry->checksum, hex);
             return ERROR_CHECKSUM;
         }
     }
-    
-    log_debug("백업 검증 성공: %s", source);
+
+    log_debug("재구성 검증 완료: %s", rel_path);
     return SUCCESS;
-}
\ No newline at end of file
+}
+
+static int verify_checksum_entry(const char *backup_file, const char *rel_path, void *ctx) {
+    const checksum_verify_ctx_t *vctx = (const checksum_verify_ctx_t *)ctx;
+    index_entry_t found;
+    const index_entry_t *entry = &found;
+    char hex[MAX_DIGEST_HEX];
+    uint64_t size = 0;
+    int result;
+
+    if (!backup_index_lookup(vctx->index, rel_path, &found)) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    if (entry->type == 'C' || entry->type == 'X') {
+        metrics_count(METRIC_VERIFY, entry->size, 0);
+        return verify_rebuilt_entry(vctx, entry, rel_path);
+    }
+
+    result = checksum_file(backup_file, vctx->index->compression, vctx->index->checksum_type, hex, &size);
+    metrics_count(METRIC_VERIFY, (size_t)size, 0);
+    if (result != SUCCESS) {
+        log_error("백업 파일 읽기 실패 (손상 가능): %s", backup_file);
+        return result;
+    }
+
+    if (size != entry->size || strcmp(hex, entry->checksum) != 0) {
+        log_error("체크섬 불일치: %s (기록: %s, 실제: %s)", backup_file, entry->checksum, hex);
+        return ERROR_CHECKSUM;
+    }
+
+    log_debug("체크섬 일치: %s", backup_file);
+    return SUCCESS;
+}
+
+static int verify_checksum_handler(const char *backup_file, const char *rel_path, void *ctx) {
+    uint64_t t = metrics_now();
+    int result = verify_checksum_entry(backup_file, rel_path, ctx);
+
+    metrics_lap(METRIC_VERIFY, &t, 0);
+    metrics_count(METRIC_VERIFY, 0, 1);
+    return result;
+}
+
+// 검증할 체크섬도 청크 저장소 파일도 없으면 ERROR_FILE_NOT_FOUND (호출자가 다른 검증으로 전환)
+int verify_backup_checksums(const char *backup_path, const backup_options_t *opts) {
+    backup_index_t index;
+    checksum_verify_ctx_t ctx;
+    thread_pool_t pool;
+    char file_path[MAX_PATH];
+    size_t queued = 0, missing = 0, failures;
+    int has_checksums;
+
+    if (backup_index_load(backup_path, &index) != SUCCESS) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    ctx.index = &index;
+    ctx.backup_path = backup_path;
+    if (init_thread_pool(&pool, opts->threads, verify_checksum_handler, &ctx) != SUCCESS) {
+        log_error("검증 스레드 풀 생성 실패");
+        backup_index_free(&index);
+        return ERROR_THREAD;
+    }
+
+    for (size_t i = 0; i < index.count; i++) {
+        index_entry_t found;
+        const index_entry_t *entry = &found;
+        char rel_path[MAX_PATH];
+
+        if (!backup_index_get(&index, i, &found, rel_path, sizeof(rel_path))) {
+            continue;
+        }
+
+        // 다른 체인 백업에 데이터가 있는 항목은 그 백업에서 검증
+        if (entry->origin[0] != '\0') {
+            continue;
+        }
+
+        // 청크 저장소/델타 파일은 체크섬이 없어도 재구성해서 검증
+        if (entry->type == 'C' || entry->type == 'X') {
+            if (add_work_item(&pool, backup_path, entry->path) == SUCCESS) {
+                queued++;
+            }
+            continue;
+        }
+
+        if (entry->type != 'F' || entry->checksum[0] == '\0') {
+            continue;
+        }
+
+        snprintf(file_path, sizeof(file_path), "%s/%s", backup_path, entry->path);
+        append_compression_extension(file_path, sizeof(file_path), index.compression);
+
+        if (!file_exists(file_path)) {
+            log_error("백업 파일 없음: %s", file_path);
+            missing++;
+            continue;
+        }
+
+        if (add_work_item(&pool, file_path, entry->path) == SUCCESS) {
+            queued++;
+        }
+    }
+
+    failures = wait_thread_pool(&pool);
+    destroy_thread_pool(&pool);
+    has_checksums = index.checksum_type != CHECKSUM_NONE;
+    backup_index_free(&index);
+
+    if (queued == 0 && missing == 0 && !has_checksums) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    if (failures > 0 || missing > 0) {
+        log_error("체크섬 검증 실패: %zu개 불일치, %zu개 누락 (총 %zu개)",
+                  failures, missing, queued + missing);
+        return ERROR_CHECKSUM;
+    }
+
+    log_info("체크섬 검증 완료: %zu개 파일", queued);
+    return SUCCESS;
+}
@@ -21,9 +21,14 @@
 #include <limits.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <ctype.h>
 #include <sys/utsname.h>   // struct utsname용
 #include <sys/statvfs.h>   // struct statvfs용
 
+// xxHash (헤더 전용, 구현은 xxhash.c)
+#define XXH_STATIC_LINKING_ONLY
+#include "xxhash.h"
+
 // 버전 정보
 #define VERSION "2.0"
 #define BUILD_DATE __DATE__
@@ -31,9 +36,26 @@
 // 경로 및 버퍼 크기
 #define MAX_PATH 4096
 #define BUFFER_SIZE 8192
+#define IO_BUFFER_SIZE (1024 * 1024)      // 풀에서 빌리는 입출력 버퍼 (복사/압축/비교/해시 읽기 단위)
+#define WHOLE_FILE_MAX (16 * 1024 * 1024) // libdeflate 가 한 번에 압축/해제하는 최대 원본 크기
 #define MAX_THREADS 16
 #define MAX_PATTERNS 256
 #define MAX_EXCLUDE_PATTERNS 256  // 추가된 상수
+#define MAX_EXCLUDE_DIRS 64
+#define DEFAULT_IGNORE_FILE ".backupignore"
+#define BACKUP_INDEX_FILE ".backup_index"
+#define BACKUP_MANIFEST_FILE ".backup_manifest"  // mmap 조회용 바이너리 매니페스트
+#define BACKUP_METADATA_FILE ".backup_metadata"  // 구 형식 (목록/복원에서 제외만)
+#define BACKUP_CHAIN_FULL "full"          // 백업 체인의 전체 백업 디렉토리 이름
+#define BACKUP_NAME_MAX 64                // 체인 내 백업 디렉토리 이름 최대 길이
+#define BACKUP_RECIPES_FILE ".backup_recipes"    // 중복 제거 백업의 파일별 청크 목록
+#define BACKUP_DELTAS_FILE ".backup_deltas"      // 증분/차등 백업의 파일별 델타 레코드
+#define BACKUP_CHUNK_DIR ".chunks"        // 기본 청크 저장소 (백업 디렉토리의 상위에 생성)
+#define WATCH_DEFAULT_INTERVAL 300        // 변경 감시 모드의 기본 백업 주기 (초)
+#define DEFAULT_STATISTICS_FILE "backup_stats.json"  // save_statistics=1 이고 파일을 주지 않았을 때
+#define MEMORY_SHARE_MANIFEST 25          // --memory-limit 중 매니페스트 기록 버퍼 몫 (%)
+#define MEMORY_SHARE_CHUNKS 25            // 청크 색인 몫 (%)
+#define MEMORY_SHARE_MOVES 15             // 이동 감지 표 몫 (%)
 
 // 에러 코드
 #define SUCCESS 0
@@ -56,6 +78,63 @@ typedef enum {
     COMPRESS_LZ4 = 3
 } compression_type_t;
 
+// deflate 백엔드 (gzip/zlib 압축 구현 선택)
+typedef enum {
+    DEFLATE_BACKEND_INVALID = -1, // parse_deflate_backend: 알 수 없는 이름
+    DEFLATE_BACKEND_AUTO = 0,
+    DEFLATE_BACKEND_ZLIB = 1,
+    DEFLATE_BACKEND_LIBDEFLATE = 2
+} deflate_backend_t;
+
+// 체크섬 알고리즘
+typedef enum {
+    CHECKSUM_NONE = 0,
+    CHECKSUM_MD5 = 1,
+    CHECKSUM_SHA1 = 2,
+    CHECKSUM_SHA256 = 3,
+    CHECKSUM_CRC32 = 4,
+    CHECKSUM_XXH3 = 5,      // XXH3-128: 변경 감지/중복 제거 키용 (비암호)
+    CHECKSUM_BLAKE3 = 6     // 암호학적 무결성용
+} checksum_type_t;
+
+#define MAX_DIGEST_SIZE 32
+#define MAX_DIGEST_HEX (MAX_DIGEST_SIZE * 2 + 1)
+
+// BLAKE3 해셔 상태
+#define BLAKE3_OUT_LEN 32
+#define BLAKE3_BLOCK_LEN 64
+#define BLAKE3_CHUNK_LEN 1024
+#define BLAKE3_MAX_DEPTH 54
+
+typedef struct {
+    uint32_t cv[8];
+    uint64_t chunk_counter;
+    unsigned char buf[BLAKE3_BLOCK_LEN];
+    uint8_t buf_len;
+    uint8_t blocks_compressed;
+    uint8_t flags;
+} blake3_chunk_state_t;
+
+typedef struct {
+    uint32_t key[8];
+    blake3_chunk_state_t chunk;
+    uint8_t cv_stack_len;
+    unsigned char cv_stack[(BLAKE3_MAX_DEPTH + 1) * BLAKE3_OUT_LEN];
+} blake3_hasher_t;
+
+// 스트리밍 체크섬 상태 (MD5/SHA 계열은 state/buffer, 그 외는 fast 사용)
+typedef struct {
+    checksum_type_t type;
+    uint32_t state[8];
+    uint64_t total_len;
+    unsigned char buffer[64];
+    size_t buffer_len;
+    union {
+        XXH3_state_t xxh3;
+        blake3_hasher_t blake3;
+    } fast;
+} checksum_ctx_t;
+
 // 백업 모드
 typedef enum {
     BACKUP_FULL = 0,
@@ -71,6 +150,25 @@ typedef enum {
     CONFLICT_RENAME = 3
 } conflict_mode_t;
 
+// 변경 없는 하위 트리 건너뛰기 (증분/차등 백업)
+typedef enum {
+    SUBTREE_SKIP_OFF = 0,
+    SUBTREE_SKIP_TRUST = 1,       // 디렉토리 시간이 모두 같으면 건너뜀
+    SUBTREE_SKIP_SAMPLE = 2       // 건너뛸 하위 트리 일부를 실제로 걸어 요약과 비교
+} subtree_skip_t;
+
+// 성능 지표 단계 (metrics.c, 시간은 스레드별 합계)
+typedef enum {
+    METRIC_SCAN = 0,              // 디렉토리 목록 읽기, 파일 stat
+    METRIC_OPEN,                  // 원본/대상 파일 열기
+    METRIC_READ,                  // 원본 읽기 (읽는 동안의 해시 포함)
+    METRIC_COMPRESS,              // 압축/해제 (청크/델타 저장은 파일 단위 전체)
+    METRIC_WRITE,                 // 백업 데이터 쓰기
+    METRIC_METADATA,              // 권한/시간 복사, 인덱스 기록
+    METRIC_VERIFY,                // 백업 검증
+    METRIC_PHASES
+} metric_phase_t;
+
 // 로그 레벨
 typedef enum {
     LOG_ERROR = 0,
@@ -88,7 +186,11 @@ typedef struct {
     int preserve_timestamps;
     int dry_run;
     int verify;
+    int calculate_checksum;
+    checksum_type_t checksum_algorithm;
     compression_type_t compression;
+    int compression_level;
+    deflate_backend_t deflate_backend;
     backup_mode_t backup_mode;
     backup_mode_t mode;           // 추가된 멤버 (mode 호환성용)
     conflict_mode_t conflict_mode;
@@ -97,10 +199,30 @@ typedef struct {
     int logging;                  // 추가된 멤버
     char exclude_patterns[MAX_PATTERNS][256];
     int exclude_count;
+    char exclude_dirs[MAX_EXCLUDE_DIRS][256]; // 하위 트리를 통째로 건너뛸 디렉토리 패턴
+    int exclude_dir_count;
+    int exclude_system_dirs;      // /proc, /sys, /dev, /run 제외
+    char ignore_file[64];         // 디렉토리별 제외 파일 이름 ("none" = 사용 안 함)
+    size_t memory_limit;          // 메모리 예산 (bytes, 0 = 제한 없음)
+    int monitor_memory;           // 끝날 때 최대 RSS 와 디스크로 내보낸 양을 로그에 기록
+    int huge_pages;               // 입출력 버퍼 풀을 huge page 로 (MADV_HUGEPAGE)
     char config_file[MAX_PATH];
     char log_file[MAX_PATH];
+    char write_config[MAX_PATH];  // compress-bench 추천 결과를 기록할 설정 파일
     log_level_t log_level;
+    int log_drop;                 // 로그 링이 가득 차면 기다리지 않고 버림 (log_overflow=drop)
+    int save_statistics;          // 끝날 때 성능 지표 파일 (JSON + Prometheus textfile) 기록
+    char statistics_file[MAX_PATH]; // JSON 경로 (Prometheus 는 확장자를 .prom 으로)
     size_t max_file_size;
+    int dedup;                    // 내용 정의 청킹 중복 제거 저장
+    char chunk_store[MAX_PATH];   // 청크 저장소 경로 (빈 값 = 백업 상위의 .chunks)
+    int delta;                    // 증분/차등 백업에서 변경된 큰 파일을 기준 버전 대비 델타로 저장
+    char hash_cache[MAX_PATH];    // 영구 해시 캐시 파일 (빈 값 = 기본 위치, "none" = 사용 안 함)
+    subtree_skip_t skip_subtrees; // 변경 없는 하위 트리를 stat 없이 기준 백업에서 이어받음
+    int skip_sample_percent;      // SUBTREE_SKIP_SAMPLE 에서 검사할 하위 트리 비율 (%)
+    int watch_interval;           // 변경 감시 모드의 백업 주기 (초)
+    char link_dest[MAX_PATH];     // 전체 백업에서 변경 없는 파일을 하드 링크할 이전 스냅샷
+    char as_of[BACKUP_NAME_MAX];  // 체인 복원 시점 (백업 이름 또는 시각, 빈 값 = 지정한 백업 그대로)
 } backup_options_t;
 
 // 백업 통계 구조체
@@ -113,10 +235,31 @@ typedef struct {
     size_t bytes_processed;
     size_t bytes_compressed;
     double compression_ratio;     // 추가된 멤버
+    size_t files_unchanged;       // 증분/차등 백업에서 기준 백업과 같아 복사하지 않은 파일
+    size_t hash_cache_lookups;    // 해시 캐시 조회 수
+    size_t hash_cache_hits;       // 파일을 읽지 않고 캐시에서 얻은 해시 수
+    size_t subtrees_skipped;      // 기준 백업에서 통째로 이어받은 하위 트리 수
+    size_t subtrees_checked;      // 건너뛰는 대신 표본 검사한 하위 트리 수
+    size_t files_linked;          // --link-dest 스냅샷에서 하드 링크한 파일 수
+    size_t files_moved;           // 이름이 바뀌거나 옮겨져 이전 데이터를 재사용한 파일 수
+    size_t bytes_moved;           // 옮겨진 파일로 복사를 생략한 바이트 수
+    size_t spill_runs;            // 메모리 예산 때문에 디스크에 내보낸 정렬 구간 수
+    size_t bytes_spilled;         // 그 구간들의 크기
     time_t start_time;
     time_t end_time;
 } backup_stats_t;
 
+// 입출력 버퍼 풀 / 스레드 arena 카운터 (bufpool.c)
+typedef struct {
+    size_t slabs;                 // 할당한 slab 수
+    size_t buffers;               // slab 에서 만든 버퍼 수
+    size_t gets;                  // 버퍼 요청 수 (arena 블록 포함)
+    size_t arena_blocks;          // arena 가 받은 블록 수
+    size_t arena_bytes;           // 그 크기 합
+    size_t arena_allocs;          // arena 할당 수
+    size_t whole_bytes;           // 파일 전체 버퍼로 할당한 바이트 합
+} bufpool_stats_t;
+
 // 진행률 정보 구조체
 typedef struct {
     size_t total_files;
@@ -128,23 +271,116 @@ typedef struct {
     pthread_mutex_t mutex;        // 추가된 멤버
 } progress_info_t;
 
-// 작업 큐 항목
-typedef struct work_item {
-    char source[MAX_PATH];
-    char dest[MAX_PATH];
-    struct work_item *next;
+// 작업 큐 항목 (경로는 스레드 풀의 경로 표 id)
+typedef struct {
+    uint32_t source;
+    uint32_t dest;
 } work_item_t;
 
+// 백업 인덱스 항목 (.backup_index 한 줄)
+typedef struct {
+    char type;                    // 'F' 파일, 'D' 디렉토리, 'C' 청크 저장소의 파일, 'X' 델타
+    char *path;                   // 백업 루트 기준 상대 경로 (압축 확장자 제외)
+    size_t size;                  // 'D'는 디렉토리 ctime (ns)
+    time_t mtime;
+    long mtime_nsec;
+    uint64_t inode;
+    uint64_t offset;              // 저장 객체 내 데이터 오프셋 ('C' 레시피/'X' 델타 레코드 위치, 파일 단위 저장은 0)
+                                  // 'D'는 하위 트리 요약 해시 (0 = 없음)
+    uint32_t file_mode;           // 원본 st_mode (매니페스트에만 기록)
+    uint8_t codec;                // 저장된 데이터의 압축 형식
+    char checksum[MAX_DIGEST_HEX];
+    char origin[BACKUP_NAME_MAX]; // 데이터가 있는 체인 내 백업 이름 (빈 값 = 이 백업)
+} index_entry_t;
+
+// 로드된 백업 인덱스: 매니페스트가 있으면 mmap(map)으로 이진 탐색,
+// 없으면 텍스트 인덱스를 entries에 읽어 경로 해시 테이블로 O(1) 조회
+typedef struct {
+    index_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    size_t *slots;                // entries 위치 + 1 (0 = 빈 슬롯)
+    size_t slot_count;
+    checksum_type_t checksum_type;
+    compression_type_t compression;
+    backup_mode_t mode;
+    char base[BACKUP_NAME_MAX];   // 증분/차등 백업의 기준 백업 이름
+    const unsigned char *map;     // mmap 된 .backup_manifest (없으면 NULL)
+    size_t map_size;
+} backup_index_t;
+
+// 매니페스트 작성기 (manifest.c)
+typedef struct manifest_builder manifest_builder_t;
+
+// 중복 제거 청크 저장소 (chunkstore.c)
+typedef struct chunk_store chunk_store_t;
+
+// 경로 집합 (watch.c 변경 감시의 바뀐 디렉토리)
+typedef struct path_set path_set_t;
+
+// (상위 id, 이름) 노드로 저장하는 경로 문자열 표 (pathtab.c)
+typedef struct path_table path_table_t;
+
+// 인덱스 단위 병렬 작업 함수 (thread_pool.c parallel_for)
+typedef void (*parallel_fn_t)(void *ctx, size_t index);
+
+// 작업 처리 함수 (SUCCESS가 아니면 실패로 집계)
+typedef int (*work_handler_t)(const char *source, const char *dest, void *ctx);
+
 // 스레드 풀 구조체
 typedef struct {
     pthread_t *threads;
-    work_item_t *work_queue;
+    work_item_t *queue;           // 고리 버퍼 (queue_capacity 는 2의 거듭제곱)
+    size_t queue_head;
+    size_t queue_count;
+    size_t queue_capacity;
+    path_table_t *paths;          // 큐에 있는 작업의 경로 (큐가 비면 비움)
     pthread_mutex_t queue_mutex;
     pthread_cond_t queue_cond;
+    pthread_cond_t space_cond;    // 큐가 비면 신호 (가득 차서 기다리는 생산자)
+    pthread_cond_t done_cond;     // 대기 중인 작업이 모두 끝나면 신호
+    work_handler_t handler;
+    void *handler_ctx;
+    size_t pending;
+    size_t failures;
     int thread_count;
     int shutdown;
 } thread_pool_t;
 
+// 스트리밍 압축 해제 리더 (compression.c)
+typedef struct decompress_stream decompress_stream_t;
+
+// 재귀 없는 디렉토리 순회 (walk.c)
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} path_buf_t;
+
+typedef struct {
+    size_t names;                 // 이 디렉토리 항목이 시작하는 names 위치
+    size_t next;                  // 다음에 돌려줄 항목
+    size_t src_len;               // 이 디렉토리 경로 길이
+    size_t dst_len;
+    uint64_t started;             // walk_enter 시각 (metrics_now)
+    uint64_t children;            // 하위 디렉토리에서 보낸 시간
+} walk_frame_t;
+
+typedef struct {
+    path_buf_t src;               // 현재 항목 경로
+    path_buf_t dst;               // 대응하는 대상 경로 (대상 없이 순회하면 비어 있음)
+    size_t root_len;
+    char *names;                  // 열린 디렉토리들의 항목 (d_type 1바이트 + 이름 + NUL)
+    size_t names_len;
+    size_t names_cap;
+    walk_frame_t *frames;
+    size_t depth;
+    size_t frame_cap;
+    unsigned char *data;          // 디렉토리마다 호출자가 쓰는 상태 (data_size 바이트씩)
+    size_t data_size;
+    unsigned char d_type;         // walk_next 가 돌려준 항목의 d_type
+} dir_walk_t;
+
 // 전역 변수 선언
 extern backup_options_t g_options;
 extern backup_stats_t g_stats;
@@ -160,19 +396,44 @@ void print_version(void);
 int parse_options(int argc, char **argv, backup_options_t *opts);
 compression_type_t parse_compression_type(const char *str);
 backup_mode_t parse_backup_mode(const char *str);
+const char *get_backup_mode_name(backup_mode_t mode);
 conflict_mode_t parse_conflict_mode(const char *str);
+subtree_skip_t parse_subtree_skip(const char *str);
 log_level_t parse_log_level(const char *str);
+deflate_backend_t parse_deflate_backend(const char *str);
 
 // backup.c
 int backup_file(const char *source, const char *dest, const backup_options_t *opts);
 int backup_directory(const char *source, const char *dest, const backup_options_t *opts);
 int backup_directory_recursive(const char *source, const char *dest, const backup_options_t *opts);
 int verify_backup_integrity(const char *source, const char *backup, const backup_options_t *opts);
+int verify_backup_checksums(const char *backup_path, const backup_options_t *opts);
+void backup_set_dirty_set(const path_set_t *dirty);
+
+// exclude.c
+void exclude_matcher_init(const backup_options_t *opts);
+int is_excluded_path(const char *path, const backup_options_t *opts);
+int is_excluded_directory(const char *root, const char *rel, const char *name, const backup_options_t *opts);
+int ignore_push(const char *dir, const char *rel, const backup_options_t *opts);
+void ignore_pop(void);
+void ignore_reset(void);
+int ignore_excluded(const char *rel, const char *name, int is_dir);
+
+// consolidate.c
+int consolidate_chain(const char *chain, const char *dest, const backup_options_t *opts);
+
+// watch.c
+int watch_directory(const char *source, const char *chain, const backup_options_t *opts);
+int path_set_contains(const path_set_t *set, const char *path);
 
 // restore.c
 int restore_file(const char *source, const char *dest, const backup_options_t *opts);
 int restore_directory(const char *source, const char *dest, const backup_options_t *opts);
 int restore_directory_recursive(const char *source, const char *dest, const backup_options_t *opts);
+int verify_backup_chain(const char *backup_base_path);
+int find_latest_backup(const char *backup_base_path, char *name, size_t size);
+int find_backup_as_of(const char *chain, const char *as_of, char *name, size_t size);
+int restore_backup_as_of(const char *chain, const char *as_of, const char *dest, const backup_options_t *opts);
 
 // file_utils.c
 int file_exists(const char *path);
@@ -182,10 +443,14 @@ int create_directory(const char *path);
 int create_directory_recursive(const char *path);
 int copy_file_metadata(const char *source, const char *dest);
 int should_include_file(const char *path, const backup_options_t *opts);
+int should_include_stat(const char *path, const struct stat *st, const backup_options_t *opts);
 int compare_files(const char *file1, const char *file2);
 size_t get_file_size(const char *path);
+int is_backup_internal_file(const char *name);
 char *get_relative_path(const char *base, const char *path);
 void normalize_path(char *path);
+ssize_t read_full(int fd, void *buf, size_t len);
+int write_full(int fd, const void *buf, size_t len);
 
 // compression.c
 int compress_file(const char *source, const char *dest, compression_type_t type);
@@ -193,6 +458,98 @@ int decompress_file(const char *source, const char *dest, compression_type_t typ
 const char *get_compression_extension(compression_type_t type);
 compression_type_t get_compression_type(const char *filename);
 int copy_file_simple(const char *source, const char *dest);
+int copy_file_hashed(const char *source, const char *dest, checksum_ctx_t *hash);
+int compress_file_ex(const char *source, const char *dest, compression_type_t type, checksum_ctx_t *hash);
+int decompress_file_ex(const char *source, const char *dest, compression_type_t type, checksum_ctx_t *hash);
+void init_compression(const backup_options_t *opts);
+deflate_backend_t get_deflate_backend(void);
+const char *get_deflate_backend_name(deflate_backend_t backend);
+int compress_buffer(compression_type_t type, int level, const unsigned char *in, size_t in_len,
+                    unsigned char **out, size_t *out_len);
+int decompress_buffer(compression_type_t type, const unsigned char *in, size_t in_len,
+                      unsigned char **out, size_t *out_len);
+uint32_t backend_crc32(uint32_t crc, const void *data, size_t len);
+decompress_stream_t *decompress_stream_open(const char *path, compression_type_t type);
+ssize_t decompress_stream_read(decompress_stream_t *stream, void *buf, size_t len);
+void decompress_stream_close(decompress_stream_t *stream);
+
+// checksum.c
+checksum_type_t parse_checksum_type(const char *str);
+const char *get_checksum_name(checksum_type_t type);
+size_t checksum_digest_size(checksum_type_t type);
+void checksum_init(checksum_ctx_t *ctx, checksum_type_t type);
+void checksum_update(checksum_ctx_t *ctx, const void *data, size_t len);
+size_t checksum_final(checksum_ctx_t *ctx, unsigned char *digest);
+void checksum_final_hex(checksum_ctx_t *ctx, char *hex);
+void init_checksum(const backup_options_t *opts);
+int checksum_file(const char *path, compression_type_t type, checksum_type_t algorithm,
+                  char *hex, uint64_t *size);
+
+// hashcache.c
+int hash_cache_open(const char *path);
+void hash_cache_close(void);
+int hash_cache_lookup(const struct stat *st, checksum_type_t type, char *hex);
+void hash_cache_store(const struct stat *st, checksum_type_t type, const char *hex);
+
+// blake3.c
+void blake3_set_max_threads(int threads);
+const char *blake3_implementation(void);
+void blake3_hasher_init(blake3_hasher_t *self);
+void blake3_hasher_update(blake3_hasher_t *self, const void *data, size_t len);
+void blake3_hasher_finalize(const blake3_hasher_t *self, unsigned char out[BLAKE3_OUT_LEN]);
+
+// index.c
+int backup_index_open(const char *backup_path, const backup_options_t *opts, const char *base);
+void backup_index_record(const char *path, const index_entry_t *entry);
+void backup_index_drop_summaries(void);
+int backup_index_close(void);
+int backup_index_load(const char *backup_path, backup_index_t *index);
+int backup_index_lookup(const backup_index_t *index, const char *path, index_entry_t *entry);
+int backup_index_get(const backup_index_t *index, size_t pos, index_entry_t *entry, char *path, size_t size);
+int backup_index_subtree(const backup_index_t *index, const char *dir, size_t *first, size_t *last);
+void backup_index_free(backup_index_t *index);
+
+// manifest.c
+manifest_builder_t *manifest_builder_create(checksum_type_t checksum_type, compression_type_t compression,
+                                            backup_mode_t mode, const char *base);
+int manifest_builder_add(manifest_builder_t *builder, const char *path, const index_entry_t *entry);
+int manifest_builder_write(manifest_builder_t *builder, const char *backup_path);
+void manifest_builder_free(manifest_builder_t *builder);
+void manifest_builder_spill_to(manifest_builder_t *builder, const char *dir);
+void manifest_builder_drop_summaries(manifest_builder_t *builder);
+int manifest_open(const char *backup_path, backup_index_t *index);
+void manifest_close(backup_index_t *index);
+int manifest_find(const backup_index_t *index, const char *path, index_entry_t *entry);
+int manifest_get(const backup_index_t *index, size_t pos, index_entry_t *entry, char *path, size_t size);
+size_t manifest_lower_bound(const backup_index_t *index, const char *path);
+int manifest_string(const backup_index_t *index, uint32_t id, char *out, size_t size);
+
+// chunkstore.c
+chunk_store_t *chunk_store_open(const char *path, const backup_options_t *opts);
+void chunk_store_close(chunk_store_t *store);
+int chunk_store_backup_file(chunk_store_t *store, const char *source, checksum_ctx_t *hash,
+                            uint64_t *offset, uint64_t *size, uint64_t *stored);
+int chunk_store_restore_file(const char *backup_path, uint64_t offset, FILE *out,
+                             checksum_ctx_t *hash, int threads, uint64_t *size);
+int recipe_file_open(const char *backup_path, const char *store_path);
+int recipe_file_close(void);
+int recipe_store_path(const char *backup_path, char *store_path, size_t size);
+int chunk_store_copy_recipe(const char *backup_path, uint64_t offset, const char *store_path,
+                            uint64_t *new_offset);
+
+// delta.c
+int delta_pack_open(const char *backup_path);
+int delta_pack_close(void);
+int delta_record_base(const char *backup_path, uint64_t offset, char *base_name, size_t name_size,
+                      char *base_path, size_t path_size, uint8_t *codec);
+int delta_backup_file(const char *source, const char *chain, const char *base_name, const char *base_path,
+                      compression_type_t base_codec, int threads,
+                      checksum_ctx_t *hash, uint64_t *offset, uint64_t *size, uint64_t *stored);
+int delta_restore_file(const char *backup_path, uint64_t offset, FILE *out, checksum_ctx_t *hash, uint64_t *size);
+
+// bench.c
+int run_compress_bench(const char *path, const backup_options_t *opts);
+int run_hash_bench(const backup_options_t *opts);
 
 // logging.c
 void log_message(log_level_t level, const char *format, ...);
@@ -201,13 +558,71 @@ void log_warning(const char *format, ...);
 void log_info(const char *format, ...);
 void log_debug(const char *format, ...);
 void init_logging(const backup_options_t *opts);
+void log_flush(void);
+void log_counts(size_t *errors, size_t *warnings);
 void cleanup_logging(void);
 
-// 스레드 관련
-int init_thread_pool(thread_pool_t *pool, int thread_count);
+// bufpool.c
+void bufpool_init(const backup_options_t *opts);
+void *io_buffer_get(void);
+void io_buffer_put(void *buffer);
+void *arena_alloc(size_t size);
+void *whole_buffer_get(int slot, size_t size);
+void bufpool_get_stats(bufpool_stats_t *stats);
+
+// memory.c
+void memory_init(const backup_options_t *opts);
+size_t memory_limit(void);
+size_t memory_budget(int share);
+size_t memory_rss(void);
+size_t memory_peak_rss(void);
+int memory_over_limit(void);
+void memory_note_spill(size_t bytes);
+FILE *memory_spill_file(const char *dir);
+void memory_report(void);
+
+// metrics.c
+void metrics_start(void);
+uint64_t metrics_now(void);
+void metrics_add(metric_phase_t phase, uint64_t ns, size_t bytes);
+void metrics_lap(metric_phase_t phase, uint64_t *since, size_t bytes);
+void metrics_count(metric_phase_t phase, size_t bytes, size_t files);
+void metrics_codec(compression_type_t codec, size_t bytes_in, size_t bytes_out);
+double metrics_elapsed(void);
+void metrics_file_begin(void);
+void metrics_file_end(const char *path);
+void metrics_directory(const char *path, size_t len, uint64_t ns);
+void metrics_print_latency(FILE *out);
+int metrics_write(const char *path, const char *command, const char *source, const char *dest, int result);
+
+// pathtab.c
+path_table_t *path_table_create(void);
+void path_table_free(path_table_t *table);
+int path_table_reset(path_table_t *table);
+size_t path_table_memory(const path_table_t *table);
+int path_table_add(path_table_t *table, const char *path, uint32_t *id);
+int path_table_get(const path_table_t *table, uint32_t id, char *out, size_t size);
+int path_table_compare(const path_table_t *table, uint32_t a, uint32_t b);
+
+// walk.c
+int walk_init(dir_walk_t *walk, const char *src, const char *dst, size_t data_size);
+void walk_free(dir_walk_t *walk);
+int walk_enter(dir_walk_t *walk);
+const char *walk_next(dir_walk_t *walk);
+int walk_set_dest_name(dir_walk_t *walk, const char *name);
+void walk_leave(dir_walk_t *walk);
+void *walk_data(dir_walk_t *walk);
+const char *walk_name(const dir_walk_t *walk);
+const char *walk_rel(const dir_walk_t *walk);
+
+// thread_pool.c
+int init_thread_pool(thread_pool_t *pool, int thread_count, work_handler_t handler, void *ctx);
 void destroy_thread_pool(thread_pool_t *pool);
 int add_work_item(thread_pool_t *pool, const char *source, const char *dest);
+size_t wait_thread_pool(thread_pool_t *pool);
 void *worker_thread(void *arg);
+void parallel_for(parallel_fn_t fn, void *ctx, size_t count, int threads);
+int parallel_thread_count(int threads);
 
 // 진행률 표시
 void init_progress(size_t total_files, size_t total_bytes);
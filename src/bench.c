@@ -0,0 +1,696 @@
+#include "backup.h"
+
+// 압축 벤치마크 (compress-bench 명령)
+//
+// 트리 전체를 스캔한 뒤 바이트 가중 계통 표본추출로 파일 일부를 메모리에 읽고,
+// 사용 가능한 모든 코덱/레벨 조합을 워커 스레드에서 병렬로 실행합니다.
+// 스레드 CPU 시간으로 코어당 처리량을 측정해 전체 트리의 예상 시간과 크기를 계산합니다.
+
+#define BENCH_DEFAULT_SAMPLE (64 * 1024 * 1024)
+#define BENCH_MAX_SAMPLE_FILES 256
+#define BENCH_MIN_CHUNK (256 * 1024)
+#define BENCH_SIZE_TOLERANCE 1.05   // 최소 크기 대비 허용 범위 (5%)
+#define BENCH_TIME_TOLERANCE 1.10   // 최소 시간 대비 허용 범위 (10%)
+#define BENCH_INCOMPRESSIBLE 0.95   // 이보다 압축률이 나쁘면 압축하지 않음
+
+static const int bench_levels[] = {1, 3, 6, 9};
+static const int bench_jobs[] = {1, 2, 4, 8, 16};
+
+#define BENCH_LEVEL_COUNT (int)(sizeof(bench_levels) / sizeof(bench_levels[0]))
+#define BENCH_JOB_COUNT (int)(sizeof(bench_jobs) / sizeof(bench_jobs[0]))
+
+typedef struct {
+    char *path;
+    size_t size;
+} bench_file_t;
+
+typedef struct {
+    bench_file_t *files;
+    size_t count;
+    size_t capacity;
+    size_t total_bytes;
+} bench_scan_t;
+
+typedef struct {
+    unsigned char *data;
+    size_t len;
+} bench_sample_t;
+
+typedef struct {
+    compression_type_t type;
+    int level;
+    size_t in_bytes;
+    size_t out_bytes;
+    double cpu_seconds;
+} bench_result_t;
+
+typedef struct {
+    bench_sample_t *samples;
+    size_t sample_count;
+    bench_result_t *results;
+    size_t result_count;
+    size_t next_task;
+    int failures;
+    pthread_mutex_t mutex;
+} bench_ctx_t;
+
+static double bench_now(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static const char *bench_codec_name(compression_type_t type) {
+    switch (type) {
+        case COMPRESS_GZIP:
+            return "gzip";
+        case COMPRESS_ZLIB:
+            return "zlib";
+        default:
+            return "none";
+    }
+}
+
+static void format_size(double bytes, char *buf, size_t len) {
+    const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+    int unit = 0;
+
+    while (bytes >= 1024.0 && unit < 4) {
+        bytes /= 1024.0;
+        unit++;
+    }
+    snprintf(buf, len, "%.1f %s", bytes, units[unit]);
+}
+
+static void format_duration(double seconds, char *buf, size_t len) {
+    if (seconds < 10.0) {
+        snprintf(buf, len, "%.2fs", seconds);
+    } else if (seconds < 60.0) {
+        snprintf(buf, len, "%.1fs", seconds);
+    } else if (seconds < 3600.0) {
+        snprintf(buf, len, "%.1fm", seconds / 60.0);
+    } else {
+        snprintf(buf, len, "%.1fh", seconds / 3600.0);
+    }
+}
+
+static int bench_add_file(bench_scan_t *scan, const char *path, size_t size) {
+    if (scan->count == scan->capacity) {
+        size_t new_capacity = scan->capacity ? scan->capacity * 2 : 1024;
+        bench_file_t *grown = realloc(scan->files, new_capacity * sizeof(bench_file_t));
+        if (!grown) {
+            return ERROR_MEMORY;
+        }
+        scan->files = grown;
+        scan->capacity = new_capacity;
+    }
+
+    scan->files[scan->count].path = strdup(path);
+    if (!scan->files[scan->count].path) {
+        return ERROR_MEMORY;
+    }
+    scan->files[scan->count].size = size;
+    scan->count++;
+    scan->total_bytes += size;
+    return SUCCESS;
+}
+
+static int bench_scan_directory(const char *path, const backup_options_t *opts, bench_scan_t *scan) {
+    dir_walk_t walk;
+    int result = SUCCESS;
+
+    if (walk_init(&walk, path, NULL, 0) != SUCCESS) {
+        return ERROR_MEMORY;
+    }
+    if (walk_enter(&walk) != SUCCESS) {
+        log_warning("디렉토리 열기 실패: %s", path);
+        walk_free(&walk);
+        return SUCCESS;
+    }
+
+    while (walk.depth > 0 && result == SUCCESS) {
+        struct stat st;
+
+        if (!walk_next(&walk)) {
+            walk_leave(&walk);
+            continue;
+        }
+
+        if (stat(walk.src.buf, &st) != 0 || !should_include_stat(walk.src.buf, &st, opts)) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (walk_enter(&walk) != SUCCESS) {
+                log_warning("디렉토리 열기 실패: %s", walk.src.buf);
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            result = bench_add_file(scan, walk.src.buf, st.st_size);
+        }
+    }
+
+    walk_free(&walk);
+    return result;
+}
+
+static void bench_free_scan(bench_scan_t *scan) {
+    for (size_t i = 0; i < scan->count; i++) {
+        free(scan->files[i].path);
+    }
+    free(scan->files);
+    memset(scan, 0, sizeof(*scan));
+}
+
+static size_t bench_read_chunk(const char *path, size_t limit, unsigned char **out) {
+    unsigned char *buffer;
+    size_t total = 0;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_warning("샘플 파일 열기 실패: %s", path);
+        return 0;
+    }
+
+    buffer = malloc(limit ? limit : 1);
+    if (!buffer) {
+        close(fd);
+        return 0;
+    }
+
+    while (total < limit) {
+        ssize_t n = read(fd, buffer + total, limit - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        total += (size_t)n;
+    }
+    close(fd);
+
+    if (total == 0) {
+        free(buffer);
+        return 0;
+    }
+
+    *out = buffer;
+    return total;
+}
+
+// 바이트 가중 계통 표본추출: 큰 파일일수록 선택될 확률이 높아 전체 바이트 분포를 반영
+static size_t bench_pick_samples(const bench_scan_t *scan, size_t budget, bench_sample_t **out) {
+    size_t picks = MIN((size_t)BENCH_MAX_SAMPLE_FILES, scan->count);
+    size_t chunk = MAX(budget / picks, (size_t)BENCH_MIN_CHUNK);
+    double step = (double)scan->total_bytes / picks;
+    double target = step / 2.0;
+    double cumulative = 0.0;
+    size_t used = 0, count = 0;
+    size_t last_index = SIZE_MAX;
+    bench_sample_t *samples;
+
+    samples = calloc(picks, sizeof(bench_sample_t));
+    if (!samples) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < scan->count && count < picks && used < budget; i++) {
+        cumulative += scan->files[i].size;
+        if (cumulative < target) {
+            continue;
+        }
+
+        while (target <= cumulative) {
+            target += step;
+        }
+
+        if (i == last_index || scan->files[i].size == 0) {
+            continue;
+        }
+        last_index = i;
+
+        size_t len = bench_read_chunk(scan->files[i].path, MIN(chunk, budget - used),
+                                      &samples[count].data);
+        if (len > 0) {
+            samples[count].len = len;
+            used += len;
+            count++;
+        }
+    }
+
+    *out = samples;
+    return count;
+}
+
+static void *bench_worker(void *arg) {
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    size_t total_tasks = ctx->result_count * ctx->sample_count;
+
+    for (;;) {
+        size_t task = __atomic_fetch_add(&ctx->next_task, 1, __ATOMIC_RELAXED);
+        if (task >= total_tasks) {
+            break;
+        }
+
+        bench_result_t *r = &ctx->results[task / ctx->sample_count];
+        bench_sample_t *sample = &ctx->samples[task % ctx->sample_count];
+        unsigned char *packed = NULL;
+        size_t packed_len = 0;
+        int result = SUCCESS;
+
+        double start = bench_now(CLOCK_THREAD_CPUTIME_ID);
+        if (r->type == COMPRESS_NONE) {
+            // 비압축 기준선: 버퍼 복사 비용
+            packed = malloc(sample->len);
+            if (packed) {
+                memcpy(packed, sample->data, sample->len);
+                packed_len = sample->len;
+            } else {
+                result = ERROR_MEMORY;
+            }
+        } else {
+            result = compress_buffer(r->type, r->level, sample->data, sample->len, &packed, &packed_len);
+        }
+        double elapsed = bench_now(CLOCK_THREAD_CPUTIME_ID) - start;
+        free(packed);
+
+        pthread_mutex_lock(&ctx->mutex);
+        if (result == SUCCESS) {
+            r->in_bytes += sample->len;
+            r->out_bytes += packed_len;
+            r->cpu_seconds += elapsed;
+        } else {
+            ctx->failures++;
+        }
+        pthread_mutex_unlock(&ctx->mutex);
+    }
+
+    return NULL;
+}
+
+static double bench_mbps(const bench_result_t *r) {
+    if (r->cpu_seconds <= 0.0) return 0.0;
+    return r->in_bytes / (1024.0 * 1024.0) / r->cpu_seconds;
+}
+
+static double bench_ratio(const bench_result_t *r) {
+    if (r->in_bytes == 0) return 1.0;
+    return (double)r->out_bytes / r->in_bytes;
+}
+
+// 전체 트리 예상 시간: CPU 처리량(코어 수만큼 확장)과 샘플 읽기 속도 중 느린 쪽
+static double bench_project_time(const bench_result_t *r, size_t total_bytes, int jobs,
+                                 int cpu_count, double read_bps) {
+    double mbps = bench_mbps(r);
+    double cpu_time, io_time = 0.0;
+
+    if (mbps <= 0.0) return 0.0;
+
+    cpu_time = total_bytes / (mbps * 1024.0 * 1024.0) / MIN(jobs, cpu_count);
+    if (read_bps > 0.0) {
+        io_time = total_bytes / read_bps;
+    }
+    return MAX(cpu_time, io_time);
+}
+
+// 설정 파일의 키를 갱신 (없으면 추가, 주석과 다른 키는 유지).
+// 줄 끝(CRLF/LF)과 마지막 줄바꿈 유무는 기존 파일을 따름
+static int bench_write_config(const char *config_path, compression_type_t type, int level, int threads) {
+    const char *keys[] = {"compression", "compression_level", "num_threads"};
+    char values[3][32];
+    int written[3] = {0, 0, 0};
+    char tmp_path[MAX_PATH];
+    char line[1024];
+    const char *eol = NULL;       // 기존 파일의 줄 끝 (처음 줄바꿈에서 정함)
+    int trailing_newline = 1;     // 기존 파일이 줄바꿈으로 끝나는지
+    FILE *in, *out;
+
+    snprintf(values[0], sizeof(values[0]), "%s", bench_codec_name(type));
+    snprintf(values[1], sizeof(values[1]), "%d", level);
+    snprintf(values[2], sizeof(values[2]), "%d", threads);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", config_path);
+
+    out = fopen(tmp_path, "w");
+    if (!out) {
+        log_error("설정 파일 생성 실패: %s", tmp_path);
+        return ERROR_FILE_WRITE;
+    }
+
+    in = fopen(config_path, "r");
+    if (in) {
+        while (fgets(line, sizeof(line), in)) {
+            size_t len = strlen(line);
+            int replaced = 0;
+
+            trailing_newline = len > 0 && line[len - 1] == '\n';
+            if (!eol && trailing_newline) {
+                eol = (len > 1 && line[len - 2] == '\r') ? "\r\n" : "\n";
+            }
+            for (int i = 0; i < 3; i++) {
+                size_t key_len = strlen(keys[i]);
+                if (strncmp(line, keys[i], key_len) == 0 && line[key_len] == '=') {
+                    fprintf(out, "%s=%s%s", keys[i], values[i], trailing_newline ? eol : "");
+                    written[i] = 1;
+                    replaced = 1;
+                    break;
+                }
+            }
+            if (!replaced) {
+                fputs(line, out);
+            }
+        }
+        fclose(in);
+    }
+
+    if (!eol) {
+        eol = "\n";
+    }
+    for (int i = 0; i < 3; i++) {
+        if (!written[i]) {
+            if (trailing_newline) {
+                fprintf(out, "%s=%s%s", keys[i], values[i], eol);
+            } else {
+                fprintf(out, "%s%s=%s", eol, keys[i], values[i]);
+            }
+        }
+    }
+
+    if (fclose(out) != 0 || rename(tmp_path, config_path) != 0) {
+        log_error("설정 파일 쓰기 실패: %s", config_path);
+        unlink(tmp_path);
+        return ERROR_FILE_WRITE;
+    }
+
+    return SUCCESS;
+}
+
+int run_compress_bench(const char *path, const backup_options_t *opts) {
+    bench_scan_t scan = {0};
+    bench_ctx_t ctx;
+    bench_sample_t *samples = NULL;
+    pthread_t threads[MAX_THREADS];
+    size_t sample_count, sample_bytes = 0;
+    int cpu_count, workers, started = 0;
+    double read_start, read_seconds, read_bps = 0.0, wall_start, wall_seconds, cpu_total = 0.0;
+    char size_buf[32], size_buf2[32], time_buf[32];
+    int result = SUCCESS;
+
+    if (!is_directory(path)) {
+        printf("오류: 디렉토리가 아닙니다: %s\n", path);
+        return ERROR_INVALID_PARAMS;
+    }
+
+    cpu_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count < 1) cpu_count = 1;
+    workers = MAX(1, MIN(opts->threads, cpu_count));
+
+    printf("파일 스캔 중: %s\n", path);
+    if (bench_scan_directory(path, opts, &scan) != SUCCESS) {
+        bench_free_scan(&scan);
+        return ERROR_MEMORY;
+    }
+
+    if (scan.count == 0 || scan.total_bytes == 0) {
+        printf("오류: 샘플링할 데이터가 없습니다: %s\n", path);
+        bench_free_scan(&scan);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    read_start = bench_now(CLOCK_MONOTONIC);
+    sample_count = bench_pick_samples(&scan, BENCH_DEFAULT_SAMPLE, &samples);
+    read_seconds = bench_now(CLOCK_MONOTONIC) - read_start;
+
+    for (size_t i = 0; i < sample_count; i++) {
+        sample_bytes += samples[i].len;
+    }
+    if (read_seconds > 0.0) {
+        read_bps = sample_bytes / read_seconds;
+    }
+
+    if (sample_count == 0) {
+        printf("오류: 샘플 파일을 읽을 수 없습니다\n");
+        free(samples);
+        bench_free_scan(&scan);
+        return ERROR_FILE_READ;
+    }
+
+    // 벤치마크 대상: 비압축 기준선 + 모든 deflate 코덱/레벨
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.samples = samples;
+    ctx.sample_count = sample_count;
+    ctx.result_count = 1 + 2 * BENCH_LEVEL_COUNT;
+    ctx.results = calloc(ctx.result_count, sizeof(bench_result_t));
+    if (!ctx.results) {
+        result = ERROR_MEMORY;
+        goto cleanup;
+    }
+    pthread_mutex_init(&ctx.mutex, NULL);
+
+    ctx.results[0].type = COMPRESS_NONE;
+    for (int i = 0; i < BENCH_LEVEL_COUNT; i++) {
+        ctx.results[1 + i].type = COMPRESS_GZIP;
+        ctx.results[1 + i].level = bench_levels[i];
+        ctx.results[1 + BENCH_LEVEL_COUNT + i].type = COMPRESS_ZLIB;
+        ctx.results[1 + BENCH_LEVEL_COUNT + i].level = bench_levels[i];
+    }
+
+    format_size(scan.total_bytes, size_buf, sizeof(size_buf));
+    format_size(sample_bytes, size_buf2, sizeof(size_buf2));
+    printf("\n=== 압축 벤치마크: %s ===\n", path);
+    printf("전체: %zu개 파일, %s / 샘플: %zu개 파일, %s\n", scan.count, size_buf, sample_count, size_buf2);
+    printf("CPU: %d개, 워커: %d개, deflate 백엔드: %s\n\n",
+           cpu_count, workers, get_deflate_backend_name(get_deflate_backend()));
+
+    wall_start = bench_now(CLOCK_MONOTONIC);
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, bench_worker, &ctx) != 0) {
+            log_warning("벤치마크 스레드 생성 실패");
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        bench_worker(&ctx);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    wall_seconds = bench_now(CLOCK_MONOTONIC) - wall_start;
+
+    if (ctx.failures > 0) {
+        log_warning("벤치마크 실패한 작업: %d개", ctx.failures);
+    }
+
+    // 한글 헤더는 바이트 수와 화면 폭이 달라 직접 정렬
+    printf("코덱    레벨   MB/s/코어   압축률     예상 크기\n");
+    for (size_t i = 0; i < ctx.result_count; i++) {
+        bench_result_t *r = &ctx.results[i];
+        char level_buf[8];
+        cpu_total += r->cpu_seconds;
+        snprintf(level_buf, sizeof(level_buf), r->type == COMPRESS_NONE ? "-" : "%d", r->level);
+        format_size(scan.total_bytes * bench_ratio(r), size_buf, sizeof(size_buf));
+        printf("%-6s %5s %11.1f %7.1f%% %13s\n", bench_codec_name(r->type), level_buf,
+               bench_mbps(r), bench_ratio(r) * 100.0, size_buf);
+    }
+
+    if (wall_seconds > 0.0) {
+        printf("\n병렬 효율: %.0f%% (CPU %.2fs / 경과 %.2fs x %d 워커)\n",
+               cpu_total / (wall_seconds * MAX(started, 1)) * 100.0, cpu_total, wall_seconds, MAX(started, 1));
+    }
+    if (read_bps > 0.0) {
+        format_size(read_bps, size_buf, sizeof(size_buf));
+        printf("샘플 읽기 속도: %s/s\n", size_buf);
+    }
+
+    printf("\n전체 트리 예상 소요 시간:\n코덱/레벨   ");
+    for (int j = 0; j < BENCH_JOB_COUNT; j++) {
+        char label[16];
+        snprintf(label, sizeof(label), "-j%d", bench_jobs[j]);
+        printf(" %8s", label);
+    }
+    printf("\n");
+    for (size_t i = 0; i < ctx.result_count; i++) {
+        bench_result_t *r = &ctx.results[i];
+        char label[32];
+        if (r->type == COMPRESS_NONE) {
+            snprintf(label, sizeof(label), "%s", bench_codec_name(r->type));
+        } else {
+            snprintf(label, sizeof(label), "%s/%d", bench_codec_name(r->type), r->level);
+        }
+        printf("%-12s", label);
+        for (int j = 0; j < BENCH_JOB_COUNT; j++) {
+            format_duration(bench_project_time(r, scan.total_bytes, bench_jobs[j], cpu_count, read_bps),
+                            time_buf, sizeof(time_buf));
+            printf(" %8s", time_buf);
+        }
+        printf("\n");
+    }
+
+    // 추천: 최소 출력 크기의 5% 이내에서 가장 빠른 코덱/레벨
+    {
+        bench_result_t *best = &ctx.results[0];
+        size_t min_out = SIZE_MAX;
+        int best_jobs = 1;
+        double best_time;
+
+        for (size_t i = 1; i < ctx.result_count; i++) {
+            if (ctx.results[i].in_bytes > 0) {
+                min_out = MIN(min_out, ctx.results[i].out_bytes);
+            }
+        }
+
+        if (min_out != SIZE_MAX && (double)min_out / ctx.results[0].in_bytes < BENCH_INCOMPRESSIBLE) {
+            best = NULL;
+            for (size_t i = 1; i < ctx.result_count; i++) {
+                bench_result_t *r = &ctx.results[i];
+                if (r->in_bytes == 0 || r->out_bytes > min_out * BENCH_SIZE_TOLERANCE) {
+                    continue;
+                }
+                // gzip과 zlib은 같은 deflate이므로 확실히 빠르지 않으면 표준 gzip 우선
+                if (!best || bench_mbps(r) > bench_mbps(best) * BENCH_TIME_TOLERANCE) {
+                    best = r;
+                }
+            }
+        }
+
+        // 스레드: 최소 예상 시간의 10% 이내인 가장 작은 -j
+        best_time = bench_project_time(best, scan.total_bytes, bench_jobs[BENCH_JOB_COUNT - 1],
+                                       cpu_count, read_bps);
+        for (int j = 0; j < BENCH_JOB_COUNT; j++) {
+            if (bench_jobs[j] > MAX_THREADS) break;
+            if (bench_project_time(best, scan.total_bytes, bench_jobs[j], cpu_count, read_bps)
+                <= best_time * BENCH_TIME_TOLERANCE) {
+                best_jobs = bench_jobs[j];
+                break;
+            }
+        }
+
+        int best_level = best->type == COMPRESS_NONE ? 1 : best->level;
+        printf("\n추천 프로파일:\n");
+        printf("  compression=%s\n", bench_codec_name(best->type));
+        printf("  compression_level=%d\n", best_level);
+        printf("  num_threads=%d\n", best_jobs);
+
+        if (opts->write_config[0] != '\0') {
+            result = bench_write_config(opts->write_config, best->type, best_level, best_jobs);
+            if (result == SUCCESS) {
+                printf("설정 파일 갱신 완료: %s\n", opts->write_config);
+            }
+        }
+    }
+
+    pthread_mutex_destroy(&ctx.mutex);
+
+cleanup:
+    free(ctx.results);
+    for (size_t i = 0; i < sample_count; i++) {
+        free(samples[i].data);
+    }
+    free(samples);
+    bench_free_scan(&scan);
+    return result;
+}
+
+// ===== 해시 벤치마크 (hash-bench 명령) =====
+//
+// 메모리 버퍼를 복사 루프와 같은 BUFFER_SIZE 단위로 해시해 알고리즘별 코어당 처리량을 측정합니다.
+// BLAKE3는 큰 단위 갱신(checksum_file 읽기 크기)으로 다중 스레드 처리량도 함께 측정합니다.
+
+#define HASH_BENCH_BYTES (64 * 1024 * 1024)
+#define HASH_BENCH_MIN_SECONDS 0.5
+#define HASH_BENCH_LARGE_UPDATE (1024 * 1024)
+
+typedef struct {
+    checksum_type_t type;
+    int threads;
+    size_t update_size;
+} hash_bench_case_t;
+
+static void hash_bench_fill(unsigned char *buf, size_t len) {
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+
+    // xorshift64: 압축/중복 제거와 무관한 임의 데이터
+    for (size_t i = 0; i + 8 <= len; i += 8) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(buf + i, &x, 8);
+    }
+}
+
+static void hash_bench_run(const hash_bench_case_t *c, const unsigned char *buf, size_t len,
+                           double *cpu_seconds, double *wall_seconds, size_t *bytes) {
+    double cpu_start = bench_now(CLOCK_PROCESS_CPUTIME_ID);
+    double wall_start = bench_now(CLOCK_MONOTONIC);
+    char hex[MAX_DIGEST_HEX];
+
+    blake3_set_max_threads(c->threads);
+    *bytes = 0;
+
+    do {
+        checksum_ctx_t ctx;
+
+        checksum_init(&ctx, c->type);
+        for (size_t off = 0; off < len; off += c->update_size) {
+            checksum_update(&ctx, buf + off, MIN(c->update_size, len - off));
+        }
+        checksum_final_hex(&ctx, hex);
+        *bytes += len;
+    } while (bench_now(CLOCK_MONOTONIC) - wall_start < HASH_BENCH_MIN_SECONDS);
+
+    *cpu_seconds = bench_now(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+    *wall_seconds = bench_now(CLOCK_MONOTONIC) - wall_start;
+}
+
+int run_hash_bench(const backup_options_t *opts) {
+    hash_bench_case_t cases[8];
+    int case_count = 0;
+    unsigned char *buf;
+    double md5_gbps = 0.0;
+    int cpu_count, threads;
+
+    cpu_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count < 1) cpu_count = 1;
+    threads = MAX(1, MIN(opts->threads, cpu_count));
+
+    buf = malloc(HASH_BENCH_BYTES);
+    if (!buf) {
+        return ERROR_MEMORY;
+    }
+    hash_bench_fill(buf, HASH_BENCH_BYTES);
+
+    cases[case_count++] = (hash_bench_case_t){CHECKSUM_MD5, 1, BUFFER_SIZE};
+    cases[case_count++] = (hash_bench_case_t){CHECKSUM_SHA1, 1, BUFFER_SIZE};
+    cases[case_count++] = (hash_bench_case_t){CHECKSUM_SHA256, 1, BUFFER_SIZE};
+    cases[case_count++] = (hash_bench_case_t){CHECKSUM_CRC32, 1, BUFFER_SIZE};
+    cases[case_count++] = (hash_bench_case_t){CHECKSUM_XXH3, 1, BUFFER_SIZE};
+    cases[case_count++] = (hash_bench_case_t){CHECKSUM_BLAKE3, 1, BUFFER_SIZE};
+    cases[case_count++] = (hash_bench_case_t){CHECKSUM_BLAKE3, 1, HASH_BENCH_LARGE_UPDATE};
+    if (threads > 1) {
+        cases[case_count++] = (hash_bench_case_t){CHECKSUM_BLAKE3, threads, HASH_BENCH_LARGE_UPDATE};
+    }
+
+    printf("\n=== 해시 벤치마크 ===\n");
+    printf("데이터: %d MB (메모리), CPU: %d개, BLAKE3 구현: %s\n\n",
+           HASH_BENCH_BYTES / (1024 * 1024), cpu_count, blake3_implementation());
+    printf("알고리즘  스레드  갱신 단위   GB/s/코어  GB/s(경과)  MD5 대비\n");
+
+    for (int i = 0; i < case_count; i++) {
+        double cpu_seconds, wall_seconds, per_core, wall_gbps;
+        size_t bytes;
+        char unit_buf[32];
+
+        hash_bench_run(&cases[i], buf, HASH_BENCH_BYTES, &cpu_seconds, &wall_seconds, &bytes);
+        per_core = cpu_seconds > 0.0 ? bytes / cpu_seconds / 1e9 : 0.0;
+        wall_gbps = wall_seconds > 0.0 ? bytes / wall_seconds / 1e9 : 0.0;
+        if (cases[i].type == CHECKSUM_MD5) {
+            md5_gbps = per_core;
+        }
+
+        format_size(cases[i].update_size, unit_buf, sizeof(unit_buf));
+        printf("%-8s %6d %10s %10.2f %11.2f %8.1fx\n", get_checksum_name(cases[i].type),
+               cases[i].threads, unit_buf, per_core, wall_gbps,
+               md5_gbps > 0.0 ? per_core / md5_gbps : 0.0);
+    }
+
+    init_checksum(opts);
+    free(buf);
+    return SUCCESS;
+}
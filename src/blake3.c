@@ -0,0 +1,699 @@
+#include "backup.h"
+
+// BLAKE3 해시 (기본 해시 모드, 32바이트 출력)
+//
+// 전체 청크(1KB)는 BLAKE3_SIMD_DEGREE개씩 묶어 벡터 레인 하나에 청크 하나를 배치해 압축하고,
+// 큰 입력은 서브트리 단위로 나눠 여러 스레드에서 동시에 계산합니다.
+// 트리 구성과 병합 순서는 BLAKE3 명세의 참조 구현과 동일합니다.
+
+#define BLAKE3_CHUNK_START 1
+#define BLAKE3_CHUNK_END 2
+#define BLAKE3_PARENT 4
+#define BLAKE3_ROOT 8
+
+// 한 번에 압축하는 청크 수 (GCC 벡터 확장, SSE2/NEON 등으로 컴파일됨)
+#define BLAKE3_SIMD_DEGREE 8
+#define BLAKE3_MAX_SIMD_DEGREE_OR_2 (BLAKE3_SIMD_DEGREE > 2 ? BLAKE3_SIMD_DEGREE : 2)
+
+// 이보다 작은 서브트리는 스레드를 나누지 않음 (스레드 생성 비용 대비)
+#define BLAKE3_MT_MIN_LEN (512 * 1024)
+
+static const uint32_t blake3_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint8_t blake3_schedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13}
+};
+
+static int blake3_max_threads = 1;
+
+static uint32_t load_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void store_le32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static void store_cv(unsigned char *out, const uint32_t cv[8]) {
+    for (int i = 0; i < 8; i++) {
+        store_le32(out + i * 4, cv[i]);
+    }
+}
+
+// ===== 단일 블록 압축 =====
+
+#define B3_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define B3_G(v, a, b, c, d, x, y) do {          \
+        v[a] = v[a] + v[b] + (x);               \
+        v[d] = B3_ROTR(v[d] ^ v[a], 16);        \
+        v[c] = v[c] + v[d];                     \
+        v[b] = B3_ROTR(v[b] ^ v[c], 12);        \
+        v[a] = v[a] + v[b] + (y);               \
+        v[d] = B3_ROTR(v[d] ^ v[a], 8);         \
+        v[c] = v[c] + v[d];                     \
+        v[b] = B3_ROTR(v[b] ^ v[c], 7);         \
+    } while (0)
+
+#define B3_ROUND(v, m, s) do {                                  \
+        B3_G(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);                 \
+        B3_G(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);                 \
+        B3_G(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);                \
+        B3_G(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);                \
+        B3_G(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);                \
+        B3_G(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);              \
+        B3_G(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);               \
+        B3_G(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);               \
+    } while (0)
+
+static void blake3_compress(uint32_t cv[8], const unsigned char block[BLAKE3_BLOCK_LEN],
+                            uint8_t block_len, uint64_t counter, uint8_t flags) {
+    uint32_t m[16];
+    uint32_t v[16];
+
+    for (int i = 0; i < 16; i++) {
+        m[i] = load_le32(block + i * 4);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        v[i] = cv[i];
+    }
+    v[8] = blake3_iv[0];
+    v[9] = blake3_iv[1];
+    v[10] = blake3_iv[2];
+    v[11] = blake3_iv[3];
+    v[12] = (uint32_t)counter;
+    v[13] = (uint32_t)(counter >> 32);
+    v[14] = block_len;
+    v[15] = flags;
+
+    for (int r = 0; r < 7; r++) {
+        B3_ROUND(v, m, blake3_schedule[r]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        cv[i] = v[i] ^ v[i + 8];
+    }
+}
+
+// ===== 다중 입력 압축 (레인마다 입력 하나) =====
+//
+// 벡터 한 개에 BLAKE3_SIMD_DEGREE개 입력의 같은 워드를 담아 G 함수를 레인별로 동시에 계산합니다.
+// x86에서는 AVX2 버전을 따로 컴파일해 런타임에 선택합니다 (전치 로드, 바이트 셔플 회전).
+
+typedef uint32_t b3_vec_t __attribute__((vector_size(BLAKE3_SIMD_DEGREE * 4)));
+typedef uint8_t b3_bytes_t __attribute__((vector_size(BLAKE3_SIMD_DEGREE * 4)));
+
+#define B3_INLINE static inline __attribute__((always_inline))
+
+#define B3_SPLAT(x) ((b3_vec_t){0} + (uint32_t)(x))
+
+// 16/8비트 회전은 fast일 때 바이트 셔플 한 번으로
+#define B3_ROT16_MASK ((b3_bytes_t){2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, \
+                                    18, 19, 16, 17, 22, 23, 20, 21, 26, 27, 24, 25, 30, 31, 28, 29})
+#define B3_ROT8_MASK ((b3_bytes_t){1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12, \
+                                   17, 18, 19, 16, 21, 22, 23, 20, 25, 26, 27, 24, 29, 30, 31, 28})
+#define B3_VROTR16(x, fast) \
+    ((fast) ? (b3_vec_t)__builtin_shuffle((b3_bytes_t)(x), B3_ROT16_MASK) : B3_ROTR(x, 16))
+#define B3_VROTR8(x, fast) \
+    ((fast) ? (b3_vec_t)__builtin_shuffle((b3_bytes_t)(x), B3_ROT8_MASK) : B3_ROTR(x, 8))
+
+#define B3_VG(v, a, b, c, d, x, y, fast) do {   \
+        v[a] = v[a] + v[b] + (x);               \
+        v[d] = B3_VROTR16(v[d] ^ v[a], fast);   \
+        v[c] = v[c] + v[d];                     \
+        v[b] = B3_ROTR(v[b] ^ v[c], 12);        \
+        v[a] = v[a] + v[b] + (y);               \
+        v[d] = B3_VROTR8(v[d] ^ v[a], fast);    \
+        v[c] = v[c] + v[d];                     \
+        v[b] = B3_ROTR(v[b] ^ v[c], 7);         \
+    } while (0)
+
+// 레인 8개의 32바이트(워드 8개)를 읽어 워드별 벡터로 전치 (out[w][lane])
+B3_INLINE void b3_load_transposed(const unsigned char *const *inputs, size_t offset, b3_vec_t out[8]) {
+    b3_vec_t r[8], a[8], b[8];
+
+    for (int lane = 0; lane < 8; lane++) {
+        memcpy(&r[lane], inputs[lane] + offset, sizeof(b3_vec_t));
+    }
+    for (int i = 0; i < 8; i += 2) {
+        a[i] = __builtin_shuffle(r[i], r[i + 1], (b3_vec_t){0, 8, 2, 10, 4, 12, 6, 14});
+        a[i + 1] = __builtin_shuffle(r[i], r[i + 1], (b3_vec_t){1, 9, 3, 11, 5, 13, 7, 15});
+    }
+    for (int i = 0; i < 8; i += 4) {
+        b[i] = __builtin_shuffle(a[i], a[i + 2], (b3_vec_t){0, 1, 8, 9, 4, 5, 12, 13});
+        b[i + 1] = __builtin_shuffle(a[i + 1], a[i + 3], (b3_vec_t){0, 1, 8, 9, 4, 5, 12, 13});
+        b[i + 2] = __builtin_shuffle(a[i], a[i + 2], (b3_vec_t){2, 3, 10, 11, 6, 7, 14, 15});
+        b[i + 3] = __builtin_shuffle(a[i + 1], a[i + 3], (b3_vec_t){2, 3, 10, 11, 6, 7, 14, 15});
+    }
+    for (int i = 0; i < 4; i++) {
+        out[i] = __builtin_shuffle(b[i], b[i + 4], (b3_vec_t){0, 1, 2, 3, 8, 9, 10, 11});
+        out[i + 4] = __builtin_shuffle(b[i], b[i + 4], (b3_vec_t){4, 5, 6, 7, 12, 13, 14, 15});
+    }
+}
+
+B3_INLINE void b3_load_gather(const unsigned char *const *inputs, size_t offset, b3_vec_t out[16]) {
+    uint32_t lanes[BLAKE3_SIMD_DEGREE];
+
+    for (int w = 0; w < 16; w++) {
+        for (int lane = 0; lane < BLAKE3_SIMD_DEGREE; lane++) {
+            lanes[lane] = load_le32(inputs[lane] + offset + w * 4);
+        }
+        memcpy(&out[w], lanes, sizeof(lanes));
+    }
+}
+
+// fast: 전치 로드와 셔플 회전 사용 (바이트 셔플 명령이 있는 대상에서만)
+B3_INLINE void hash_many_kernel(const unsigned char *const *inputs, size_t blocks, const uint32_t key[8],
+                                uint64_t counter, int increment_counter, uint8_t flags,
+                                uint8_t flags_start, uint8_t flags_end, unsigned char *out, int fast) {
+    b3_vec_t h[8], v[16], m[16];
+    b3_vec_t counter_lo, counter_hi;
+    uint8_t block_flags = flags | flags_start;
+
+    for (int i = 0; i < 8; i++) {
+        h[i] = B3_SPLAT(key[i]);
+    }
+
+    for (int lane = 0; lane < BLAKE3_SIMD_DEGREE; lane++) {
+        uint64_t c = counter + (increment_counter ? (uint64_t)lane : 0);
+        counter_lo[lane] = (uint32_t)c;
+        counter_hi[lane] = (uint32_t)(c >> 32);
+    }
+
+    for (size_t b = 0; b < blocks; b++) {
+        size_t offset = b * BLAKE3_BLOCK_LEN;
+
+        if (b + 1 == blocks) {
+            block_flags |= flags_end;
+        }
+
+        if (fast) {
+            b3_load_transposed(inputs, offset, m);
+            b3_load_transposed(inputs, offset + 32, m + 8);
+        } else {
+            b3_load_gather(inputs, offset, m);
+        }
+
+        for (int i = 0; i < 8; i++) {
+            v[i] = h[i];
+        }
+        v[8] = B3_SPLAT(blake3_iv[0]);
+        v[9] = B3_SPLAT(blake3_iv[1]);
+        v[10] = B3_SPLAT(blake3_iv[2]);
+        v[11] = B3_SPLAT(blake3_iv[3]);
+        v[12] = counter_lo;
+        v[13] = counter_hi;
+        v[14] = B3_SPLAT(BLAKE3_BLOCK_LEN);
+        v[15] = B3_SPLAT(block_flags);
+
+        for (int r = 0; r < 7; r++) {
+            const uint8_t *s = blake3_schedule[r];
+            B3_VG(v, 0, 4, 8, 12, m[s[0]], m[s[1]], fast);
+            B3_VG(v, 1, 5, 9, 13, m[s[2]], m[s[3]], fast);
+            B3_VG(v, 2, 6, 10, 14, m[s[4]], m[s[5]], fast);
+            B3_VG(v, 3, 7, 11, 15, m[s[6]], m[s[7]], fast);
+            B3_VG(v, 0, 5, 10, 15, m[s[8]], m[s[9]], fast);
+            B3_VG(v, 1, 6, 11, 12, m[s[10]], m[s[11]], fast);
+            B3_VG(v, 2, 7, 8, 13, m[s[12]], m[s[13]], fast);
+            B3_VG(v, 3, 4, 9, 14, m[s[14]], m[s[15]], fast);
+        }
+
+        for (int i = 0; i < 8; i++) {
+            h[i] = v[i] ^ v[i + 8];
+        }
+        block_flags = flags;
+    }
+
+    for (int lane = 0; lane < BLAKE3_SIMD_DEGREE; lane++) {
+        for (int i = 0; i < 8; i++) {
+            store_le32(out + lane * BLAKE3_OUT_LEN + i * 4, h[i][lane]);
+        }
+    }
+}
+
+static void hash_many_portable(const unsigned char *const *inputs, size_t blocks, const uint32_t key[8],
+                               uint64_t counter, int increment_counter, uint8_t flags,
+                               uint8_t flags_start, uint8_t flags_end, unsigned char *out) {
+    hash_many_kernel(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out, 0);
+}
+
+#if defined(__x86_64__) && defined(__GNUC__) && BLAKE3_SIMD_DEGREE == 8
+#define BLAKE3_HAVE_AVX2 1
+
+__attribute__((target("avx2")))
+static void hash_many_avx2(const unsigned char *const *inputs, size_t blocks, const uint32_t key[8],
+                           uint64_t counter, int increment_counter, uint8_t flags,
+                           uint8_t flags_start, uint8_t flags_end, unsigned char *out) {
+    hash_many_kernel(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out, 1);
+}
+#endif
+
+// AVX2 사용 여부 (-1 = 아직 확인 전)
+static int blake3_avx2 = -1;
+
+static int blake3_use_avx2(void) {
+#ifdef BLAKE3_HAVE_AVX2
+    int avx2 = __atomic_load_n(&blake3_avx2, __ATOMIC_RELAXED);
+
+    if (avx2 < 0) {
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&blake3_avx2, avx2, __ATOMIC_RELAXED);
+    }
+    return avx2;
+#else
+    return 0;
+#endif
+}
+
+const char *blake3_implementation(void) {
+    return blake3_use_avx2() ? "avx2" : "portable-simd";
+}
+
+static void hash_one(const unsigned char *input, size_t blocks, const uint32_t key[8],
+                     uint64_t counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end,
+                     unsigned char *out) {
+    uint32_t cv[8];
+    uint8_t block_flags = flags | flags_start;
+
+    memcpy(cv, key, sizeof(cv));
+    for (size_t b = 0; b < blocks; b++) {
+        if (b + 1 == blocks) {
+            block_flags |= flags_end;
+        }
+        blake3_compress(cv, input + b * BLAKE3_BLOCK_LEN, BLAKE3_BLOCK_LEN, counter, block_flags);
+        block_flags = flags;
+    }
+    store_cv(out, cv);
+}
+
+// 같은 길이(blocks개 블록)의 입력 여러 개를 압축해 입력마다 CV 하나씩 출력
+static void hash_many(const unsigned char *const *inputs, size_t num_inputs, size_t blocks,
+                      const uint32_t key[8], uint64_t counter, int increment_counter, uint8_t flags,
+                      uint8_t flags_start, uint8_t flags_end, unsigned char *out) {
+    while (num_inputs >= BLAKE3_SIMD_DEGREE) {
+#ifdef BLAKE3_HAVE_AVX2
+        if (blake3_use_avx2()) {
+            hash_many_avx2(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+        } else
+#endif
+        hash_many_portable(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+        if (increment_counter) {
+            counter += BLAKE3_SIMD_DEGREE;
+        }
+        inputs += BLAKE3_SIMD_DEGREE;
+        num_inputs -= BLAKE3_SIMD_DEGREE;
+        out += BLAKE3_SIMD_DEGREE * BLAKE3_OUT_LEN;
+    }
+
+    while (num_inputs > 0) {
+        hash_one(inputs[0], blocks, key, counter, flags, flags_start, flags_end, out);
+        if (increment_counter) {
+            counter++;
+        }
+        inputs++;
+        num_inputs--;
+        out += BLAKE3_OUT_LEN;
+    }
+}
+
+// ===== 청크 상태 =====
+
+static void chunk_state_init(blake3_chunk_state_t *self, const uint32_t key[8], uint64_t chunk_counter) {
+    memcpy(self->cv, key, sizeof(self->cv));
+    self->chunk_counter = chunk_counter;
+    memset(self->buf, 0, sizeof(self->buf));
+    self->buf_len = 0;
+    self->blocks_compressed = 0;
+    self->flags = 0;
+}
+
+static size_t chunk_state_len(const blake3_chunk_state_t *self) {
+    return (size_t)BLAKE3_BLOCK_LEN * self->blocks_compressed + self->buf_len;
+}
+
+static uint8_t chunk_state_start_flag(const blake3_chunk_state_t *self) {
+    return self->blocks_compressed == 0 ? BLAKE3_CHUNK_START : 0;
+}
+
+static void chunk_state_update(blake3_chunk_state_t *self, const unsigned char *input, size_t len) {
+    while (len > 0) {
+        if (self->buf_len == BLAKE3_BLOCK_LEN) {
+            blake3_compress(self->cv, self->buf, BLAKE3_BLOCK_LEN, self->chunk_counter,
+                            self->flags | chunk_state_start_flag(self));
+            self->blocks_compressed++;
+            self->buf_len = 0;
+            memset(self->buf, 0, sizeof(self->buf));
+        }
+
+        size_t take = MIN((size_t)(BLAKE3_BLOCK_LEN - self->buf_len), len);
+        memcpy(self->buf + self->buf_len, input, take);
+        self->buf_len += (uint8_t)take;
+        input += take;
+        len -= take;
+    }
+}
+
+// 압축 직전 상태 (CV 또는 루트 출력으로 마무리)
+typedef struct {
+    uint32_t input_cv[8];
+    unsigned char block[BLAKE3_BLOCK_LEN];
+    uint8_t block_len;
+    uint64_t counter;
+    uint8_t flags;
+} blake3_output_t;
+
+static blake3_output_t chunk_state_output(const blake3_chunk_state_t *self) {
+    blake3_output_t output;
+
+    memcpy(output.input_cv, self->cv, sizeof(output.input_cv));
+    memcpy(output.block, self->buf, sizeof(output.block));
+    output.block_len = self->buf_len;
+    output.counter = self->chunk_counter;
+    output.flags = self->flags | chunk_state_start_flag(self) | BLAKE3_CHUNK_END;
+    return output;
+}
+
+static blake3_output_t parent_output(const unsigned char block[BLAKE3_BLOCK_LEN], const uint32_t key[8],
+                                     uint8_t flags) {
+    blake3_output_t output;
+
+    memcpy(output.input_cv, key, sizeof(output.input_cv));
+    memcpy(output.block, block, sizeof(output.block));
+    output.block_len = BLAKE3_BLOCK_LEN;
+    output.counter = 0;
+    output.flags = flags | BLAKE3_PARENT;
+    return output;
+}
+
+static void output_chaining_value(const blake3_output_t *self, unsigned char cv_out[BLAKE3_OUT_LEN]) {
+    uint32_t cv[8];
+
+    memcpy(cv, self->input_cv, sizeof(cv));
+    blake3_compress(cv, self->block, self->block_len, self->counter, self->flags);
+    store_cv(cv_out, cv);
+}
+
+static void output_root_bytes(const blake3_output_t *self, unsigned char out[BLAKE3_OUT_LEN]) {
+    uint32_t cv[8];
+
+    memcpy(cv, self->input_cv, sizeof(cv));
+    blake3_compress(cv, self->block, self->block_len, 0, self->flags | BLAKE3_ROOT);
+    store_cv(out, cv);
+}
+
+// ===== 서브트리 =====
+
+static size_t round_down_to_power_of_2(uint64_t x) {
+    uint64_t p = 1;
+
+    while (p <= x / 2) {
+        p <<= 1;
+    }
+    return (size_t)p;
+}
+
+// 왼쪽 서브트리 길이: len보다 작은 가장 큰 2의 거듭제곱 청크 수
+static size_t left_subtree_len(size_t len) {
+    size_t full_chunks = (len - 1) / BLAKE3_CHUNK_LEN;
+    return round_down_to_power_of_2(full_chunks) * BLAKE3_CHUNK_LEN;
+}
+
+static size_t compress_chunks_parallel(const unsigned char *input, size_t len, const uint32_t key[8],
+                                       uint64_t chunk_counter, uint8_t flags, unsigned char *out) {
+    const unsigned char *chunks[BLAKE3_SIMD_DEGREE];
+    size_t count = 0;
+
+    while (len - count * BLAKE3_CHUNK_LEN >= BLAKE3_CHUNK_LEN && count < BLAKE3_SIMD_DEGREE) {
+        chunks[count] = input + count * BLAKE3_CHUNK_LEN;
+        count++;
+    }
+
+    hash_many(chunks, count, BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN, key, chunk_counter, 1, flags,
+              BLAKE3_CHUNK_START, BLAKE3_CHUNK_END, out);
+
+    // 마지막 부분 청크 (있는 경우)
+    if (len > count * BLAKE3_CHUNK_LEN) {
+        blake3_chunk_state_t chunk;
+        blake3_output_t output;
+
+        chunk_state_init(&chunk, key, chunk_counter + count);
+        chunk.flags = flags;
+        chunk_state_update(&chunk, input + count * BLAKE3_CHUNK_LEN, len - count * BLAKE3_CHUNK_LEN);
+        output = chunk_state_output(&chunk);
+        output_chaining_value(&output, out + count * BLAKE3_OUT_LEN);
+        return count + 1;
+    }
+
+    return count;
+}
+
+static size_t compress_parents_parallel(const unsigned char *cvs, size_t num_cvs, const uint32_t key[8],
+                                        uint8_t flags, unsigned char *out) {
+    const unsigned char *parents[BLAKE3_MAX_SIMD_DEGREE_OR_2];
+    size_t count = 0;
+
+    while (num_cvs - 2 * count >= 2) {
+        parents[count] = cvs + 2 * count * BLAKE3_OUT_LEN;
+        count++;
+    }
+
+    hash_many(parents, count, 1, key, 0, 0, flags | BLAKE3_PARENT, 0, 0, out);
+
+    // 홀수 개면 마지막 CV는 그대로 다음 단계로
+    if (num_cvs > 2 * count) {
+        memcpy(out + count * BLAKE3_OUT_LEN, cvs + 2 * count * BLAKE3_OUT_LEN, BLAKE3_OUT_LEN);
+        return count + 1;
+    }
+
+    return count;
+}
+
+static size_t compress_subtree_wide(const unsigned char *input, size_t len, const uint32_t key[8],
+                                    uint64_t chunk_counter, uint8_t flags, unsigned char *out, int threads);
+
+typedef struct {
+    const unsigned char *input;
+    size_t len;
+    const uint32_t *key;
+    uint64_t chunk_counter;
+    uint8_t flags;
+    unsigned char *out;
+    int threads;
+    size_t result;
+} subtree_job_t;
+
+static void *subtree_thread(void *arg) {
+    subtree_job_t *job = (subtree_job_t *)arg;
+
+    job->result = compress_subtree_wide(job->input, job->len, job->key, job->chunk_counter,
+                                        job->flags, job->out, job->threads);
+    return NULL;
+}
+
+// 서브트리를 압축해 최대 MAX_SIMD_DEGREE_OR_2개의 CV를 out에 기록하고 개수 반환
+// threads > 1이고 입력이 충분히 크면 왼쪽 절반을 별도 스레드에서 계산
+static size_t compress_subtree_wide(const unsigned char *input, size_t len, const uint32_t key[8],
+                                    uint64_t chunk_counter, uint8_t flags, unsigned char *out, int threads) {
+    unsigned char cv_array[2 * BLAKE3_MAX_SIMD_DEGREE_OR_2 * BLAKE3_OUT_LEN];
+    size_t left_len, right_len, left_n = 0, right_n = 0;
+    unsigned char *right_cvs;
+    int degree = BLAKE3_SIMD_DEGREE;
+
+    if (len <= (size_t)BLAKE3_SIMD_DEGREE * BLAKE3_CHUNK_LEN) {
+        return compress_chunks_parallel(input, len, key, chunk_counter, flags, out);
+    }
+
+    left_len = left_subtree_len(len);
+    right_len = len - left_len;
+
+    // SIMD 폭이 1이어도 왼쪽이 여러 청크면 CV 2개를 돌려받아야 함
+    if (left_len > BLAKE3_CHUNK_LEN && degree == 1) {
+        degree = 2;
+    }
+    right_cvs = cv_array + degree * BLAKE3_OUT_LEN;
+
+    if (threads > 1 && right_len >= BLAKE3_MT_MIN_LEN) {
+        pthread_t thread;
+        subtree_job_t job = {input, left_len, key, chunk_counter, flags, cv_array, threads / 2, 0};
+
+        if (pthread_create(&thread, NULL, subtree_thread, &job) == 0) {
+            right_n = compress_subtree_wide(input + left_len, right_len, key,
+                                            chunk_counter + left_len / BLAKE3_CHUNK_LEN, flags,
+                                            right_cvs, threads - threads / 2);
+            pthread_join(thread, NULL);
+            left_n = job.result;
+        } else {
+            threads = 1; // 스레드 생성 실패 시 현재 스레드에서 순차 처리
+        }
+    }
+
+    if (threads <= 1 || right_len < BLAKE3_MT_MIN_LEN) {
+        left_n = compress_subtree_wide(input, left_len, key, chunk_counter, flags, cv_array, 1);
+        right_n = compress_subtree_wide(input + left_len, right_len, key,
+                                        chunk_counter + left_len / BLAKE3_CHUNK_LEN, flags, right_cvs, 1);
+    }
+
+    // 왼쪽이 청크 하나면 오른쪽도 하나 (CV 2개를 그대로 반환)
+    if (left_n == 1) {
+        memcpy(out, cv_array, 2 * BLAKE3_OUT_LEN);
+        return 2;
+    }
+
+    return compress_parents_parallel(cv_array, left_n + right_n, key, flags, out);
+}
+
+// 한 청크보다 큰 서브트리를 부모 노드(CV 2개)까지 압축
+static void compress_subtree_to_parent_node(const unsigned char *input, size_t len, const uint32_t key[8],
+                                            uint64_t chunk_counter, uint8_t flags,
+                                            unsigned char out[2 * BLAKE3_OUT_LEN]) {
+    unsigned char cv_array[BLAKE3_MAX_SIMD_DEGREE_OR_2 * BLAKE3_OUT_LEN];
+    unsigned char out_array[BLAKE3_MAX_SIMD_DEGREE_OR_2 * BLAKE3_OUT_LEN / 2];
+    int threads = __atomic_load_n(&blake3_max_threads, __ATOMIC_RELAXED);
+    size_t num_cvs = compress_subtree_wide(input, len, key, chunk_counter, flags, cv_array, threads);
+
+    while (num_cvs > 2) {
+        num_cvs = compress_parents_parallel(cv_array, num_cvs, key, flags, out_array);
+        memcpy(cv_array, out_array, num_cvs * BLAKE3_OUT_LEN);
+    }
+    memcpy(out, cv_array, 2 * BLAKE3_OUT_LEN);
+}
+
+// ===== 해셔 =====
+
+void blake3_set_max_threads(int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    __atomic_store_n(&blake3_max_threads, threads, __ATOMIC_RELAXED);
+}
+
+void blake3_hasher_init(blake3_hasher_t *self) {
+    memcpy(self->key, blake3_iv, sizeof(self->key));
+    chunk_state_init(&self->chunk, self->key, 0);
+    self->cv_stack_len = 0;
+}
+
+// 완료된 서브트리 수(total_len 청크)의 비트 수만큼만 스택에 남기고 병합
+static void hasher_merge_cv_stack(blake3_hasher_t *self, uint64_t total_len) {
+    size_t post_merge_stack_len = (size_t)__builtin_popcountll(total_len);
+
+    while (self->cv_stack_len > post_merge_stack_len) {
+        unsigned char *parent_node = self->cv_stack + (self->cv_stack_len - 2) * BLAKE3_OUT_LEN;
+        blake3_output_t output = parent_output(parent_node, self->key, self->chunk.flags);
+
+        output_chaining_value(&output, parent_node);
+        self->cv_stack_len--;
+    }
+}
+
+static void hasher_push_cv(blake3_hasher_t *self, const unsigned char cv[BLAKE3_OUT_LEN], uint64_t chunk_counter) {
+    hasher_merge_cv_stack(self, chunk_counter);
+    memcpy(self->cv_stack + self->cv_stack_len * BLAKE3_OUT_LEN, cv, BLAKE3_OUT_LEN);
+    self->cv_stack_len++;
+}
+
+void blake3_hasher_update(blake3_hasher_t *self, const void *data, size_t len) {
+    const unsigned char *input = (const unsigned char *)data;
+
+    if (len == 0) return;
+
+    // 진행 중인 청크 먼저 채우기
+    if (chunk_state_len(&self->chunk) > 0) {
+        size_t take = MIN((size_t)BLAKE3_CHUNK_LEN - chunk_state_len(&self->chunk), len);
+        chunk_state_update(&self->chunk, input, take);
+        input += take;
+        len -= take;
+
+        if (len == 0) return;
+
+        unsigned char chunk_cv[BLAKE3_OUT_LEN];
+        blake3_output_t output = chunk_state_output(&self->chunk);
+        output_chaining_value(&output, chunk_cv);
+        hasher_push_cv(self, chunk_cv, self->chunk.chunk_counter);
+        chunk_state_init(&self->chunk, self->key, self->chunk.chunk_counter + 1);
+    }
+
+    // 마지막 청크를 제외한 나머지는 정렬된 서브트리 단위로 한 번에 처리
+    while (len > BLAKE3_CHUNK_LEN) {
+        size_t subtree_len = round_down_to_power_of_2(len);
+        uint64_t count_so_far = self->chunk.chunk_counter * BLAKE3_CHUNK_LEN;
+
+        while (((uint64_t)(subtree_len - 1) & count_so_far) != 0) {
+            subtree_len /= 2;
+        }
+
+        uint64_t subtree_chunks = subtree_len / BLAKE3_CHUNK_LEN;
+        if (subtree_len <= BLAKE3_CHUNK_LEN) {
+            blake3_chunk_state_t chunk;
+            blake3_output_t output;
+            unsigned char cv[BLAKE3_OUT_LEN];
+
+            chunk_state_init(&chunk, self->key, self->chunk.chunk_counter);
+            chunk.flags = self->chunk.flags;
+            chunk_state_update(&chunk, input, subtree_len);
+            output = chunk_state_output(&chunk);
+            output_chaining_value(&output, cv);
+            hasher_push_cv(self, cv, chunk.chunk_counter);
+        } else {
+            unsigned char cv_pair[2 * BLAKE3_OUT_LEN];
+
+            compress_subtree_to_parent_node(input, subtree_len, self->key, self->chunk.chunk_counter,
+                                            self->chunk.flags, cv_pair);
+            hasher_push_cv(self, cv_pair, self->chunk.chunk_counter);
+            hasher_push_cv(self, cv_pair + BLAKE3_OUT_LEN, self->chunk.chunk_counter + subtree_chunks / 2);
+        }
+
+        self->chunk.chunk_counter += subtree_chunks;
+        input += subtree_len;
+        len -= subtree_len;
+    }
+
+    if (len > 0) {
+        chunk_state_update(&self->chunk, input, len);
+        hasher_merge_cv_stack(self, self->chunk.chunk_counter);
+    }
+}
+
+void blake3_hasher_finalize(const blake3_hasher_t *self, unsigned char out[BLAKE3_OUT_LEN]) {
+    blake3_output_t output;
+    size_t cvs_remaining;
+
+    // 스택이 비어 있으면 현재 청크가 루트
+    if (self->cv_stack_len == 0) {
+        output = chunk_state_output(&self->chunk);
+        output_root_bytes(&output, out);
+        return;
+    }
+
+    if (chunk_state_len(&self->chunk) > 0) {
+        cvs_remaining = self->cv_stack_len;
+        output = chunk_state_output(&self->chunk);
+    } else {
+        cvs_remaining = self->cv_stack_len - 2;
+        output = parent_output(self->cv_stack + cvs_remaining * BLAKE3_OUT_LEN, self->key, self->chunk.flags);
+    }
+
+    while (cvs_remaining > 0) {
+        unsigned char parent_block[BLAKE3_BLOCK_LEN];
+
+        cvs_remaining--;
+        memcpy(parent_block, self->cv_stack + cvs_remaining * BLAKE3_OUT_LEN, BLAKE3_OUT_LEN);
+        output_chaining_value(&output, parent_block + BLAKE3_OUT_LEN);
+        output = parent_output(parent_block, self->key, self->chunk.flags);
+    }
+
+    output_root_bytes(&output, out);
+}
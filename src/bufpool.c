@@ -0,0 +1,230 @@
+#include "backup.h"
+#include <sys/mman.h>
+
+// 입출력 버퍼 풀과 스레드별 arena
+//
+// 복사/압축/해제/비교/해시 경로는 파일마다 IO_BUFFER_SIZE 크기의 페이지 정렬 버퍼를 빌려 쓰고
+// 돌려줌. 버퍼는 BUFPOOL_SLAB_SIZE 단위 slab 에서 잘라 만들고 해제하지 않으므로 처음 몇 파일
+// 이후로는 malloc 이 없음 (huge_pages 이면 slab 에 MADV_HUGEPAGE).
+//   io_buffer_get/put: 스레드별 캐시 (BUFPOOL_THREAD_CACHE 개) → 전역 목록 (mutex) → 새 slab
+//   arena_alloc: 스레드가 끝날 때까지 유지되는 할당 (zlib 스트림 상태, 해제 스트림 객체).
+//                블록은 입출력 버퍼 하나이고 스레드가 끝나면 풀로 돌아감. 개별 해제는 없음.
+//   whole_buffer_get: 파일 하나를 통째로 담는 스레드별 버퍼 (libdeflate 한 번 호출 경로).
+//                     자리마다 하나씩 두고 더 큰 요청이 오면 키움. 스레드가 끝나면 해제.
+
+#define BUFPOOL_SLAB_SIZE (2 * 1024 * 1024)   // huge page 하나
+#define BUFPOOL_THREAD_CACHE 4
+#define ARENA_ALIGN 16
+#define WHOLE_BUFFER_SLOTS 2
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;                  // IO_BUFFER_SIZE 가 아니면 따로 할당한 큰 블록
+    size_t used;
+} arena_block_t;
+
+typedef struct {
+    void *buffers[BUFPOOL_THREAD_CACHE];
+    int count;
+    arena_block_t *arena;
+    void *whole[WHOLE_BUFFER_SLOTS];
+    size_t whole_size[WHOLE_BUFFER_SLOTS];
+} thread_cache_t;
+
+static void *free_buffers = NULL;             // 빈 버퍼 첫 8바이트에 다음 포인터
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static __thread thread_cache_t *tls_cache = NULL;
+static int use_huge_pages = 0;
+static bufpool_stats_t pool_stats;
+
+void bufpool_init(const backup_options_t *opts) {
+    use_huge_pages = opts->huge_pages;
+}
+
+static void pool_push(void *buffer) {
+    *(void **)buffer = free_buffers;
+    free_buffers = buffer;
+}
+
+// 호출 전 pool_mutex 보유
+static int add_slab(void) {
+    void *slab = NULL;
+
+    if (posix_memalign(&slab, BUFPOOL_SLAB_SIZE, BUFPOOL_SLAB_SIZE) != 0) {
+        return ERROR_MEMORY;
+    }
+#ifdef MADV_HUGEPAGE
+    if (use_huge_pages && madvise(slab, BUFPOOL_SLAB_SIZE, MADV_HUGEPAGE) != 0) {
+        log_debug("huge page 사용 불가: %s", strerror(errno));
+    }
+#endif
+    for (size_t off = BUFPOOL_SLAB_SIZE; off > 0; off -= IO_BUFFER_SIZE) {
+        pool_push((unsigned char *)slab + off - IO_BUFFER_SIZE);
+    }
+    pool_stats.slabs++;
+    pool_stats.buffers += BUFPOOL_SLAB_SIZE / IO_BUFFER_SIZE;
+    return SUCCESS;
+}
+
+// 스레드가 끝날 때: 캐시한 버퍼와 arena 블록을 풀로 돌려줌
+static void release_thread_cache(void *arg) {
+    thread_cache_t *cache = (thread_cache_t *)arg;
+    arena_block_t *block = cache->arena;
+
+    pthread_mutex_lock(&pool_mutex);
+    for (int i = 0; i < cache->count; i++) {
+        pool_push(cache->buffers[i]);
+    }
+    while (block) {
+        arena_block_t *next = block->next;
+
+        if (block->size == IO_BUFFER_SIZE) {
+            pool_push(block);
+        } else {
+            free(block);
+        }
+        block = next;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    for (int i = 0; i < WHOLE_BUFFER_SLOTS; i++) {
+        free(cache->whole[i]);
+    }
+    free(cache);
+}
+
+static void create_cache_key(void) {
+    pthread_key_create(&cache_key, release_thread_cache);
+}
+
+static thread_cache_t *thread_cache(void) {
+    if (!tls_cache) {
+        pthread_once(&cache_once, create_cache_key);
+        tls_cache = calloc(1, sizeof(thread_cache_t));
+        if (tls_cache) {
+            pthread_setspecific(cache_key, tls_cache);
+        }
+    }
+    return tls_cache;
+}
+
+// IO_BUFFER_SIZE 바이트, 페이지 정렬 (실패하면 NULL)
+void *io_buffer_get(void) {
+    thread_cache_t *cache = thread_cache();
+    void *buffer;
+
+    __atomic_fetch_add(&pool_stats.gets, 1, __ATOMIC_RELAXED);
+    if (cache && cache->count > 0) {
+        return cache->buffers[--cache->count];
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    if (!free_buffers && add_slab() != SUCCESS) {
+        pthread_mutex_unlock(&pool_mutex);
+        log_error("입출력 버퍼 할당 실패");
+        return NULL;
+    }
+    buffer = free_buffers;
+    free_buffers = *(void **)buffer;
+    pthread_mutex_unlock(&pool_mutex);
+    return buffer;
+}
+
+void io_buffer_put(void *buffer) {
+    thread_cache_t *cache;
+
+    if (!buffer) return;
+    cache = thread_cache();
+    if (cache && cache->count < BUFPOOL_THREAD_CACHE) {
+        cache->buffers[cache->count++] = buffer;
+        return;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_push(buffer);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+// 호출 스레드의 arena 에서 할당 (스레드가 끝날 때까지 유지, 실패하면 NULL)
+void *arena_alloc(size_t size) {
+    thread_cache_t *cache = thread_cache();
+    arena_block_t *block;
+    size_t header = (sizeof(arena_block_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    void *ptr;
+
+    if (!cache) return NULL;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    block = cache->arena;
+    if (!block || block->used + size > block->size) {
+        if (header + size <= IO_BUFFER_SIZE) {
+            block = io_buffer_get();
+            if (!block) return NULL;
+            block->size = IO_BUFFER_SIZE;
+            __atomic_fetch_add(&pool_stats.arena_bytes, IO_BUFFER_SIZE, __ATOMIC_RELAXED);
+        } else {
+            block = malloc(header + size);
+            if (!block) return NULL;
+            block->size = header + size;
+            __atomic_fetch_add(&pool_stats.arena_bytes, header + size, __ATOMIC_RELAXED);
+        }
+        block->used = header;
+        // 큰 블록은 현재 블록 뒤에 끼워 남은 공간을 계속 씀
+        if (cache->arena && block->size != IO_BUFFER_SIZE) {
+            block->next = cache->arena->next;
+            cache->arena->next = block;
+        } else {
+            block->next = cache->arena;
+            cache->arena = block;
+        }
+        __atomic_fetch_add(&pool_stats.arena_blocks, 1, __ATOMIC_RELAXED);
+    }
+
+    ptr = (unsigned char *)block + block->used;
+    block->used += size;
+    __atomic_fetch_add(&pool_stats.arena_allocs, 1, __ATOMIC_RELAXED);
+    return ptr;
+}
+
+// 호출 스레드의 slot 번 버퍼를 size 바이트 이상으로 (내용은 보존하지 않음, 실패하면 NULL)
+void *whole_buffer_get(int slot, size_t size) {
+    thread_cache_t *cache = thread_cache();
+    void *buffer = NULL;
+
+    if (!cache || slot < 0 || slot >= WHOLE_BUFFER_SLOTS) return NULL;
+    if (cache->whole[slot] && cache->whole_size[slot] >= size) {
+        return cache->whole[slot];
+    }
+
+    // 조금씩 커지는 요청마다 다시 할당하지 않도록 입출력 버퍼 단위로 올림
+    size = (size + IO_BUFFER_SIZE - 1) / IO_BUFFER_SIZE * IO_BUFFER_SIZE;
+    free(cache->whole[slot]);
+    cache->whole[slot] = NULL;
+    cache->whole_size[slot] = 0;
+    if (posix_memalign(&buffer, 4096, size) != 0) {
+        log_error("파일 전체 버퍼 할당 실패 (%zu bytes)", size);
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (use_huge_pages) {
+        madvise(buffer, size, MADV_HUGEPAGE);
+    }
+#endif
+    cache->whole[slot] = buffer;
+    cache->whole_size[slot] = size;
+    __atomic_fetch_add(&pool_stats.whole_bytes, size, __ATOMIC_RELAXED);
+    return buffer;
+}
+
+void bufpool_get_stats(bufpool_stats_t *stats) {
+    pthread_mutex_lock(&pool_mutex);
+    stats->slabs = pool_stats.slabs;
+    stats->buffers = pool_stats.buffers;
+    pthread_mutex_unlock(&pool_mutex);
+    stats->gets = __atomic_load_n(&pool_stats.gets, __ATOMIC_RELAXED);
+    stats->arena_blocks = __atomic_load_n(&pool_stats.arena_blocks, __ATOMIC_RELAXED);
+    stats->arena_bytes = __atomic_load_n(&pool_stats.arena_bytes, __ATOMIC_RELAXED);
+    stats->arena_allocs = __atomic_load_n(&pool_stats.arena_allocs, __ATOMIC_RELAXED);
+    stats->whole_bytes = __atomic_load_n(&pool_stats.whole_bytes, __ATOMIC_RELAXED);
+}
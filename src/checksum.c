@@ -0,0 +1,471 @@
+#include "backup.h"
+
+// 체크섬 계산 (복사/압축 루프에서 스트리밍으로 갱신)
+// MD5(RFC 1321), SHA-1(FIPS 180-4), SHA-256(FIPS 180-4), CRC32,
+// XXH3-128(xxhash.c), BLAKE3(blake3.c)
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t load_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t load_be32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void store_le32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static void store_be32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+// ===== MD5 =====
+
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const unsigned char md5_r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void md5_block(uint32_t state[4], const unsigned char *block) {
+    uint32_t m[16];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+    for (int i = 0; i < 16; i++) {
+        m[i] = load_le32(block + i * 4);
+    }
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+
+        uint32_t tmp = d;
+        d = c;
+        c = b;
+        b = b + ROTL32(a + f + md5_k[i] + m[g], md5_r[i]);
+        a = tmp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+// ===== SHA-1 =====
+
+static void sha1_block(uint32_t state[5], const unsigned char *block) {
+    uint32_t w[80];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = load_be32(block + i * 4);
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = ROTL32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+
+        uint32_t tmp = ROTL32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROTL32(b, 30);
+        b = a;
+        a = tmp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+// ===== SHA-256 =====
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void sha256_block(uint32_t state[8], const unsigned char *block) {
+    uint32_t w[64];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = load_be32(block + i * 4);
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+// ===== 공통 블록 처리 (MD5/SHA 계열은 64바이트 블록) =====
+
+static void checksum_process_block(checksum_ctx_t *ctx, const unsigned char *block) {
+    switch (ctx->type) {
+        case CHECKSUM_MD5:
+            md5_block(ctx->state, block);
+            break;
+        case CHECKSUM_SHA1:
+            sha1_block(ctx->state, block);
+            break;
+        case CHECKSUM_SHA256:
+            sha256_block(ctx->state, block);
+            break;
+        default:
+            break;
+    }
+}
+
+checksum_type_t parse_checksum_type(const char *str) {
+    if (!str || strcmp(str, "none") == 0) return CHECKSUM_NONE;
+    if (strcmp(str, "md5") == 0) return CHECKSUM_MD5;
+    if (strcmp(str, "sha1") == 0) return CHECKSUM_SHA1;
+    if (strcmp(str, "sha256") == 0) return CHECKSUM_SHA256;
+    if (strcmp(str, "crc32") == 0) return CHECKSUM_CRC32;
+    if (strcmp(str, "xxh3") == 0 || strcmp(str, "xxh128") == 0) return CHECKSUM_XXH3;
+    if (strcmp(str, "blake3") == 0) return CHECKSUM_BLAKE3;
+    return CHECKSUM_NONE;
+}
+
+const char *get_checksum_name(checksum_type_t type) {
+    switch (type) {
+        case CHECKSUM_MD5:
+            return "md5";
+        case CHECKSUM_SHA1:
+            return "sha1";
+        case CHECKSUM_SHA256:
+            return "sha256";
+        case CHECKSUM_CRC32:
+            return "crc32";
+        case CHECKSUM_XXH3:
+            return "xxh3";
+        case CHECKSUM_BLAKE3:
+            return "blake3";
+        default:
+            return "none";
+    }
+}
+
+// 알고리즘별 digest 바이트 수 (checksum_final 반환값과 같음)
+size_t checksum_digest_size(checksum_type_t type) {
+    switch (type) {
+        case CHECKSUM_MD5:
+            return 16;
+        case CHECKSUM_SHA1:
+            return 20;
+        case CHECKSUM_SHA256:
+            return 32;
+        case CHECKSUM_CRC32:
+            return 4;
+        case CHECKSUM_XXH3:
+            return 16;
+        case CHECKSUM_BLAKE3:
+            return BLAKE3_OUT_LEN;
+        default:
+            return 0;
+    }
+}
+
+void checksum_init(checksum_ctx_t *ctx, checksum_type_t type) {
+    if (!ctx) return;
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->type = type;
+
+    switch (type) {
+        case CHECKSUM_MD5:
+            ctx->state[0] = 0x67452301;
+            ctx->state[1] = 0xefcdab89;
+            ctx->state[2] = 0x98badcfe;
+            ctx->state[3] = 0x10325476;
+            break;
+        case CHECKSUM_SHA1:
+            ctx->state[0] = 0x67452301;
+            ctx->state[1] = 0xefcdab89;
+            ctx->state[2] = 0x98badcfe;
+            ctx->state[3] = 0x10325476;
+            ctx->state[4] = 0xc3d2e1f0;
+            break;
+        case CHECKSUM_SHA256:
+            ctx->state[0] = 0x6a09e667;
+            ctx->state[1] = 0xbb67ae85;
+            ctx->state[2] = 0x3c6ef372;
+            ctx->state[3] = 0xa54ff53a;
+            ctx->state[4] = 0x510e527f;
+            ctx->state[5] = 0x9b05688c;
+            ctx->state[6] = 0x1f83d9ab;
+            ctx->state[7] = 0x5be0cd19;
+            break;
+        case CHECKSUM_XXH3:
+            XXH3_128bits_reset(&ctx->fast.xxh3);
+            break;
+        case CHECKSUM_BLAKE3:
+            blake3_hasher_init(&ctx->fast.blake3);
+            break;
+        default:
+            break;
+    }
+}
+
+void checksum_update(checksum_ctx_t *ctx, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+
+    if (!ctx || ctx->type == CHECKSUM_NONE || len == 0) return;
+
+    if (ctx->type == CHECKSUM_CRC32) {
+        ctx->state[0] = backend_crc32(ctx->state[0], p, len);
+        ctx->total_len += len;
+        return;
+    }
+
+    if (ctx->type == CHECKSUM_XXH3) {
+        XXH3_128bits_update(&ctx->fast.xxh3, p, len);
+        ctx->total_len += len;
+        return;
+    }
+
+    if (ctx->type == CHECKSUM_BLAKE3) {
+        blake3_hasher_update(&ctx->fast.blake3, p, len);
+        ctx->total_len += len;
+        return;
+    }
+
+    ctx->total_len += len;
+
+    // 남은 부분 블록 채우기
+    if (ctx->buffer_len > 0) {
+        size_t take = MIN(len, sizeof(ctx->buffer) - ctx->buffer_len);
+        memcpy(ctx->buffer + ctx->buffer_len, p, take);
+        ctx->buffer_len += take;
+        p += take;
+        len -= take;
+
+        if (ctx->buffer_len == sizeof(ctx->buffer)) {
+            checksum_process_block(ctx, ctx->buffer);
+            ctx->buffer_len = 0;
+        }
+    }
+
+    // 전체 블록은 입력에서 바로 처리
+    while (len >= sizeof(ctx->buffer)) {
+        checksum_process_block(ctx, p);
+        p += sizeof(ctx->buffer);
+        len -= sizeof(ctx->buffer);
+    }
+
+    if (len > 0) {
+        memcpy(ctx->buffer, p, len);
+        ctx->buffer_len = len;
+    }
+}
+
+// 최종 다이제스트 계산, 다이제스트 길이 반환 (digest는 MAX_DIGEST_SIZE 이상)
+size_t checksum_final(checksum_ctx_t *ctx, unsigned char *digest) {
+    unsigned char pad[72];
+    uint64_t bit_len;
+    size_t pad_len;
+
+    if (!ctx || !digest) return 0;
+
+    switch (ctx->type) {
+        case CHECKSUM_CRC32:
+            store_be32(digest, ctx->state[0]);
+            return 4;
+        case CHECKSUM_XXH3: {
+            // 정규 표현(빅 엔디언)으로 xxhsum -H2 출력과 동일
+            XXH128_canonical_t canonical;
+            XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(&ctx->fast.xxh3));
+            memcpy(digest, canonical.digest, sizeof(canonical.digest));
+            return sizeof(canonical.digest);
+        }
+        case CHECKSUM_BLAKE3:
+            blake3_hasher_finalize(&ctx->fast.blake3, digest);
+            return BLAKE3_OUT_LEN;
+        case CHECKSUM_MD5:
+        case CHECKSUM_SHA1:
+        case CHECKSUM_SHA256:
+            break;
+        default:
+            return 0;
+    }
+
+    // 패딩: 0x80, 0 채움, 64비트 길이 (MD5는 리틀 엔디언, SHA는 빅 엔디언)
+    bit_len = ctx->total_len * 8;
+    pad_len = (ctx->buffer_len < 56) ? (56 - ctx->buffer_len) : (120 - ctx->buffer_len);
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+
+    for (int i = 0; i < 8; i++) {
+        if (ctx->type == CHECKSUM_MD5) {
+            pad[pad_len + i] = (unsigned char)(bit_len >> (8 * i));
+        } else {
+            pad[pad_len + i] = (unsigned char)(bit_len >> (56 - 8 * i));
+        }
+    }
+
+    uint64_t saved_len = ctx->total_len;
+    checksum_update(ctx, pad, pad_len + 8);
+    ctx->total_len = saved_len;
+
+    switch (ctx->type) {
+        case CHECKSUM_MD5:
+            for (int i = 0; i < 4; i++) store_le32(digest + i * 4, ctx->state[i]);
+            return 16;
+        case CHECKSUM_SHA1:
+            for (int i = 0; i < 5; i++) store_be32(digest + i * 4, ctx->state[i]);
+            return 20;
+        default:
+            for (int i = 0; i < 8; i++) store_be32(digest + i * 4, ctx->state[i]);
+            return 32;
+    }
+}
+
+// 최종 다이제스트를 16진수 문자열로 (hex는 MAX_DIGEST_HEX 이상)
+void checksum_final_hex(checksum_ctx_t *ctx, char *hex) {
+    unsigned char digest[MAX_DIGEST_SIZE];
+    size_t len = checksum_final(ctx, digest);
+
+    for (size_t i = 0; i < len; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+    hex[len * 2] = '\0';
+}
+
+// BLAKE3 다중 스레드 수 (-j, CPU 코어 수 이하)
+void init_checksum(const backup_options_t *opts) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = opts ? opts->threads : 1;
+
+    if (cores > 0 && threads > cores) {
+        threads = (int)cores;
+    }
+    blake3_set_max_threads(threads);
+}
+
+// 파일 전체 체크섬 (압축 백업은 해제된 내용 기준)
+int checksum_file(const char *path, compression_type_t type, checksum_type_t algorithm,
+                  char *hex, uint64_t *size) {
+    unsigned char *buffer;
+    decompress_stream_t *stream;
+    checksum_ctx_t ctx;
+    ssize_t n;
+
+    // 풀 버퍼 (IO_BUFFER_SIZE 단위로 읽어야 BLAKE3가 큰 입력을 여러 스레드로 나눌 수 있음)
+    buffer = io_buffer_get();
+    if (!buffer) {
+        return ERROR_MEMORY;
+    }
+
+    stream = decompress_stream_open(path, type);
+    if (!stream) {
+        io_buffer_put(buffer);
+        return ERROR_FILE_OPEN;
+    }
+
+    checksum_init(&ctx, algorithm);
+    while ((n = decompress_stream_read(stream, buffer, IO_BUFFER_SIZE)) > 0) {
+        checksum_update(&ctx, buffer, (size_t)n);
+    }
+    decompress_stream_close(stream);
+    io_buffer_put(buffer);
+
+    if (n < 0) {
+        return ERROR_FILE_READ;
+    }
+
+    if (size) {
+        *size = ctx.total_len;
+    }
+    checksum_final_hex(&ctx, hex);
+    return SUCCESS;
+}
@@ -0,0 +1,894 @@
+#include "backup.h"
+
+// 내용 정의 청킹(CDC) 중복 제거 저장소
+//
+// 파일을 Gear 롤링 해시(FastCDC 정규화 청킹)로 가변 크기 청크로 나누고, 각 청크를 BLAKE3 해시
+// 이름으로 저장소에 한 번만 저장합니다.
+//   <store>/<hh>/<hh>/<hash>    청크 파일 (codec 1바이트 + 데이터)
+//   <store>/chunks.idx          청크 색인 (해시 32 + 저장 크기 u32 + 원본 크기 u32, 추가 기록)
+//   <backup>/.backup_recipes    파일별 레시피 (청크 수 u32 + (해시 32 + 길이 u32) × N)
+// 인덱스/매니페스트 항목은 type 'C'이고 offset 열이 레시피 파일 내 위치를 가리킵니다.
+// 청크 해시/압축/저장과 복원 시 읽기/해제/검증은 구간 단위로 여러 스레드가 나눠 처리합니다.
+
+#define CDC_MIN_SIZE (16 * 1024)
+#define CDC_AVG_SIZE (64 * 1024)
+#define CDC_MAX_SIZE (256 * 1024)
+#define CDC_MASK_S 0xFFFFC00000000000ULL    // 평균 전: 상위 18비트 (경계가 드묾)
+#define CDC_MASK_L 0xFFFC000000000000ULL    // 평균 후: 상위 14비트 (경계가 잦음)
+#define CDC_SEGMENT_SIZE (16 * 1024 * 1024) // 한 번에 읽어 청킹하는 구간
+#define CDC_RESTORE_WINDOW 64               // 복원 시 동시에 읽는 청크 수
+#define CHUNK_INDEX_FILE "chunks.idx"
+#define CHUNK_INDEX_RECORD (BLAKE3_OUT_LEN + 8)
+#define RECIPE_MAGIC "BKRECIP"
+#define RECIPE_ENTRY_SIZE (BLAKE3_OUT_LEN + 4)
+
+typedef struct {
+    unsigned char hash[BLAKE3_OUT_LEN];
+    uint8_t state;                // 0 = 빈 슬롯, 1 = 저장됨, 2 = 저장 실패 (다시 저장 가능)
+} chunk_slot_t;
+
+struct chunk_store {
+    char path[MAX_PATH];
+    compression_type_t codec;
+    int level;
+    int threads;
+    FILE *index_file;
+    chunk_slot_t *slots;
+    size_t slot_count;
+    size_t used;
+    size_t slot_budget;           // 슬롯 표 최대 크기 (bytes, --memory-limit 몫)
+    int partial;                  // 표가 예산에 닿아 더 넣지 않음: 표에 없는 해시는 청크 파일로 확인
+    pthread_mutex_t mutex;
+    uint64_t new_chunks;
+    uint64_t duplicate_chunks;
+    uint64_t new_bytes;           // 이번 실행에서 새로 저장한 바이트 (압축 후)
+};
+
+// 레시피 청크 항목
+typedef struct {
+    unsigned char hash[BLAKE3_OUT_LEN];
+    uint32_t length;
+} recipe_chunk_t;
+
+static uint64_t gear_table[256];
+static pthread_once_t gear_once = PTHREAD_ONCE_INIT;
+
+static FILE *recipe_file = NULL;
+static uint64_t recipe_offset = 0;
+static pthread_mutex_t recipe_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// 고정 시드 splitmix64로 Gear 표 생성 (실행마다 같은 경계가 나와야 함)
+static void init_gear_table(void) {
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+
+    for (int i = 0; i < 256; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        gear_table[i] = z ^ (z >> 31);
+    }
+}
+
+// data[0..len) 에서 첫 청크 길이 (FastCDC: 최소 크기까지 건너뛰고 평균 전후로 마스크 변경)
+static size_t cdc_chunk_length(const unsigned char *data, size_t len) {
+    uint64_t fp = 0;
+    size_t i, normal, limit;
+
+    if (len <= CDC_MIN_SIZE) {
+        return len;
+    }
+
+    limit = MIN(len, (size_t)CDC_MAX_SIZE);
+    normal = MIN(limit, (size_t)CDC_AVG_SIZE);
+
+    for (i = CDC_MIN_SIZE; i < normal; i++) {
+        fp = (fp << 1) + gear_table[data[i]];
+        if (!(fp & CDC_MASK_S)) return i + 1;
+    }
+    for (; i < limit; i++) {
+        fp = (fp << 1) + gear_table[data[i]];
+        if (!(fp & CDC_MASK_L)) return i + 1;
+    }
+    return limit;
+}
+
+static void store_u32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static uint32_t load_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void hash_to_hex(const unsigned char *hash, char *hex) {
+    for (int i = 0; i < BLAKE3_OUT_LEN; i++) {
+        snprintf(hex + i * 2, 3, "%02x", hash[i]);
+    }
+}
+
+// 청크 파일 경로 (잘리면 다른 청크를 가리킬 수 있으므로 버퍼에 들어가지 않으면 ERROR_INVALID_PARAMS)
+static int chunk_path(const char *store_path, const unsigned char *hash, char *path, size_t size) {
+    char hex[BLAKE3_OUT_LEN * 2 + 1];
+
+    hash_to_hex(hash, hex);
+    if ((size_t)snprintf(path, size, "%s/%.2s/%.2s/%s", store_path, hex, hex + 2, hex) >= size) {
+        log_error("청크 경로가 너무 깁니다: %s", store_path);
+        return ERROR_INVALID_PARAMS;
+    }
+    return SUCCESS;
+}
+
+// ---- 청크 색인 ----
+
+static size_t slot_of(const chunk_store_t *store, const unsigned char *hash) {
+    uint64_t h;
+
+    memcpy(&h, hash, sizeof(h));
+    return (size_t)h & (store->slot_count - 1);
+}
+
+static int grow_slots(chunk_store_t *store) {
+    size_t old_count = store->slot_count;
+    chunk_slot_t *old_slots = store->slots;
+    size_t new_count = old_count ? old_count * 2 : 4096;
+
+    store->slots = calloc(new_count, sizeof(chunk_slot_t));
+    if (!store->slots) {
+        store->slots = old_slots;
+        return ERROR_MEMORY;
+    }
+    store->slot_count = new_count;
+
+    for (size_t i = 0; i < old_count; i++) {
+        if (old_slots[i].state == 0) continue;
+
+        size_t slot = slot_of(store, old_slots[i].hash);
+        while (store->slots[slot].state != 0) {
+            slot = (slot + 1) & (new_count - 1);
+        }
+        store->slots[slot] = old_slots[i];
+    }
+
+    free(old_slots);
+    return SUCCESS;
+}
+
+// 호출 전 mutex 보유. 해시의 슬롯 (없으면 빈 슬롯)
+static chunk_slot_t *find_slot(chunk_store_t *store, const unsigned char *hash) {
+    size_t slot = slot_of(store, hash);
+
+    while (store->slots[slot].state != 0 &&
+           memcmp(store->slots[slot].hash, hash, BLAKE3_OUT_LEN) != 0) {
+        slot = (slot + 1) & (store->slot_count - 1);
+    }
+    return &store->slots[slot];
+}
+
+// 호출 전 mutex 보유. 한 칸 더 넣을 자리를 만듦 (예산에 닿으면 partial 로 바꾸고 SUCCESS)
+static int reserve_slot(chunk_store_t *store) {
+    if (store->partial || (store->used + 1) * 2 <= store->slot_count) {
+        return SUCCESS;
+    }
+    if (store->slot_count * 2 * sizeof(chunk_slot_t) > store->slot_budget) {
+        store->partial = 1;
+        log_info("청크 색인이 메모리 예산에 닿았습니다 (%zu개): 나머지 청크는 저장소 파일로 확인합니다", store->used);
+        return SUCCESS;
+    }
+    return grow_slots(store);
+}
+
+// 새 청크면 1 (호출자가 저장), 이미 저장되어 있으면 0, 메모리 부족이면 -1
+static int claim_chunk(chunk_store_t *store, const unsigned char *hash) {
+    chunk_slot_t *slot;
+    int claimed = 1;
+    int check_file = 0;
+
+    pthread_mutex_lock(&store->mutex);
+    if (reserve_slot(store) != SUCCESS) {
+        pthread_mutex_unlock(&store->mutex);
+        return -1;
+    }
+
+    slot = find_slot(store, hash);
+    if (slot->state == 1) {
+        claimed = 0;
+        store->duplicate_chunks++;
+    } else if (slot->state == 0 && store->partial) {
+        // 표에 없음: 파일이 있으면 중복. 같은 새 청크를 두 스레드가 함께 저장할 수 있지만
+        // 내용이 같고 rename 으로 바꾸므로 결과는 같음 (색인에 중복 기록은 읽을 때 무시)
+        check_file = 1;
+    } else {
+        if (slot->state == 0) {
+            memcpy(slot->hash, hash, BLAKE3_OUT_LEN);
+            store->used++;
+        }
+        slot->state = 1;
+    }
+    pthread_mutex_unlock(&store->mutex);
+
+    if (check_file) {
+        char path[MAX_PATH];
+
+        // 경로를 만들 수 없으면 기록할 때 오류로 보고함
+        if (chunk_path(store->path, hash, path, sizeof(path)) == SUCCESS && file_exists(path)) {
+            pthread_mutex_lock(&store->mutex);
+            store->duplicate_chunks++;
+            pthread_mutex_unlock(&store->mutex);
+            claimed = 0;
+        }
+    }
+    return claimed;
+}
+
+static void release_chunk(chunk_store_t *store, const unsigned char *hash) {
+    chunk_slot_t *slot;
+
+    pthread_mutex_lock(&store->mutex);
+    slot = find_slot(store, hash);
+    if (slot->state != 0) {
+        slot->state = 2;
+    }
+    pthread_mutex_unlock(&store->mutex);
+}
+
+static int load_chunk_index(chunk_store_t *store) {
+    char path[MAX_PATH];
+    unsigned char record[CHUNK_INDEX_RECORD];
+    FILE *file;
+
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", store->path, CHUNK_INDEX_FILE) >= sizeof(path)) {
+        return ERROR_INVALID_PARAMS;
+    }
+    file = fopen(path, "rb");
+    if (!file) {
+        return SUCCESS; // 새 저장소
+    }
+
+    while (fread(record, 1, sizeof(record), file) == sizeof(record)) {
+        chunk_slot_t *slot;
+
+        if (reserve_slot(store) != SUCCESS) {
+            fclose(file);
+            return ERROR_MEMORY;
+        }
+        if (store->partial) {
+            break;
+        }
+        slot = find_slot(store, record);
+        if (slot->state == 0) {
+            memcpy(slot->hash, record, BLAKE3_OUT_LEN);
+            slot->state = 1;
+            store->used++;
+        }
+    }
+
+    fclose(file);
+    return SUCCESS;
+}
+
+chunk_store_t *chunk_store_open(const char *path, const backup_options_t *opts) {
+    chunk_store_t *store;
+    char index_path[MAX_PATH];
+
+    pthread_once(&gear_once, init_gear_table);
+
+    if (!file_exists(path) && create_directory_recursive(path) != SUCCESS) {
+        log_error("청크 저장소 생성 실패: %s", path);
+        return NULL;
+    }
+
+    store = calloc(1, sizeof(*store));
+    if (!store) return NULL;
+
+    if ((size_t)snprintf(store->path, sizeof(store->path), "%s", path) >= sizeof(store->path)) {
+        log_error("청크 저장소 경로가 너무 깁니다: %s", path);
+        free(store);
+        return NULL;
+    }
+    store->codec = (opts->compression == COMPRESS_GZIP || opts->compression == COMPRESS_ZLIB) ?
+                   COMPRESS_ZLIB : COMPRESS_NONE;
+    store->level = opts->compression_level;
+    store->threads = parallel_thread_count(opts->threads);
+    store->slot_budget = memory_budget(MEMORY_SHARE_CHUNKS);
+    pthread_mutex_init(&store->mutex, NULL);
+
+    if (grow_slots(store) != SUCCESS || load_chunk_index(store) != SUCCESS) {
+        log_error("청크 색인 로드 실패: %s", path);
+        chunk_store_close(store);
+        return NULL;
+    }
+
+    if ((size_t)snprintf(index_path, sizeof(index_path), "%s/%s", path, CHUNK_INDEX_FILE) >= sizeof(index_path)) {
+        chunk_store_close(store);
+        return NULL;
+    }
+    store->index_file = fopen(index_path, "ab");
+    if (!store->index_file) {
+        log_error("청크 색인 열기 실패: %s", index_path);
+        chunk_store_close(store);
+        return NULL;
+    }
+
+    log_debug("청크 저장소 열기: %s (%zu개 청크)", path, store->used);
+    return store;
+}
+
+void chunk_store_close(chunk_store_t *store) {
+    if (!store) return;
+
+    if (store->index_file) {
+        fclose(store->index_file);
+    }
+    if (store->new_chunks + store->duplicate_chunks > 0) {
+        log_info("중복 제거: 새 청크 %llu개 (%llu bytes), 중복 청크 %llu개",
+                 (unsigned long long)store->new_chunks, (unsigned long long)store->new_bytes,
+                 (unsigned long long)store->duplicate_chunks);
+    }
+    pthread_mutex_destroy(&store->mutex);
+    free(store->slots);
+    free(store);
+}
+
+// 청크 파일 기록 (임시 파일 후 rename), 저장된 크기 반환
+static int write_chunk(chunk_store_t *store, const unsigned char *hash,
+                       const unsigned char *data, size_t len, size_t *stored) {
+    char path[MAX_PATH];
+    char temp_path[MAX_PATH + 32];
+    unsigned char *packed = NULL;
+    size_t packed_len = 0;
+    uint8_t codec = COMPRESS_NONE;
+    FILE *file;
+    int ok;
+
+    if (chunk_path(store->path, hash, path, sizeof(path)) != SUCCESS) {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (store->codec != COMPRESS_NONE &&
+        compress_buffer(store->codec, store->level, data, len, &packed, &packed_len) == SUCCESS &&
+        packed_len < len) {
+        codec = (uint8_t)store->codec;
+        data = packed;
+        len = packed_len;
+    }
+
+    {
+        char dir[MAX_PATH];
+        char *slash;
+
+        snprintf(dir, sizeof(dir), "%s", path);
+        slash = strrchr(dir, '/');
+        if (slash) *slash = '\0';
+        if (!file_exists(dir)) {
+            create_directory_recursive(dir);
+        }
+    }
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp.%lu", path, (unsigned long)pthread_self());
+    file = fopen(temp_path, "wb");
+    if (!file) {
+        free(packed);
+        log_error("청크 파일 생성 실패: %s", temp_path);
+        return ERROR_FILE_WRITE;
+    }
+
+    ok = fwrite(&codec, 1, 1, file) == 1 && fwrite(data, 1, len, file) == len;
+    ok = (fclose(file) == 0) && ok;
+    free(packed);
+
+    if (!ok || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        log_error("청크 파일 쓰기 실패: %s", path);
+        return ERROR_FILE_WRITE;
+    }
+
+    *stored = len + 1;
+    return SUCCESS;
+}
+
+// ---- 백업 (청킹) ----
+
+typedef struct {
+    const unsigned char *data;
+    size_t length;
+    unsigned char hash[BLAKE3_OUT_LEN];
+    size_t stored;                // 새로 저장한 경우 저장 크기 (중복이면 0)
+    int result;
+} chunk_job_t;
+
+typedef struct {
+    chunk_store_t *store;
+    chunk_job_t *jobs;
+} store_jobs_t;
+
+static void store_chunk_job(void *ctx, size_t index) {
+    store_jobs_t *batch = (store_jobs_t *)ctx;
+    chunk_store_t *store = batch->store;
+    chunk_job_t *job = &batch->jobs[index];
+    blake3_hasher_t hasher;
+    size_t stored = 0;
+    int claimed;
+
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, job->data, job->length);
+    blake3_hasher_finalize(&hasher, job->hash);
+
+    claimed = claim_chunk(store, job->hash);
+    if (claimed < 0) {
+        job->result = ERROR_MEMORY;
+        return;
+    }
+    if (claimed == 0) {
+        job->result = SUCCESS;
+        return;
+    }
+
+    job->result = write_chunk(store, job->hash, job->data, job->length, &stored);
+    job->stored = stored;
+    if (job->result != SUCCESS) {
+        release_chunk(store, job->hash);
+        return;
+    }
+
+    unsigned char record[CHUNK_INDEX_RECORD];
+    memcpy(record, job->hash, BLAKE3_OUT_LEN);
+    store_u32(record + BLAKE3_OUT_LEN, (uint32_t)stored);
+    store_u32(record + BLAKE3_OUT_LEN + 4, (uint32_t)job->length);
+
+    pthread_mutex_lock(&store->mutex);
+    if (fwrite(record, 1, sizeof(record), store->index_file) != sizeof(record)) {
+        job->result = ERROR_FILE_WRITE;
+    }
+    store->new_chunks++;
+    store->new_bytes += stored;
+    pthread_mutex_unlock(&store->mutex);
+}
+
+static int append_recipe(const recipe_chunk_t *chunks, size_t count, uint64_t *offset) {
+    unsigned char header[4];
+    unsigned char entry[RECIPE_ENTRY_SIZE];
+    int result = SUCCESS;
+
+    pthread_mutex_lock(&recipe_mutex);
+    if (!recipe_file) {
+        pthread_mutex_unlock(&recipe_mutex);
+        return ERROR_INVALID_PARAMS;
+    }
+
+    *offset = recipe_offset;
+    store_u32(header, (uint32_t)count);
+    if (fwrite(header, 1, sizeof(header), recipe_file) != sizeof(header)) {
+        result = ERROR_FILE_WRITE;
+    }
+    for (size_t i = 0; i < count && result == SUCCESS; i++) {
+        memcpy(entry, chunks[i].hash, BLAKE3_OUT_LEN);
+        store_u32(entry + BLAKE3_OUT_LEN, chunks[i].length);
+        if (fwrite(entry, 1, sizeof(entry), recipe_file) != sizeof(entry)) {
+            result = ERROR_FILE_WRITE;
+        }
+    }
+    recipe_offset += sizeof(header) + count * RECIPE_ENTRY_SIZE;
+    pthread_mutex_unlock(&recipe_mutex);
+
+    return result;
+}
+
+// 파일을 청크로 나눠 저장하고 레시피를 기록 (hash가 있으면 파일 전체 체크섬도 계산)
+// size = 원본 크기, stored = 이 파일로 새로 저장된 청크 크기 (압축 후)
+int chunk_store_backup_file(chunk_store_t *store, const char *source, checksum_ctx_t *hash,
+                            uint64_t *offset, uint64_t *size, uint64_t *stored) {
+    size_t capacity = CDC_SEGMENT_SIZE + CDC_MAX_SIZE;
+    size_t max_jobs = capacity / CDC_MIN_SIZE + 1;
+    unsigned char *buffer = NULL;
+    chunk_job_t *jobs = NULL;
+    recipe_chunk_t *recipe = NULL;
+    size_t recipe_count = 0, recipe_capacity = 0;
+    size_t filled = 0;
+    uint64_t total = 0, new_bytes = 0;
+    int eof = 0;
+    int result = SUCCESS;
+    int fd;
+
+    fd = open(source, O_RDONLY);
+    if (fd < 0) {
+        log_error("소스 파일 열기 실패: %s", source);
+        return ERROR_FILE_OPEN;
+    }
+
+    buffer = malloc(capacity);
+    jobs = malloc(max_jobs * sizeof(chunk_job_t));
+    if (!buffer || !jobs) {
+        result = ERROR_MEMORY;
+    }
+
+    while (result == SUCCESS) {
+        size_t pos = 0, count = 0;
+
+        while (!eof && filled < capacity) {
+            ssize_t n = read(fd, buffer + filled, capacity - filled);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                log_error("파일 읽기 실패: %s", source);
+                result = ERROR_FILE_READ;
+                break;
+            }
+            if (n == 0) {
+                eof = 1;
+            }
+            filled += (size_t)n;
+        }
+        if (result != SUCCESS || filled == 0) {
+            break;
+        }
+
+        // 파일 끝이 아니면 최대 청크 크기만큼은 남겨 다음 구간과 이어서 자름
+        while (pos < filled && (eof || filled - pos >= CDC_MAX_SIZE)) {
+            size_t len = cdc_chunk_length(buffer + pos, filled - pos);
+            jobs[count].data = buffer + pos;
+            jobs[count].length = len;
+            jobs[count].stored = 0;
+            jobs[count].result = SUCCESS;
+            count++;
+            pos += len;
+        }
+
+        store_jobs_t batch = { store, jobs };
+        parallel_for(store_chunk_job, &batch, count, store->threads);
+
+        if (recipe_count + count > recipe_capacity) {
+            size_t new_capacity = MAX(recipe_capacity * 2, recipe_count + count);
+            recipe_chunk_t *grown = realloc(recipe, new_capacity * sizeof(recipe_chunk_t));
+            if (!grown) {
+                result = ERROR_MEMORY;
+                break;
+            }
+            recipe = grown;
+            recipe_capacity = new_capacity;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (jobs[i].result != SUCCESS) {
+                result = jobs[i].result;
+            }
+            new_bytes += jobs[i].stored;
+            memcpy(recipe[recipe_count].hash, jobs[i].hash, BLAKE3_OUT_LEN);
+            recipe[recipe_count].length = (uint32_t)jobs[i].length;
+            recipe_count++;
+        }
+
+        if (hash) {
+            checksum_update(hash, buffer, pos);
+        }
+        total += pos;
+
+        memmove(buffer, buffer + pos, filled - pos);
+        filled -= pos;
+        if (eof && filled == 0) {
+            break;
+        }
+    }
+
+    close(fd);
+    free(buffer);
+    free(jobs);
+
+    if (result == SUCCESS) {
+        result = append_recipe(recipe, recipe_count, offset);
+    }
+    free(recipe);
+
+    if (result == SUCCESS) {
+        *size = total;
+        *stored = new_bytes;
+    }
+    return result;
+}
+
+// ---- 레시피 파일 ----
+
+// store_path는 기록용 경로 (상대 경로면 백업 루트 기준)
+int recipe_file_open(const char *backup_path, const char *store_path) {
+    char path[MAX_PATH];
+    unsigned char header[8 + 2];
+    size_t store_len = strlen(store_path);
+
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_RECIPES_FILE) >= sizeof(path)) {
+        log_error("경로가 너무 깁니다: %s", backup_path);
+        return ERROR_INVALID_PARAMS;
+    }
+
+    pthread_mutex_lock(&recipe_mutex);
+    recipe_file = fopen(path, "wb");
+    if (!recipe_file) {
+        pthread_mutex_unlock(&recipe_mutex);
+        log_error("레시피 파일 생성 실패: %s", path);
+        return ERROR_FILE_WRITE;
+    }
+
+    memcpy(header, RECIPE_MAGIC, 8);
+    header[8] = (unsigned char)store_len;
+    header[9] = (unsigned char)(store_len >> 8);
+    fwrite(header, 1, sizeof(header), recipe_file);
+    fwrite(store_path, 1, store_len, recipe_file);
+    recipe_offset = sizeof(header) + store_len;
+    pthread_mutex_unlock(&recipe_mutex);
+
+    return SUCCESS;
+}
+
+int recipe_file_close(void) {
+    int result = SUCCESS;
+
+    pthread_mutex_lock(&recipe_mutex);
+    if (recipe_file && fclose(recipe_file) != 0) {
+        result = ERROR_FILE_WRITE;
+    }
+    recipe_file = NULL;
+    pthread_mutex_unlock(&recipe_mutex);
+
+    return result;
+}
+
+// ---- 복원 (재조립) ----
+
+typedef struct {
+    char store_path[MAX_PATH];
+    const recipe_chunk_t *chunks;
+    unsigned char **data;
+    int *results;
+} fetch_jobs_t;
+
+// 청크 읽기 + 압축 해제 + BLAKE3 확인
+static void fetch_chunk_job(void *ctx, size_t index) {
+    fetch_jobs_t *batch = (fetch_jobs_t *)ctx;
+    const recipe_chunk_t *chunk = &batch->chunks[index];
+    char path[MAX_PATH];
+    unsigned char hash[BLAKE3_OUT_LEN];
+    unsigned char *raw = NULL, *plain = NULL;
+    size_t plain_len = 0;
+    blake3_hasher_t hasher;
+    struct stat st;
+    FILE *file;
+
+    batch->data[index] = NULL;
+    if (chunk_path(batch->store_path, chunk->hash, path, sizeof(path)) != SUCCESS) {
+        batch->results[index] = ERROR_INVALID_PARAMS;
+        return;
+    }
+
+    file = fopen(path, "rb");
+    if (!file) {
+        log_error("청크 없음: %s", path);
+        batch->results[index] = ERROR_FILE_NOT_FOUND;
+        return;
+    }
+
+    if (fstat(fileno(file), &st) != 0 || st.st_size < 1 ||
+        !(raw = malloc((size_t)st.st_size)) ||
+        fread(raw, 1, (size_t)st.st_size, file) != (size_t)st.st_size) {
+        fclose(file);
+        free(raw);
+        log_error("청크 읽기 실패: %s", path);
+        batch->results[index] = ERROR_FILE_READ;
+        return;
+    }
+    fclose(file);
+
+    if (raw[0] == COMPRESS_NONE) {
+        plain_len = (size_t)st.st_size - 1;
+        plain = malloc(plain_len ? plain_len : 1);
+        if (plain) memcpy(plain, raw + 1, plain_len);
+    } else if (decompress_buffer((compression_type_t)raw[0], raw + 1, (size_t)st.st_size - 1,
+                                 &plain, &plain_len) != SUCCESS) {
+        plain = NULL;
+    }
+    free(raw);
+
+    if (!plain) {
+        log_error("청크 압축 해제 실패: %s", path);
+        batch->results[index] = ERROR_COMPRESSION;
+        return;
+    }
+
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, plain, plain_len);
+    blake3_hasher_finalize(&hasher, hash);
+    if (plain_len != chunk->length || memcmp(hash, chunk->hash, BLAKE3_OUT_LEN) != 0) {
+        log_error("청크 손상: %s", path);
+        free(plain);
+        batch->results[index] = ERROR_CHECKSUM;
+        return;
+    }
+
+    batch->data[index] = plain;
+    batch->results[index] = SUCCESS;
+}
+
+// 백업의 레시피 파일을 열고 헤더의 저장소 경로를 읽음 (상대 경로면 백업 루트 기준으로 바꿈)
+static FILE *open_recipe_file(const char *backup_path, char *store_path, size_t store_size) {
+    char path[MAX_PATH];
+    unsigned char header[8 + 2];
+    char stored[MAX_PATH];
+    size_t store_len;
+    FILE *file;
+
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_RECIPES_FILE) >= sizeof(path)) {
+        log_error("경로가 너무 깁니다: %s", backup_path);
+        return NULL;
+    }
+    file = fopen(path, "rb");
+    if (!file) {
+        log_error("레시피 파일 없음: %s", path);
+        return NULL;
+    }
+
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, RECIPE_MAGIC, 8) != 0) {
+        fclose(file);
+        log_error("레시피 파일 형식 오류: %s", path);
+        return NULL;
+    }
+
+    store_len = (size_t)header[8] | ((size_t)header[9] << 8);
+    if (store_len >= sizeof(stored) || fread(stored, 1, store_len, file) != store_len) {
+        fclose(file);
+        log_error("레시피 파일 형식 오류: %s", path);
+        return NULL;
+    }
+    stored[store_len] = '\0';
+
+    if ((size_t)(stored[0] == '/' ? snprintf(store_path, store_size, "%s", stored)
+                                  : snprintf(store_path, store_size, "%s/%s", backup_path, stored)) >= store_size) {
+        fclose(file);
+        log_error("청크 저장소 경로가 너무 깁니다: %s", stored);
+        return NULL;
+    }
+    return file;
+}
+
+// 백업의 레시피 파일에서 저장소 경로와 offset 위치 레시피 읽기
+static int read_recipe(const char *backup_path, uint64_t offset, char *store_path, size_t store_size,
+                       recipe_chunk_t **chunks, size_t *count) {
+    char path[MAX_PATH];
+    unsigned char count_buf[4];
+    unsigned char entry[RECIPE_ENTRY_SIZE];
+    FILE *file;
+
+    file = open_recipe_file(backup_path, store_path, store_size);
+    if (!file) {
+        return ERROR_FILE_READ;
+    }
+    snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_RECIPES_FILE);
+
+    if (fseeko(file, (off_t)offset, SEEK_SET) != 0 || fread(count_buf, 1, 4, file) != 4) {
+        fclose(file);
+        log_error("레시피 읽기 실패: %s (offset %llu)", path, (unsigned long long)offset);
+        return ERROR_FILE_READ;
+    }
+
+    *count = load_u32(count_buf);
+    *chunks = malloc((*count ? *count : 1) * sizeof(recipe_chunk_t));
+    if (!*chunks) {
+        fclose(file);
+        return ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < *count; i++) {
+        if (fread(entry, 1, sizeof(entry), file) != sizeof(entry)) {
+            fclose(file);
+            free(*chunks);
+            *chunks = NULL;
+            return ERROR_FILE_READ;
+        }
+        memcpy((*chunks)[i].hash, entry, BLAKE3_OUT_LEN);
+        (*chunks)[i].length = load_u32(entry + BLAKE3_OUT_LEN);
+    }
+
+    fclose(file);
+    return SUCCESS;
+}
+
+// 레시피대로 청크를 모아 out에 순서대로 기록 (out이 NULL이면 검증만), hash가 있으면 함께 계산
+int chunk_store_restore_file(const char *backup_path, uint64_t offset, FILE *out,
+                             checksum_ctx_t *hash, int threads, uint64_t *size) {
+    fetch_jobs_t batch;
+    recipe_chunk_t *chunks = NULL;
+    unsigned char *data[CDC_RESTORE_WINDOW];
+    int results[CDC_RESTORE_WINDOW];
+    size_t count = 0;
+    uint64_t total = 0;
+    int result;
+
+    pthread_once(&gear_once, init_gear_table);
+
+    result = read_recipe(backup_path, offset, batch.store_path, sizeof(batch.store_path), &chunks, &count);
+    if (result != SUCCESS) {
+        return result;
+    }
+
+    threads = parallel_thread_count(threads);
+    batch.data = data;
+    batch.results = results;
+
+    for (size_t start = 0; start < count && result == SUCCESS; start += CDC_RESTORE_WINDOW) {
+        size_t window = MIN((size_t)CDC_RESTORE_WINDOW, count - start);
+
+        batch.chunks = chunks + start;
+        parallel_for(fetch_chunk_job, &batch, window, threads);
+
+        for (size_t i = 0; i < window; i++) {
+            if (result == SUCCESS && results[i] != SUCCESS) {
+                result = results[i];
+            }
+            if (result == SUCCESS) {
+                if (out && fwrite(data[i], 1, chunks[start + i].length, out) != chunks[start + i].length) {
+                    result = ERROR_FILE_WRITE;
+                }
+                if (hash) {
+                    checksum_update(hash, data[i], chunks[start + i].length);
+                }
+                total += chunks[start + i].length;
+            }
+            free(data[i]);
+        }
+    }
+
+    free(chunks);
+    if (result == SUCCESS && size) {
+        *size = total;
+    }
+    return result;
+}
+
+
+// ---- 레시피 복사 (합성 전체 백업) ----
+
+// 백업의 레시피 파일이 가리키는 청크 저장소의 절대 경로
+int recipe_store_path(const char *backup_path, char *store_path, size_t size) {
+    char path[MAX_PATH];
+    char resolved[PATH_MAX];
+    FILE *file;
+
+    file = open_recipe_file(backup_path, path, sizeof(path));
+    if (!file) {
+        return ERROR_FILE_READ;
+    }
+    fclose(file);
+
+    if (!realpath(path, resolved)) {
+        log_error("청크 저장소 경로 확인 실패: %s", path);
+        return ERROR_FILE_NOT_FOUND;
+    }
+    if ((size_t)snprintf(store_path, size, "%s", resolved) >= size) {
+        log_error("청크 저장소 경로가 너무 깁니다: %s", resolved);
+        return ERROR_INVALID_PARAMS;
+    }
+    return SUCCESS;
+}
+
+// 다른 백업의 레시피를 지금 열린 레시피 파일에 그대로 추가 (청크는 다시 읽지 않음)
+// 두 레시피가 같은 저장소를 가리켜야 함 (store_path = 열린 레시피 파일의 저장소 절대 경로)
+int chunk_store_copy_recipe(const char *backup_path, uint64_t offset, const char *store_path,
+                            uint64_t *new_offset) {
+    recipe_chunk_t *chunks = NULL;
+    char source_store[MAX_PATH];
+    char resolved[PATH_MAX];
+    size_t count = 0;
+    int result;
+
+    result = read_recipe(backup_path, offset, source_store, sizeof(source_store), &chunks, &count);
+    if (result != SUCCESS) {
+        return result;
+    }
+
+    if (!realpath(source_store, resolved) || strcmp(resolved, store_path) != 0) {
+        free(chunks);
+        return ERROR_INVALID_PARAMS;
+    }
+
+    result = append_recipe(chunks, count, new_offset);
+    free(chunks);
+    return result;
+}
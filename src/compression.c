@@ -1,5 +1,13 @@
 #include "backup.h"
 
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+// 현재 사용 중인 deflate 백엔드와 압축 레벨
+static deflate_backend_t active_backend = DEFLATE_BACKEND_ZLIB;
+static int active_level = Z_BEST_COMPRESSION;
+
 const char *get_compression_extension(compression_type_t type) {
     switch (type) {
         case COMPRESS_GZIP:
@@ -21,318 +29,1057 @@ compression_type_t get_compression_type(const char *filename) {
     return COMPRESS_NONE;
 }
 
-// 간단한 파일 복사 (압축 없음)
-int copy_file_simple(const char *source, const char *dest) {
-    FILE *src_file, *dest_file;
-    char buffer[BUFFER_SIZE];
-    size_t bytes_read, bytes_written;
-    
-    if (!source || !dest) {
+deflate_backend_t parse_deflate_backend(const char *str) {
+    if (!str || strcmp(str, "auto") == 0) return DEFLATE_BACKEND_AUTO;
+    if (strcmp(str, "zlib") == 0) return DEFLATE_BACKEND_ZLIB;
+    if (strcmp(str, "libdeflate") == 0) return DEFLATE_BACKEND_LIBDEFLATE;
+    return DEFLATE_BACKEND_INVALID;
+}
+
+const char *get_deflate_backend_name(deflate_backend_t backend) {
+    switch (backend) {
+        case DEFLATE_BACKEND_ZLIB:
+            return "zlib";
+        case DEFLATE_BACKEND_LIBDEFLATE:
+            return "libdeflate";
+        default:
+            return "auto";
+    }
+}
+
+deflate_backend_t get_deflate_backend(void) {
+    return active_backend;
+}
+
+// 압축 백엔드 초기화 (auto는 빌드에 포함된 가장 빠른 구현 선택)
+void init_compression(const backup_options_t *opts) {
+    if (!opts) return;
+
+    switch (opts->deflate_backend) {
+        case DEFLATE_BACKEND_LIBDEFLATE:
+#ifdef HAVE_LIBDEFLATE
+            active_backend = DEFLATE_BACKEND_LIBDEFLATE;
+#else
+            log_warning("libdeflate 없이 빌드되었습니다 (make LIBDEFLATE=1 필요). zlib 백엔드를 사용합니다.");
+            active_backend = DEFLATE_BACKEND_ZLIB;
+#endif
+            break;
+        case DEFLATE_BACKEND_ZLIB:
+            active_backend = DEFLATE_BACKEND_ZLIB;
+            break;
+        case DEFLATE_BACKEND_AUTO:
+        default:
+#ifdef HAVE_LIBDEFLATE
+            active_backend = DEFLATE_BACKEND_LIBDEFLATE;
+#else
+            active_backend = DEFLATE_BACKEND_ZLIB;
+#endif
+            break;
+    }
+
+    if (opts->compression_level >= 1 && opts->compression_level <= 9) {
+        active_level = opts->compression_level;
+    }
+
+    log_debug("deflate 백엔드: %s (레벨 %d)", get_deflate_backend_name(active_backend), active_level);
+}
+
+#ifdef HAVE_LIBDEFLATE
+// libdeflate 압축기/해제기는 스레드 간 공유할 수 없으므로 스레드별로 캐시
+static __thread struct libdeflate_compressor *tls_compressor = NULL;
+static __thread int tls_compressor_level = -1;
+static __thread struct libdeflate_decompressor *tls_decompressor = NULL;
+
+static struct libdeflate_compressor *get_libdeflate_compressor(int level) {
+    if (tls_compressor && tls_compressor_level == level) {
+        return tls_compressor;
+    }
+
+    if (tls_compressor) {
+        libdeflate_free_compressor(tls_compressor);
+    }
+
+    tls_compressor = libdeflate_alloc_compressor(level);
+    tls_compressor_level = tls_compressor ? level : -1;
+    return tls_compressor;
+}
+
+static struct libdeflate_decompressor *get_libdeflate_decompressor(void) {
+    if (!tls_decompressor) {
+        tls_decompressor = libdeflate_alloc_decompressor();
+    }
+    return tls_decompressor;
+}
+
+// out 에 압축 (cap 에 들어가지 않으면 ERROR_MEMORY)
+static int compress_into_libdeflate(compression_type_t type, int level, const unsigned char *in, size_t in_len,
+                                    unsigned char *out, size_t cap, size_t *out_len) {
+    struct libdeflate_compressor *compressor = get_libdeflate_compressor(level);
+    size_t written;
+
+    if (!compressor) {
+        log_error("libdeflate 압축기 생성 실패 (레벨 %d)", level);
+        return ERROR_COMPRESSION;
+    }
+
+    written = (type == COMPRESS_GZIP) ? libdeflate_gzip_compress(compressor, in, in_len, out, cap)
+                                      : libdeflate_zlib_compress(compressor, in, in_len, out, cap);
+    if (written == 0) {
+        return ERROR_MEMORY;
+    }
+    *out_len = written;
+    return SUCCESS;
+}
+
+static int compress_buffer_libdeflate(compression_type_t type, int level,
+                                      const unsigned char *in, size_t in_len,
+                                      unsigned char **out, size_t *out_len) {
+    struct libdeflate_compressor *compressor = get_libdeflate_compressor(level);
+    unsigned char *buffer;
+    size_t bound;
+    int result;
+
+    if (!compressor) {
+        log_error("libdeflate 압축기 생성 실패 (레벨 %d)", level);
+        return ERROR_MEMORY;
+    }
+
+    bound = (type == COMPRESS_GZIP) ? libdeflate_gzip_compress_bound(compressor, in_len)
+                                    : libdeflate_zlib_compress_bound(compressor, in_len);
+    buffer = malloc(bound);
+    if (!buffer) {
+        return ERROR_MEMORY;
+    }
+
+    result = compress_into_libdeflate(type, level, in, in_len, buffer, bound, out_len);
+    if (result != SUCCESS) {
+        free(buffer);
+        return ERROR_COMPRESSION;
+    }
+    *out = buffer;
+    return SUCCESS;
+}
+
+// out 에 해제 (gzip 은 여러 멤버를 이어서, cap 에 들어가지 않으면 ERROR_MEMORY)
+static int decompress_into_libdeflate(compression_type_t type, const unsigned char *in, size_t in_len,
+                                      unsigned char *out, size_t cap, size_t *out_len) {
+    struct libdeflate_decompressor *decompressor = get_libdeflate_decompressor();
+    size_t in_pos = 0, out_pos = 0;
+
+    if (!decompressor) {
+        return ERROR_MEMORY;
+    }
+
+    for (;;) {
+        size_t in_used = 0, produced = 0;
+        enum libdeflate_result ret;
+
+        if (type == COMPRESS_GZIP) {
+            ret = libdeflate_gzip_decompress_ex(decompressor, in + in_pos, in_len - in_pos,
+                                                out + out_pos, cap - out_pos, &in_used, &produced);
+        } else {
+            ret = libdeflate_zlib_decompress_ex(decompressor, in + in_pos, in_len - in_pos,
+                                                out + out_pos, cap - out_pos, &in_used, &produced);
+        }
+        if (ret == LIBDEFLATE_INSUFFICIENT_SPACE) {
+            return ERROR_MEMORY;
+        }
+        if (ret != LIBDEFLATE_SUCCESS) {
+            return ERROR_COMPRESSION;
+        }
+
+        in_pos += in_used;
+        out_pos += produced;
+        if (type != COMPRESS_GZIP || in_pos >= in_len) {
+            break;
+        }
+    }
+
+    *out_len = out_pos;
+    return SUCCESS;
+}
+
+static int decompress_buffer_libdeflate(compression_type_t type, const unsigned char *in, size_t in_len,
+                                        size_t initial, size_t limit,
+                                        unsigned char **out, size_t *out_len) {
+    unsigned char *buffer = NULL;
+    size_t capacity = initial;
+    int result;
+
+    // 버퍼가 모자라면 키워서 처음부터 다시 해제
+    for (;;) {
+        unsigned char *grown = realloc(buffer, capacity);
+
+        if (!grown) {
+            free(buffer);
+            return ERROR_MEMORY;
+        }
+        buffer = grown;
+
+        result = decompress_into_libdeflate(type, in, in_len, buffer, capacity, out_len);
+        if (result != ERROR_MEMORY || capacity >= limit) {
+            break;
+        }
+        capacity = MIN(capacity * 2, limit);
+    }
+
+    if (result != SUCCESS) {
+        free(buffer);
+        return result;
+    }
+    *out = buffer;
+    return SUCCESS;
+}
+#endif
+
+// 스레드별 zlib 스트림 (상태는 arena 에서 할당, 스레드가 끝날 때까지 Reset 으로 재사용)
+// 레벨 9 deflate 상태는 약 270KB 이므로 파일/청크마다 Init/End 하지 않음.
+// deflateParams 는 zlib 버전에 따라 Reset 직후에도 블록을 내보낼 수 있어 레벨별로 따로 둠.
+static __thread z_stream *tls_deflate[2][10];   // [gzip 여부][레벨]
+static __thread z_stream *tls_inflate[2];       // [gzip 여부]
+
+static voidpf arena_zalloc(voidpf opaque, uInt items, uInt size) {
+    (void)opaque;
+    return arena_alloc((size_t)items * size);
+}
+
+static void arena_zfree(voidpf opaque, voidpf address) {
+    (void)opaque;
+    (void)address; // arena 는 스레드가 끝날 때 한꺼번에 반환
+}
+
+static z_stream *new_zstream(void) {
+    z_stream *strm = arena_alloc(sizeof(z_stream));
+
+    if (!strm) return NULL;
+    memset(strm, 0, sizeof(*strm));
+    strm->zalloc = arena_zalloc;
+    strm->zfree = arena_zfree;
+    return strm;
+}
+
+// 호출 스레드의 deflate 스트림 (처음 시작 상태, 실패하면 NULL)
+static z_stream *acquire_deflate(compression_type_t type, int level) {
+    int gzip = (type == COMPRESS_GZIP);
+    z_stream **slot = &tls_deflate[gzip][level];
+
+    if (*slot) {
+        return deflateReset(*slot) == Z_OK ? *slot : NULL;
+    }
+
+    z_stream *strm = new_zstream();
+    if (!strm || deflateInit2(strm, level, Z_DEFLATED, gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        log_error("ZLIB 초기화 실패");
+        return NULL;
+    }
+    *slot = strm;
+    return strm;
+}
+
+static z_stream *acquire_inflate(compression_type_t type) {
+    int gzip = (type == COMPRESS_GZIP);
+    z_stream **slot = &tls_inflate[gzip];
+
+    if (*slot) {
+        return inflateReset(*slot) == Z_OK ? *slot : NULL;
+    }
+
+    z_stream *strm = new_zstream();
+    if (!strm || inflateInit2(strm, gzip ? 15 + 16 : 15) != Z_OK) {
+        log_error("ZLIB 초기화 실패");
+        return NULL;
+    }
+    *slot = strm;
+    return strm;
+}
+
+// zlib 단일 호출 압축 (gzip/zlib 래퍼)
+static int compress_buffer_zlib(compression_type_t type, int level,
+                                const unsigned char *in, size_t in_len,
+                                unsigned char **out, size_t *out_len) {
+    z_stream *strm;
+    unsigned char *buffer;
+    uLong bound;
+
+    if (in_len > UINT_MAX) {
         return ERROR_INVALID_PARAMS;
     }
-    
-    src_file = fopen(source, "rb");
-    if (!src_file) {
-        log_error("소스 파일 열기 실패: %s", source);
-        return ERROR_FILE_OPEN;
+
+    strm = acquire_deflate(type, level);
+    if (!strm) {
+        return ERROR_COMPRESSION;
     }
-    
-    dest_file = fopen(dest, "wb");
-    if (!dest_file) {
-        log_error("대상 파일 생성 실패: %s", dest);
-        fclose(src_file);
-        return ERROR_FILE_OPEN;
+
+    bound = deflateBound(strm, in_len);
+    buffer = malloc(bound);
+    if (!buffer) {
+        return ERROR_MEMORY;
     }
-    
-    while ((bytes_read = fread(buffer, 1, BUFFER_SIZE, src_file)) > 0) {
-        bytes_written = fwrite(buffer, 1, bytes_read, dest_file);
-        if (bytes_written != bytes_read) {
-            log_error("파일 쓰기 실패: %s", dest);
-            fclose(src_file);
-            fclose(dest_file);
-            unlink(dest); // 불완전한 파일 제거
-            return ERROR_FILE_WRITE;
+
+    strm->next_in = (Bytef *)in;
+    strm->avail_in = (uInt)in_len;
+    strm->next_out = buffer;
+    strm->avail_out = (uInt)bound;
+
+    if (deflate(strm, Z_FINISH) != Z_STREAM_END) {
+        free(buffer);
+        return ERROR_COMPRESSION;
+    }
+
+    *out = buffer;
+    *out_len = strm->total_out;
+    return SUCCESS;
+}
+
+static int decompress_buffer_zlib(compression_type_t type, const unsigned char *in, size_t in_len,
+                                  size_t initial, size_t limit,
+                                  unsigned char **out, size_t *out_len) {
+    z_stream *strm;
+    unsigned char *buffer;
+    size_t capacity = initial ? initial : 1;
+    int ret;
+
+    if (in_len > UINT_MAX) {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    strm = acquire_inflate(type);
+    if (!strm) {
+        return ERROR_COMPRESSION;
+    }
+
+    buffer = malloc(capacity);
+    if (!buffer) {
+        return ERROR_MEMORY;
+    }
+
+    strm->next_in = (Bytef *)in;
+    strm->avail_in = (uInt)in_len;
+
+    for (;;) {
+        if (strm->total_out == capacity) {
+            if (capacity >= limit) {
+                ret = Z_MEM_ERROR;
+                break;
+            }
+            capacity = MIN(capacity * 2, limit);
+            unsigned char *grown = realloc(buffer, capacity);
+            if (!grown) {
+                ret = Z_MEM_ERROR;
+                break;
+            }
+            buffer = grown;
+        }
+
+        strm->next_out = buffer + strm->total_out;
+        strm->avail_out = (uInt)MIN(capacity - strm->total_out, (size_t)UINT_MAX);
+
+        ret = inflate(strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            // 다음 gzip 멤버가 이어지면 계속 해제
+            if (type == COMPRESS_GZIP && strm->avail_in > 0) {
+                uLong produced = strm->total_out;
+                inflateReset(strm);
+                strm->total_out = produced;
+                continue;
+            }
+            break;
+        }
+        if (ret == Z_BUF_ERROR && strm->avail_in == 0) {
+            ret = Z_DATA_ERROR; // 잘린 스트림
+            break;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            break;
         }
     }
-    
-    if (ferror(src_file)) {
-        log_error("파일 읽기 실패: %s", source);
-        fclose(src_file);
-        fclose(dest_file);
-        unlink(dest);
+
+    if (ret != Z_STREAM_END) {
+        free(buffer);
+        return (ret == Z_MEM_ERROR) ? ERROR_MEMORY : ERROR_COMPRESSION;
+    }
+
+    *out = buffer;
+    *out_len = strm->total_out;
+    return SUCCESS;
+}
+
+// 메모리 버퍼 전체를 한 번에 압축 (결과 버퍼는 호출자가 free)
+int compress_buffer(compression_type_t type, int level, const unsigned char *in, size_t in_len,
+                    unsigned char **out, size_t *out_len) {
+    if (!out || !out_len || (!in && in_len > 0)) {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (type != COMPRESS_GZIP && type != COMPRESS_ZLIB) {
+        log_error("지원되지 않는 압축 타입: %d", type);
+        return ERROR_COMPRESSION;
+    }
+
+    level = MAX(0, MIN(level, 9));
+
+#ifdef HAVE_LIBDEFLATE
+    if (active_backend == DEFLATE_BACKEND_LIBDEFLATE) {
+        return compress_buffer_libdeflate(type, level, in, in_len, out, out_len);
+    }
+#endif
+    return compress_buffer_zlib(type, level, in, in_len, out, out_len);
+}
+
+// gzip 트레일러의 ISIZE (마지막 멤버의 원본 크기 mod 2^32, little-endian)
+static size_t gzip_isize(const unsigned char *trailer) {
+    return (size_t)trailer[0] | ((size_t)trailer[1] << 8) | ((size_t)trailer[2] << 16) |
+           ((size_t)trailer[3] << 24);
+}
+
+static int decompress_buffer_limited(compression_type_t type, const unsigned char *in, size_t in_len,
+                                     size_t limit, unsigned char **out, size_t *out_len) {
+    size_t initial = in_len * 4;
+
+    if (!out || !out_len || (!in && in_len > 0)) {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (type != COMPRESS_GZIP && type != COMPRESS_ZLIB) {
+        log_error("지원되지 않는 압축 타입: %d", type);
+        return ERROR_COMPRESSION;
+    }
+
+    // gzip 트레일러의 ISIZE(원본 크기 mod 2^32)를 초기 버퍼 크기로 사용
+    if (type == COMPRESS_GZIP && in_len >= 18) {
+        initial = gzip_isize(in + in_len - 4);
+    }
+    initial = MAX(MIN(initial, limit), (size_t)BUFFER_SIZE);
+
+#ifdef HAVE_LIBDEFLATE
+    if (active_backend == DEFLATE_BACKEND_LIBDEFLATE) {
+        return decompress_buffer_libdeflate(type, in, in_len, initial, limit, out, out_len);
+    }
+#endif
+    return decompress_buffer_zlib(type, in, in_len, initial, limit, out, out_len);
+}
+
+// 메모리 버퍼 전체를 한 번에 해제 (결과 버퍼는 호출자가 free)
+int decompress_buffer(compression_type_t type, const unsigned char *in, size_t in_len,
+                      unsigned char **out, size_t *out_len) {
+    return decompress_buffer_limited(type, in, in_len, SIZE_MAX / 2, out, out_len);
+}
+
+// 백엔드의 CRC32 구현 (zlib crc32와 동일한 값)
+uint32_t backend_crc32(uint32_t crc, const void *data, size_t len) {
+#ifdef HAVE_LIBDEFLATE
+    if (active_backend == DEFLATE_BACKEND_LIBDEFLATE) {
+        return libdeflate_crc32(crc, data, len);
+    }
+#endif
+    return (uint32_t)crc32_z(crc, (const Bytef *)data, len);
+}
+
+#ifdef HAVE_LIBDEFLATE
+// zlib 포맷은 원본 크기를 담지 않으므로 이 압축률까지만 가정하고 한 번에 해제
+#define ZLIB_WHOLE_RATIO 16
+
+// 연 파일에서 size 바이트 이하를 buffer 에 통째로 읽음 (그보다 커졌으면 ERROR_MEMORY: 스트리밍으로 전환)
+static int read_whole_file(int fd, const char *path, unsigned char *buffer, size_t size, size_t *len) {
+    unsigned char extra;
+    ssize_t n;
+
+    n = read_full(fd, buffer, size);
+    if (n == (ssize_t)size && read_full(fd, &extra, 1) != 0) {
+        return ERROR_MEMORY;
+    }
+    if (n < 0) {
+        log_error("파일 읽기 실패: %s", path);
         return ERROR_FILE_READ;
     }
-    
-    fclose(src_file);
-    fclose(dest_file);
-    
+    *len = (size_t)n;
     return SUCCESS;
 }
 
-// GZIP 압축
-int compress_file_gzip(const char *source, const char *dest) {
-    FILE *src_file;
-    gzFile dest_gz;
-    char buffer[BUFFER_SIZE];
-    int bytes_read;
-    
-    src_file = fopen(source, "rb");
-    if (!src_file) {
+// 압축 파일 하나를 해제한 크기 (gzip 은 트레일러의 ISIZE, zlib 은 ZLIB_WHOLE_RATIO 로 가정한 상한).
+// WHOLE_FILE_MAX 를 넘으면 ERROR_MEMORY: 읽기 전에 스트리밍으로 보냄
+static int whole_output_size(int fd, compression_type_t type, size_t packed, size_t *raw) {
+    unsigned char trailer[4];
+
+    if (type == COMPRESS_ZLIB) {
+        if (packed > WHOLE_FILE_MAX / ZLIB_WHOLE_RATIO) {
+            return ERROR_MEMORY;
+        }
+        *raw = WHOLE_FILE_MAX;
+        return SUCCESS;
+    }
+
+    // 여러 멤버거나 원본이 4GB 를 넘으면 ISIZE 가 작게 나옴: 해제 중 모자라서 전환
+    if (packed < 18 || pread(fd, trailer, sizeof(trailer), (off_t)(packed - 4)) != (ssize_t)sizeof(trailer)) {
+        return ERROR_MEMORY;
+    }
+    *raw = gzip_isize(trailer);
+    return (*raw <= WHOLE_FILE_MAX) ? SUCCESS : ERROR_MEMORY;
+}
+
+// 버퍼 전체 쓰기 (실패 시 불완전한 파일 제거, 여는 시간은 *t 부터 open 단계로)
+static int write_whole_file(const char *path, const unsigned char *data, size_t len, uint64_t *t) {
+    int fd;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        log_error("대상 파일 생성 실패: %s", path);
+        return ERROR_FILE_OPEN;
+    }
+    metrics_lap(METRIC_OPEN, t, 0);
+
+    if (write_full(fd, data, len) != SUCCESS || close(fd) != 0) {
+        log_error("파일 쓰기 실패: %s", path);
+        unlink(path);
+        return ERROR_FILE_WRITE;
+    }
+    return SUCCESS;
+}
+
+// WHOLE_FILE_MAX 이하 파일을 한 번의 libdeflate 호출로 압축 (입력/출력은 스레드별 파일 전체 버퍼).
+// 출력 버퍼는 압축 상한 크기라 모자라지 않음. 읽는 사이 파일이 커졌으면 아무것도 쓰지 않고
+// ERROR_MEMORY (호출자가 스트리밍)
+static int compress_file_whole(const char *source, const char *dest, compression_type_t type,
+                               size_t size, checksum_ctx_t *hash) {
+    struct libdeflate_compressor *compressor = get_libdeflate_compressor(active_level);
+    unsigned char *data, *packed;
+    size_t bound, data_len = 0, packed_len = 0;
+    uint64_t start = metrics_now(), opened, t;
+    int result, fd;
+
+    if (!compressor) {
+        log_error("libdeflate 압축기 생성 실패 (레벨 %d)", active_level);
+        return ERROR_COMPRESSION;
+    }
+    bound = (type == COMPRESS_GZIP) ? libdeflate_gzip_compress_bound(compressor, size)
+                                    : libdeflate_zlib_compress_bound(compressor, size);
+    data = whole_buffer_get(0, MAX(size, (size_t)1));
+    packed = whole_buffer_get(1, bound);
+    if (!data || !packed) {
+        return ERROR_MEMORY;
+    }
+
+    fd = open(source, O_RDONLY);
+    if (fd < 0) {
         log_error("소스 파일 열기 실패: %s", source);
         return ERROR_FILE_OPEN;
     }
-    
-    dest_gz = gzopen(dest, "wb9"); // 최대 압축 레벨
-    if (!dest_gz) {
-        log_error("GZIP 파일 생성 실패: %s", dest);
-        fclose(src_file);
+    opened = metrics_now();
+
+    result = read_whole_file(fd, source, data, size, &data_len);
+    close(fd);
+    // 스트리밍으로 넘어가면 거기서 다시 열고 세므로 여는 시간과 파일 수는 이 경로가 파일을 맡은 뒤에 기록
+    if (result == ERROR_MEMORY) {
+        return result;
+    }
+    t = metrics_now();
+    metrics_add(METRIC_OPEN, opened - start, 0);
+    metrics_count(METRIC_OPEN, 0, 1);
+    metrics_add(METRIC_READ, t - opened, data_len);
+    if (result != SUCCESS) {
+        return result;
+    }
+
+    if (compress_into_libdeflate(type, active_level, data, data_len, packed, bound, &packed_len) != SUCCESS) {
+        log_error("압축 실패: %s", source);
+        return ERROR_COMPRESSION;
+    }
+    if (hash) {
+        checksum_update(hash, data, data_len);
+    }
+    metrics_lap(METRIC_COMPRESS, &t, data_len);
+
+    result = write_whole_file(dest, packed, packed_len, &t);
+    metrics_lap(METRIC_WRITE, &t, packed_len);
+    if (result == SUCCESS) {
+        metrics_count(METRIC_READ, 0, 1);
+        metrics_count(METRIC_COMPRESS, 0, 1);
+        metrics_count(METRIC_WRITE, 0, 1);
+    }
+    return result;
+}
+
+// 해제 결과가 WHOLE_FILE_MAX 이하인 압축 파일을 한 번에 해제.
+// 결과 크기는 읽기 전에 whole_output_size 로 정하고, 그래도 모자라면 ERROR_MEMORY (호출자가 스트리밍)
+static int decompress_file_whole(const char *source, const char *dest, compression_type_t type,
+                                 size_t size, checksum_ctx_t *hash) {
+    unsigned char *packed, *data;
+    size_t raw = 0, packed_len = 0, data_len = 0;
+    uint64_t start = metrics_now(), opened, t;
+    int result, fd;
+
+    fd = open(source, O_RDONLY);
+    if (fd < 0) {
+        log_error("소스 파일 열기 실패: %s", source);
         return ERROR_FILE_OPEN;
     }
-    
-    while ((bytes_read = fread(buffer, 1, BUFFER_SIZE, src_file)) > 0) {
-        if (gzwrite(dest_gz, buffer, bytes_read) != bytes_read) {
-            log_error("GZIP 쓰기 실패: %s", dest);
-            fclose(src_file);
-            gzclose(dest_gz);
-            unlink(dest);
-            return ERROR_FILE_WRITE;
+    opened = metrics_now();
+    if (whole_output_size(fd, type, size, &raw) != SUCCESS) {
+        close(fd);
+        return ERROR_MEMORY;
+    }
+    packed = whole_buffer_get(0, MAX(size, (size_t)1));
+    data = whole_buffer_get(1, MAX(raw, (size_t)1));
+    if (!packed || !data) {
+        close(fd);
+        return ERROR_MEMORY;
+    }
+
+    result = read_whole_file(fd, source, packed, size, &packed_len);
+    close(fd);
+    t = metrics_now();
+    if (result == SUCCESS) {
+        result = decompress_into_libdeflate(type, packed, packed_len, data, raw, &data_len);
+        if (result != SUCCESS && result != ERROR_MEMORY) {
+            log_error("%s 읽기 실패: %s", type == COMPRESS_GZIP ? "GZIP" : "ZLIB", source);
         }
     }
-    
-    if (ferror(src_file)) {
-        log_error("파일 읽기 실패: %s", source);
-        fclose(src_file);
-        gzclose(dest_gz);
-        unlink(dest);
-        return ERROR_FILE_READ;
+    // 해제가 모자라 스트리밍으로 넘어가면 거기서 다시 열고 세므로 여기까지는 기록하지 않음
+    if (result == ERROR_MEMORY) {
+        return result;
     }
-    
-    fclose(src_file);
-    
-    if (gzclose(dest_gz) != Z_OK) {
-        log_error("GZIP 파일 닫기 실패: %s", dest);
-        unlink(dest);
-        return ERROR_FILE_WRITE;
+    metrics_add(METRIC_OPEN, opened - start, 0);
+    metrics_count(METRIC_OPEN, 0, 1);
+    metrics_add(METRIC_READ, t - opened, packed_len);
+    if (result != SUCCESS) {
+        return result;
     }
-    
-    return SUCCESS;
+    if (hash) {
+        checksum_update(hash, data, data_len);
+    }
+    metrics_lap(METRIC_COMPRESS, &t, data_len);
+
+    result = write_whole_file(dest, data, data_len, &t);
+    metrics_lap(METRIC_WRITE, &t, data_len);
+    if (result == SUCCESS) {
+        metrics_count(METRIC_READ, 0, 1);
+        metrics_count(METRIC_COMPRESS, 0, 1);
+        metrics_count(METRIC_WRITE, 0, 1);
+    }
+    return result;
 }
+#endif
 
-// GZIP 해제
-int decompress_file_gzip(const char *source, const char *dest) {
-    gzFile src_gz;
-    FILE *dest_file;
-    char buffer[BUFFER_SIZE];
-    int bytes_read;
+// 간단한 파일 복사 (압축 없음, hash가 있으면 읽은 데이터를 함께 해시)
+int copy_file_hashed(const char *source, const char *dest, checksum_ctx_t *hash) {
+    unsigned char *buffer;
+    int src_fd, dest_fd;
+    int result = SUCCESS;
+    uint64_t t = metrics_now();
+    ssize_t n;
+    
+    if (!source || !dest) {
+        return ERROR_INVALID_PARAMS;
+    }
     
-    src_gz = gzopen(source, "rb");
-    if (!src_gz) {
-        log_error("GZIP 파일 열기 실패: %s", source);
+    src_fd = open(source, O_RDONLY);
+    if (src_fd < 0) {
+        log_error("소스 파일 열기 실패: %s", source);
         return ERROR_FILE_OPEN;
     }
     
-    dest_file = fopen(dest, "wb");
-    if (!dest_file) {
+    dest_fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (dest_fd < 0) {
         log_error("대상 파일 생성 실패: %s", dest);
-        gzclose(src_gz);
+        close(src_fd);
         return ERROR_FILE_OPEN;
     }
+    metrics_lap(METRIC_OPEN, &t, 0);
+    metrics_count(METRIC_OPEN, 0, 1);
+    
+    buffer = io_buffer_get();
+    if (!buffer) {
+        result = ERROR_MEMORY;
+        goto done;
+    }
     
-    while ((bytes_read = gzread(src_gz, buffer, BUFFER_SIZE)) > 0) {
-        if (fwrite(buffer, 1, bytes_read, dest_file) != (size_t)bytes_read) {
+    while ((n = read_full(src_fd, buffer, IO_BUFFER_SIZE)) > 0) {
+        if (hash) {
+            checksum_update(hash, buffer, (size_t)n);
+        }
+        metrics_lap(METRIC_READ, &t, (size_t)n);
+        if (write_full(dest_fd, buffer, (size_t)n) != SUCCESS) {
             log_error("파일 쓰기 실패: %s", dest);
-            gzclose(src_gz);
-            fclose(dest_file);
-            unlink(dest);
-            return ERROR_FILE_WRITE;
+            result = ERROR_FILE_WRITE;
+            break;
         }
+        metrics_lap(METRIC_WRITE, &t, (size_t)n);
     }
     
-    if (bytes_read < 0) {
-        log_error("GZIP 읽기 실패: %s", source);
-        gzclose(src_gz);
-        fclose(dest_file);
-        unlink(dest);
-        return ERROR_FILE_READ;
+    if (n < 0) {
+        log_error("파일 읽기 실패: %s", source);
+        result = ERROR_FILE_READ;
+    }
+
+done:
+    io_buffer_put(buffer);
+    close(src_fd);
+    if (close(dest_fd) != 0 && result == SUCCESS) {
+        log_error("파일 쓰기 실패: %s", dest);
+        result = ERROR_FILE_WRITE;
+    }
+    if (result != SUCCESS) {
+        unlink(dest); // 불완전한 파일 제거
+    } else {
+        metrics_count(METRIC_READ, 0, 1);
+        metrics_count(METRIC_WRITE, 0, 1);
     }
     
-    gzclose(src_gz);
-    fclose(dest_file);
-    
-    return SUCCESS;
+    return result;
 }
 
-// ZLIB 압축
-int compress_file_zlib(const char *source, const char *dest) {
-    FILE *src_file, *dest_file;
-    z_stream strm;
-    unsigned char in[BUFFER_SIZE];
-    unsigned char out[BUFFER_SIZE];
-    int ret, flush;
-    unsigned have;
+int copy_file_simple(const char *source, const char *dest) {
+    return copy_file_hashed(source, dest, NULL);
+}
+
+// GZIP/ZLIB 스트리밍 압축 (스레드의 deflate 스트림과 풀 버퍼 두 개 사용)
+static int compress_file_deflate(const char *source, const char *dest, compression_type_t type,
+                                 checksum_ctx_t *hash) {
+    unsigned char *in = NULL, *out = NULL;
+    z_stream *strm;
+    int src_fd, dest_fd;
+    int result = SUCCESS;
+    int flush = Z_NO_FLUSH;
+    uint64_t t = metrics_now();
     
-    src_file = fopen(source, "rb");
-    if (!src_file) {
+    src_fd = open(source, O_RDONLY);
+    if (src_fd < 0) {
         log_error("소스 파일 열기 실패: %s", source);
         return ERROR_FILE_OPEN;
     }
     
-    dest_file = fopen(dest, "wb");
-    if (!dest_file) {
-        log_error("대상 파일 생성 실패: %s", dest);
-        fclose(src_file);
+    dest_fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (dest_fd < 0) {
+        log_error("%s 파일 생성 실패: %s", type == COMPRESS_GZIP ? "GZIP" : "ZLIB", dest);
+        close(src_fd);
         return ERROR_FILE_OPEN;
     }
+    metrics_lap(METRIC_OPEN, &t, 0);
+    metrics_count(METRIC_OPEN, 0, 1);
     
-    // zlib 초기화
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    ret = deflateInit(&strm, Z_BEST_COMPRESSION);
-    if (ret != Z_OK) {
-        log_error("ZLIB 초기화 실패");
-        fclose(src_file);
-        fclose(dest_file);
-        unlink(dest);
-        return ERROR_COMPRESSION;
+    strm = acquire_deflate(type, active_level);
+    in = io_buffer_get();
+    out = io_buffer_get();
+    if (!strm || !in || !out) {
+        result = strm ? ERROR_MEMORY : ERROR_COMPRESSION;
+        goto done;
     }
     
-    // 압축 수행
-    do {
-        strm.avail_in = fread(in, 1, BUFFER_SIZE, src_file);
-        if (ferror(src_file)) {
-            deflateEnd(&strm);
-            fclose(src_file);
-            fclose(dest_file);
-            unlink(dest);
-            return ERROR_FILE_READ;
+    while (result == SUCCESS && flush != Z_FINISH) {
+        ssize_t n = read_full(src_fd, in, IO_BUFFER_SIZE);
+        if (n < 0) {
+            log_error("파일 읽기 실패: %s", source);
+            result = ERROR_FILE_READ;
+            break;
+        }
+        if (hash) {
+            checksum_update(hash, in, (size_t)n);
         }
+        metrics_lap(METRIC_READ, &t, (size_t)n);
+        metrics_count(METRIC_COMPRESS, (size_t)n, 0);
         
-        flush = feof(src_file) ? Z_FINISH : Z_NO_FLUSH;
-        strm.next_in = in;
+        // 버퍼를 다 채우지 못했으면 파일 끝
+        flush = (n < IO_BUFFER_SIZE) ? Z_FINISH : Z_NO_FLUSH;
+        strm->next_in = in;
+        strm->avail_in = (uInt)n;
         
         do {
-            strm.avail_out = BUFFER_SIZE;
-            strm.next_out = out;
+            strm->next_out = out;
+            strm->avail_out = IO_BUFFER_SIZE;
             
-            ret = deflate(&strm, flush);
-            if (ret == Z_STREAM_ERROR) {
-                deflateEnd(&strm);
-                fclose(src_file);
-                fclose(dest_file);
-                unlink(dest);
-                return ERROR_COMPRESSION;
+            if (deflate(strm, flush) == Z_STREAM_ERROR) {
+                result = ERROR_COMPRESSION;
+                break;
             }
-            
-            have = BUFFER_SIZE - strm.avail_out;
-            if (fwrite(out, 1, have, dest_file) != have || ferror(dest_file)) {
-                deflateEnd(&strm);
-                fclose(src_file);
-                fclose(dest_file);
-                unlink(dest);
-                return ERROR_FILE_WRITE;
+            metrics_lap(METRIC_COMPRESS, &t, 0);
+            if (write_full(dest_fd, out, IO_BUFFER_SIZE - strm->avail_out) != SUCCESS) {
+                log_error("%s 쓰기 실패: %s", type == COMPRESS_GZIP ? "GZIP" : "ZLIB", dest);
+                result = ERROR_FILE_WRITE;
+                break;
             }
-        } while (strm.avail_out == 0);
-        
-    } while (flush != Z_FINISH);
-    
-    deflateEnd(&strm);
-    fclose(src_file);
-    fclose(dest_file);
+            metrics_lap(METRIC_WRITE, &t, IO_BUFFER_SIZE - strm->avail_out);
+        } while (strm->avail_out == 0);
+    }
+
+done:
+    io_buffer_put(in);
+    io_buffer_put(out);
+    close(src_fd);
+    if (close(dest_fd) != 0 && result == SUCCESS) {
+        log_error("%s 파일 닫기 실패: %s", type == COMPRESS_GZIP ? "GZIP" : "ZLIB", dest);
+        result = ERROR_FILE_WRITE;
+    }
+    if (result != SUCCESS) {
+        unlink(dest);
+    } else {
+        metrics_count(METRIC_READ, 0, 1);
+        metrics_count(METRIC_COMPRESS, 0, 1);
+        metrics_count(METRIC_WRITE, 0, 1);
+    }
     
-    return SUCCESS;
+    return result;
 }
 
-// ZLIB 해제
-int decompress_file_zlib(const char *source, const char *dest) {
-    FILE *src_file, *dest_file;
-    z_stream strm;
-    unsigned char in[BUFFER_SIZE];
-    unsigned char out[BUFFER_SIZE];
-    int ret;
-    unsigned have;
+// GZIP/ZLIB 스트리밍 해제 (해제 스트림 + 풀 버퍼)
+static int decompress_file_deflate(const char *source, const char *dest, compression_type_t type,
+                                   checksum_ctx_t *hash) {
+    decompress_stream_t *stream;
+    unsigned char *buffer;
+    int dest_fd;
+    int result = SUCCESS;
+    uint64_t t = metrics_now();
+    ssize_t n;
     
-    src_file = fopen(source, "rb");
-    if (!src_file) {
-        log_error("ZLIB 파일 열기 실패: %s", source);
+    stream = decompress_stream_open(source, type);
+    if (!stream) {
         return ERROR_FILE_OPEN;
     }
     
-    dest_file = fopen(dest, "wb");
-    if (!dest_file) {
+    dest_fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (dest_fd < 0) {
         log_error("대상 파일 생성 실패: %s", dest);
-        fclose(src_file);
+        decompress_stream_close(stream);
         return ERROR_FILE_OPEN;
     }
+    metrics_lap(METRIC_OPEN, &t, 0);
+    metrics_count(METRIC_OPEN, 0, 1);
     
-    // zlib 초기화
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.avail_in = 0;
-    strm.next_in = Z_NULL;
-    ret = inflateInit(&strm);
-    if (ret != Z_OK) {
-        log_error("ZLIB 초기화 실패");
-        fclose(src_file);
-        fclose(dest_file);
-        unlink(dest);
-        return ERROR_COMPRESSION;
+    buffer = io_buffer_get();
+    if (!buffer) {
+        result = ERROR_MEMORY;
+        goto done;
     }
     
-    // 압축 해제 수행
-    do {
-        strm.avail_in = fread(in, 1, BUFFER_SIZE, src_file);
-        if (ferror(src_file)) {
-            inflateEnd(&strm);
-            fclose(src_file);
-            fclose(dest_file);
-            unlink(dest);
-            return ERROR_FILE_READ;
+    // 해제 시간에는 압축 파일 읽기도 포함
+    while ((n = decompress_stream_read(stream, buffer, IO_BUFFER_SIZE)) > 0) {
+        if (hash) {
+            checksum_update(hash, buffer, (size_t)n);
         }
-        
-        if (strm.avail_in == 0) break;
-        strm.next_in = in;
-        
-        do {
-            strm.avail_out = BUFFER_SIZE;
-            strm.next_out = out;
-            
-            ret = inflate(&strm, Z_NO_FLUSH);
-            switch (ret) {
-                case Z_NEED_DICT:
-                case Z_DATA_ERROR:
-                case Z_MEM_ERROR:
-                    inflateEnd(&strm);
-                    fclose(src_file);
-                    fclose(dest_file);
-                    unlink(dest);
-                    return ERROR_COMPRESSION;
-            }
-            
-            have = BUFFER_SIZE - strm.avail_out;
-            if (fwrite(out, 1, have, dest_file) != have || ferror(dest_file)) {
-                inflateEnd(&strm);
-                fclose(src_file);
-                fclose(dest_file);
-                unlink(dest);
-                return ERROR_FILE_WRITE;
-            }
-        } while (strm.avail_out == 0);
-        
-    } while (ret != Z_STREAM_END);
+        metrics_lap(METRIC_COMPRESS, &t, (size_t)n);
+        if (write_full(dest_fd, buffer, (size_t)n) != SUCCESS) {
+            log_error("파일 쓰기 실패: %s", dest);
+            result = ERROR_FILE_WRITE;
+            break;
+        }
+        metrics_lap(METRIC_WRITE, &t, (size_t)n);
+    }
     
-    inflateEnd(&strm);
-    fclose(src_file);
-    fclose(dest_file);
+    if (n < 0) {
+        log_error("%s 읽기 실패: %s", type == COMPRESS_GZIP ? "GZIP" : "ZLIB", source);
+        result = ERROR_COMPRESSION;
+    }
+
+done:
+    io_buffer_put(buffer);
+    decompress_stream_close(stream);
+    if (close(dest_fd) != 0 && result == SUCCESS) {
+        log_error("파일 쓰기 실패: %s", dest);
+        result = ERROR_FILE_WRITE;
+    }
+    if (result != SUCCESS) {
+        unlink(dest);
+    } else {
+        metrics_count(METRIC_COMPRESS, 0, 1);
+        metrics_count(METRIC_WRITE, 0, 1);
+    }
     
-    return SUCCESS;
+    return result;
 }
 
-// 메인 압축 함수
-int compress_file(const char *source, const char *dest, compression_type_t type) {
+// 스트리밍 압축 해제 리더 (임시 파일 없이 해제된 데이터를 블록 단위로 제공)
+// 스트림 객체와 z_stream 은 스레드 arena 에 두고 닫으면 스레드별 목록에 돌려 다시 씀
+// (inflateInit 은 객체마다 한 번, 이후 inflateReset2). 연 스레드에서 닫아야 함.
+struct decompress_stream {
+    compression_type_t type;
+    int fd;
+    int finished;
+    int raw;                          // gzip 헤더가 없는 파일: gzread 처럼 그대로 전달
+    int inflate_ready;
+    unsigned char *in;                // 풀 버퍼 (압축 파일만)
+    z_stream strm;
+    struct decompress_stream *next_free;
+};
+
+static __thread decompress_stream_t *free_streams = NULL;
+
+static void release_stream(decompress_stream_t *stream) {
+    if (stream->fd >= 0) {
+        close(stream->fd);
+    }
+    io_buffer_put(stream->in);
+    stream->in = NULL;
+    stream->next_free = free_streams;
+    free_streams = stream;
+}
+
+// 입력 버퍼가 비었을 때 다시 채움 (읽은 바이트 수, 파일 끝이면 0, 오류면 -1)
+static ssize_t fill_input(decompress_stream_t *stream) {
+    ssize_t n = read_full(stream->fd, stream->in, IO_BUFFER_SIZE);
+
+    if (n > 0) {
+        stream->strm.next_in = stream->in;
+        stream->strm.avail_in = (uInt)n;
+    }
+    return n;
+}
+
+decompress_stream_t *decompress_stream_open(const char *path, compression_type_t type) {
+    decompress_stream_t *stream;
+    const char *label;
+
+    if (!path) return NULL;
+
+    switch (type) {
+        case COMPRESS_GZIP: label = "GZIP 파일"; break;
+        case COMPRESS_ZLIB: label = "ZLIB 파일"; break;
+        case COMPRESS_NONE: label = "파일"; break;
+        default:
+            log_error("지원되지 않는 압축 타입: %d", type);
+            return NULL;
+    }
+
+    stream = free_streams;
+    if (stream) {
+        free_streams = stream->next_free;
+    } else {
+        stream = arena_alloc(sizeof(decompress_stream_t));
+        if (!stream) {
+            return NULL;
+        }
+        memset(stream, 0, sizeof(*stream));
+        stream->strm.zalloc = arena_zalloc;
+        stream->strm.zfree = arena_zfree;
+    }
+    stream->type = type;
+    stream->finished = 0;
+    stream->raw = 0;
+    stream->in = NULL;
+
+    stream->fd = open(path, O_RDONLY);
+    if (stream->fd < 0) {
+        log_error("%s 열기 실패: %s", label, path);
+        release_stream(stream);
+        return NULL;
+    }
+    if (type == COMPRESS_NONE) {
+        return stream;
+    }
+
+    stream->in = io_buffer_get();
+    if (!stream->in) {
+        release_stream(stream);
+        return NULL;
+    }
+
+    int window_bits = (type == COMPRESS_GZIP) ? 15 + 16 : 15;
+    int ret = stream->inflate_ready ? inflateReset2(&stream->strm, window_bits)
+                                    : inflateInit2(&stream->strm, window_bits);
+    if (ret != Z_OK) {
+        log_error("ZLIB 초기화 실패");
+        release_stream(stream);
+        return NULL;
+    }
+    stream->inflate_ready = 1;
+    stream->strm.avail_in = 0;
+
+    // gzread 와 같이 빈 파일은 빈 스트림, gzip 이 아닌 파일은 그대로 읽음
+    if (type == COMPRESS_GZIP) {
+        ssize_t n = fill_input(stream);
+        if (n < 0) {
+            log_error("%s 읽기 실패: %s", label, path);
+            release_stream(stream);
+            return NULL;
+        }
+        if (n == 0) {
+            stream->finished = 1;
+        } else if (n < 2 || stream->in[0] != 0x1f || stream->in[1] != 0x8b) {
+            stream->raw = 1;
+        }
+    }
+
+    return stream;
+}
+
+// raw 스트림: 이미 읽어 둔 입력부터 전달한 뒤 파일에서 직접 읽음
+static ssize_t read_raw(decompress_stream_t *stream, unsigned char *buf, size_t len) {
+    size_t total = 0;
+    ssize_t n;
+
+    if (stream->strm.avail_in > 0) {
+        total = MIN(len, (size_t)stream->strm.avail_in);
+        memcpy(buf, stream->strm.next_in, total);
+        stream->strm.next_in += total;
+        stream->strm.avail_in -= (uInt)total;
+        if (total == len) {
+            return (ssize_t)total;
+        }
+    }
+
+    n = read_full(stream->fd, buf + total, len - total);
+    if (n < 0) {
+        return -1;
+    }
+    return (ssize_t)(total + (size_t)n);
+}
+
+// gzip 멤버가 끝난 뒤 다음 멤버가 이어지는지 (gzread 처럼 뒤따르는 쓰레기는 무시)
+static int next_gzip_member(decompress_stream_t *stream) {
+    if (stream->strm.avail_in == 0 && fill_input(stream) <= 0) {
+        return 0;
+    }
+    if (stream->strm.next_in[0] != 0x1f) {
+        return 0;
+    }
+    return inflateReset(&stream->strm) == Z_OK;
+}
+
+// 최대 len 바이트를 읽음 (0 = 스트림 끝, -1 = 오류 또는 손상된 데이터)
+ssize_t decompress_stream_read(decompress_stream_t *stream, void *buf, size_t len) {
+    if (!stream || !buf) return -1;
+
+    if (stream->type == COMPRESS_NONE) {
+        return read_full(stream->fd, buf, len);
+    }
+    if (stream->raw) {
+        return read_raw(stream, buf, len);
+    }
+    if (stream->finished) {
+        return 0;
+    }
+
+    stream->strm.next_out = buf;
+    stream->strm.avail_out = (uInt)MIN(len, (size_t)UINT_MAX);
+
+    while (stream->strm.avail_out > 0) {
+        if (stream->strm.avail_in == 0 && fill_input(stream) <= 0) {
+            return -1; // 스트림 끝 이전에 파일이 끝남
+        }
+
+        int ret = inflate(&stream->strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            if (stream->type == COMPRESS_GZIP && next_gzip_member(stream)) {
+                continue;
+            }
+            stream->finished = 1;
+            break;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            return -1;
+        }
+    }
+
+    return (ssize_t)(MIN(len, (size_t)UINT_MAX) - stream->strm.avail_out);
+}
+
+void decompress_stream_close(decompress_stream_t *stream) {
+    if (!stream) return;
+    release_stream(stream);
+}
+
+// 메인 압축 함수 (hash가 있으면 원본 데이터를 읽는 동안 함께 해시)
+int compress_file_ex(const char *source, const char *dest, compression_type_t type, checksum_ctx_t *hash) {
     if (type == COMPRESS_NONE) {
-        return copy_file_simple(source, dest);
+        return copy_file_hashed(source, dest, hash);
     }
     
     if (type != COMPRESS_GZIP && type != COMPRESS_ZLIB) {
@@ -340,20 +1087,32 @@ int compress_file(const char *source, const char *dest, compression_type_t type)
         return ERROR_COMPRESSION;
     }
     
-    switch (type) {
-        case COMPRESS_GZIP:
-            return compress_file_gzip(source, dest);
-        case COMPRESS_ZLIB:
-            return compress_file_zlib(source, dest);
-        default:
-            return ERROR_COMPRESSION;
+#ifdef HAVE_LIBDEFLATE
+    // 가속 백엔드는 WHOLE_FILE_MAX 이하 파일을 한 번의 호출로 압축
+    if (active_backend == DEFLATE_BACKEND_LIBDEFLATE) {
+        size_t size = get_file_size(source);
+
+        if (size <= WHOLE_FILE_MAX) {
+            int result = compress_file_whole(source, dest, type, size, hash);
+            if (result != ERROR_MEMORY) {
+                return result;
+            }
+            log_debug("파일이 버퍼보다 커져 스트리밍 압축으로 전환: %s", source);
+        }
     }
+#endif
+    
+    return compress_file_deflate(source, dest, type, hash);
 }
 
-// 메인 압축 해제 함수
-int decompress_file(const char *source, const char *dest, compression_type_t type) {
+int compress_file(const char *source, const char *dest, compression_type_t type) {
+    return compress_file_ex(source, dest, type, NULL);
+}
+
+// 메인 압축 해제 함수 (hash가 있으면 해제된 데이터를 쓰는 동안 함께 해시)
+int decompress_file_ex(const char *source, const char *dest, compression_type_t type, checksum_ctx_t *hash) {
     if (type == COMPRESS_NONE) {
-        return copy_file_simple(source, dest);
+        return copy_file_hashed(source, dest, hash);
     }
     
     if (type != COMPRESS_GZIP && type != COMPRESS_ZLIB) {
@@ -361,14 +1120,25 @@ int decompress_file(const char *source, const char *dest, compression_type_t typ
         return ERROR_COMPRESSION;
     }
     
-    switch (type) {
-        case COMPRESS_GZIP:
-            return decompress_file_gzip(source, dest);
-        case COMPRESS_ZLIB:
-            return decompress_file_zlib(source, dest);
-        default:
-            return ERROR_COMPRESSION;
+#ifdef HAVE_LIBDEFLATE
+    if (active_backend == DEFLATE_BACKEND_LIBDEFLATE) {
+        size_t size = get_file_size(source);
+
+        if (size <= WHOLE_FILE_MAX) {
+            int result = decompress_file_whole(source, dest, type, size, hash);
+            if (result != ERROR_MEMORY) {
+                return result;
+            }
+            log_debug("해제 결과가 버퍼보다 커서 스트리밍 해제로 전환: %s", source);
+        }
     }
+#endif
+    
+    return decompress_file_deflate(source, dest, type, hash);
+}
+
+int decompress_file(const char *source, const char *dest, compression_type_t type) {
+    return decompress_file_ex(source, dest, type, NULL);
 }
 
 // 압축률 계산
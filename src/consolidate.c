@@ -0,0 +1,425 @@
+#include "backup.h"
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+// 합성 전체 백업 (consolidate): 체인의 한 시점 인덱스로 새 전체 백업을 백업 쪽에서만 만듦
+//   'F' 같은 압축 형식 -> 하드 링크, 안 되면 reflink, 안 되면 스트리밍 복사
+//   'C' -> 레시피만 새 백업의 레시피 파일로 복사 (청크는 같은 저장소를 공유)
+//   'X' 또는 압축 형식이 다른 'F' -> 내용을 재구성해 새 백업의 압축 형식으로 저장
+// 결과 인덱스는 원본의 메타데이터(크기, 시간, inode, 디렉토리 요약)를 그대로 가지므로
+// 새 체인의 full 로 두고 증분 백업을 이어 갈 수 있음
+#define CONSOLIDATE_BATCH_SIZE 1024
+
+typedef struct {
+    char *rel;
+    index_entry_t entry;
+    int result;
+} consolidate_job_t;
+
+typedef struct {
+    consolidate_job_t *jobs;
+    const char *chain;
+    const char *name;             // 시점 백업 이름 (origin이 비어 있는 항목의 레이어)
+    const char *dest;
+    compression_type_t compression;
+    checksum_type_t checksum_type;
+    const char *store_path;       // 새 레시피 파일의 청크 저장소 (NULL = 아직 열지 않음)
+    size_t linked;
+    size_t reflinked;
+    size_t recipes;
+    size_t copied;
+    size_t rebuilt;
+} consolidate_ctx_t;
+
+static void count_method(size_t *counter) {
+    pthread_mutex_lock(&g_stats_mutex);
+    (*counter)++;
+    pthread_mutex_unlock(&g_stats_mutex);
+}
+
+// 복사 대신 같은 데이터 블록을 공유 (btrfs, XFS 등에서만 가능)
+static int reflink_file(const char *from, const char *to) {
+#ifdef FICLONE
+    int in, out, result;
+
+    in = open(from, O_RDONLY);
+    if (in < 0) {
+        return -1;
+    }
+    out = open(to, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (out < 0) {
+        close(in);
+        return -1;
+    }
+
+    result = ioctl(out, FICLONE, in);
+    close(in);
+    close(out);
+    if (result != 0) {
+        unlink(to);
+    }
+    return result;
+#else
+    (void)from;
+    (void)to;
+    errno = EOPNOTSUPP;
+    return -1;
+#endif
+}
+
+// 저장된 파일을 그대로 가져옴: 하드 링크 -> reflink -> 스트리밍 복사
+static int transfer_stored_file(consolidate_ctx_t *ctx, const char *from, const char *to) {
+    if (link(from, to) == 0) {
+        count_method(&ctx->linked);
+        return SUCCESS;
+    }
+    log_debug("하드 링크 실패: %s (%s)", from, strerror(errno));
+
+    if (reflink_file(from, to) == 0) {
+        copy_file_metadata(from, to);
+        count_method(&ctx->reflinked);
+        return SUCCESS;
+    }
+
+    if (copy_file_hashed(from, to, NULL) != SUCCESS) {
+        log_error("파일 복사 실패: %s -> %s", from, to);
+        return ERROR_FILE_WRITE;
+    }
+    copy_file_metadata(from, to);
+    count_method(&ctx->copied);
+    return SUCCESS;
+}
+
+// 내용을 재구성해 임시 파일에 쓰고 (기록된 크기·체크섬 확인), 새 백업의 압축 형식으로 저장
+static int rebuild_entry(consolidate_ctx_t *ctx, const char *layer, const char *from,
+                         const index_entry_t *entry, const char *to) {
+    char temp[MAX_PATH + 16];
+    checksum_ctx_t hash;
+    checksum_ctx_t *hash_ptr = NULL;
+    uint64_t size = 0;
+    int result;
+
+    if (ctx->compression == COMPRESS_NONE) {
+        snprintf(temp, sizeof(temp), "%s", to);
+    } else {
+        snprintf(temp, sizeof(temp), "%s.rebuild", to);
+    }
+
+    if (ctx->checksum_type != CHECKSUM_NONE && entry->checksum[0] != '\0') {
+        checksum_init(&hash, ctx->checksum_type);
+        hash_ptr = &hash;
+    }
+
+    if (entry->type == 'F') {
+        result = decompress_file_ex(from, temp, (compression_type_t)entry->codec, hash_ptr);
+        size = result == SUCCESS ? (uint64_t)get_file_size(temp) : 0;
+    } else {
+        FILE *out = fopen(temp, "wb");
+
+        if (!out) {
+            log_error("파일 생성 실패: %s", temp);
+            return ERROR_FILE_WRITE;
+        }
+        if (entry->type == 'X') {
+            result = delta_restore_file(layer, entry->offset, out, hash_ptr, &size);
+        } else {
+            result = chunk_store_restore_file(layer, entry->offset, out, hash_ptr, 1, &size);
+        }
+        if (fclose(out) != 0 && result == SUCCESS) {
+            result = ERROR_FILE_WRITE;
+        }
+    }
+
+    if (result == SUCCESS && size != entry->size) {
+        log_error("재구성한 파일 크기 불일치: %s (기록: %zu, 실제: %llu)", to, entry->size, (unsigned long long)size);
+        result = ERROR_CHECKSUM;
+    }
+    if (result == SUCCESS && hash_ptr) {
+        char hex[MAX_DIGEST_HEX];
+
+        checksum_final_hex(&hash, hex);
+        if (strcmp(hex, entry->checksum) != 0) {
+            log_error("재구성한 파일의 체크섬 불일치: %s (기록: %s, 실제: %s)", to, entry->checksum, hex);
+            result = ERROR_CHECKSUM;
+        }
+    }
+    if (result == SUCCESS && ctx->compression != COMPRESS_NONE) {
+        result = compress_file_ex(temp, to, ctx->compression, NULL);
+    }
+    if (ctx->compression != COMPRESS_NONE || result != SUCCESS) {
+        unlink(temp);
+    }
+    if (result != SUCCESS) {
+        return result;
+    }
+
+    // 백업 파일의 메타데이터는 원본 파일 것 (복원 시 --preserve-* 가 여기서 가져감)
+    if (entry->file_mode != 0) {
+        chmod(to, entry->file_mode & 07777);
+    }
+    struct timespec times[2];
+    times[0].tv_sec = entry->mtime;
+    times[0].tv_nsec = entry->mtime_nsec;
+    times[1] = times[0];
+    utimensat(AT_FDCWD, to, times, 0);
+
+    count_method(&ctx->rebuilt);
+    return SUCCESS;
+}
+
+static void consolidate_job(void *arg, size_t index) {
+    consolidate_ctx_t *ctx = arg;
+    consolidate_job_t *job = &ctx->jobs[index];
+    index_entry_t entry = job->entry;
+    const char *holder = entry.origin[0] ? entry.origin : ctx->name;
+    char layer[MAX_PATH], from[MAX_PATH], to[MAX_PATH], dest_path[MAX_PATH];
+
+    if ((size_t)snprintf(layer, sizeof(layer), "%s/%s", ctx->chain, holder) >= sizeof(layer) ||
+        (size_t)snprintf(dest_path, sizeof(dest_path), "%s/%s", ctx->dest, job->rel) >= sizeof(dest_path) ||
+        (size_t)snprintf(from, sizeof(from), "%s/%s%s", layer, job->rel,
+                         entry.codec != COMPRESS_NONE ? get_compression_extension((compression_type_t)entry.codec) : "") >= sizeof(from) ||
+        (size_t)snprintf(to, sizeof(to), "%s%s", dest_path,
+                         ctx->compression != COMPRESS_NONE ? get_compression_extension(ctx->compression) : "") >= sizeof(to)) {
+        log_error("경로가 너무 깁니다: %s", job->rel);
+        job->result = ERROR_INVALID_PARAMS;
+        return;
+    }
+
+    entry.origin[0] = '\0';
+
+    if (entry.type == 'C' && ctx->store_path &&
+        chunk_store_copy_recipe(layer, job->entry.offset, ctx->store_path, &entry.offset) == SUCCESS) {
+        count_method(&ctx->recipes);
+        backup_index_record(dest_path, &entry);
+        job->result = SUCCESS;
+        return;
+    }
+
+    if (entry.type == 'F' && entry.codec == (uint8_t)ctx->compression) {
+        job->result = transfer_stored_file(ctx, from, to);
+    } else {
+        job->result = rebuild_entry(ctx, layer, from, &job->entry, to);
+        entry.type = 'F';
+        entry.codec = (uint8_t)ctx->compression;
+        entry.offset = 0;
+    }
+
+    if (job->result == SUCCESS) {
+        backup_index_record(dest_path, &entry);
+    }
+}
+
+static int flush_consolidate_batch(consolidate_ctx_t *ctx, size_t count, int threads) {
+    int result = SUCCESS;
+
+    parallel_for(consolidate_job, ctx, count, threads);
+    for (size_t i = 0; i < count; i++) {
+        if (ctx->jobs[i].result != SUCCESS) {
+            log_error("합성 실패: %s", ctx->jobs[i].rel);
+            result = ctx->jobs[i].result;
+        } else {
+            pthread_mutex_lock(&g_stats_mutex);
+            g_stats.files_processed++;
+            g_stats.bytes_processed += ctx->jobs[i].entry.size;
+            pthread_mutex_unlock(&g_stats_mutex);
+        }
+        free(ctx->jobs[i].rel);
+    }
+    return result;
+}
+
+// 청크 저장소 항목이 처음 나오면 새 백업의 레시피 파일을 같은 저장소(절대 경로)로 엶
+static void open_consolidated_recipes(consolidate_ctx_t *ctx, const char *holder, char *store, size_t size) {
+    char layer[MAX_PATH];
+
+    if ((size_t)snprintf(layer, sizeof(layer), "%s/%s", ctx->chain, holder) < sizeof(layer) &&
+        recipe_store_path(layer, store, size) == SUCCESS && recipe_file_open(ctx->dest, store) == SUCCESS) {
+        ctx->store_path = store;
+        log_info("청크 저장소 공유: %s", store);
+    } else {
+        log_warning("레시피를 복사할 수 없어 청크 저장소 파일을 재구성합니다: %s", layer);
+    }
+}
+
+// 디렉토리 메타데이터는 안의 파일을 모두 만든 뒤에 (깊은 곳부터)
+static void apply_directory_metadata(const backup_index_t *index, const char *dest) {
+    for (size_t pos = index->count; pos-- > 0;) {
+        index_entry_t entry;
+        char rel[MAX_PATH];
+        char dir_path[MAX_PATH];
+        struct timespec times[2];
+
+        // 경로가 너무 긴 디렉토리는 만들 때 이미 오류로 보고함
+        if (!backup_index_get(index, pos, &entry, rel, sizeof(rel)) || entry.type != 'D' ||
+            (size_t)snprintf(dir_path, sizeof(dir_path), "%s/%s", dest, rel) >= sizeof(dir_path)) {
+            continue;
+        }
+        if (entry.file_mode != 0) {
+            chmod(dir_path, entry.file_mode & 07777);
+        }
+        times[0].tv_sec = entry.mtime;
+        times[0].tv_nsec = entry.mtime_nsec;
+        times[1] = times[0];
+        utimensat(AT_FDCWD, dir_path, times, 0);
+    }
+}
+
+int consolidate_chain(const char *chain, const char *dest, const backup_options_t *opts) {
+    char name[BACKUP_NAME_MAX];
+    char backup_path[MAX_PATH];
+    char store[MAX_PATH];
+    backup_index_t index;
+    backup_options_t index_opts;
+    consolidate_ctx_t ctx;
+    size_t count = 0;
+    int threads = opts->threads > 0 ? opts->threads : 1;
+    int result = SUCCESS;
+
+    if (opts->as_of[0]) {
+        result = find_backup_as_of(chain, opts->as_of, name, sizeof(name));
+    } else {
+        result = find_latest_backup(chain, name, sizeof(name));
+    }
+    if (result != SUCCESS) {
+        return result;
+    }
+
+    snprintf(backup_path, sizeof(backup_path), "%s/%s", chain, name);
+    if (backup_index_load(backup_path, &index) != SUCCESS) {
+        log_error("백업 인덱스가 없어 합성할 수 없습니다: %s", backup_path);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    if (file_exists(dest)) {
+        log_error("합성 대상이 이미 있습니다: %s", dest);
+        backup_index_free(&index);
+        return ERROR_FILE_WRITE;
+    }
+
+    log_info("합성 전체 백업: %s -> %s (%zu개 항목)", backup_path, dest, index.count);
+    if (opts->dry_run) {
+        printf("DRY RUN: %s 시점의 %zu개 항목으로 전체 백업 %s 생성\n", name, index.count, dest);
+        backup_index_free(&index);
+        return SUCCESS;
+    }
+
+    if (create_directory_recursive(dest) != SUCCESS) {
+        log_error("디렉토리 생성 실패: %s", dest);
+        backup_index_free(&index);
+        return ERROR_FILE_WRITE;
+    }
+
+    // 새 인덱스 헤더는 원본 인덱스의 체크섬/압축 형식을 따름 (항목의 체크섬을 그대로 이어받음)
+    index_opts = *opts;
+    index_opts.calculate_checksum = index.checksum_type != CHECKSUM_NONE;
+    index_opts.checksum_algorithm = index.checksum_type;
+    index_opts.compression = index.compression;
+    if (backup_index_open(dest, &index_opts, NULL) != SUCCESS) {
+        backup_index_free(&index);
+        return ERROR_FILE_WRITE;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.jobs = malloc(CONSOLIDATE_BATCH_SIZE * sizeof(consolidate_job_t));
+    if (!ctx.jobs) {
+        backup_index_close();
+        backup_index_free(&index);
+        return ERROR_MEMORY;
+    }
+    ctx.chain = chain;
+    ctx.name = name;
+    ctx.dest = dest;
+    ctx.compression = index.compression;
+    ctx.checksum_type = index.checksum_type;
+
+    int recipes_checked = 0;
+
+    for (size_t pos = 0; pos < index.count && result != ERROR_MEMORY; pos++) {
+        index_entry_t entry;
+        char rel[MAX_PATH];
+        char path[MAX_PATH];
+        consolidate_job_t *job;
+
+        if (!backup_index_get(&index, pos, &entry, rel, sizeof(rel))) {
+            continue;
+        }
+        if ((size_t)snprintf(path, sizeof(path), "%s/%s", dest, rel) >= sizeof(path)) {
+            log_error("경로가 너무 깁니다: %s/%s", dest, rel);
+            result = ERROR_INVALID_PARAMS;
+            continue;
+        }
+
+        if (entry.type == 'D') {
+            // 경로순이라 디렉토리 항목은 그 안의 파일보다 먼저 나옴
+            if (!file_exists(path) && create_directory_recursive(path) != SUCCESS) {
+                log_error("디렉토리 생성 실패: %s", path);
+                result = ERROR_FILE_WRITE;
+            }
+            backup_index_record(path, &entry);
+            pthread_mutex_lock(&g_stats_mutex);
+            g_stats.directories_processed++;
+            pthread_mutex_unlock(&g_stats_mutex);
+            continue;
+        }
+        if (entry.type != 'F' && entry.type != 'C' && entry.type != 'X') {
+            continue;
+        }
+
+        // 디렉토리 항목이 없는 이전 인덱스를 위해 상위 디렉토리 확인
+        char *slash = strrchr(path, '/');
+        *slash = '\0';
+        if (!file_exists(path) && create_directory_recursive(path) != SUCCESS) {
+            log_error("디렉토리 생성 실패: %s", path);
+            result = ERROR_FILE_WRITE;
+            continue;
+        }
+
+        if (entry.type == 'C' && !recipes_checked) {
+            recipes_checked = 1;
+            open_consolidated_recipes(&ctx, entry.origin[0] ? entry.origin : name, store, sizeof(store));
+        }
+
+        job = &ctx.jobs[count];
+        job->rel = strdup(rel);
+        if (!job->rel) {
+            result = ERROR_MEMORY;
+            break;
+        }
+        job->entry = entry;
+        job->entry.path = job->rel;
+        job->result = SUCCESS;
+
+        if (++count == CONSOLIDATE_BATCH_SIZE) {
+            int batch_result = flush_consolidate_batch(&ctx, count, threads);
+            if (batch_result != SUCCESS) {
+                result = batch_result;
+            }
+            count = 0;
+        }
+    }
+
+    if (count > 0) {
+        int batch_result = flush_consolidate_batch(&ctx, count, threads);
+        if (batch_result != SUCCESS) {
+            result = batch_result;
+        }
+    }
+    free(ctx.jobs);
+
+    if (ctx.store_path && recipe_file_close() != SUCCESS && result == SUCCESS) {
+        result = ERROR_FILE_WRITE;
+    }
+    if (backup_index_close() != SUCCESS && result == SUCCESS) {
+        result = ERROR_FILE_WRITE;
+    }
+    apply_directory_metadata(&index, dest);
+    backup_index_free(&index);
+
+    log_info("합성 완료: 하드 링크 %zu, reflink %zu, 레시피 %zu, 복사 %zu, 재구성 %zu",
+             ctx.linked, ctx.reflinked, ctx.recipes, ctx.copied, ctx.rebuilt);
+    if (result == SUCCESS) {
+        log_info("이제 이전 체인(%s)을 지워도 %s 는 독립적으로 복원됩니다%s", chain, dest,
+                 ctx.recipes > 0 ? " (청크 저장소는 유지)" : "");
+    }
+    return result;
+}
@@ -0,0 +1,729 @@
+#include "backup.h"
+
+// rsync 방식 롤링 체크섬 델타 (증분/차등 백업의 변경된 큰 파일)
+//
+// 기준 백업에 통째로 저장된 이전 버전을 고정 크기 블록으로 나눠 약한 체크섬(rsync 롤링 합)과
+// 강한 해시(XXH3-128) 서명을 만들고, 새 버전을 한 바이트씩 굴리며 같은 블록을 찾아
+// "기준 블록 참조"와 "리터럴 데이터"만 기록합니다. 서명 계산과 매칭은 구간별로 병렬 처리합니다.
+//
+// 백업마다 델타 묶음 파일 하나(.backup_deltas)에 파일별 레코드를 이어 쓰고, 인덱스 항목은
+// type 'X', offset = 레코드 위치입니다. 레코드 형식 (리틀 엔디언):
+//   u32 블록 크기, u8 기준 codec, u16+기준 백업 이름, u16+기준 파일 경로 (기준 백업 루트 기준)
+//   연산 반복: 'C' u64 블록 번호 u32 블록 수 | 'L' u32 길이 + 데이터
+//   'E' u64 복원 크기
+// 델타가 원본의 절반보다 크면 레코드를 되돌리고 호출자가 파일을 통째로 복사합니다.
+
+#define DELTA_MAGIC "BKDELTA"
+#define DELTA_MIN_BLOCK 4096
+#define DELTA_MAX_BLOCK (1024 * 1024)
+#define DELTA_MAX_BLOCKS (1 << 21)           // 서명 메모리 상한 (블록 수)
+#define DELTA_RANGE_SIZE (8 * 1024 * 1024)  // 매칭 스레드 하나가 맡는 구간
+#define DELTA_COPY_BUFFER (1024 * 1024)
+
+typedef struct {
+    uint32_t block_size;
+    size_t block_count;
+    uint32_t *weak;
+    XXH128_hash_t *strong;
+    size_t *table;                // weak 해시 테이블 (블록 번호 + 1, 0 = 빈 슬롯)
+    size_t table_mask;
+} delta_signature_t;
+
+// 매칭 결과 연산 ('C' = 블록 복사, 'L' = 리터럴)
+typedef struct {
+    char type;
+    uint64_t a;                   // 'C': 블록 번호, 'L': 구간 버퍼 내 시작 위치
+    uint64_t b;                   // 'C': 블록 수,   'L': 길이
+} delta_op_t;
+
+typedef struct {
+    delta_op_t *ops;
+    size_t count;
+    size_t capacity;
+    int failed;
+} delta_op_list_t;
+
+static FILE *delta_pack = NULL;
+static uint64_t delta_pack_offset = 0;
+static pthread_mutex_t delta_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void put_u16(FILE *file, uint16_t v) {
+    unsigned char b[2] = { (unsigned char)v, (unsigned char)(v >> 8) };
+    fwrite(b, 1, 2, file);
+}
+
+static void put_u32(FILE *file, uint32_t v) {
+    unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8),
+                           (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+    fwrite(b, 1, 4, file);
+}
+
+static void put_u64(FILE *file, uint64_t v) {
+    put_u32(file, (uint32_t)v);
+    put_u32(file, (uint32_t)(v >> 32));
+}
+
+static int get_bytes(FILE *file, unsigned char *buf, size_t len) {
+    return fread(buf, 1, len, file) == len;
+}
+
+static int get_u16(FILE *file, uint16_t *v) {
+    unsigned char b[2];
+    if (!get_bytes(file, b, 2)) return 0;
+    *v = (uint16_t)(b[0] | (b[1] << 8));
+    return 1;
+}
+
+static int get_u32(FILE *file, uint32_t *v) {
+    unsigned char b[4];
+    if (!get_bytes(file, b, 4)) return 0;
+    *v = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+    return 1;
+}
+
+static int get_u64(FILE *file, uint64_t *v) {
+    uint32_t lo, hi;
+    if (!get_u32(file, &lo) || !get_u32(file, &hi)) return 0;
+    *v = ((uint64_t)hi << 32) | lo;
+    return 1;
+}
+
+static void put_string(FILE *file, const char *s) {
+    size_t len = strlen(s);
+    put_u16(file, (uint16_t)len);
+    fwrite(s, 1, len, file);
+}
+
+static int get_string(FILE *file, char *out, size_t size) {
+    uint16_t len;
+    if (!get_u16(file, &len) || len >= size || !get_bytes(file, (unsigned char *)out, len)) return 0;
+    out[len] = '\0';
+    return 1;
+}
+
+// ---- 체크섬 ----
+
+// rsync 약한 체크섬: a = Σx, b = Σ(L-i)x (각 16비트)
+static uint32_t weak_checksum(const unsigned char *data, size_t len, uint32_t *a_out, uint32_t *b_out) {
+    uint32_t a = 0, b = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        a += data[i];
+        b += (uint32_t)(len - i) * data[i];
+    }
+    *a_out = a & 0xFFFF;
+    *b_out = b & 0xFFFF;
+    return *a_out | (*b_out << 16);
+}
+
+// 파일 크기에 맞는 블록 크기 (블록 수가 DELTA_MAX_BLOCKS 이하가 되도록 2의 거듭제곱으로 키움)
+static uint32_t choose_block_size(uint64_t size) {
+    uint32_t block = DELTA_MIN_BLOCK;
+
+    while (block < DELTA_MAX_BLOCK && size / block > DELTA_MAX_BLOCKS) {
+        block <<= 1;
+    }
+    return block;
+}
+
+static size_t weak_slot(uint32_t weak, size_t mask) {
+    return (size_t)((weak * 0x9E3779B1u) ^ (weak >> 15)) & mask;
+}
+
+// ---- 서명 ----
+
+typedef struct {
+    delta_signature_t *sig;
+    const unsigned char *data;
+    size_t first_block;
+} signature_job_t;
+
+static void signature_block_job(void *ctx, size_t index) {
+    signature_job_t *job = (signature_job_t *)ctx;
+    delta_signature_t *sig = job->sig;
+    const unsigned char *block = job->data + index * sig->block_size;
+    uint32_t a, b;
+
+    sig->weak[job->first_block + index] = weak_checksum(block, sig->block_size, &a, &b);
+    sig->strong[job->first_block + index] = XXH3_128bits(block, sig->block_size);
+}
+
+static void free_signature(delta_signature_t *sig) {
+    free(sig->weak);
+    free(sig->strong);
+    free(sig->table);
+    memset(sig, 0, sizeof(*sig));
+}
+
+// 서명 배열을 블록 n개까지 담을 수 있게 확장
+static int reserve_signature(delta_signature_t *sig, size_t n, size_t *capacity) {
+    uint32_t *weak;
+    XXH128_hash_t *strong;
+    size_t new_capacity = *capacity ? *capacity : 1024;
+
+    if (n <= *capacity) return SUCCESS;
+    while (new_capacity < n) new_capacity *= 2;
+
+    weak = realloc(sig->weak, new_capacity * sizeof(uint32_t));
+    if (!weak) return ERROR_MEMORY;
+    sig->weak = weak;
+    strong = realloc(sig->strong, new_capacity * sizeof(XXH128_hash_t));
+    if (!strong) return ERROR_MEMORY;
+    sig->strong = strong;
+
+    *capacity = new_capacity;
+    return SUCCESS;
+}
+
+// 기준 파일(압축 가능)을 끝까지 읽어 전체 블록의 서명을 병렬 계산 (끝의 짧은 블록은 서명하지 않음)
+static int build_signature(const char *base_file, compression_type_t codec, uint32_t block_size,
+                           int threads, delta_signature_t *sig) {
+    decompress_stream_t *stream;
+    unsigned char *buffer;
+    size_t segment_blocks, segment_size, capacity = 0;
+    int result = SUCCESS;
+    int eof = 0;
+
+    memset(sig, 0, sizeof(*sig));
+    sig->block_size = block_size;
+
+    // 스레드마다 여러 블록을 맡도록 구간을 크게 읽음
+    segment_blocks = MAX((size_t)1, (size_t)(DELTA_RANGE_SIZE / block_size)) * (size_t)threads;
+    segment_size = segment_blocks * block_size;
+
+    buffer = malloc(segment_size);
+    if (!buffer) {
+        return ERROR_MEMORY;
+    }
+
+    stream = decompress_stream_open(base_file, codec);
+    if (!stream) {
+        free(buffer);
+        return ERROR_FILE_OPEN;
+    }
+
+    while (!eof && result == SUCCESS) {
+        size_t got = 0, blocks;
+
+        while (got < segment_size) {
+            ssize_t n = decompress_stream_read(stream, buffer + got, segment_size - got);
+            if (n < 0) {
+                log_error("기준 파일 읽기 실패: %s", base_file);
+                result = ERROR_FILE_READ;
+                break;
+            }
+            if (n == 0) {
+                eof = 1;
+                break;
+            }
+            got += (size_t)n;
+        }
+
+        blocks = got / block_size;
+        if (result != SUCCESS || blocks == 0) break;
+
+        if (sig->block_count + blocks > DELTA_MAX_BLOCKS * 2) {
+            result = ERROR_MEMORY;  // 새 파일보다 훨씬 큰 기준 파일은 델타 대상 아님
+            break;
+        }
+        result = reserve_signature(sig, sig->block_count + blocks, &capacity);
+        if (result != SUCCESS) break;
+
+        signature_job_t job = { sig, buffer, sig->block_count };
+        parallel_for(signature_block_job, &job, blocks, threads);
+        sig->block_count += blocks;
+    }
+
+    decompress_stream_close(stream);
+    free(buffer);
+
+    if (result == SUCCESS) {
+        size_t slots = 16;
+
+        while (slots < sig->block_count * 2) slots <<= 1;
+        sig->table = calloc(slots, sizeof(size_t));
+        if (!sig->table) {
+            result = ERROR_MEMORY;
+        } else {
+            sig->table_mask = slots - 1;
+            for (size_t i = 0; i < sig->block_count; i++) {
+                size_t slot = weak_slot(sig->weak[i], sig->table_mask);
+                while (sig->table[slot] != 0) slot = (slot + 1) & sig->table_mask;
+                sig->table[slot] = i + 1;
+            }
+        }
+    }
+
+    if (result != SUCCESS) {
+        free_signature(sig);
+    }
+    return result;
+}
+
+// 창과 같은 블록 번호 (없으면 -1), 강한 해시는 약한 체크섬이 맞을 때만 계산
+static long long find_block(const delta_signature_t *sig, uint32_t weak, const unsigned char *window) {
+    size_t slot = weak_slot(weak, sig->table_mask);
+    int have_strong = 0;
+    XXH128_hash_t strong = { 0, 0 };
+
+    while (sig->table[slot] != 0) {
+        size_t block = sig->table[slot] - 1;
+
+        if (sig->weak[block] == weak) {
+            if (!have_strong) {
+                strong = XXH3_128bits(window, sig->block_size);
+                have_strong = 1;
+            }
+            if (XXH128_isEqual(strong, sig->strong[block])) {
+                return (long long)block;
+            }
+        }
+        slot = (slot + 1) & sig->table_mask;
+    }
+    return -1;
+}
+
+// ---- 매칭 ----
+
+static void add_op(delta_op_list_t *list, char type, uint64_t a, uint64_t b) {
+    if (list->count > 0) {
+        delta_op_t *last = &list->ops[list->count - 1];
+
+        // 연속된 블록 복사와 이어지는 리터럴은 하나로 합침
+        if (type == 'C' && last->type == 'C' && last->a + last->b == a) {
+            last->b += b;
+            return;
+        }
+        if (type == 'L' && last->type == 'L' && last->a + last->b == a) {
+            last->b += b;
+            return;
+        }
+    }
+
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+        delta_op_t *grown = realloc(list->ops, new_capacity * sizeof(delta_op_t));
+        if (!grown) {
+            list->failed = 1;
+            return;
+        }
+        list->ops = grown;
+        list->capacity = new_capacity;
+    }
+    list->ops[list->count].type = type;
+    list->ops[list->count].a = a;
+    list->ops[list->count].b = b;
+    list->count++;
+}
+
+typedef struct {
+    const delta_signature_t *sig;
+    const unsigned char *data;
+    size_t length;
+    delta_op_list_t *lists;
+} match_job_t;
+
+// 구간 하나를 롤링 체크섬으로 훑어 블록 참조/리터럴 연산 생성 (구간 경계를 넘는 매칭은 하지 않음)
+static void match_range_job(void *ctx, size_t index) {
+    match_job_t *job = (match_job_t *)ctx;
+    const delta_signature_t *sig = job->sig;
+    const size_t L = sig->block_size;
+    size_t start = index * DELTA_RANGE_SIZE;
+    size_t end = MIN(start + DELTA_RANGE_SIZE, job->length);
+    const unsigned char *data = job->data;
+    delta_op_list_t *list = &job->lists[index];
+    size_t pos = start, literal = start;
+    uint32_t a = 0, b = 0;
+
+    memset(list, 0, sizeof(*list));
+
+    if (sig->block_count > 0 && end - pos >= L) {
+        weak_checksum(data + pos, L, &a, &b);
+    }
+
+    while (sig->block_count > 0 && pos + L <= end) {
+        long long block = find_block(sig, a | (b << 16), data + pos);
+
+        if (block >= 0) {
+            if (pos > literal) add_op(list, 'L', literal, pos - literal);
+            add_op(list, 'C', (uint64_t)block, 1);
+            pos += L;
+            literal = pos;
+            if (pos + L <= end) weak_checksum(data + pos, L, &a, &b);
+            continue;
+        }
+
+        if (pos + L < end) {
+            uint32_t out = data[pos], in = data[pos + L];
+            a = (a - out + in) & 0xFFFF;
+            b = (b - (uint32_t)L * out + a) & 0xFFFF;
+        }
+        pos++;
+    }
+
+    if (end > literal) add_op(list, 'L', literal, end - literal);
+}
+
+// ---- 델타 묶음 파일 ----
+
+int delta_pack_open(const char *backup_path) {
+    char path[MAX_PATH];
+
+    snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_DELTAS_FILE);
+
+    pthread_mutex_lock(&delta_mutex);
+    delta_pack = fopen(path, "w+b");
+    if (!delta_pack) {
+        pthread_mutex_unlock(&delta_mutex);
+        log_error("델타 파일 생성 실패: %s", path);
+        return ERROR_FILE_WRITE;
+    }
+    fwrite(DELTA_MAGIC, 1, 8, delta_pack);
+    delta_pack_offset = 8;
+    pthread_mutex_unlock(&delta_mutex);
+
+    return SUCCESS;
+}
+
+int delta_pack_close(void) {
+    int result = SUCCESS;
+
+    pthread_mutex_lock(&delta_mutex);
+    if (delta_pack && fclose(delta_pack) != 0) {
+        result = ERROR_FILE_WRITE;
+    }
+    delta_pack = NULL;
+    pthread_mutex_unlock(&delta_mutex);
+
+    return result;
+}
+
+// 레코드 머리의 기준 백업 정보 읽기 (이전 델타를 기준으로 다시 델타를 만들 때 원래 기준을 따라감)
+static int read_record_header(FILE *file, uint32_t *block_size, uint8_t *codec,
+                              char *base_name, size_t name_size, char *base_path, size_t path_size) {
+    unsigned char c;
+
+    if (!get_u32(file, block_size) || !get_bytes(file, &c, 1) ||
+        !get_string(file, base_name, name_size) || !get_string(file, base_path, path_size)) {
+        return 0;
+    }
+    *codec = c;
+    return *block_size >= DELTA_MIN_BLOCK && *block_size <= DELTA_MAX_BLOCK;
+}
+
+static FILE *open_record(const char *backup_path, uint64_t offset) {
+    char path[MAX_PATH];
+    char magic[8];
+    FILE *file;
+
+    snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_DELTAS_FILE);
+    file = fopen(path, "rb");
+    if (!file) {
+        log_error("델타 파일 없음: %s", path);
+        return NULL;
+    }
+    if (fread(magic, 1, 8, file) != 8 || memcmp(magic, DELTA_MAGIC, 8) != 0 ||
+        fseeko(file, (off_t)offset, SEEK_SET) != 0) {
+        log_error("델타 파일 형식 오류: %s", path);
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+int delta_record_base(const char *backup_path, uint64_t offset, char *base_name, size_t name_size,
+                      char *base_path, size_t path_size, uint8_t *codec) {
+    uint32_t block_size;
+    FILE *file = open_record(backup_path, offset);
+    int ok;
+
+    if (!file) return ERROR_FILE_OPEN;
+    ok = read_record_header(file, &block_size, codec, base_name, name_size, base_path, path_size);
+    fclose(file);
+    return ok ? SUCCESS : ERROR_FILE_READ;
+}
+
+// ---- 백업 ----
+
+// source를 기준 파일(<chain>/<base_name>/<base_path>) 대비 델타로 기록
+// 델타 이득이 없으면 ERROR_GENERAL (호출자가 통째로 복사)
+int delta_backup_file(const char *source, const char *chain, const char *base_name, const char *base_path,
+                      compression_type_t base_codec, int threads,
+                      checksum_ctx_t *hash, uint64_t *offset, uint64_t *size, uint64_t *stored) {
+    char base_file[MAX_PATH];
+    delta_signature_t sig;
+    delta_op_list_t *lists = NULL;
+    unsigned char *buffer = NULL;
+    size_t ranges_per_segment, segment_size;
+    uint64_t total = 0, literal_bytes = 0, start;
+    struct stat st;
+    FILE *src;
+    int result;
+
+    if (stat(source, &st) != 0) {
+        return ERROR_FILE_OPEN;
+    }
+
+    threads = parallel_thread_count(threads);
+    snprintf(base_file, sizeof(base_file), "%s/%s/%s", chain, base_name, base_path);
+    result = build_signature(base_file, base_codec, choose_block_size((uint64_t)st.st_size), threads, &sig);
+    if (result != SUCCESS) {
+        return result;
+    }
+
+    ranges_per_segment = (size_t)threads * 2;
+    segment_size = ranges_per_segment * DELTA_RANGE_SIZE;
+    buffer = malloc(segment_size);
+    lists = calloc(ranges_per_segment, sizeof(delta_op_list_t));
+    src = fopen(source, "rb");
+    if (!buffer || !lists || !src) {
+        if (src) fclose(src);
+        free(buffer);
+        free(lists);
+        free_signature(&sig);
+        return src ? ERROR_MEMORY : ERROR_FILE_OPEN;
+    }
+
+    pthread_mutex_lock(&delta_mutex);
+    if (!delta_pack) {
+        pthread_mutex_unlock(&delta_mutex);
+        fclose(src);
+        free(buffer);
+        free(lists);
+        free_signature(&sig);
+        return ERROR_INVALID_PARAMS;
+    }
+
+    start = delta_pack_offset;
+    fseeko(delta_pack, (off_t)start, SEEK_SET);
+    put_u32(delta_pack, sig.block_size);
+    fputc((int)base_codec, delta_pack);
+    put_string(delta_pack, base_name);
+    put_string(delta_pack, base_path);
+
+    for (;;) {
+        size_t len = fread(buffer, 1, segment_size, src);
+        size_t ranges;
+
+        if (len == 0) {
+            if (ferror(src)) result = ERROR_FILE_READ;
+            break;
+        }
+
+        ranges = (len + DELTA_RANGE_SIZE - 1) / DELTA_RANGE_SIZE;
+        match_job_t job = { &sig, buffer, len, lists };
+        parallel_for(match_range_job, &job, ranges, threads);
+
+        for (size_t r = 0; r < ranges; r++) {
+            if (lists[r].failed) result = ERROR_MEMORY;
+            for (size_t i = 0; i < lists[r].count && result == SUCCESS; i++) {
+                const delta_op_t *op = &lists[r].ops[i];
+
+                if (op->type == 'C') {
+                    fputc('C', delta_pack);
+                    put_u64(delta_pack, op->a);
+                    put_u32(delta_pack, (uint32_t)op->b);
+                } else {
+                    fputc('L', delta_pack);
+                    put_u32(delta_pack, (uint32_t)op->b);
+                    fwrite(buffer + op->a, 1, (size_t)op->b, delta_pack);
+                    literal_bytes += op->b;
+                }
+            }
+            free(lists[r].ops);
+            lists[r].ops = NULL;
+        }
+
+        if (hash) checksum_update(hash, buffer, len);
+        total += len;
+
+        // 리터럴이 원본의 절반을 넘으면 델타가 의미 없음
+        if (result != SUCCESS || literal_bytes > (uint64_t)st.st_size / 2) {
+            if (result == SUCCESS) result = ERROR_GENERAL;
+            break;
+        }
+    }
+
+    if (result == SUCCESS) {
+        fputc('E', delta_pack);
+        put_u64(delta_pack, total);
+        if (fflush(delta_pack) != 0 || ferror(delta_pack)) {
+            result = ERROR_FILE_WRITE;
+        }
+    }
+
+    if (result == SUCCESS) {
+        *offset = start;
+        *size = total;
+        *stored = (uint64_t)ftello(delta_pack) - start;
+        delta_pack_offset = (uint64_t)ftello(delta_pack);
+    } else {
+        // 쓰다 만 레코드 되돌리기
+        fflush(delta_pack);
+        if (ftruncate(fileno(delta_pack), (off_t)start) != 0) {
+            log_warning("델타 파일 정리 실패");
+        }
+    }
+    pthread_mutex_unlock(&delta_mutex);
+
+    fclose(src);
+    free(buffer);
+    free(lists);
+    free_signature(&sig);
+    return result;
+}
+
+// ---- 복원 ----
+
+// 압축된 기준 파일은 임의 접근을 위해 임시 파일로 풀어 둠
+static FILE *open_base_file(const char *path, compression_type_t codec) {
+    decompress_stream_t *stream;
+    unsigned char *buf;
+    FILE *temp;
+    ssize_t n;
+
+    if (codec == COMPRESS_NONE) {
+        return fopen(path, "rb");
+    }
+
+    stream = decompress_stream_open(path, codec);
+    if (!stream) return NULL;
+
+    temp = tmpfile();
+    buf = malloc(DELTA_COPY_BUFFER);
+    if (!temp || !buf) {
+        if (temp) fclose(temp);
+        free(buf);
+        decompress_stream_close(stream);
+        return NULL;
+    }
+
+    while ((n = decompress_stream_read(stream, buf, DELTA_COPY_BUFFER)) > 0) {
+        if (fwrite(buf, 1, (size_t)n, temp) != (size_t)n) {
+            n = -1;
+            break;
+        }
+    }
+    free(buf);
+    decompress_stream_close(stream);
+
+    if (n < 0) {
+        fclose(temp);
+        return NULL;
+    }
+    return temp;
+}
+
+// 델타 레코드와 기준 파일로 원본을 재구성해 out에 기록 (out이 NULL이면 검증만)
+int delta_restore_file(const char *backup_path, uint64_t offset, FILE *out, checksum_ctx_t *hash, uint64_t *size) {
+    char base_name[BACKUP_NAME_MAX];
+    char base_path[MAX_PATH];
+    char base_file[MAX_PATH * 2];
+    uint32_t block_size;
+    uint8_t codec;
+    unsigned char *buf = NULL;
+    uint64_t total = 0, expected = 0;
+    FILE *record, *base = NULL;
+    int result = SUCCESS;
+    int done = 0;
+
+    record = open_record(backup_path, offset);
+    if (!record) return ERROR_FILE_OPEN;
+
+    if (!read_record_header(record, &block_size, &codec, base_name, sizeof(base_name),
+                            base_path, sizeof(base_path))) {
+        fclose(record);
+        log_error("델타 레코드 손상: %s (offset %llu)", backup_path, (unsigned long long)offset);
+        return ERROR_FILE_READ;
+    }
+
+    // 기준 백업은 같은 체인 디렉토리 안 (<백업>/../<기준 이름>)
+    snprintf(base_file, sizeof(base_file), "%s/../%s/%s", backup_path, base_name, base_path);
+    base = open_base_file(base_file, (compression_type_t)codec);
+    buf = malloc(DELTA_COPY_BUFFER);
+    if (!base || !buf) {
+        log_error("델타 기준 파일 열기 실패: %s", base_file);
+        if (base) fclose(base);
+        free(buf);
+        fclose(record);
+        return base ? ERROR_MEMORY : ERROR_FILE_NOT_FOUND;
+    }
+
+    while (result == SUCCESS && !done) {
+        int op = fgetc(record);
+        uint64_t block;
+        uint32_t count, len;
+
+        switch (op) {
+            case 'C': {
+                uint64_t remaining, pos;
+
+                if (!get_u64(record, &block) || !get_u32(record, &count)) {
+                    result = ERROR_FILE_READ;
+                    break;
+                }
+                pos = block * block_size;
+                remaining = (uint64_t)count * block_size;
+                while (remaining > 0 && result == SUCCESS) {
+                    size_t n = (size_t)MIN(remaining, (uint64_t)DELTA_COPY_BUFFER);
+                    ssize_t got = pread(fileno(base), buf, n, (off_t)pos);
+
+                    if (got != (ssize_t)n) {
+                        log_error("델타 기준 파일이 짧음: %s", base_file);
+                        result = ERROR_FILE_READ;
+                        break;
+                    }
+                    if (out && fwrite(buf, 1, n, out) != n) result = ERROR_FILE_WRITE;
+                    if (hash) checksum_update(hash, buf, n);
+                    pos += n;
+                    remaining -= n;
+                    total += n;
+                }
+                break;
+            }
+
+            case 'L':
+                if (!get_u32(record, &len)) {
+                    result = ERROR_FILE_READ;
+                    break;
+                }
+                while (len > 0 && result == SUCCESS) {
+                    size_t n = MIN((size_t)len, (size_t)DELTA_COPY_BUFFER);
+
+                    if (!get_bytes(record, buf, n)) {
+                        result = ERROR_FILE_READ;
+                        break;
+                    }
+                    if (out && fwrite(buf, 1, n, out) != n) result = ERROR_FILE_WRITE;
+                    if (hash) checksum_update(hash, buf, n);
+                    len -= (uint32_t)n;
+                    total += n;
+                }
+                break;
+
+            case 'E':
+                if (!get_u64(record, &expected) || expected != total) {
+                    result = ERROR_CHECKSUM;
+                }
+                done = 1;
+                break;
+
+            default:
+                result = ERROR_FILE_READ;
+                break;
+        }
+    }
+
+    if (result != SUCCESS) {
+        log_error("델타 재구성 실패: %s (offset %llu)", backup_path, (unsigned long long)offset);
+    }
+
+    free(buf);
+    fclose(base);
+    fclose(record);
+
+    if (result == SUCCESS && size) {
+        *size = total;
+    }
+    return result;
+}
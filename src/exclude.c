@@ -0,0 +1,563 @@
+#include "backup.h"
+
+// 제외 패턴 매처: 패턴을 한 번 분류해 두고 파일마다 fnmatch 를 반복하지 않음
+//   리터럴 (a.txt, build/out)      -> 파일명/전체 경로 정확히 일치 해시 집합
+//   *.ext (점 하나인 확장자)        -> 파일명 마지막 확장자 해시 집합
+//   *접미사                         -> 경로 끝 L 바이트 해시 집합 (길이별)
+//   접두사*                         -> 파일명/경로 앞 L 바이트 해시 집합 (길이별)
+//   그 밖의 glob                    -> 소문자로 바꿔 둔 패턴을 할당 없이 직접 비교
+//   [[:class:]] 등 문자 클래스      -> fnmatch 그대로 (드묾)
+// 의미는 fnmatch(pattern, 파일명 또는 경로, FNM_CASEFOLD) 와 같음 ('*'는 '/'도 포함)
+#define EXCLUDE_SET_SLOTS (MAX_PATTERNS * 4)
+
+typedef struct {
+    uint64_t hash;
+    const char *text;             // 소문자 리터럴 (matcher.lowered 안)
+    uint16_t len;
+    uint16_t pattern;             // 로그용 원래 패턴 번호 + 1 (0 = 빈 칸)
+} literal_slot_t;
+
+typedef struct {
+    literal_slot_t slots[EXCLUDE_SET_SLOTS];
+    uint16_t lengths[MAX_PATTERNS]; // 들어 있는 리터럴 길이 (접두사/접미사 비교용, 중복 없음)
+    int length_count;
+    int count;
+} literal_set_t;
+
+typedef struct {
+    const backup_options_t *opts; // 컴파일한 옵션 (다르면 다시 컴파일)
+    int source_count;
+    int count;
+    char lowered[MAX_PATTERNS][256];
+    literal_set_t exact;
+    literal_set_t exts;
+    literal_set_t suffixes;
+    literal_set_t prefixes;
+    int globs[MAX_PATTERNS];
+    char required[MAX_PATTERNS][256]; // glob 마다 반드시 들어 있어야 하는 가장 긴 리터럴 조각
+    int glob_count;
+    int fallbacks[MAX_PATTERNS];  // fnmatch 로 비교할 패턴
+    int fallback_count;
+} exclude_matcher_t;
+
+static exclude_matcher_t matcher;
+static pthread_mutex_t matcher_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int has_glob_meta(const char *s) {
+    return strpbrk(s, "*?[\\") != NULL;
+}
+
+static void literal_set_add(literal_set_t *set, const char *text, size_t len, int pattern) {
+    uint64_t hash = XXH3_64bits(text, len);
+    size_t i = (size_t)hash & (EXCLUDE_SET_SLOTS - 1);
+    int known = 0;
+
+    while (set->slots[i].pattern != 0) {
+        if (set->slots[i].hash == hash && set->slots[i].len == len && memcmp(set->slots[i].text, text, len) == 0) {
+            return; // 같은 리터럴
+        }
+        i = (i + 1) & (EXCLUDE_SET_SLOTS - 1);
+    }
+    set->slots[i].hash = hash;
+    set->slots[i].text = text;
+    set->slots[i].len = (uint16_t)len;
+    set->slots[i].pattern = (uint16_t)(pattern + 1);
+    set->count++;
+
+    for (int k = 0; k < set->length_count; k++) {
+        if (set->lengths[k] == len) {
+            known = 1;
+            break;
+        }
+    }
+    if (!known) {
+        set->lengths[set->length_count++] = (uint16_t)len;
+    }
+}
+
+// 일치하면 원래 패턴 번호, 없으면 -1
+static int literal_set_find(const literal_set_t *set, const char *text, size_t len) {
+    uint64_t hash;
+    size_t i;
+
+    if (set->length_count == 0) {
+        return -1;
+    }
+    hash = XXH3_64bits(text, len);
+    for (i = (size_t)hash & (EXCLUDE_SET_SLOTS - 1); set->slots[i].pattern != 0; i = (i + 1) & (EXCLUDE_SET_SLOTS - 1)) {
+        if (set->slots[i].hash == hash && set->slots[i].len == len && memcmp(set->slots[i].text, text, len) == 0) {
+            return set->slots[i].pattern - 1;
+        }
+    }
+    return -1;
+}
+
+// 괄호 식 [...] 하나와 문자 c 비교: 1 일치, 0 불일치, -1 닫는 ']' 없음 ('['는 보통 문자)
+static int match_bracket(const char *p, char c, const char **next) {
+    const char *start;
+    int negate = 0, matched = 0;
+
+    p++;
+    if (*p == '!' || *p == '^') {
+        negate = 1;
+        p++;
+    }
+    start = p;
+    while (*p && (*p != ']' || p == start)) {
+        char lo = *p;
+
+        if (lo == '\\' && p[1]) {
+            lo = *++p;
+        }
+        if (p[1] == '-' && p[2] && p[2] != ']') {
+            char hi = p[2];
+
+            p += 2;
+            if (hi == '\\' && p[1]) {
+                hi = *++p;
+            }
+            if (c >= lo && c <= hi) {
+                matched = 1;
+            }
+        } else if (c == lo) {
+            matched = 1;
+        }
+        p++;
+    }
+    if (*p != ']') {
+        return -1;
+    }
+    *next = p + 1;
+    return matched != negate;
+}
+
+// 닫히지 않은 '[' 가 있는 패턴 (glibc 처리 방식이 경우마다 달라 끝의 '\\' 와 함께 fnmatch 에 맡김)
+static int has_open_bracket(const char *p) {
+    for (const char *b = strchr(p, '['); b; b = strchr(b + 1, '[')) {
+        const char *next;
+
+        if (match_bracket(b, '\0', &next) < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// glob 의 메타 문자 사이 리터럴 조각 중 가장 긴 것 (경로에 없으면 glob 비교를 건너뜀)
+static void longest_literal(const char *p, char *out, size_t size) {
+    size_t best = 0, run = 0;
+    const char *start = p;
+
+    out[0] = '\0';
+    for (;; p++) {
+        if (*p == '\0' || strchr("*?[\\", *p)) {
+            if (run > best && run < size) {
+                best = run;
+                memcpy(out, start, run);
+                out[run] = '\0';
+            }
+            if (*p == '\0') {
+                break;
+            }
+            if (*p == '[') {
+                const char *next;
+
+                // 괄호 식은 한 글자이므로 조각을 끊고 건너뜀
+                if (match_bracket(p, '\0', &next) >= 0) {
+                    p = next - 1;
+                }
+            } else if (*p == '\\' && p[1]) {
+                p++;
+            }
+            run = 0;
+            start = p + 1;
+        } else {
+            run++;
+        }
+    }
+}
+
+// fnmatch(p, s, 0) 와 같은 비교 (둘 다 소문자): 마지막 '*' 위치로만 되돌아가므로 지수 시간이 없음
+static int glob_match(const char *p, const char *s) {
+    const char *star_p = NULL, *star_s = NULL;
+
+    while (*s) {
+        if (*p == '*') {
+            while (*p == '*') {
+                p++;
+            }
+            if (*p == '\0') {
+                return 1;
+            }
+            star_p = p;
+            star_s = s;
+            continue;
+        }
+        if (*p == '?') {
+            p++;
+            s++;
+            continue;
+        }
+        if (*p == '[') {
+            const char *next;
+            int r = match_bracket(p, *s, &next);
+
+            if (r == 1) {
+                p = next;
+                s++;
+                continue;
+            }
+            if (r == -1 && *s == '[') {
+                p++;
+                s++;
+                continue;
+            }
+        } else if (*p != '\0') {
+            const char *lit = (*p == '\\' && p[1]) ? p + 1 : p;
+
+            if (*lit == *s) {
+                p = lit + 1;
+                s++;
+                continue;
+            }
+        }
+        if (!star_p) {
+            return 0;
+        }
+        p = star_p;
+        s = ++star_s;
+    }
+
+    while (*p == '*') {
+        p++;
+    }
+    return *p == '\0';
+}
+
+static void compile_matcher(const backup_options_t *opts) {
+    memset(&matcher, 0, sizeof(matcher));
+    matcher.opts = opts;
+    matcher.source_count = opts->exclude_count;
+    matcher.count = opts->exclude_count < MAX_PATTERNS ? opts->exclude_count : MAX_PATTERNS;
+
+    for (int i = 0; i < matcher.count; i++) {
+        char *p = matcher.lowered[i];
+        size_t len;
+
+        snprintf(p, sizeof(matcher.lowered[i]), "%s", opts->exclude_patterns[i]);
+        for (char *c = p; *c; c++) {
+            *c = (char)tolower((unsigned char)*c);
+        }
+        len = strlen(p);
+
+        if (len == 0) {
+            literal_set_add(&matcher.exact, p, 0, i);
+        } else if (!has_glob_meta(p)) {
+            literal_set_add(&matcher.exact, p, len, i);
+        } else if (p[0] == '*' && len > 1 && !has_glob_meta(p + 1)) {
+            // ".ext" 가 경로 끝이면 점은 파일명 안의 마지막 점이므로 확장자 비교와 같음
+            if (p[1] == '.' && !strpbrk(p + 2, "./")) {
+                literal_set_add(&matcher.exts, p + 1, len - 1, i);
+            } else {
+                literal_set_add(&matcher.suffixes, p + 1, len - 1, i);
+            }
+        } else if (p[len - 1] == '*' && len > 1 && !strpbrk(p, "?[\\") && strchr(p, '*') == p + len - 1) {
+            literal_set_add(&matcher.prefixes, p, len - 1, i);
+        } else if (strstr(p, "[:") || strstr(p, "[=") || strstr(p, "[.") || has_open_bracket(p) ||
+                   p[len - 1] == '\\') {
+            matcher.fallbacks[matcher.fallback_count++] = i;
+        } else {
+            longest_literal(p, matcher.required[matcher.glob_count], sizeof(matcher.required[0]));
+            matcher.globs[matcher.glob_count++] = i;
+        }
+    }
+
+    log_debug("제외 패턴 %d개 컴파일: 리터럴 %d, 확장자 %d, 접미사 %d, 접두사 %d, glob %d, fnmatch %d",
+              matcher.count, matcher.exact.count, matcher.exts.count,
+              matcher.suffixes.count, matcher.prefixes.count,
+              matcher.glob_count, matcher.fallback_count);
+}
+
+void exclude_matcher_init(const backup_options_t *opts) {
+    pthread_mutex_lock(&matcher_mutex);
+    compile_matcher(opts);
+    pthread_mutex_unlock(&matcher_mutex);
+}
+
+static int report_match(const char *path, int pattern) {
+    log_debug("제외 패턴 일치로 제외: %s (패턴: %s)", path, matcher.opts->exclude_patterns[pattern]);
+    return 1;
+}
+
+// 제외 패턴만 확인 (stat 없이 경로로 판단, 파일명과 전체 경로 모두 비교)
+int is_excluded_path(const char *path, const backup_options_t *opts) {
+    char lower[MAX_PATH];
+    const char *base, *dot;
+    size_t len, base_len;
+    int found;
+
+    if (opts->exclude_count == 0) {
+        return 0;
+    }
+    if (matcher.opts != opts || matcher.source_count != opts->exclude_count) {
+        exclude_matcher_init(opts);
+    }
+
+    len = strlen(path);
+    if (len >= sizeof(lower)) {
+        len = sizeof(lower) - 1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        lower[i] = (char)tolower((unsigned char)path[i]);
+    }
+    lower[len] = '\0';
+    base = strrchr(lower, '/');
+    base = base ? base + 1 : lower;
+    base_len = len - (size_t)(base - lower);
+
+    if ((found = literal_set_find(&matcher.exact, base, base_len)) >= 0 ||
+        (found = literal_set_find(&matcher.exact, lower, len)) >= 0) {
+        return report_match(path, found);
+    }
+
+    dot = strrchr(base, '.');
+    if (dot && (found = literal_set_find(&matcher.exts, dot, base_len - (size_t)(dot - base))) >= 0) {
+        return report_match(path, found);
+    }
+
+    // 파일명의 접미사는 경로의 접미사이기도 하므로 경로만 비교
+    for (int k = 0; k < matcher.suffixes.length_count; k++) {
+        size_t l = matcher.suffixes.lengths[k];
+
+        if (l <= len && (found = literal_set_find(&matcher.suffixes, lower + len - l, l)) >= 0) {
+            return report_match(path, found);
+        }
+    }
+
+    for (int k = 0; k < matcher.prefixes.length_count; k++) {
+        size_t l = matcher.prefixes.lengths[k];
+
+        if ((l <= base_len && (found = literal_set_find(&matcher.prefixes, base, l)) >= 0) ||
+            (l <= len && (found = literal_set_find(&matcher.prefixes, lower, l)) >= 0)) {
+            return report_match(path, found);
+        }
+    }
+
+    // 파일명은 경로의 일부이므로 리터럴 조각이 경로에 없으면 둘 다 일치할 수 없음
+    for (int k = 0; k < matcher.glob_count; k++) {
+        const char *p = matcher.lowered[matcher.globs[k]];
+
+        if (matcher.required[k][0] && !strstr(lower, matcher.required[k])) {
+            continue;
+        }
+        if (glob_match(p, base) || glob_match(p, lower)) {
+            return report_match(path, matcher.globs[k]);
+        }
+    }
+
+    for (int k = 0; k < matcher.fallback_count; k++) {
+        const char *p = opts->exclude_patterns[matcher.fallbacks[k]];
+
+        if (fnmatch(p, base, FNM_CASEFOLD) == 0 || fnmatch(p, lower, FNM_CASEFOLD) == 0) {
+            return report_match(path, matcher.fallbacks[k]);
+        }
+    }
+
+    return 0;
+}
+
+// 디렉토리 제외: 하위 트리를 열기 전에 이름/경로만으로 통째로 건너뜀
+//   /로 시작       -> 백업 원본의 절대 경로와 비교 (/proc, /var/tmp)
+//   중간에 / 포함   -> 백업 원본 기준 상대 경로와 비교 (build/cache)
+//   그 밖           -> 디렉토리 이름과 비교 (node_modules, .git)
+static const char *const system_dirs[] = { "/proc", "/sys", "/dev", "/run" };
+
+static int directory_pattern_match(const char *pattern, const char *root, const char *rel, const char *name) {
+    char abs[MAX_PATH];
+
+    if (pattern[0] == '/') {
+        if (!root || !root[0]) {
+            return 0;
+        }
+        snprintf(abs, sizeof(abs), "%s/%s", strcmp(root, "/") == 0 ? "" : root, rel);
+        return fnmatch(pattern, abs, 0) == 0;
+    }
+    if (strchr(pattern, '/')) {
+        return fnmatch(pattern, rel, 0) == 0;
+    }
+    return fnmatch(pattern, name, 0) == 0;
+}
+
+int is_excluded_directory(const char *root, const char *rel, const char *name, const backup_options_t *opts) {
+    if (opts->exclude_system_dirs) {
+        for (size_t i = 0; i < sizeof(system_dirs) / sizeof(system_dirs[0]); i++) {
+            if (directory_pattern_match(system_dirs[i], root, rel, name)) {
+                log_debug("시스템 디렉토리 제외: %s", rel);
+                return 1;
+            }
+        }
+    }
+    for (int i = 0; i < opts->exclude_dir_count; i++) {
+        if (directory_pattern_match(opts->exclude_dirs[i], root, rel, name)) {
+            log_debug("디렉토리 제외: %s (패턴: %s)", rel, opts->exclude_dirs[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 디렉토리별 제외 파일 (.backupignore)
+// 디렉토리에 들어갈 때 한 번 읽어 스택에 쌓고 하위 트리 전체에 물려줌 (나올 때 버림)
+//   # 주석, 빈 줄 무시         !패턴 -> 앞에서 제외된 것을 다시 포함
+//   패턴/ -> 디렉토리에만 적용  / 가 들어간 패턴 -> 제외 파일이 있는 디렉토리 기준 경로와 비교
+//   그 밖 -> 어느 깊이든 이름과 비교 (** 는 / 를 넘어 일치)
+typedef struct {
+    char pattern[256];
+    uint8_t anchored;
+    uint8_t dir_only;
+    uint8_t negate;
+} ignore_rule_t;
+
+typedef struct {
+    size_t rel_len;               // 제외 파일이 있는 디렉토리의 상대 경로 길이
+    size_t first;                 // ignore_rules 안 첫 규칙
+} ignore_frame_t;
+
+static ignore_rule_t *ignore_rules = NULL;
+static size_t ignore_rule_count = 0;
+static size_t ignore_rule_capacity = 0;
+static ignore_frame_t *ignore_frames = NULL;
+static size_t ignore_depth = 0;
+static size_t ignore_frame_capacity = 0;
+
+static int parse_ignore_rule(char *line, ignore_rule_t *rule) {
+    size_t len = strcspn(line, "\r\n");
+
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) {
+        len--;
+    }
+    line[len] = '\0';
+    if (len == 0 || line[0] == '#') {
+        return 0;
+    }
+
+    memset(rule, 0, sizeof(*rule));
+    if (line[0] == '!') {
+        rule->negate = 1;
+        line++;
+    } else if (line[0] == '\\' && (line[1] == '#' || line[1] == '!')) {
+        line++;
+    }
+    len = strlen(line);
+    if (len > 1 && line[len - 1] == '/') {
+        rule->dir_only = 1;
+        line[--len] = '\0';
+    }
+    if (strncmp(line, "**/", 3) == 0 && !strchr(line + 3, '/')) {
+        line += 3; // 어느 깊이든 = 이름 비교
+    } else if (strchr(line, '/')) {
+        rule->anchored = 1;
+        if (line[0] == '/') {
+            line++;
+        }
+    }
+    if (!line[0] || strlen(line) >= sizeof(rule->pattern)) {
+        return 0;
+    }
+    memcpy(rule->pattern, line, strlen(line) + 1);
+    return 1;
+}
+
+int ignore_push(const char *dir, const char *rel, const backup_options_t *opts) {
+    char path[MAX_PATH];
+    char line[512];
+    ignore_rule_t rule;
+    size_t first = ignore_rule_count;
+    FILE *file;
+
+    if (!opts->ignore_file[0] || strcmp(opts->ignore_file, "none") == 0) {
+        return 0;
+    }
+    snprintf(path, sizeof(path), "%s/%s", dir, opts->ignore_file);
+    file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        if (!parse_ignore_rule(line, &rule)) {
+            continue;
+        }
+        if (ignore_rule_count == ignore_rule_capacity) {
+            size_t capacity = ignore_rule_capacity ? ignore_rule_capacity * 2 : 64;
+            ignore_rule_t *rules = realloc(ignore_rules, capacity * sizeof(*rules));
+
+            if (!rules) {
+                log_warning("메모리 부족으로 제외 파일 일부를 무시합니다: %s", path);
+                break;
+            }
+            ignore_rules = rules;
+            ignore_rule_capacity = capacity;
+        }
+        ignore_rules[ignore_rule_count++] = rule;
+    }
+    fclose(file);
+
+    if (ignore_depth == ignore_frame_capacity) {
+        size_t capacity = ignore_frame_capacity ? ignore_frame_capacity * 2 : 16;
+        ignore_frame_t *frames = realloc(ignore_frames, capacity * sizeof(*frames));
+
+        if (!frames) {
+            ignore_rule_count = first;
+            return 0;
+        }
+        ignore_frames = frames;
+        ignore_frame_capacity = capacity;
+    }
+    ignore_frames[ignore_depth].rel_len = strlen(rel);
+    ignore_frames[ignore_depth].first = first;
+    ignore_depth++;
+
+    log_debug("제외 파일 적용: %s (규칙 %zu개)", path, ignore_rule_count - first);
+    return 1;
+}
+
+void ignore_pop(void) {
+    if (ignore_depth > 0) {
+        ignore_depth--;
+        ignore_rule_count = ignore_frames[ignore_depth].first;
+    }
+}
+
+void ignore_reset(void) {
+    free(ignore_rules);
+    free(ignore_frames);
+    ignore_rules = NULL;
+    ignore_frames = NULL;
+    ignore_rule_count = ignore_rule_capacity = 0;
+    ignore_depth = ignore_frame_capacity = 0;
+}
+
+// 마지막으로 일치한 규칙이 결정 (상위 디렉토리 규칙 먼저, 가까운 디렉토리 규칙이 나중)
+int ignore_excluded(const char *rel, const char *name, int is_dir) {
+    int excluded = 0;
+
+    for (size_t f = 0; f < ignore_depth; f++) {
+        size_t end = f + 1 < ignore_depth ? ignore_frames[f + 1].first : ignore_rule_count;
+        size_t skip = ignore_frames[f].rel_len;
+        const char *sub = rel + skip + (skip > 0 && rel[skip] == '/');
+
+        for (size_t r = ignore_frames[f].first; r < end; r++) {
+            const ignore_rule_t *rule = &ignore_rules[r];
+            int flags = strstr(rule->pattern, "**") ? 0 : FNM_PATHNAME;
+
+            if (rule->dir_only && !is_dir) {
+                continue;
+            }
+            if (fnmatch(rule->pattern, rule->anchored ? sub : name, rule->anchored ? flags : 0) == 0) {
+                excluded = !rule->negate;
+            }
+        }
+    }
+    return excluded;
+}
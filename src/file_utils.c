@@ -108,107 +108,125 @@ int copy_file_metadata(const char *source, const char *dest) {
     return SUCCESS;
 }
 
-int should_include_file(const char *path, const backup_options_t *opts) {
+// 이미 stat 한 항목의 포함 여부 (크기 제한, 제외 패턴)
+int should_include_stat(const char *path, const struct stat *st, const backup_options_t *opts) {
     const char *filename;
-    struct stat st;
-    
-    if (!path || !opts) return 0;
-    
-    // 파일 정보 가져오기
-    if (stat(path, &st) != 0) {
-        return 0; // 접근할 수 없는 파일은 제외
-    }
-    
+
+    if (!path || !st || !opts) return 0;
+
     // 파일 크기 제한 확인
-    if (opts->max_file_size != SIZE_MAX && st.st_size > opts->max_file_size) {
-        log_debug("파일 크기 제한으로 제외: %s (%zu bytes)", path, st.st_size);
+    if (opts->max_file_size != SIZE_MAX && !S_ISDIR(st->st_mode) && (size_t)st->st_size > opts->max_file_size) {
+        log_debug("파일 크기 제한으로 제외: %s (%zu bytes)", path, (size_t)st->st_size);
         return 0;
     }
-    
-    // 파일명 추출
-    filename = strrchr(path, '/');
-    if (!filename) {
-        filename = path;
-    } else {
-        filename++; // '/' 다음 문자부터
-    }
-    
-    // 제외 패턴 확인
-    for (int i = 0; i < opts->exclude_count; i++) {
-        if (fnmatch(opts->exclude_patterns[i], filename, FNM_CASEFOLD) == 0) {
-            log_debug("제외 패턴 일치로 제외: %s (패턴: %s)", 
-                     filename, opts->exclude_patterns[i]);
-            return 0;
-        }
-        
-        // 전체 경로에 대해서도 패턴 확인
-        if (fnmatch(opts->exclude_patterns[i], path, FNM_CASEFOLD) == 0) {
-            log_debug("제외 패턴 일치로 제외: %s (패턴: %s)", 
-                     path, opts->exclude_patterns[i]);
-            return 0;
-        }
+
+    if (is_excluded_path(path, opts)) {
+        return 0;
     }
-    
+
     // 숨김 파일 처리 (일반적으로 포함하지만 로그는 debug 레벨로)
-    if (filename[0] == '.' && strlen(filename) > 1) {
+    filename = strrchr(path, '/');
+    filename = filename ? filename + 1 : path;
+    if (filename[0] == '.' && filename[1] != '\0') {
         log_debug("숨김 파일 포함: %s", filename);
     }
-    
+
     return 1; // 포함
 }
 
+int should_include_file(const char *path, const backup_options_t *opts) {
+    struct stat st;
+
+    if (!path || !opts) return 0;
+
+    // 파일 정보 가져오기
+    if (stat(path, &st) != 0) {
+        return 0; // 접근할 수 없는 파일은 제외
+    }
+
+    return should_include_stat(path, &st, opts);
+}
+
+// len 바이트를 채울 때까지 읽음 (EINTR/짧은 읽기 반복), 읽은 바이트 수 (파일 끝이면 더 적음, 오류면 -1)
+ssize_t read_full(int fd, void *buf, size_t len) {
+    size_t total = 0;
+
+    while (total < len) {
+        ssize_t n = read(fd, (unsigned char *)buf + total, len - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        total += (size_t)n;
+    }
+    return (ssize_t)total;
+}
+
+int write_full(int fd, const void *buf, size_t len) {
+    size_t written = 0;
+
+    while (written < len) {
+        ssize_t n = write(fd, (const unsigned char *)buf + written, len - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return ERROR_FILE_WRITE;
+        written += (size_t)n;
+    }
+    return SUCCESS;
+}
+
 int compare_files(const char *file1, const char *file2) {
-    FILE *f1, *f2;
-    char buf1[BUFFER_SIZE], buf2[BUFFER_SIZE];
-    size_t n1, n2;
+    unsigned char *buf1 = NULL, *buf2 = NULL;
+    struct stat st1, st2;
+    int fd1, fd2;
     int result = 1; // 기본적으로 동일하다고 가정
     
     if (!file1 || !file2) return 0;
     
-    f1 = fopen(file1, "rb");
-    if (!f1) {
+    fd1 = open(file1, O_RDONLY);
+    if (fd1 < 0) {
         log_error("파일 열기 실패: %s", file1);
         return 0;
     }
     
-    f2 = fopen(file2, "rb");
-    if (!f2) {
+    fd2 = open(file2, O_RDONLY);
+    if (fd2 < 0) {
         log_error("파일 열기 실패: %s", file2);
-        fclose(f1);
+        close(fd1);
         return 0;
     }
     
     // 파일 크기 먼저 비교
-    struct stat st1, st2;
-    if (fstat(fileno(f1), &st1) == 0 && fstat(fileno(f2), &st2) == 0) {
-        if (st1.st_size != st2.st_size) {
-            log_debug("파일 크기 다름: %s (%zu) vs %s (%zu)", 
-                     file1, st1.st_size, file2, st2.st_size);
-            result = 0;
-            goto cleanup;
-        }
+    if (fstat(fd1, &st1) == 0 && fstat(fd2, &st2) == 0 && st1.st_size != st2.st_size) {
+        log_debug("파일 크기 다름: %s (%zu) vs %s (%zu)", 
+                 file1, st1.st_size, file2, st2.st_size);
+        result = 0;
+        goto cleanup;
+    }
+    
+    buf1 = io_buffer_get();
+    buf2 = io_buffer_get();
+    if (!buf1 || !buf2) {
+        result = 0;
+        goto cleanup;
     }
     
-    // 바이트 단위로 비교
-    while ((n1 = fread(buf1, 1, BUFFER_SIZE, f1)) > 0) {
-        n2 = fread(buf2, 1, BUFFER_SIZE, f2);
+    // 블록 단위로 비교 (f2에 더 많은 데이터가 있으면 마지막 읽기에서 n2 > n1)
+    for (;;) {
+        ssize_t n1 = read_full(fd1, buf1, IO_BUFFER_SIZE);
+        ssize_t n2 = read_full(fd2, buf2, n1 > 0 ? (size_t)n1 : 1);
         
-        if (n1 != n2 || memcmp(buf1, buf2, n1) != 0) {
+        if (n1 < 0 || n2 < 0 || n1 != n2 || memcmp(buf1, buf2, (size_t)n1) != 0) {
             log_debug("파일 내용 다름: %s vs %s", file1, file2);
             result = 0;
             break;
         }
-    }
-    
-    // f2에 더 많은 데이터가 있는지 확인
-    if (result && fread(buf2, 1, 1, f2) > 0) {
-        log_debug("파일 크기 다름 (f2가 더 큼): %s vs %s", file1, file2);
-        result = 0;
+        if (n1 == 0) break;
     }
 
 cleanup:
-    fclose(f1);
-    fclose(f2);
+    io_buffer_put(buf1);
+    io_buffer_put(buf2);
+    close(fd1);
+    close(fd2);
     
     return result;
 }
@@ -223,6 +241,16 @@ size_t get_file_size(const char *path) {
     return st.st_size;
 }
 
+// 백업 도구가 백업 루트에 생성하는 내부 파일 여부 (이름만 비교)
+int is_backup_internal_file(const char *name) {
+    if (!name) return 0;
+
+    return strcmp(name, BACKUP_INDEX_FILE) == 0 || strcmp(name, BACKUP_MANIFEST_FILE) == 0 ||
+           strcmp(name, BACKUP_METADATA_FILE) == 0 || strcmp(name, BACKUP_RECIPES_FILE) == 0 ||
+           strcmp(name, BACKUP_DELTAS_FILE) == 0 ||
+           strcmp(name, BACKUP_CHUNK_DIR) == 0;
+}
+
 char *get_relative_path(const char *base, const char *path) {
     static char relative[MAX_PATH];
     size_t base_len, path_len;
@@ -343,70 +371,73 @@ const char *get_file_type_string(const char *path) {
     return "special";
 }
 
-// 디렉토리 크기 계산 (재귀적)
+// 디렉토리 크기 계산 (하위 트리 전체)
 size_t calculate_directory_size(const char *path) {
-    DIR *dir;
-    struct dirent *entry;
+    dir_walk_t walk;
     struct stat st;
-    char full_path[MAX_PATH];
     size_t total_size = 0;
     
     if (!path) return 0;
     
-    dir = opendir(path);
-    if (!dir) {
+    if (walk_init(&walk, path, NULL, 0) != SUCCESS) {
+        return 0;
+    }
+    if (walk_enter(&walk) != SUCCESS) {
+        walk_free(&walk);
         return 0;
     }
     
-    while ((entry = readdir(dir)) != NULL) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+    while (walk.depth > 0) {
+        if (!walk_next(&walk)) {
+            walk_leave(&walk);
             continue;
         }
         
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-        
-        if (stat(full_path, &st) == 0) {
+        if (stat(walk.src.buf, &st) == 0) {
             if (S_ISREG(st.st_mode)) {
                 total_size += st.st_size;
             } else if (S_ISDIR(st.st_mode)) {
-                total_size += calculate_directory_size(full_path);
+                walk_enter(&walk);
             }
         }
     }
     
-    closedir(dir);
+    walk_free(&walk);
     return total_size;
 }
 
-// 파일 개수 계산 (재귀적)
+// 파일 개수 계산 (하위 트리 전체)
 size_t count_files_in_directory(const char *path) {
-    DIR *dir;
-    struct dirent *entry;
-    char full_path[MAX_PATH];
+    dir_walk_t walk;
+    struct stat st;
     size_t file_count = 0;
     
     if (!path) return 0;
     
-    dir = opendir(path);
-    if (!dir) {
+    if (walk_init(&walk, path, NULL, 0) != SUCCESS) {
+        return 0;
+    }
+    if (walk_enter(&walk) != SUCCESS) {
+        walk_free(&walk);
         return 0;
     }
     
-    while ((entry = readdir(dir)) != NULL) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+    while (walk.depth > 0) {
+        if (!walk_next(&walk)) {
+            walk_leave(&walk);
             continue;
         }
         
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-        
-        if (is_regular_file(full_path)) {
-            file_count++;
-        } else if (is_directory(full_path)) {
-            file_count += count_files_in_directory(full_path);
+        if (stat(walk.src.buf, &st) == 0) {
+            if (S_ISREG(st.st_mode)) {
+                file_count++;
+            } else if (S_ISDIR(st.st_mode)) {
+                walk_enter(&walk);
+            }
         }
     }
     
-    closedir(dir);
+    walk_free(&walk);
     return file_count;
 }
 
@@ -0,0 +1,404 @@
+#include "backup.h"
+#include <sys/mman.h>
+#include <sys/file.h>
+
+// 영구 해시 캐시: (dev, inode, size, mtime_ns, ctime_ns) → 마지막으로 계산한 내용 해시
+//
+// mmap 한 고정 크기 슬롯의 open addressing 해시 테이블입니다. 슬롯은 (dev, inode, 알고리즘)으로
+// 찾고, 크기/mtime/ctime 중 하나라도 다르면 내용이 바뀐 것으로 보고 새 해시로 덮어씁니다
+// (mtime을 되돌려도 ctime이 바뀌므로 무효화됨). 다른 백업 프로세스와는 flock(LOCK_EX)으로
+// 배타적으로 사용하고(잠겨 있으면 캐시 없이 진행), 같은 프로세스의 워커 스레드는 mutex로 직렬화합니다.
+// 실행마다 세대 번호를 올려 조회/기록된 슬롯에 남기고, 오래 보이지 않은 파일의 슬롯이 많아지면
+// 닫을 때 새 파일로 다시 만들어 정리합니다. 표가 3/4 이상 차면 두 배로 키워 다시 만듭니다.
+// 호스트 로컬 캐시이므로 구조체를 그대로 기록합니다 (형식이 다르면 새로 만듦).
+
+#define HASH_CACHE_MAGIC "BKHCACHE"
+#define HASH_CACHE_VERSION 1
+#define HASH_CACHE_MIN_SLOTS 4096
+#define HASH_CACHE_MAX_AGE 16             // 이 세대 수 동안 보이지 않은 항목은 정리 대상
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t capacity;
+    uint64_t used;
+    uint64_t generation;
+    uint8_t reserved[24];
+} hash_cache_header_t;
+
+typedef struct {
+    uint64_t dev;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+    uint8_t algorithm;
+    uint8_t digest_len;
+    uint8_t state;                        // 0 = 빈 슬롯, 1 = 사용 중
+    uint8_t reserved;
+    uint32_t generation;                  // 마지막으로 조회/기록된 실행
+    uint32_t check;                       // 찢어진 기록 감지용 (generation, check 제외 해시)
+    uint32_t reserved2;
+    unsigned char digest[MAX_DIGEST_SIZE];
+} hash_cache_slot_t;
+
+static int cache_fd = -1;
+static unsigned char *cache_map = NULL;
+static size_t cache_map_size = 0;
+static hash_cache_header_t *cache_header = NULL;
+static hash_cache_slot_t *cache_slots = NULL;
+static char cache_path[MAX_PATH];
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int64_t timespec_ns(const struct timespec *ts) {
+    return (int64_t)ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static uint32_t slot_check(const hash_cache_slot_t *slot) {
+    hash_cache_slot_t copy = *slot;
+
+    copy.generation = 0;
+    copy.check = 0;
+    return (uint32_t)XXH3_64bits(&copy, sizeof(copy));
+}
+
+static size_t slot_index(uint64_t dev, uint64_t inode, uint8_t algorithm, uint64_t capacity) {
+    uint64_t key[3] = { dev, inode, algorithm };
+
+    return (size_t)(XXH3_64bits(key, sizeof(key)) & (capacity - 1));
+}
+
+static int hex_to_digest(const char *hex, unsigned char *digest, size_t len) {
+    if (strlen(hex) != len * 2) return 0;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned int value;
+        if (sscanf(hex + i * 2, "%2x", &value) != 1) return 0;
+        digest[i] = (unsigned char)value;
+    }
+    return 1;
+}
+
+static void digest_to_hex(const unsigned char *digest, size_t len, char *hex) {
+    for (size_t i = 0; i < len; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+    hex[len * 2] = '\0';
+}
+
+// 캐시 파일 매핑 (fd는 이미 잠겨 있어야 함)
+static int map_cache(int fd) {
+    struct stat st;
+    void *map;
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(hash_cache_header_t)) {
+        return ERROR_FILE_READ;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return ERROR_MEMORY;
+    }
+
+    cache_map = map;
+    cache_map_size = (size_t)st.st_size;
+    cache_header = (hash_cache_header_t *)cache_map;
+    cache_slots = (hash_cache_slot_t *)(cache_map + sizeof(hash_cache_header_t));
+    return SUCCESS;
+}
+
+static void unmap_cache(void) {
+    if (cache_map) {
+        munmap(cache_map, cache_map_size);
+    }
+    cache_map = NULL;
+    cache_map_size = 0;
+    cache_header = NULL;
+    cache_slots = NULL;
+}
+
+static int valid_header(const hash_cache_header_t *header, size_t file_size) {
+    return memcmp(header->magic, HASH_CACHE_MAGIC, 8) == 0 &&
+           header->version == HASH_CACHE_VERSION &&
+           header->slot_size == sizeof(hash_cache_slot_t) &&
+           header->capacity >= HASH_CACHE_MIN_SLOTS &&
+           (header->capacity & (header->capacity - 1)) == 0 &&
+           file_size == sizeof(hash_cache_header_t) + header->capacity * sizeof(hash_cache_slot_t);
+}
+
+// 살아 있는 항목만 capacity 크기의 새 파일로 옮기고 교체 (호출 전 cache_mutex 보유)
+static int rebuild_cache(uint64_t capacity, int drop_stale) {
+    char temp_path[MAX_PATH + 8];
+    hash_cache_header_t header;
+    hash_cache_slot_t *new_slots;
+    size_t new_size = sizeof(hash_cache_header_t) + capacity * sizeof(hash_cache_slot_t);
+    unsigned char *new_map;
+    uint64_t used = 0;
+    int fd;
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path);
+    fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return ERROR_FILE_WRITE;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0 || ftruncate(fd, (off_t)new_size) != 0) {
+        close(fd);
+        unlink(temp_path);
+        return ERROR_FILE_WRITE;
+    }
+
+    new_map = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (new_map == MAP_FAILED) {
+        close(fd);
+        unlink(temp_path);
+        return ERROR_MEMORY;
+    }
+    new_slots = (hash_cache_slot_t *)(new_map + sizeof(hash_cache_header_t));
+
+    if (cache_header) {
+        uint64_t generation = cache_header->generation;
+
+        for (uint64_t i = 0; i < cache_header->capacity; i++) {
+            const hash_cache_slot_t *slot = &cache_slots[i];
+            size_t index;
+
+            if (slot->state != 1 || slot->check != slot_check(slot)) continue;
+            if (drop_stale && generation - slot->generation > HASH_CACHE_MAX_AGE) continue;
+
+            index = slot_index(slot->dev, slot->inode, slot->algorithm, capacity);
+            while (new_slots[index].state != 0) {
+                index = (index + 1) & (capacity - 1);
+            }
+            new_slots[index] = *slot;
+            used++;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HASH_CACHE_MAGIC, 8);
+    header.version = HASH_CACHE_VERSION;
+    header.slot_size = sizeof(hash_cache_slot_t);
+    header.capacity = capacity;
+    header.used = used;
+    header.generation = cache_header ? cache_header->generation : 1;
+    memcpy(new_map, &header, sizeof(header));
+
+    if (rename(temp_path, cache_path) != 0) {
+        munmap(new_map, new_size);
+        close(fd);
+        unlink(temp_path);
+        return ERROR_FILE_WRITE;
+    }
+
+    // 새 파일을 잠근 채로 교체했으므로 이전 파일은 바로 닫아도 됨
+    unmap_cache();
+    if (cache_fd >= 0) {
+        close(cache_fd);
+    }
+    cache_fd = fd;
+    cache_map = new_map;
+    cache_map_size = new_size;
+    cache_header = (hash_cache_header_t *)cache_map;
+    cache_slots = (hash_cache_slot_t *)(cache_map + sizeof(hash_cache_header_t));
+
+    log_debug("해시 캐시 재구성: %llu개 항목, %llu개 슬롯",
+              (unsigned long long)used, (unsigned long long)capacity);
+    return SUCCESS;
+}
+
+static void default_cache_path(char *path, size_t size) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+
+    if (xdg && xdg[0]) {
+        snprintf(path, size, "%s/backup-utility/hashes.cache", xdg);
+    } else if (home && home[0]) {
+        snprintf(path, size, "%s/.cache/backup-utility/hashes.cache", home);
+    } else {
+        path[0] = '\0';
+    }
+}
+
+// 캐시 열기 (path가 비어 있으면 기본 위치, "none"이면 사용 안 함). 실패해도 캐시 없이 계속
+int hash_cache_open(const char *path) {
+    char dir[MAX_PATH];
+    char *slash;
+    struct stat st;
+
+    if (path && strcmp(path, "none") == 0) {
+        return SUCCESS;
+    }
+
+    if (path && path[0]) {
+        snprintf(cache_path, sizeof(cache_path), "%s", path);
+    } else {
+        default_cache_path(cache_path, sizeof(cache_path));
+    }
+    if (!cache_path[0]) {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    snprintf(dir, sizeof(dir), "%s", cache_path);
+    slash = strrchr(dir, '/');
+    if (slash && slash != dir) {
+        *slash = '\0';
+        if (!file_exists(dir)) {
+            create_directory_recursive(dir);
+        }
+    }
+
+    cache_fd = open(cache_path, O_RDWR | O_CREAT, 0600);
+    if (cache_fd < 0) {
+        log_warning("해시 캐시를 열 수 없습니다: %s", cache_path);
+        return ERROR_FILE_OPEN;
+    }
+
+    if (flock(cache_fd, LOCK_EX | LOCK_NB) != 0) {
+        log_info("해시 캐시를 다른 백업이 사용 중이어서 캐시 없이 진행합니다: %s", cache_path);
+        close(cache_fd);
+        cache_fd = -1;
+        return ERROR_FILE_OPEN;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+    if (fstat(cache_fd, &st) == 0 && (size_t)st.st_size >= sizeof(hash_cache_header_t) &&
+        map_cache(cache_fd) == SUCCESS && !valid_header(cache_header, cache_map_size)) {
+        log_warning("해시 캐시 형식이 달라 새로 만듭니다: %s", cache_path);
+        unmap_cache();
+    }
+    if (!cache_map && rebuild_cache(HASH_CACHE_MIN_SLOTS, 0) != SUCCESS) {
+        pthread_mutex_unlock(&cache_mutex);
+        log_warning("해시 캐시 생성 실패: %s", cache_path);
+        close(cache_fd);
+        cache_fd = -1;
+        return ERROR_FILE_WRITE;
+    }
+    cache_header->generation++;
+    pthread_mutex_unlock(&cache_mutex);
+
+    log_debug("해시 캐시 열기: %s (%llu개 항목)", cache_path, (unsigned long long)cache_header->used);
+    return SUCCESS;
+}
+
+// 닫기 전 오래된 항목이 1/4 이상이면 정리된 파일로 다시 만듦
+void hash_cache_close(void) {
+    pthread_mutex_lock(&cache_mutex);
+    if (cache_map) {
+        uint64_t stale = 0, live;
+        uint64_t capacity = HASH_CACHE_MIN_SLOTS;
+
+        for (uint64_t i = 0; i < cache_header->capacity; i++) {
+            if (cache_slots[i].state == 1 &&
+                cache_header->generation - cache_slots[i].generation > HASH_CACHE_MAX_AGE) {
+                stale++;
+            }
+        }
+
+        if (stale > 0 && stale * 4 >= cache_header->used) {
+            live = cache_header->used - stale;
+            while (capacity < live * 2) capacity <<= 1;
+            rebuild_cache(capacity, 1);
+        }
+        unmap_cache();
+    }
+    if (cache_fd >= 0) {
+        close(cache_fd);
+        cache_fd = -1;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+// 파일 상태가 캐시와 같으면 해시(hex)를 돌려주고 1, 아니면 0
+int hash_cache_lookup(const struct stat *st, checksum_type_t type, char *hex) {
+    size_t digest_len = checksum_digest_size(type);
+    int hit = 0;
+
+    if (digest_len == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+    if (!cache_map) {
+        pthread_mutex_unlock(&cache_mutex);
+        return 0;
+    }
+
+    size_t index = slot_index((uint64_t)st->st_dev, (uint64_t)st->st_ino, (uint8_t)type, cache_header->capacity);
+    while (cache_slots[index].state != 0) {
+        hash_cache_slot_t *slot = &cache_slots[index];
+
+        if (slot->dev == (uint64_t)st->st_dev && slot->inode == (uint64_t)st->st_ino &&
+            slot->algorithm == (uint8_t)type) {
+            if (slot->size == (uint64_t)st->st_size &&
+                slot->mtime_ns == timespec_ns(&st->st_mtim) &&
+                slot->ctime_ns == timespec_ns(&st->st_ctim) &&
+                slot->digest_len == digest_len && slot->check == slot_check(slot)) {
+                digest_to_hex(slot->digest, digest_len, hex);
+                slot->generation = (uint32_t)cache_header->generation;
+                hit = 1;
+            }
+            break;
+        }
+        index = (index + 1) & (cache_header->capacity - 1);
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.hash_cache_lookups++;
+    if (hit) g_stats.hash_cache_hits++;
+    pthread_mutex_unlock(&g_stats_mutex);
+
+    return hit;
+}
+
+// st 상태의 파일 내용 해시 기록 (같은 파일의 이전 항목은 덮어씀)
+void hash_cache_store(const struct stat *st, checksum_type_t type, const char *hex) {
+    size_t digest_len = checksum_digest_size(type);
+    hash_cache_slot_t entry;
+
+    memset(&entry, 0, sizeof(entry));
+    if (digest_len == 0 || digest_len > MAX_DIGEST_SIZE || !hex_to_digest(hex, entry.digest, digest_len)) {
+        return;
+    }
+
+    entry.dev = (uint64_t)st->st_dev;
+    entry.inode = (uint64_t)st->st_ino;
+    entry.size = (uint64_t)st->st_size;
+    entry.mtime_ns = timespec_ns(&st->st_mtim);
+    entry.ctime_ns = timespec_ns(&st->st_ctim);
+    entry.algorithm = (uint8_t)type;
+    entry.digest_len = (uint8_t)digest_len;
+    entry.state = 1;
+    entry.check = slot_check(&entry);
+
+    pthread_mutex_lock(&cache_mutex);
+    if (!cache_map) {
+        pthread_mutex_unlock(&cache_mutex);
+        return;
+    }
+
+    if ((cache_header->used + 1) * 4 > cache_header->capacity * 3 &&
+        rebuild_cache(cache_header->capacity * 2, 0) != SUCCESS) {
+        pthread_mutex_unlock(&cache_mutex);
+        return;
+    }
+
+    entry.generation = (uint32_t)cache_header->generation;
+
+    size_t index = slot_index(entry.dev, entry.inode, entry.algorithm, cache_header->capacity);
+    while (cache_slots[index].state != 0) {
+        const hash_cache_slot_t *slot = &cache_slots[index];
+
+        if (slot->dev == entry.dev && slot->inode == entry.inode && slot->algorithm == entry.algorithm) {
+            break;
+        }
+        index = (index + 1) & (cache_header->capacity - 1);
+    }
+
+    if (cache_slots[index].state == 0) {
+        cache_header->used++;
+    }
+    cache_slots[index] = entry;
+    pthread_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,377 @@
+#include "backup.h"
+
+// 백업 인덱스 (.backup_index)
+//
+// 백업 중 파일마다 한 줄씩 기록하고, 검증/복원 시 로드하여 경로 해시 테이블로 조회합니다.
+// 형식: <type>|<path>|<size>|<mtime>|<checksum>|<inode>|<origin>|<offset>
+// mtime은 "초.나노초", origin은 데이터가 다른 체인 백업에 있을 때 그 백업 이름입니다.
+// offset은 청크 저장소 파일('C')의 레시피 위치입니다 (chunkstore.c).
+// 디렉토리('D')는 mtime/inode에 디렉토리 자신의 값을, size에 ctime(ns), offset에 하위 트리 요약
+// (자식 메타데이터 머클 해시, backup.c)을 기록해 다음 증분 백업이 변경 없는 하위 트리를 건너뛰게 합니다.
+// 증분/차등 백업의 인덱스도 변경 없는 파일까지 모두 기록하므로 다음 백업의 기준이 됩니다.
+// 경로의 '%', '|', 줄바꿈은 %XX 로 이스케이프합니다. 예전 5/7필드 형식도 읽을 수 있습니다.
+// 같은 항목을 모아 닫을 때 .backup_manifest (manifest.c)도 만들고, 로드 시 매니페스트를 우선 사용합니다.
+
+static FILE *index_file = NULL;
+static char index_root[MAX_PATH];
+static size_t index_root_len = 0;
+static manifest_builder_t *index_manifest = NULL;
+static pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void write_escaped_path(FILE *file, const char *path) {
+    for (const char *p = path; *p; p++) {
+        if (*p == '%' || *p == '|' || *p == '\n') {
+            fprintf(file, "%%%02X", (unsigned char)*p);
+        } else {
+            fputc(*p, file);
+        }
+    }
+}
+
+static void unescape_path(char *path) {
+    char *src = path, *dst = path;
+
+    while (*src) {
+        unsigned int value;
+        if (src[0] == '%' && src[1] && src[2] && sscanf(src + 1, "%2X", &value) == 1) {
+            *dst++ = (char)value;
+            src += 3;
+        } else {
+            *dst++ = *src++;
+        }
+    }
+    *dst = '\0';
+}
+
+// 인덱스 쓰기 시작 (헤더에 체크섬 알고리즘, 압축 형식, 백업 모드와 기준 백업 기록)
+int backup_index_open(const char *backup_path, const backup_options_t *opts, const char *base) {
+    char path[MAX_PATH];
+
+    if (!backup_path || !opts) return ERROR_INVALID_PARAMS;
+
+    snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_INDEX_FILE);
+
+    pthread_mutex_lock(&index_mutex);
+    index_file = fopen(path, "w");
+    if (!index_file) {
+        pthread_mutex_unlock(&index_mutex);
+        log_error("백업 인덱스 파일 생성 실패: %s", path);
+        return ERROR_FILE_WRITE;
+    }
+
+    snprintf(index_root, sizeof(index_root), "%s", backup_path);
+    index_root_len = strlen(index_root);
+
+    index_manifest = manifest_builder_create(opts->calculate_checksum ? opts->checksum_algorithm : CHECKSUM_NONE,
+                                             opts->compression, base ? opts->mode : BACKUP_FULL, base);
+    if (!index_manifest) {
+        log_warning("매니페스트 없이 인덱스만 기록합니다: %s", backup_path);
+    } else if (memory_limit() > 0) {
+        manifest_builder_spill_to(index_manifest, backup_path);
+    }
+
+    fprintf(index_file, "# Backup Index File\n");
+    fprintf(index_file, "# Generated: %s", ctime(&g_stats.start_time));
+    fprintf(index_file, "# Format: <type>|<path>|<size>|<mtime>|<checksum>|<inode>|<origin>|<offset>\n");
+    fprintf(index_file, "# Checksum: %s\n",
+            opts->calculate_checksum ? get_checksum_name(opts->checksum_algorithm) : "none");
+    fprintf(index_file, "# Compression: %s\n", get_compression_extension(opts->compression));
+    fprintf(index_file, "# Mode: %s\n", get_backup_mode_name(base ? opts->mode : BACKUP_FULL));
+    if (base) {
+        fprintf(index_file, "# Base: %s\n", base);
+    }
+    pthread_mutex_unlock(&index_mutex);
+
+    log_debug("백업 인덱스 생성: %s", path);
+    return SUCCESS;
+}
+
+// 인덱스 루트 기준 상대 경로 (루트 자체나 루트 밖 경로는 NULL)
+static const char *relative_index_path(const char *path) {
+    if (index_root_len == 0 || strncmp(path, index_root, index_root_len) != 0) {
+        return NULL;
+    }
+    return path[index_root_len] == '/' ? path + index_root_len + 1 : NULL;
+}
+
+// 항목 기록 (path는 백업 대상 경로, 인덱스 루트 기준 상대 경로로 저장, entry->path는 무시)
+void backup_index_record(const char *path, const index_entry_t *entry) {
+    const char *rel;
+
+    pthread_mutex_lock(&index_mutex);
+    if (!index_file) {
+        pthread_mutex_unlock(&index_mutex);
+        return;
+    }
+
+    rel = relative_index_path(path);
+    if (!rel) {
+        if (strcmp(path, index_root) == 0) {
+            pthread_mutex_unlock(&index_mutex);
+            return; // 백업 루트 자체는 기록하지 않음
+        }
+        rel = path;
+    }
+
+    fprintf(index_file, "%c|", entry->type);
+    write_escaped_path(index_file, rel);
+    fprintf(index_file, "|%zu|%ld.%09ld|%s|%llu|%s|%llu\n", entry->size, (long)entry->mtime,
+            entry->mtime_nsec, entry->checksum, (unsigned long long)entry->inode, entry->origin,
+            (unsigned long long)entry->offset);
+
+    if (index_manifest && manifest_builder_add(index_manifest, rel, entry) != SUCCESS) {
+        log_warning("메모리 부족으로 매니페스트 기록을 중단합니다");
+        manifest_builder_free(index_manifest);
+        index_manifest = NULL;
+    }
+    pthread_mutex_unlock(&index_mutex);
+}
+
+// 기록 중인 매니페스트의 디렉토리 요약을 버림 (하위 트리 건너뛰기는 매니페스트가 있을 때만 하므로
+// 텍스트 인덱스의 offset 은 그대로 둠)
+void backup_index_drop_summaries(void) {
+    pthread_mutex_lock(&index_mutex);
+    if (index_manifest) {
+        manifest_builder_drop_summaries(index_manifest);
+    }
+    pthread_mutex_unlock(&index_mutex);
+}
+
+int backup_index_close(void) {
+    int result = SUCCESS;
+
+    pthread_mutex_lock(&index_mutex);
+    if (index_file) {
+        if (fclose(index_file) != 0) {
+            log_error("백업 인덱스 쓰기 실패: %s", index_root);
+            result = ERROR_FILE_WRITE;
+        }
+        index_file = NULL;
+
+        if (index_manifest && result == SUCCESS) {
+            result = manifest_builder_write(index_manifest, index_root);
+        }
+    }
+    manifest_builder_free(index_manifest);
+    index_manifest = NULL;
+    index_root_len = 0;
+    pthread_mutex_unlock(&index_mutex);
+
+    return result;
+}
+
+// FNV-1a 64비트 경로 해시
+static uint64_t hash_path(const char *path) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static int build_hash_table(backup_index_t *index) {
+    size_t slot_count = 16;
+
+    while (slot_count < index->count * 2) {
+        slot_count <<= 1;
+    }
+
+    index->slots = calloc(slot_count, sizeof(size_t));
+    if (!index->slots) {
+        return ERROR_MEMORY;
+    }
+    index->slot_count = slot_count;
+
+    // 같은 경로가 여러 번 기록되면 마지막 항목이 우선
+    for (size_t i = 0; i < index->count; i++) {
+        size_t slot = hash_path(index->entries[i].path) & (slot_count - 1);
+
+        while (index->slots[slot] != 0 &&
+               strcmp(index->entries[index->slots[slot] - 1].path, index->entries[i].path) != 0) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        index->slots[slot] = i + 1;
+    }
+
+    return SUCCESS;
+}
+
+static int parse_index_line(char *line, index_entry_t *entry) {
+    char *fields[8] = { NULL };
+    char *p = line;
+    char *end;
+    int count = 0;
+
+    while (count < 8) {
+        fields[count++] = p;
+        p = strchr(p, '|');
+        if (!p) break;
+        *p++ = '\0';
+    }
+
+    if ((count != 5 && count != 7 && count != 8) || strlen(fields[0]) != 1) return 0;
+
+    unescape_path(fields[1]);
+    memset(entry, 0, sizeof(*entry));
+    entry->type = fields[0][0];
+    entry->path = strdup(fields[1]);
+    entry->size = (size_t)strtoull(fields[2], NULL, 10);
+    entry->mtime = (time_t)strtoll(fields[3], &end, 10);
+    if (*end == '.') {
+        entry->mtime_nsec = strtol(end + 1, NULL, 10);
+    }
+    snprintf(entry->checksum, sizeof(entry->checksum), "%s", fields[4]);
+    if (count >= 7) {
+        entry->inode = strtoull(fields[5], NULL, 10);
+        snprintf(entry->origin, sizeof(entry->origin), "%s", fields[6]);
+    }
+    if (count == 8) {
+        entry->offset = strtoull(fields[7], NULL, 10);
+    }
+
+    return entry->path != NULL;
+}
+
+int backup_index_load(const char *backup_path, backup_index_t *index) {
+    char path[MAX_PATH];
+    char line[MAX_PATH + 256];
+    FILE *file;
+
+    if (!backup_path || !index) return ERROR_INVALID_PARAMS;
+
+    // 매니페스트가 있으면 파싱 없이 mmap 으로 조회
+    if (manifest_open(backup_path, index) == SUCCESS) {
+        return SUCCESS;
+    }
+
+    memset(index, 0, sizeof(*index));
+    snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_INDEX_FILE);
+
+    file = fopen(path, "r");
+    if (!file) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\n")] = '\0';
+
+        if (line[0] == '#') {
+            if (strncmp(line, "# Checksum: ", 12) == 0) {
+                index->checksum_type = parse_checksum_type(line + 12);
+            } else if (strncmp(line, "# Compression: ", 15) == 0) {
+                index->compression = line[15] ? get_compression_type(line + 15) : COMPRESS_NONE;
+            } else if (strncmp(line, "# Mode: ", 8) == 0) {
+                index->mode = parse_backup_mode(line + 8);
+            } else if (strncmp(line, "# Base: ", 8) == 0 &&
+                       (size_t)snprintf(index->base, sizeof(index->base), "%s", line + 8) >= sizeof(index->base)) {
+                // 잘린 이름은 체인의 다른 백업을 가리킬 수 있음
+                log_error("인덱스의 기준 백업 이름이 너무 깁니다: %s", path);
+                fclose(file);
+                backup_index_free(index);
+                return ERROR_INVALID_PARAMS;
+            }
+            continue;
+        }
+
+        if (index->count == index->capacity) {
+            size_t new_capacity = index->capacity ? index->capacity * 2 : 1024;
+            index_entry_t *grown = realloc(index->entries, new_capacity * sizeof(index_entry_t));
+            if (!grown) {
+                fclose(file);
+                backup_index_free(index);
+                return ERROR_MEMORY;
+            }
+            index->entries = grown;
+            index->capacity = new_capacity;
+        }
+
+        if (parse_index_line(line, &index->entries[index->count])) {
+            index->entries[index->count].codec = (uint8_t)index->compression;
+            index->count++;
+        } else {
+            log_warning("잘못된 인덱스 항목 무시: %s", line);
+        }
+    }
+    fclose(file);
+
+    if (build_hash_table(index) != SUCCESS) {
+        backup_index_free(index);
+        return ERROR_MEMORY;
+    }
+
+    log_debug("백업 인덱스 로드: %s (%zu개 항목)", path, index->count);
+    return SUCCESS;
+}
+
+// 경로로 항목 조회 (찾으면 1, entry->path는 매니페스트 조회 시 NULL)
+int backup_index_lookup(const backup_index_t *index, const char *path, index_entry_t *entry) {
+    size_t slot;
+
+    if (!index || !path) return 0;
+
+    if (index->map) {
+        return manifest_find(index, path, entry);
+    }
+
+    if (!index->slots) return 0;
+
+    slot = hash_path(path) & (index->slot_count - 1);
+    while (index->slots[slot] != 0) {
+        const index_entry_t *found = &index->entries[index->slots[slot] - 1];
+        if (strcmp(found->path, path) == 0) {
+            *entry = *found;
+            return 1;
+        }
+        slot = (slot + 1) & (index->slot_count - 1);
+    }
+
+    return 0;
+}
+
+// pos번째 항목 (경로는 path 버퍼에 복사되고 entry->path가 이를 가리킴)
+int backup_index_get(const backup_index_t *index, size_t pos, index_entry_t *entry, char *path, size_t size) {
+    if (!index || pos >= index->count) return 0;
+
+    if (index->map) {
+        return manifest_get(index, pos, entry, path, size);
+    }
+
+    *entry = index->entries[pos];
+    snprintf(path, size, "%s", index->entries[pos].path);
+    entry->path = path;
+    return 1;
+}
+
+// dir 아래 항목 전체의 위치 범위 [*first, *last) (경로순으로 정렬된 매니페스트에서만 가능, 아니면 0)
+int backup_index_subtree(const backup_index_t *index, const char *dir, size_t *first, size_t *last) {
+    char key[MAX_PATH];
+    int len;
+
+    if (!index || !index->map) return 0;
+
+    // "dir/" 로 시작하는 경로는 "dir/" 이상 "dir0" 미만 ('0' = '/' + 1)
+    len = snprintf(key, sizeof(key), "%s/", dir);
+    if (len < 0 || (size_t)len >= sizeof(key)) return 0;
+    *first = manifest_lower_bound(index, key);
+    key[len - 1] = '0';
+    *last = manifest_lower_bound(index, key);
+    return *first <= *last;
+}
+
+void backup_index_free(backup_index_t *index) {
+    if (!index) return;
+
+    if (index->map) {
+        manifest_close(index);
+        return;
+    }
+
+    for (size_t i = 0; i < index->count; i++) {
+        free(index->entries[i].path);
+    }
+    free(index->entries);
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
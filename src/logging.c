@@ -1,14 +1,276 @@
 #include "backup.h"
 
+// 비동기 로깅
+// log_* 는 레벨이 꺼져 있으면 형식화하지 않고 돌아가고, 켜져 있으면 메시지를 한 번만 형식화해
+// 잠금 없는 MPSC 링(LOG_RING_SIZE 칸, 칸마다 순번)에 넣음. 쓰기 스레드가 시각을 붙여 모아서
+// stderr/로그 파일에 쓰고 한 묶음에 한 번 fflush. 링이 가득 차면 기본은 빈 칸이 날 때까지
+// 기다리고, log_overflow=drop 이면 버린 개수만 세었다가 경고 한 줄로 남김.
+// init_logging 이전/cleanup_logging 이후와 쓰기 스레드를 만들 수 없을 때는 바로 씀.
+
+#define LOG_RING_SIZE 1024                // 2의 거듭제곱
+#define LOG_MESSAGE_MAX 1024
+#define LOG_BATCH_SIZE 64                 // 이만큼 쓰면 한 번 flush
+#define LOG_IDLE_WAIT_MS 100
+
+typedef struct {
+    size_t seq;                           // 칸 순번 (== 위치: 빈 칸, == 위치 + 1: 채워짐)
+    time_t time;
+    log_level_t level;
+    char message[LOG_MESSAGE_MAX];
+} log_record_t;
+
 static FILE *log_file = NULL;
 static log_level_t current_log_level = LOG_INFO;
 static int log_to_console = 1;
 static int log_to_file = 0;
+static int console_is_tty = 0;
+static int drop_when_full = 0;
+
+static log_record_t *ring = NULL;
+static size_t enqueue_pos = 0;            // 생산자들이 CAS 로 전진
+static size_t dequeue_pos = 0;            // 쓰기 스레드만 사용
+static size_t dropped = 0;
+static size_t error_count = 0;            // 레벨과 상관없이 센 ERROR/WARNING 수 (성능 지표용)
+static size_t warning_count = 0;
+static int async_running = 0;
+static int writer_stop = 0;
+static int writer_waiting = 0;
+static pthread_t writer_thread;
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t drained_cond = PTHREAD_COND_INITIALIZER;
+
+static const char *level_names[] = {"ERROR", "WARNING", "INFO", "DEBUG"};
+static const char *level_colors[] = {
+    "\033[31m", // 빨간색 (ERROR)
+    "\033[33m", // 노란색 (WARNING)
+    "\033[32m", // 초록색 (INFO)
+    "\033[36m"  // 청록색 (DEBUG)
+};
+
+// 레코드 한 줄 쓰기 (g_log_mutex 보유, flush 는 호출자)
+static void write_record(time_t when, log_level_t level, const char *message) {
+    static time_t cached_time = (time_t)-1;
+    static char time_str[64];
+
+    // 시각 문자열은 초가 바뀔 때만 다시 만듦
+    if (when != cached_time) {
+        struct tm tm_info;
+        localtime_r(&when, &tm_info);
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm_info);
+        cached_time = when;
+    }
+
+    // 콘솔 출력 (터미널이면 색상, 파이프나 리다이렉션이면 색상 없이)
+    if (log_to_console || level <= LOG_WARNING) {
+        if (console_is_tty) {
+            fprintf(stderr, "[%s] %s%s\033[0m: %s\n", time_str, level_colors[level], level_names[level], message);
+        } else {
+            fprintf(stderr, "[%s] %s: %s\n", time_str, level_names[level], message);
+        }
+    }
+
+    // 파일 출력
+    if (log_to_file && log_file) {
+        fprintf(log_file, "[%s] %s: %s\n", time_str, level_names[level], message);
+    }
+}
+
+static void flush_outputs(void) {
+    fflush(stderr);
+    if (log_to_file && log_file) {
+        fflush(log_file);
+    }
+}
+
+static void report_dropped(void) {
+    size_t count = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+    char message[128];
+
+    if (count > 0) {
+        snprintf(message, sizeof(message), "로그 링이 가득 차 메시지 %zu개를 버렸습니다", count);
+        write_record(time(NULL), LOG_WARNING, message);
+    }
+}
+
+// 링이 비어 있으면 1 (쓰기 스레드 전용)
+static int ring_empty(void) {
+    log_record_t *rec = &ring[dequeue_pos & (LOG_RING_SIZE - 1)];
+    return __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != dequeue_pos + 1;
+}
+
+static void *log_writer(void *arg) {
+    (void)arg;
+
+    for (;;) {
+        int written = 0;
+
+        // 채워진 칸을 순서대로 비우며 묶음 단위로 씀
+        pthread_mutex_lock(&g_log_mutex);
+        while (!ring_empty()) {
+            log_record_t *rec = &ring[dequeue_pos & (LOG_RING_SIZE - 1)];
+
+            write_record(rec->time, rec->level, rec->message);
+            __atomic_store_n(&rec->seq, dequeue_pos + LOG_RING_SIZE, __ATOMIC_RELEASE);
+            __atomic_store_n(&dequeue_pos, dequeue_pos + 1, __ATOMIC_RELEASE);
+            if (++written % LOG_BATCH_SIZE == 0) {
+                flush_outputs();
+            }
+        }
+        report_dropped();
+        flush_outputs();
+        pthread_mutex_unlock(&g_log_mutex);
+
+        // 비었으면 생산자가 깨울 때까지 대기 (놓친 신호에 대비해 시간 제한)
+        pthread_mutex_lock(&writer_mutex);
+        pthread_cond_broadcast(&drained_cond);
+        __atomic_store_n(&writer_waiting, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (ring_empty()) {
+            if (__atomic_load_n(&writer_stop, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&writer_waiting, 0, __ATOMIC_SEQ_CST);
+                pthread_mutex_unlock(&writer_mutex);
+                break;
+            }
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += LOG_IDLE_WAIT_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&writer_cond, &writer_mutex, &deadline);
+        }
+        __atomic_store_n(&writer_waiting, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&writer_mutex);
+    }
+    return NULL;
+}
+
+static void wake_writer(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&writer_waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&writer_mutex);
+        pthread_cond_signal(&writer_cond);
+        pthread_mutex_unlock(&writer_mutex);
+    }
+}
+
+// 빈 칸을 차지함 (가득 차면 NULL)
+static log_record_t *ring_claim(size_t *pos_out) {
+    size_t pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+
+    for (;;) {
+        log_record_t *rec = &ring[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos_out = pos;
+                return rec;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// 쓰기 스레드 없이 바로 기록 (시작 전, 멈춘 뒤)
+static void write_sync(log_level_t level, const char *format, va_list args) {
+    char message[LOG_MESSAGE_MAX];
+
+    vsnprintf(message, sizeof(message), format, args);
+    pthread_mutex_lock(&g_log_mutex);
+    write_record(time(NULL), level, message);
+    flush_outputs();
+    pthread_mutex_unlock(&g_log_mutex);
+}
+
+static void log_va(log_level_t level, const char *format, va_list args) {
+    log_record_t *rec;
+    size_t pos;
+
+    if (level == LOG_ERROR) {
+        __atomic_fetch_add(&error_count, 1, __ATOMIC_RELAXED);
+    } else if (level == LOG_WARNING) {
+        __atomic_fetch_add(&warning_count, 1, __ATOMIC_RELAXED);
+    }
+
+    // 로그 레벨 확인 (꺼진 레벨은 형식화하지 않음)
+    if (level > current_log_level) {
+        return;
+    }
+
+    if (!__atomic_load_n(&async_running, __ATOMIC_ACQUIRE)) {
+        write_sync(level, format, args);
+        return;
+    }
+
+    while ((rec = ring_claim(&pos)) == NULL) {
+        if (drop_when_full) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        // 기다리는 사이 쓰기 스레드가 멈췄으면 (stop_writer, atexit) 링이 다시 비지 않음
+        if (!__atomic_load_n(&async_running, __ATOMIC_ACQUIRE)) {
+            write_sync(level, format, args);
+            return;
+        }
+        wake_writer();
+        sched_yield();
+    }
+
+    rec->time = time(NULL);
+    rec->level = level;
+    vsnprintf(rec->message, sizeof(rec->message), format, args);
+    __atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+    wake_writer();
+}
+
+// 쓰기 스레드 멈춤 (남은 레코드를 모두 쓴 뒤, 여러 번 불러도 됨)
+// 링은 해제하지 않음: 멈추는 순간 칸을 차지한 생산자가 있어도 잘못된 메모리를 쓰지 않도록
+static void stop_writer(void) {
+    if (!__atomic_exchange_n(&async_running, 0, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    __atomic_store_n(&writer_stop, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&writer_mutex);
+    pthread_cond_signal(&writer_cond);
+    pthread_mutex_unlock(&writer_mutex);
+    pthread_join(writer_thread, NULL);
+}
+
+static void start_writer(void) {
+    if (!ring) {
+        ring = malloc(LOG_RING_SIZE * sizeof(log_record_t));
+    }
+    if (!ring) {
+        return;
+    }
+    for (size_t i = 0; i < LOG_RING_SIZE; i++) {
+        ring[i].seq = i;
+    }
+    enqueue_pos = 0;
+    dequeue_pos = 0;
+    writer_stop = 0;
+
+    if (pthread_create(&writer_thread, NULL, log_writer, NULL) != 0) {
+        return;
+    }
+    __atomic_store_n(&async_running, 1, __ATOMIC_RELEASE);
+    atexit(stop_writer); // exit() 로 끝나도 남은 로그를 씀
+}
 
 void init_logging(const backup_options_t *opts) {
     if (!opts) return;
     
     current_log_level = opts->log_level;
+    drop_when_full = opts->log_drop;
+    console_is_tty = isatty(STDERR_FILENO);
     
     // 로그 파일 설정
     if (strlen(opts->log_file) > 0) {
@@ -26,12 +288,40 @@ void init_logging(const backup_options_t *opts) {
         log_to_console = 0;
     }
     
-    log_debug("로깅 시스템 초기화 완료 (레벨: %d)", current_log_level);
+    if (!async_running) {
+        start_writer();
+    }
+    
+    log_debug("로깅 시스템 초기화 완료 (레벨: %d, %s)", current_log_level,
+              async_running ? "비동기" : "동기");
+}
+
+// 지금까지 넣은 로그가 모두 쓰일 때까지 대기 (요약 출력 전 등)
+void log_flush(void) {
+    if (!__atomic_load_n(&async_running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    size_t target = __atomic_load_n(&enqueue_pos, __ATOMIC_ACQUIRE);
+
+    pthread_mutex_lock(&writer_mutex);
+    while (__atomic_load_n(&dequeue_pos, __ATOMIC_ACQUIRE) < target) {
+        pthread_cond_signal(&writer_cond);
+        pthread_cond_wait(&drained_cond, &writer_mutex);
+    }
+    pthread_mutex_unlock(&writer_mutex);
+}
+
+void log_counts(size_t *errors, size_t *warnings) {
+    *errors = __atomic_load_n(&error_count, __ATOMIC_RELAXED);
+    *warnings = __atomic_load_n(&warning_count, __ATOMIC_RELAXED);
 }
 
 void cleanup_logging(void) {
     if (log_file) {
         log_info("로깅 시스템 종료");
+    }
+    stop_writer();
+    if (log_file) {
         fclose(log_file);
         log_file = NULL;
     }
@@ -40,106 +330,42 @@ void cleanup_logging(void) {
 
 void log_message(log_level_t level, const char *format, ...) {
     va_list args;
-    time_t now;
-    struct tm *tm_info;
-    char time_str[64];
-    char message[1024];
     
-    // 로그 레벨 확인
-    if (level > current_log_level) {
-        return;
-    }
-    
-    // 시간 문자열 생성
-    time(&now);
-    tm_info = localtime(&now);
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
-    
-    // 메시지 생성
     va_start(args, format);
-    vsnprintf(message, sizeof(message), format, args);
+    log_va(level, format, args);
     va_end(args);
-    
-    // 레벨별 문자열
-    const char *level_names[] = {"ERROR", "WARNING", "INFO", "DEBUG"};
-    const char *level_colors[] = {
-        "\033[31m", // 빨간색 (ERROR)
-        "\033[33m", // 노란색 (WARNING)
-        "\033[32m", // 초록색 (INFO)
-        "\033[36m"  // 청록색 (DEBUG)
-    };
-    const char *reset_color = "\033[0m";
-    
-    // 스레드 안전성을 위한 뮤텍스 잠금
-    pthread_mutex_lock(&g_log_mutex);
-    
-    // 콘솔 출력
-    if (log_to_console || level <= LOG_WARNING) {
-        if (isatty(STDERR_FILENO)) {
-            // 터미널인 경우 색상 출력
-            fprintf(stderr, "[%s] %s%s%s: %s\n", 
-                   time_str, level_colors[level], level_names[level], 
-                   reset_color, message);
-        } else {
-            // 파이프나 리다이렉션인 경우 색상 없이
-            fprintf(stderr, "[%s] %s: %s\n", 
-                   time_str, level_names[level], message);
-        }
-        fflush(stderr);
-    }
-    
-    // 파일 출력
-    if (log_to_file && log_file) {
-        fprintf(log_file, "[%s] %s: %s\n", 
-               time_str, level_names[level], message);
-        fflush(log_file);
-    }
-    
-    pthread_mutex_unlock(&g_log_mutex);
 }
 
 void log_error(const char *format, ...) {
     va_list args;
-    char message[1024];
     
     va_start(args, format);
-    vsnprintf(message, sizeof(message), format, args);
+    log_va(LOG_ERROR, format, args);
     va_end(args);
-    
-    log_message(LOG_ERROR, "%s", message);
 }
 
 void log_warning(const char *format, ...) {
     va_list args;
-    char message[1024];
     
     va_start(args, format);
-    vsnprintf(message, sizeof(message), format, args);
+    log_va(LOG_WARNING, format, args);
     va_end(args);
-    
-    log_message(LOG_WARNING, "%s", message);
 }
 
 void log_info(const char *format, ...) {
     va_list args;
-    char message[1024];
     
     va_start(args, format);
-    vsnprintf(message, sizeof(message), format, args);
+    log_va(LOG_INFO, format, args);
     va_end(args);
-    
-    log_message(LOG_INFO, "%s", message);
 }
 
 void log_debug(const char *format, ...) {
     va_list args;
-    char message[1024];
     
     va_start(args, format);
-    vsnprintf(message, sizeof(message), format, args);
+    log_va(LOG_DEBUG, format, args);
     va_end(args);
-    
-    log_message(LOG_DEBUG, "%s", message);
 }
 
 // 진행률 관련 함수들
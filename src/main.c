@@ -37,7 +37,8 @@ int list_backup_contents(const char *backup_path, const backup_options_t *opts)
         size_t total_size = 0;
         
         while ((entry = readdir(dir)) != NULL) {
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 ||
+                is_backup_internal_file(entry->d_name)) {
                 continue;
             }
             
@@ -99,66 +100,69 @@ int verify_backup(const char *backup_path, const backup_options_t *opts) {
         // 디렉토리 백업 검증
         printf("\n=== 디렉토리 백업 검증 ===\n");
         
-        DIR *dir = opendir(backup_path);
-        if (!dir) {
+        // 하위 디렉토리까지 한 번에 순회 (walk.c, 재귀 없음)
+        dir_walk_t walk;
+        if (walk_init(&walk, backup_path, NULL, 0) != SUCCESS || walk_enter(&walk) != SUCCESS) {
             printf("오류: 디렉토리를 열 수 없습니다: %s\n", backup_path);
+            walk_free(&walk);
             return ERROR_FILE_OPEN;
         }
         
-        struct dirent *entry;
+        const char *name;
         int file_count = 0, dir_count = 0, issues = 0;
         size_t total_size = 0;
         
-        while ((entry = readdir(dir)) != NULL) {
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+        while (walk.depth > 0) {
+            if (!(name = walk_next(&walk))) {
+                walk_leave(&walk);
+                continue;
+            }
+            if (is_backup_internal_file(name)) {
                 continue;
             }
             
-            char full_path[MAX_PATH];
-            snprintf(full_path, sizeof(full_path), "%s/%s", backup_path, entry->d_name);
-            
+            const char *rel = walk_rel(&walk);
             struct stat st;
-            if (stat(full_path, &st) != 0) {
-                printf("❌ 파일 정보 읽기 실패: %s\n", entry->d_name);
+            if (stat(walk.src.buf, &st) != 0) {
+                printf("❌ 파일 정보 읽기 실패: %s\n", rel);
                 issues++;
                 continue;
             }
             
             if (S_ISDIR(st.st_mode)) {
-                printf("📁 %s/ (디렉토리)\n", entry->d_name);
+                printf("📁 %s/ (디렉토리)\n", rel);
                 dir_count++;
                 
-                // 재귀적으로 하위 디렉토리 검증
-                int sub_result = verify_backup(full_path, opts);
-                if (sub_result != SUCCESS) {
+                if (walk_enter(&walk) != SUCCESS) {
+                    printf("❌ 디렉토리 열기 실패: %s\n", rel);
                     issues++;
                 }
             } else if (S_ISREG(st.st_mode)) {
                 // 압축 파일 검증
-                compression_type_t comp_type = get_compression_type(entry->d_name);
+                compression_type_t comp_type = get_compression_type(name);
                 if (comp_type != COMPRESS_NONE) {
-                    printf("📦 %s (%ld bytes, %s)\n", entry->d_name, st.st_size,
+                    printf("📦 %s (%ld bytes, %s)\n", rel, st.st_size,
                            comp_type == COMPRESS_GZIP ? "gzip" :
                            comp_type == COMPRESS_ZLIB ? "zlib" :
                            comp_type == COMPRESS_LZ4 ? "lz4" : "unknown");
                 } else {
-                    printf("📄 %s (%ld bytes)\n", entry->d_name, st.st_size);
+                    printf("📄 %s (%ld bytes)\n", rel, st.st_size);
                 }
                 
                 file_count++;
                 total_size += st.st_size;
                 
                 // 파일 읽기 테스트
-                FILE *test_file = fopen(full_path, "rb");
+                FILE *test_file = fopen(walk.src.buf, "rb");
                 if (!test_file) {
-                    printf("❌ 파일 읽기 실패: %s\n", entry->d_name);
+                    printf("❌ 파일 읽기 실패: %s\n", rel);
                     issues++;
                 } else {
                     fclose(test_file);
                 }
             }
         }
-        closedir(dir);
+        walk_free(&walk);
         
         printf("\n검증 결과:\n");
         printf("- 파일: %d개\n", file_count);
@@ -239,9 +243,13 @@ void print_usage(const char *prog) {
     printf("  %s <명령어> [옵션] <소스> <대상>\n\n", prog);
     printf("명령어:\n");
     printf("  backup                      파일/디렉토리 백업\n");
+    printf("  watch                       소스 변경을 감시하며 주기마다 체인에 증분 백업\n");
+    printf("  consolidate                 체인(전체 + 증분)으로 새 전체 백업을 백업 쪽에서만 합성\n");
     printf("  restore                     파일/디렉토리 복원\n");
     printf("  verify                      백업 검증\n");
     printf("  list                        백업 내용 목록\n");
+    printf("  compress-bench              트리 샘플로 코덱/레벨/스레드 추천\n");
+    printf("  hash-bench                  체크섬 알고리즘별 처리량 측정\n");
     printf("  version                     버전 정보\n");
     printf("  help                        도움말\n\n");
     printf("옵션:\n");
@@ -249,8 +257,15 @@ void print_usage(const char *prog) {
     printf("  -v, --verbose               상세 출력\n");
     printf("  -p, --progress              진행률 표시\n");
     printf("  -c, --compression=TYPE      압축 (none, gzip, zlib, lz4)\n");
+    printf("  -l, --level=N               압축 레벨 (1-9, 기본: 9)\n");
     printf("  -m, --mode=MODE             백업 모드 (full, incremental, differential)\n");
+    printf("                              증분/차등은 <대상>/full 체인에 incr-/diff-<시각> 으로 기록\n");
     printf("  -x, --exclude=PATTERN       제외 패턴\n");
+    printf("  --exclude-dir=PATTERN       디렉토리를 열지 않고 하위 트리째 제외 (/proc, build/cache, node_modules)\n");
+    printf("  --exclude-system-dirs       /proc, /sys, /dev, /run 제외\n");
+    printf("  --ignore-file=NAME          디렉토리별 제외 파일 이름 (기본: %s, none = 사용 안 함)\n", DEFAULT_IGNORE_FILE);
+    printf("  --memory-limit=SIZE         메모리 예산 (예: 512M, 4G). 넘칠 만큼 큰 목록은 백업 디렉토리에 내보냄\n");
+    printf("  --huge-pages                입출력 버퍼 풀에 huge page 요청 (MADV_HUGEPAGE)\n");
     printf("  -j, --jobs=N                병렬 처리 스레드 수 (기본: %d)\n", MAX_THREADS);
     printf("  --verify                    백업 후 검증\n");
     printf("  --preserve-permissions      권한 보존\n");
@@ -260,13 +275,37 @@ void print_usage(const char *prog) {
     printf("  --config=FILE               설정 파일\n");
     printf("  --log=FILE                  로그 파일\n");
     printf("  --log-level=LEVEL           로그 레벨 (error, warning, info, debug)\n");
-    printf("  --max-size=SIZE             최대 파일 크기 (바이트)\n\n");
+    printf("  --stats-file=FILE           끝날 때 성능 지표를 FILE (JSON) 과 .prom (Prometheus) 에 기록\n");
+    printf("  --log-overflow=MODE         로그가 쓰는 속도보다 빨리 쌓일 때 (block: 기다림 (기본), drop: 버림)\n");
+    printf("  --max-size=SIZE             최대 파일 크기 (바이트)\n");
+    printf("  --deflate-backend=NAME      deflate 구현 (auto, zlib, libdeflate)\n");
+    printf("  --write-config=FILE         compress-bench 추천 결과를 설정 파일에 기록\n");
+    printf("  --checksum[=ALG]            백업 중 체크섬 계산 (xxh3, blake3, md5, sha1, sha256, crc32, none)\n");
+    printf("  --dedup                     내용 정의 청킹으로 중복 청크를 한 번만 저장\n");
+    printf("  --chunk-store=DIR           청크 저장소 경로 (기본: 백업 디렉토리 상위의 .chunks)\n");
+    printf("  --delta                     증분/차등 백업에서 변경된 큰 파일을 이전 버전 대비 델타로 저장\n");
+    printf("  --hash-cache=FILE           영구 해시 캐시 파일 (기본: ~/.cache/backup-utility/hashes.cache, none = 끔)\n");
+    printf("  --skip-subtrees[=MODE]      증분/차등 백업에서 디렉토리 시간이 같은 하위 트리를 stat 없이 이어받음\n");
+    printf("                              (sample: 일부를 실제로 검사 (기본), trust: 검사 없음, off)\n");
+    printf("  --skip-sample=PERCENT       sample 모드에서 검사할 하위 트리 비율 (기본: 5)\n");
+    printf("  --watch-interval=SEC        watch 모드의 백업 주기 (기본: %d초)\n", WATCH_DEFAULT_INTERVAL);
+    printf("  --link-dest=DIR             전체 백업에서 변경 없는 파일을 이전 스냅샷 DIR 에서 하드 링크\n");
+    printf("  --as-of=WHEN                체인을 WHEN 시점(백업 이름 또는 \"2026-10-19 14:30\" 같은 시각)으로 복원/합성\n\n");
     printf("예시:\n");
     printf("  %s backup -rv /home/user /backup/user\n", prog);
     printf("  %s backup -c gzip --verify file.txt backup.txt.gz\n", prog);
+    printf("  %s backup -r /home/user /backup/user/full\n", prog);
+    printf("  %s backup -r -m incremental /home/user /backup/user\n", prog);
+    printf("  %s backup -r -m incremental --delta /var/lib/vm /backup/vm\n", prog);
+    printf("  %s backup -r --dedup /var/lib/images /backup/images/20261019\n", prog);
+    printf("  %s watch --watch-interval=120 /srv/projects /backup/projects\n", prog);
+    printf("  %s backup -r --link-dest=/backup/home/20261018 /home /backup/home/20261019\n", prog);
     printf("  %s restore /backup/user /home/user\n", prog);
+    printf("  %s restore --as-of=2026-10-13 /backup/user /tmp/user-tuesday\n", prog);
+    printf("  %s consolidate -j 8 /backup/user /backup/user-2026w43/full\n", prog);
     printf("  %s verify /backup/user\n", prog);
     printf("  %s list /backup/user\n", prog);
+    printf("  %s compress-bench --write-config=backup.conf /home/user\n", prog);
 }
 
 void print_version(void) {
@@ -275,6 +314,12 @@ void print_version(void) {
     printf("컴파일러: GCC %s\n", __VERSION__);
     printf("최대 병렬 스레드: %d\n", MAX_THREADS);
     printf("지원 압축: gzip, zlib, lz4\n");
+#ifdef HAVE_LIBDEFLATE
+    printf("deflate 백엔드: zlib %s, libdeflate\n", zlibVersion());
+#else
+    printf("deflate 백엔드: zlib %s\n", zlibVersion());
+#endif
+    printf("체크섬: blake3 (%s), xxh3, md5, sha1, sha256, crc32\n", blake3_implementation());
     printf("버퍼 크기: %d bytes\n", BUFFER_SIZE);
 }
 
@@ -286,6 +331,21 @@ compression_type_t parse_compression_type(const char *str) {
     return COMPRESS_NONE;
 }
 
+backup_mode_t parse_backup_mode(const char *str) {
+    if (!str || strcmp(str, "full") == 0) return BACKUP_FULL;
+    if (strcmp(str, "incremental") == 0) return BACKUP_INCREMENTAL;
+    if (strcmp(str, "differential") == 0) return BACKUP_DIFFERENTIAL;
+    return BACKUP_FULL;
+}
+
+const char *get_backup_mode_name(backup_mode_t mode) {
+    switch (mode) {
+        case BACKUP_INCREMENTAL: return "incremental";
+        case BACKUP_DIFFERENTIAL: return "differential";
+        default: return "full";
+    }
+}
+
 conflict_mode_t parse_conflict_mode(const char *str) {
     if (!str || strcmp(str, "ask") == 0) return CONFLICT_ASK;
     if (strcmp(str, "overwrite") == 0) return CONFLICT_OVERWRITE;
@@ -294,6 +354,15 @@ conflict_mode_t parse_conflict_mode(const char *str) {
     return CONFLICT_ASK;
 }
 
+// 값 없이 켜면 안전한 표본 모드
+subtree_skip_t parse_subtree_skip(const char *str) {
+    if (!str || strcmp(str, "sample") == 0 || strcmp(str, "true") == 0 || strcmp(str, "1") == 0) {
+        return SUBTREE_SKIP_SAMPLE;
+    }
+    if (strcmp(str, "trust") == 0) return SUBTREE_SKIP_TRUST;
+    return SUBTREE_SKIP_OFF;
+}
+
 log_level_t parse_log_level(const char *str) {
     if (!str || strcmp(str, "error") == 0) return LOG_ERROR;
     if (strcmp(str, "warning") == 0) return LOG_WARNING;
@@ -302,6 +371,49 @@ log_level_t parse_log_level(const char *str) {
     return LOG_INFO;
 }
 
+// "512M", "4G", "65536" 같은 크기 (K/M/G/T 는 1024 단위, 잘못된 값이면 0)
+static size_t parse_memory_size(const char *str) {
+    char *end;
+    unsigned long long value = strtoull(str, &end, 10);
+
+    if (end == str) return 0;
+    switch (toupper((unsigned char)*end)) {
+        case 'T': value <<= 10; /* fall through */
+        case 'G': value <<= 10; /* fall through */
+        case 'M': value <<= 10; /* fall through */
+        case 'K': value <<= 10; end++; break;
+        case '\0': break;
+        default: return 0;
+    }
+    if (toupper((unsigned char)*end) == 'B') end++;
+    return *end == '\0' ? (size_t)value : 0;
+}
+
+// 쉼표로 구분한 디렉토리 패턴 추가 (앞뒤 공백, 끝의 / 제거)
+static void add_exclude_dirs(backup_options_t *opts, const char *list) {
+    const char *p = list;
+
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        const char *start = p;
+
+        p += len;
+        if (*p == ',') p++;
+
+        while (len > 0 && isspace((unsigned char)*start)) { start++; len--; }
+        while (len > 0 && isspace((unsigned char)start[len - 1])) len--;
+        while (len > 1 && start[len - 1] == '/') len--;
+        if (len == 0 || len >= sizeof(opts->exclude_dirs[0])) continue;
+        if (opts->exclude_dir_count >= MAX_EXCLUDE_DIRS) {
+            log_warning("제외 디렉토리 패턴이 너무 많습니다 (최대 %d개)", MAX_EXCLUDE_DIRS);
+            return;
+        }
+        memcpy(opts->exclude_dirs[opts->exclude_dir_count], start, len);
+        opts->exclude_dirs[opts->exclude_dir_count][len] = '\0';
+        opts->exclude_dir_count++;
+    }
+}
+
 int load_config_file(const char *config_file, backup_options_t *opts) {
     FILE *file;
     char line[1024];
@@ -328,14 +440,74 @@ int load_config_file(const char *config_file, backup_options_t *opts) {
                 opts->verbose = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
             } else if (strcmp(key, "verify") == 0) {
                 opts->verify = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
-            } else if (strcmp(key, "threads") == 0) {
+            } else if (strcmp(key, "compression_level") == 0) {
+                opts->compression_level = atoi(value);
+                if (opts->compression_level < 1) opts->compression_level = 1;
+                if (opts->compression_level > 9) opts->compression_level = 9;
+            } else if (strcmp(key, "threads") == 0 || strcmp(key, "num_threads") == 0) {
                 opts->threads = atoi(value);
+                if (opts->threads == 0) opts->threads = (int)sysconf(_SC_NPROCESSORS_ONLN); // 0 = CPU 코어 수
                 if (opts->threads < 1) opts->threads = 1;
                 if (opts->threads > MAX_THREADS) opts->threads = MAX_THREADS;
             } else if (strcmp(key, "log_file") == 0) {
                 strncpy(opts->log_file, value, sizeof(opts->log_file) - 1);
             } else if (strcmp(key, "log_level") == 0) {
                 opts->log_level = parse_log_level(value);
+            } else if (strcmp(key, "save_statistics") == 0) {
+                opts->save_statistics = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "statistics_file") == 0) {
+                strncpy(opts->statistics_file, value, sizeof(opts->statistics_file) - 1);
+            } else if (strcmp(key, "log_overflow") == 0) {
+                opts->log_drop = (strcmp(value, "drop") == 0);
+            } else if (strcmp(key, "calculate_checksum") == 0) {
+                opts->calculate_checksum = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "checksum_algorithm") == 0) {
+                opts->checksum_algorithm = parse_checksum_type(value);
+                if (opts->checksum_algorithm == CHECKSUM_NONE) opts->calculate_checksum = 0;
+            } else if (strcmp(key, "backup_mode") == 0) {
+                opts->mode = parse_backup_mode(value);
+            } else if (strcmp(key, "dedup") == 0) {
+                opts->dedup = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "hash_cache") == 0) {
+                strncpy(opts->hash_cache, value, sizeof(opts->hash_cache) - 1);
+            } else if (strcmp(key, "skip_subtrees") == 0) {
+                opts->skip_subtrees = parse_subtree_skip(value);
+            } else if (strcmp(key, "skip_sample_percent") == 0) {
+                opts->skip_sample_percent = atoi(value);
+                if (opts->skip_sample_percent < 0) opts->skip_sample_percent = 0;
+                if (opts->skip_sample_percent > 100) opts->skip_sample_percent = 100;
+            } else if (strcmp(key, "link_dest") == 0) {
+                strncpy(opts->link_dest, value, sizeof(opts->link_dest) - 1);
+            } else if (strcmp(key, "watch_interval") == 0) {
+                opts->watch_interval = atoi(value);
+            } else if (strcmp(key, "delta") == 0) {
+                opts->delta = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "chunk_store") == 0) {
+                strncpy(opts->chunk_store, value, sizeof(opts->chunk_store) - 1);
+            } else if (strcmp(key, "deflate_backend") == 0) {
+                deflate_backend_t backend = parse_deflate_backend(value);
+
+                if (backend == DEFLATE_BACKEND_INVALID) {
+                    log_warning("알 수 없는 deflate 백엔드: %s (auto, zlib, libdeflate), 무시합니다", value);
+                } else {
+                    opts->deflate_backend = backend;
+                }
+            } else if (strcmp(key, "exclude_dirs") == 0) {
+                add_exclude_dirs(opts, value);
+            } else if (strcmp(key, "exclude_system_dirs") == 0) {
+                opts->exclude_system_dirs = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "ignore_file") == 0) {
+                if (strlen(value) >= sizeof(opts->ignore_file)) {
+                    log_warning("제외 파일 이름이 너무 깁니다: %s, 무시합니다", value);
+                } else {
+                    memcpy(opts->ignore_file, value, strlen(value) + 1);
+                }
+            } else if (strcmp(key, "memory_limit") == 0) {
+                opts->memory_limit = parse_memory_size(value);
+            } else if (strcmp(key, "monitor_memory") == 0) {
+                opts->monitor_memory = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "huge_pages") == 0) {
+                opts->huge_pages = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
             } else if (strcmp(key, "exclude") == 0 && opts->exclude_count < MAX_EXCLUDE_PATTERNS) {
                 strncpy(opts->exclude_patterns[opts->exclude_count], value, MAX_PATH - 1);
                 opts->exclude_count++;
@@ -354,6 +526,7 @@ int parse_options(int argc, char *argv[], backup_options_t *opts) {
         {"verbose", no_argument, 0, 'v'},
         {"progress", no_argument, 0, 'p'},
         {"compression", required_argument, 0, 'c'},
+        {"level", required_argument, 0, 'l'},
         {"mode", required_argument, 0, 'm'},
         {"exclude", required_argument, 0, 'x'},
         {"jobs", required_argument, 0, 'j'},
@@ -366,12 +539,33 @@ int parse_options(int argc, char *argv[], backup_options_t *opts) {
         {"log", required_argument, 0, 1007},
         {"log-level", required_argument, 0, 1008},
         {"max-size", required_argument, 0, 1009},
+        {"deflate-backend", required_argument, 0, 1010},
+        {"write-config", required_argument, 0, 1011},
+        {"checksum", optional_argument, 0, 1012},
+        {"dedup", no_argument, 0, 1013},
+        {"chunk-store", required_argument, 0, 1014},
+        {"delta", no_argument, 0, 1015},
+        {"hash-cache", required_argument, 0, 1016},
+        {"skip-subtrees", optional_argument, 0, 1017},
+        {"skip-sample", required_argument, 0, 1018},
+        {"watch-interval", required_argument, 0, 1019},
+        {"link-dest", required_argument, 0, 1020},
+        {"as-of", required_argument, 0, 1021},
+        {"exclude-dir", required_argument, 0, 1022},
+        {"exclude-system-dirs", no_argument, 0, 1023},
+        {"ignore-file", required_argument, 0, 1024},
+        {"memory-limit", required_argument, 0, 1025},
+        {"huge-pages", no_argument, 0, 1026},
+        {"log-overflow", required_argument, 0, 1027},
+        {"stats-file", required_argument, 0, 1028},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
     // 기본값 설정
     opts->compression = COMPRESS_NONE;
+    opts->compression_level = Z_BEST_COMPRESSION;
+    opts->checksum_algorithm = CHECKSUM_BLAKE3;
     opts->mode = BACKUP_FULL;
     opts->conflict_mode = CONFLICT_ASK;
     opts->threads = MAX_THREADS;
@@ -379,8 +573,11 @@ int parse_options(int argc, char *argv[], backup_options_t *opts) {
     opts->preserve_permissions = 1;
     opts->preserve_timestamps = 1;
     opts->log_level = LOG_INFO;
+    opts->skip_sample_percent = 5;
+    opts->watch_interval = WATCH_DEFAULT_INTERVAL;
+    strcpy(opts->ignore_file, DEFAULT_IGNORE_FILE);
     
-    while ((opt = getopt_long(argc, argv, "rvpc:m:x:j:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "rvpc:l:m:x:j:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'r':
                 opts->recursive = 1;
@@ -394,10 +591,13 @@ int parse_options(int argc, char *argv[], backup_options_t *opts) {
             case 'c':
                 opts->compression = parse_compression_type(optarg);
                 break;
+            case 'l':
+                opts->compression_level = atoi(optarg);
+                if (opts->compression_level < 1) opts->compression_level = 1;
+                if (opts->compression_level > 9) opts->compression_level = 9;
+                break;
             case 'm':
-                if (strcmp(optarg, "full") == 0) opts->mode = BACKUP_FULL;
-                else if (strcmp(optarg, "incremental") == 0) opts->mode = BACKUP_INCREMENTAL;
-                else if (strcmp(optarg, "differential") == 0) opts->mode = BACKUP_DIFFERENTIAL;
+                opts->mode = parse_backup_mode(optarg);
                 break;
             case 'x':
                 if (opts->exclude_count < MAX_EXCLUDE_PATTERNS) {
@@ -438,6 +638,86 @@ int parse_options(int argc, char *argv[], backup_options_t *opts) {
             case 1009:
                 opts->max_file_size = atol(optarg);
                 break;
+            case 1010:
+                opts->deflate_backend = parse_deflate_backend(optarg);
+                if (opts->deflate_backend == DEFLATE_BACKEND_INVALID) {
+                    printf("오류: 알 수 없는 deflate 백엔드: %s (auto, zlib, libdeflate)\n", optarg);
+                    return -1;
+                }
+                break;
+            case 1011:
+                strncpy(opts->write_config, optarg, sizeof(opts->write_config) - 1);
+                break;
+            case 1012:
+                if (optarg) {
+                    opts->checksum_algorithm = parse_checksum_type(optarg);
+                }
+                opts->calculate_checksum = (opts->checksum_algorithm != CHECKSUM_NONE);
+                break;
+            case 1013:
+                opts->dedup = 1;
+                break;
+            case 1014:
+                strncpy(opts->chunk_store, optarg, sizeof(opts->chunk_store) - 1);
+                opts->dedup = 1;
+                break;
+            case 1015:
+                opts->delta = 1;
+                break;
+            case 1016:
+                strncpy(opts->hash_cache, optarg, sizeof(opts->hash_cache) - 1);
+                break;
+            case 1017:
+                opts->skip_subtrees = parse_subtree_skip(optarg);
+                break;
+            case 1018:
+                opts->skip_sample_percent = atoi(optarg);
+                if (opts->skip_sample_percent < 0) opts->skip_sample_percent = 0;
+                if (opts->skip_sample_percent > 100) opts->skip_sample_percent = 100;
+                break;
+            case 1019:
+                opts->watch_interval = atoi(optarg);
+                break;
+            case 1020:
+                strncpy(opts->link_dest, optarg, sizeof(opts->link_dest) - 1);
+                break;
+            case 1021:
+                strncpy(opts->as_of, optarg, sizeof(opts->as_of) - 1);
+                break;
+            case 1022:
+                add_exclude_dirs(opts, optarg);
+                break;
+            case 1023:
+                opts->exclude_system_dirs = 1;
+                break;
+            case 1024:
+                if (strlen(optarg) >= sizeof(opts->ignore_file)) {
+                    printf("오류: 제외 파일 이름이 너무 깁니다: %s\n", optarg);
+                    return -1;
+                }
+                memcpy(opts->ignore_file, optarg, strlen(optarg) + 1);
+                break;
+            case 1025:
+                opts->memory_limit = parse_memory_size(optarg);
+                if (opts->memory_limit == 0) {
+                    printf("오류: 잘못된 메모리 예산: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 1026:
+                opts->huge_pages = 1;
+                break;
+            case 1027:
+                if (strcmp(optarg, "block") != 0 && strcmp(optarg, "drop") != 0) {
+                    printf("오류: 알 수 없는 로그 넘침 처리: %s (block, drop)\n", optarg);
+                    return -1;
+                }
+                opts->log_drop = (strcmp(optarg, "drop") == 0);
+                break;
+            case 1028:
+                strncpy(opts->statistics_file, optarg, sizeof(opts->statistics_file) - 1);
+                opts->save_statistics = 1;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 exit(0);
@@ -469,7 +749,7 @@ void signal_handler(int sig) {
 int main(int argc, char *argv[]) {
     int result = SUCCESS;
     const char *command;
-    const char *source, *dest;
+    const char *source = NULL, *dest = NULL;
     
     if (argc < 2) {
         print_usage(argv[0]);
@@ -499,6 +779,11 @@ int main(int argc, char *argv[]) {
     
     // 로깅 초기화
     init_logging(&g_options);
+    init_compression(&g_options);
+    init_checksum(&g_options);
+    exclude_matcher_init(&g_options);
+    memory_init(&g_options);
+    bufpool_init(&g_options);
     
     // 신호 처리기 등록
     signal(SIGINT, signal_handler);
@@ -508,10 +793,16 @@ int main(int argc, char *argv[]) {
     // 통계 초기화
     memset(&g_stats, 0, sizeof(backup_stats_t));
     g_stats.start_time = time(NULL);
+    metrics_start();
     
     // 진행률 정보 초기화
     memset(&g_progress, 0, sizeof(progress_info_t));
     pthread_mutex_init(&g_progress.mutex, NULL);
+
+    // 체크섬을 계산하는 백업은 변경 없는 파일의 해시를 캐시에서 재사용
+    if (g_options.calculate_checksum && (strcmp(command, "backup") == 0 || strcmp(command, "watch") == 0)) {
+        hash_cache_open(g_options.hash_cache);
+    }
     
     // 명령어별 처리
     if (strcmp(command, "backup") == 0) {
@@ -540,7 +831,14 @@ int main(int argc, char *argv[]) {
             result = ERROR_FILE_NOT_FOUND;
         } else {
             // 디렉토리 vs 파일 처리
-            if (is_directory(source)) {
+            if (g_options.as_of[0]) {
+                if (!is_directory(source)) {
+                    printf("오류: --as-of 는 백업 체인 디렉토리에서만 사용할 수 있습니다.\n");
+                    result = ERROR_INVALID_PARAMS;
+                } else {
+                    result = restore_backup_as_of(source, g_options.as_of, dest, &g_options);
+                }
+            } else if (is_directory(source)) {
                 if (!g_options.recursive) {
                     printf("오류: 디렉토리 백업에는 -r 옵션이 필요합니다.\n");
                     result = ERROR_GENERAL;
@@ -558,6 +856,37 @@ int main(int argc, char *argv[]) {
             result = verify_backup_integrity(source, dest, &g_options);
         }
         
+    } else if (strcmp(command, "watch") == 0) {
+        if (argc - optind - 1 < 2) {
+            printf("사용법: %s watch [옵션] <소스 디렉토리> <체인>\n", argv[0]);
+            return 1;
+        }
+
+        source = argv[optind + 1];
+        dest = argv[optind + 2];
+
+        if (!is_directory(source)) {
+            printf("오류: 감시할 소스 디렉토리가 없습니다: %s\n", source);
+            result = ERROR_FILE_NOT_FOUND;
+        } else {
+            result = watch_directory(source, dest, &g_options);
+        }
+
+    } else if (strcmp(command, "consolidate") == 0) {
+        if (argc - optind - 1 < 2) {
+            printf("사용법: %s consolidate [옵션] <체인> <새 전체 백업>\n", argv[0]);
+            return 1;
+        }
+
+        source = argv[optind + 1];
+        dest = argv[optind + 2];
+
+        if (verify_backup_chain(source) != SUCCESS) {
+            result = ERROR_FILE_NOT_FOUND;
+        } else {
+            result = consolidate_chain(source, dest, &g_options);
+        }
+
     } else if (strcmp(command, "restore") == 0) {
         if (argc < 4) {
             printf("사용법: %s restore [옵션] <소스> <대상>\n", argv[0]);
@@ -573,7 +902,14 @@ int main(int argc, char *argv[]) {
             printf("오류: 백업 소스가 존재하지 않습니다: %s\n", source);
             result = ERROR_FILE_NOT_FOUND;
         } else {
-            if (is_directory(source)) {
+            if (g_options.as_of[0]) {
+                if (!is_directory(source)) {
+                    printf("오류: --as-of 는 백업 체인 디렉토리에서만 사용할 수 있습니다.\n");
+                    result = ERROR_INVALID_PARAMS;
+                } else {
+                    result = restore_backup_as_of(source, g_options.as_of, dest, &g_options);
+                }
+            } else if (is_directory(source)) {
                 if (!g_options.recursive) {
                     printf("오류: 디렉토리 복원에는 -r 옵션이 필요합니다.\n");
                     result = ERROR_GENERAL;
@@ -592,7 +928,18 @@ int main(int argc, char *argv[]) {
         }
         
         source = argv[argc - 1];
-        result = verify_backup(source, &g_options);
+        
+        // 체크섬 인덱스가 있으면 내용까지 검증, 없으면 읽기 검사
+        result = ERROR_FILE_NOT_FOUND;
+        if (is_directory(source)) {
+            result = verify_backup_checksums(source, &g_options);
+            if (result == SUCCESS) {
+                printf("✅ 체크섬 검증 성공: %s\n", source);
+            }
+        }
+        if (result == ERROR_FILE_NOT_FOUND) {
+            result = verify_backup(source, &g_options);
+        }
         
     } else if (strcmp(command, "list") == 0) {
         if (argc < 3) {
@@ -603,6 +950,18 @@ int main(int argc, char *argv[]) {
         source = argv[argc - 1];
         result = list_backup_contents(source, &g_options);
         
+    } else if (strcmp(command, "compress-bench") == 0) {
+        if (argc < 3) {
+            printf("사용법: %s compress-bench [옵션] <디렉토리>\n", argv[0]);
+            return 1;
+        }
+        
+        source = argv[argc - 1];
+        result = run_compress_bench(source, &g_options);
+        
+    } else if (strcmp(command, "hash-bench") == 0) {
+        result = run_hash_bench(&g_options);
+        
     } else {
         printf("오류: 알 수 없는 명령어: %s\n", command);
         print_usage(argv[0]);
@@ -612,26 +971,59 @@ int main(int argc, char *argv[]) {
     // 통계 출력
     g_stats.end_time = time(NULL);
     
+    // 요약이 앞선 로그 사이에 섞이지 않도록
+    log_flush();
+    
     if (g_options.verbose || g_options.progress) {
         printf("\n=== 작업 완료 ===\n");
         printf("처리된 파일: %ld\n", g_stats.files_processed);
         printf("건너뛴 파일: %ld\n", g_stats.files_skipped);
+        if (g_options.mode != BACKUP_FULL || strcmp(command, "watch") == 0) {
+            printf("변경 없는 파일: %zu\n", g_stats.files_unchanged);
+            if (g_options.skip_subtrees != SUBTREE_SKIP_OFF) {
+                printf("건너뛴 하위 트리: %zu (표본 검사 %zu)\n", g_stats.subtrees_skipped, g_stats.subtrees_checked);
+            }
+        }
+        if (g_stats.files_linked > 0) {
+            printf("하드 링크한 파일: %zu\n", g_stats.files_linked);
+        }
+        if (g_stats.files_moved > 0) {
+            printf("옮겨진 파일: %zu (복사 생략 %zu bytes)\n", g_stats.files_moved, g_stats.bytes_moved);
+        }
+        if (g_stats.hash_cache_lookups > 0) {
+            printf("해시 캐시 적중: %zu/%zu (%.1f%%)\n", g_stats.hash_cache_hits, g_stats.hash_cache_lookups,
+                   (double)g_stats.hash_cache_hits * 100.0 / g_stats.hash_cache_lookups);
+        }
         printf("실패한 파일: %ld\n", g_stats.files_failed);
         printf("처리된 디렉토리: %ld\n", g_stats.dirs_processed);
         printf("처리된 바이트: %ld\n", g_stats.bytes_processed);
+        printf("최대 메모리(RSS): %.1f MB\n", memory_peak_rss() / (1024.0 * 1024.0));
+        if (g_stats.spill_runs > 0) {
+            printf("디스크로 내보낸 구간: %zu (%zu bytes)\n", g_stats.spill_runs, g_stats.bytes_spilled);
+        }
+        bufpool_stats_t pool;
+        bufpool_get_stats(&pool);
+        if (pool.gets > 0) {
+            printf("버퍼 풀: 요청 %zu회 (만든 버퍼 %zu개), arena %zu KB (%zu회 할당)\n",
+                   pool.gets, pool.buffers, pool.arena_bytes / 1024, pool.arena_allocs);
+        }
+        if (pool.whole_bytes > 0) {
+            printf("파일 전체 버퍼: %zu KB\n", pool.whole_bytes / 1024);
+        }
         
         if (g_stats.bytes_compressed > 0) {
             g_stats.compression_ratio = (double)g_stats.bytes_compressed / g_stats.bytes_processed * 100.0;
             printf("압축된 바이트: %ld (%.1f%%)\n", g_stats.bytes_compressed, g_stats.compression_ratio);
         }
         
-        double elapsed = difftime(g_stats.end_time, g_stats.start_time);
+        double elapsed = metrics_elapsed();
         printf("소요 시간: %.2f초\n", elapsed);
         
         if (elapsed > 0) {
             printf("처리 속도: %.2f MB/s\n", 
                    (double)g_stats.bytes_processed / (1024 * 1024) / elapsed);
         }
+        metrics_print_latency(stdout);
     }
     
     // 정리
@@ -639,6 +1031,14 @@ int main(int argc, char *argv[]) {
         log_error("작업이 실패했습니다. (오류 코드: %d)", result);
     }
     
+    if (g_options.save_statistics) {
+        metrics_write(g_options.statistics_file[0] ? g_options.statistics_file : DEFAULT_STATISTICS_FILE,
+                      command, source, dest, result);
+    }
+    if (g_options.monitor_memory) {
+        memory_report();
+    }
+    hash_cache_close();
     close_logging();
     pthread_mutex_destroy(&g_progress.mutex);
     
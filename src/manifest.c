@@ -0,0 +1,1144 @@
+#include "backup.h"
+#include <sys/mman.h>
+
+// 바이너리 매니페스트 (.backup_manifest)
+//
+// 백업이 끝날 때 인덱스 항목을 경로순으로 정렬해 한 번에 기록합니다. 읽을 때는 파일 전체를
+// mmap 하고 헤더만 검사한 뒤 파싱 없이 이진 탐색으로 조회하므로, 여는 비용이 항목 수와 무관합니다.
+//
+//   헤더       manifest_header_t (little-endian, 각 섹션 위치/크기)
+//   paths      MANIFEST_BLOCK_ENTRIES 개 단위 접두 압축: varint(공유 길이) varint(접미 길이) 접미
+//              블록 첫 항목은 공유 길이 0 (전체 경로)
+//   restarts   u64 × 블록 수: 블록 첫 항목의 paths 내 오프셋 (이진 탐색 키)
+//   열         항목 순서의 고정 폭 배열: size/mtime/inode/offset (8), mtime_nsec/mode (4),
+//              origin (2), type/codec/flags (1), hash (digest_len)
+//   strings    u16 길이 + 바이트: 0번은 기준 백업 이름, 1번부터 origin 이름
+//
+// 메모리 예산(--memory-limit)이 있으면 기록 버퍼가 몫을 넘을 때마다 정렬한 구간을 백업 디렉토리의
+// 임시 파일로 내보내고, 쓸 때 구간들을 병합하며 경로는 바로, 열은 열별 임시 파일에 모았다가 이어 붙임.
+
+#define MANIFEST_MAGIC "BKMANIF"
+#define MANIFEST_VERSION 2      // 1: modes_off가 열 앞 정렬 패딩 이전 위치를 가리킴 (읽을 때 보정)
+#define MANIFEST_BLOCK_ENTRIES 16
+#define MANIFEST_FLAG_CHECKSUM 0x01
+#define MANIFEST_MAX_ORIGINS 65535
+#define MANIFEST_MAX_RUNS 64      // 내보낸 구간이 이만큼 쌓이면 하나로 병합 (열린 파일 수 제한)
+#define MANIFEST_MIN_RUN 65536    // RSS 만 넘었을 때는 이보다 작은 구간으로 내보내지 않음
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t entry_count;
+    uint64_t block_count;
+    uint64_t file_size;
+    int64_t created;
+    uint64_t total_bytes;
+    uint64_t paths_off;
+    uint64_t paths_len;
+    uint64_t restarts_off;
+    uint64_t sizes_off;
+    uint64_t mtimes_off;
+    uint64_t inodes_off;
+    uint64_t offsets_off;
+    uint64_t nsecs_off;
+    uint64_t modes_off;
+    uint64_t origins_off;
+    uint64_t types_off;
+    uint64_t codecs_off;
+    uint64_t flags_off;
+    uint64_t hashes_off;
+    uint64_t strings_off;
+    uint64_t strings_len;
+    uint32_t string_count;
+    uint8_t checksum_type;
+    uint8_t compression;
+    uint8_t mode;
+    uint8_t digest_len;
+} manifest_header_t;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define LE16(v) __builtin_bswap16(v)
+#define LE32(v) __builtin_bswap32(v)
+#define LE64(v) __builtin_bswap64(v)
+#else
+#define LE16(v) (v)
+#define LE32(v) (v)
+#define LE64(v) (v)
+#endif
+
+// 기록 중인 항목 (고정 폭 열, 경로는 경로 표 id, digest 는 seq 위치에 따로)
+typedef struct {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t inode;
+    uint64_t offset;
+    uint32_t path;                // builder->paths 의 id
+    uint32_t seq;                 // 기록 순서: 같은 경로가 여러 번 기록되면 마지막 항목 우선
+    uint32_t mtime_nsec;
+    uint32_t mode;
+    uint16_t origin;
+    uint8_t type;
+    uint8_t codec;
+    uint8_t flags;
+} manifest_record_t;
+
+struct manifest_builder {
+    manifest_record_t *records;
+    size_t count;
+    size_t capacity;
+    path_table_t *paths;          // 같은 디렉토리 경로는 한 번만 저장
+    unsigned char *digests;       // (seq - seq_base) × digest_len (체크섬 없으면 NULL)
+    size_t digest_len;
+    uint32_t seq_base;            // records 첫 항목의 seq (앞 항목들은 구간으로 내보냄)
+    char spill_dir[MAX_PATH];     // 비어 있으면 내보내지 않음
+    FILE *runs[MANIFEST_MAX_RUNS];
+    size_t run_count;
+    char (*strings)[BACKUP_NAME_MAX];
+    size_t string_count;
+    size_t string_capacity;
+    checksum_type_t checksum_type;
+    compression_type_t compression;
+    backup_mode_t mode;
+    int drop_summaries;           // 디렉토리 항목의 하위 트리 요약(offset)을 0 으로 기록
+};
+
+static int should_spill(const manifest_builder_t *builder);
+static int spill_run(manifest_builder_t *builder);
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 빈 문자열/잘못된 값이면 0 반환
+static size_t hex_to_digest(const char *hex, unsigned char *digest) {
+    size_t len = strlen(hex);
+
+    if (len == 0 || len % 2 != 0 || len / 2 > MAX_DIGEST_SIZE) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < len / 2; i++) {
+        int hi = hex_value(hex[i * 2]);
+        int lo = hex_value(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return 0;
+        digest[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return len / 2;
+}
+
+// 0번(기준 백업 이름)은 origin 0 = "이 백업"과 겹치므로 origin 검색에서 제외
+static int add_string(manifest_builder_t *builder, const char *value) {
+    for (size_t i = 1; i < builder->string_count; i++) {
+        if (strcmp(builder->strings[i], value) == 0) {
+            return (int)i;
+        }
+    }
+
+    if (builder->string_count > MANIFEST_MAX_ORIGINS) {
+        return -1;
+    }
+
+    if (builder->string_count == builder->string_capacity) {
+        size_t new_capacity = builder->string_capacity ? builder->string_capacity * 2 : 8;
+        void *grown = realloc(builder->strings, new_capacity * sizeof(*builder->strings));
+        if (!grown) return -1;
+        builder->strings = grown;
+        builder->string_capacity = new_capacity;
+    }
+
+    snprintf(builder->strings[builder->string_count], BACKUP_NAME_MAX, "%s", value);
+    return (int)builder->string_count++;
+}
+
+manifest_builder_t *manifest_builder_create(checksum_type_t checksum_type, compression_type_t compression,
+                                            backup_mode_t mode, const char *base) {
+    manifest_builder_t *builder = calloc(1, sizeof(*builder));
+
+    if (!builder) return NULL;
+
+    builder->checksum_type = checksum_type;
+    builder->compression = compression;
+    builder->mode = mode;
+    builder->digest_len = checksum_digest_size(checksum_type);
+    builder->paths = path_table_create();
+    if (!builder->paths) {
+        manifest_builder_free(builder);
+        return NULL;
+    }
+
+    // 0번 문자열 = 기준 백업 이름 (origin 0 = 이 백업)
+    if (add_string(builder, base ? base : "") != 0) {
+        manifest_builder_free(builder);
+        return NULL;
+    }
+    return builder;
+}
+
+int manifest_builder_add(manifest_builder_t *builder, const char *path, const index_entry_t *entry) {
+    manifest_record_t *record;
+    int origin = 0;
+
+    if ((size_t)builder->seq_base + builder->count >= UINT32_MAX) {
+        return ERROR_MEMORY;
+    }
+    if (builder->count == builder->capacity && should_spill(builder)) {
+        if (spill_run(builder) != SUCCESS) return ERROR_FILE_WRITE;
+    }
+    if (builder->count == builder->capacity) {
+        size_t new_capacity = builder->capacity ? builder->capacity * 2 : 1024;
+        manifest_record_t *grown = realloc(builder->records, new_capacity * sizeof(manifest_record_t));
+        if (!grown) return ERROR_MEMORY;
+        builder->records = grown;
+        if (builder->digest_len > 0) {
+            unsigned char *digests = realloc(builder->digests, new_capacity * builder->digest_len);
+            if (!digests) return ERROR_MEMORY;
+            builder->digests = digests;
+        }
+        builder->capacity = new_capacity;
+    }
+
+    if (entry->origin[0] != '\0') {
+        origin = add_string(builder, entry->origin);
+        if (origin < 0) return ERROR_MEMORY;
+    }
+
+    record = &builder->records[builder->count];
+    memset(record, 0, sizeof(*record));
+    if (path_table_add(builder->paths, path, &record->path) != SUCCESS) return ERROR_MEMORY;
+
+    record->size = entry->size;
+    record->mtime = (int64_t)entry->mtime;
+    record->inode = entry->inode;
+    record->offset = entry->offset;
+    record->mtime_nsec = (uint32_t)entry->mtime_nsec;
+    record->mode = entry->file_mode;
+    record->origin = (uint16_t)origin;
+    record->type = (uint8_t)entry->type;
+    record->codec = entry->codec;
+    // 모든 항목의 digest는 헤더 알고리즘 길이 (다른 길이는 체크섬 없음으로 기록)
+    if (builder->digest_len > 0) {
+        unsigned char digest[MAX_DIGEST_SIZE];
+
+        if (hex_to_digest(entry->checksum, digest) == builder->digest_len) {
+            memcpy(builder->digests + builder->count * builder->digest_len, digest, builder->digest_len);
+            record->flags |= MANIFEST_FLAG_CHECKSUM;
+        }
+    }
+    record->seq = builder->seq_base + (uint32_t)builder->count;
+
+    builder->count++;
+    return SUCCESS;
+}
+
+void manifest_builder_free(manifest_builder_t *builder) {
+    if (!builder) return;
+
+    free(builder->records);
+    free(builder->digests);
+    path_table_free(builder->paths);
+    free(builder->strings);
+    for (size_t i = 0; i < builder->run_count; i++) {
+        fclose(builder->runs[i]);
+    }
+    free(builder);
+}
+
+// 메모리 예산을 넘으면 dir 에 정렬 구간을 내보냄
+void manifest_builder_spill_to(manifest_builder_t *builder, const char *dir) {
+    snprintf(builder->spill_dir, sizeof(builder->spill_dir), "%s", dir);
+}
+
+// 이 백업의 디렉토리 요약을 믿을 수 없음: 쓸 때 모두 0 으로 기록해 다음 백업이 하위 트리를 건너뛰지 않게 함
+void manifest_builder_drop_summaries(manifest_builder_t *builder) {
+    builder->drop_summaries = 1;
+}
+
+static int compare_records(const void *a, const void *b, void *table) {
+    const manifest_record_t *ra = (const manifest_record_t *)a;
+    const manifest_record_t *rb = (const manifest_record_t *)b;
+    int cmp = path_table_compare((const path_table_t *)table, ra->path, rb->path);
+
+    if (cmp != 0) return cmp;
+    return ra->seq < rb->seq ? -1 : (ra->seq > rb->seq ? 1 : 0);
+}
+
+// 경로순 정렬 후 같은 경로는 마지막 항목만 남김 (경로 문자열을 만들지 않고 경로 표에서 비교)
+static void sort_records(manifest_builder_t *builder) {
+    manifest_record_t *records = builder->records;
+    size_t count = 0;
+
+    qsort_r(records, builder->count, sizeof(manifest_record_t), compare_records, builder->paths);
+    for (size_t i = 0; i < builder->count; i++) {
+        if (i + 1 < builder->count && path_table_compare(builder->paths, records[i].path, records[i + 1].path) == 0) {
+            continue;
+        }
+        records[count++] = records[i];
+    }
+    builder->count = count;
+}
+
+static const unsigned char *record_digest(const manifest_builder_t *builder, const manifest_record_t *record) {
+    static const unsigned char zeros[MAX_DIGEST_SIZE] = { 0 };
+
+    if (!(record->flags & MANIFEST_FLAG_CHECKSUM)) return zeros;
+    return builder->digests + (size_t)(record->seq - builder->seq_base) * builder->digest_len;
+}
+
+// ---- 내보낸 구간 ----
+// 구간 항목: u16 경로 길이, 경로, manifest_record_t (path 필드는 의미 없음), digest_len 바이트
+// 같은 프로세스가 쓰고 읽는 임시 파일이므로 구조체를 그대로 기록
+
+typedef struct {
+    FILE *file;                   // NULL = 끝
+    manifest_record_t record;
+    unsigned char digest[MAX_DIGEST_SIZE];
+    char path[MAX_PATH];
+} run_cursor_t;
+
+typedef struct {
+    FILE *file;
+    size_t digest_len;
+} run_writer_t;
+
+typedef int (*run_emit_fn)(void *ctx, const char *path, const manifest_record_t *record,
+                           const unsigned char *digest);
+
+static int write_run_entry(void *ctx, const char *path, const manifest_record_t *record,
+                           const unsigned char *digest) {
+    run_writer_t *run = (run_writer_t *)ctx;
+    uint16_t len = (uint16_t)strlen(path);
+
+    if (fwrite(&len, sizeof(len), 1, run->file) != 1 || fwrite(path, 1, len, run->file) != len ||
+        fwrite(record, sizeof(*record), 1, run->file) != 1 ||
+        (run->digest_len > 0 && fwrite(digest, 1, run->digest_len, run->file) != run->digest_len)) {
+        return ERROR_FILE_WRITE;
+    }
+    return SUCCESS;
+}
+
+// 다음 항목 읽기 (끝이면 cursor->file = NULL), 읽기 오류는 ERROR_FILE_READ
+static int run_advance(run_cursor_t *cursor, size_t digest_len) {
+    uint16_t len;
+
+    if (fread(&len, sizeof(len), 1, cursor->file) != 1) {
+        int failed = ferror(cursor->file);
+        cursor->file = NULL;
+        return failed ? ERROR_FILE_READ : SUCCESS;
+    }
+    if (fread(cursor->path, 1, len, cursor->file) != len ||
+        fread(&cursor->record, sizeof(cursor->record), 1, cursor->file) != 1 ||
+        (digest_len > 0 && fread(cursor->digest, 1, digest_len, cursor->file) != digest_len)) {
+        cursor->file = NULL;
+        return ERROR_FILE_READ;
+    }
+    cursor->path[len] = '\0';
+    return SUCCESS;
+}
+
+static int compare_cursors(const run_cursor_t *a, const run_cursor_t *b) {
+    int cmp = strcmp(a->path, b->path);
+
+    if (cmp != 0) return cmp;
+    return a->record.seq < b->record.seq ? -1 : 1;
+}
+
+// 모든 구간을 경로순으로 병합해 emit 에 넘김 (같은 경로는 seq 가 가장 큰 항목만)
+// 구간 수가 MANIFEST_MAX_RUNS 이하이므로 최소 구간은 선형으로 찾음
+static int merge_runs(manifest_builder_t *builder, run_emit_fn emit, void *ctx) {
+    run_cursor_t *cursors = calloc(builder->run_count + 1, sizeof(run_cursor_t));
+    run_cursor_t *pending;
+    int has_pending = 0;
+    int result = SUCCESS;
+
+    if (!cursors) return ERROR_MEMORY;
+    pending = &cursors[builder->run_count];
+
+    for (size_t i = 0; i < builder->run_count && result == SUCCESS; i++) {
+        cursors[i].file = builder->runs[i];
+        if (fflush(builder->runs[i]) != 0 || fseeko(builder->runs[i], 0, SEEK_SET) != 0) {
+            result = ERROR_FILE_READ;
+            break;
+        }
+        result = run_advance(&cursors[i], builder->digest_len);
+    }
+
+    while (result == SUCCESS) {
+        run_cursor_t *best = NULL;
+
+        for (size_t i = 0; i < builder->run_count; i++) {
+            if (cursors[i].file && (!best || compare_cursors(&cursors[i], best) < 0)) {
+                best = &cursors[i];
+            }
+        }
+        if (!best) break;
+
+        if (has_pending && strcmp(pending->path, best->path) != 0) {
+            result = emit(ctx, pending->path, &pending->record, pending->digest);
+        }
+        strcpy(pending->path, best->path);
+        pending->record = best->record;
+        memcpy(pending->digest, best->digest, builder->digest_len);
+        has_pending = 1;
+
+        if (result == SUCCESS) {
+            result = run_advance(best, builder->digest_len);
+        }
+    }
+    if (result == SUCCESS && has_pending) {
+        result = emit(ctx, pending->path, &pending->record, pending->digest);
+    }
+
+    free(cursors);
+    return result;
+}
+
+static void close_runs(manifest_builder_t *builder) {
+    for (size_t i = 0; i < builder->run_count; i++) {
+        fclose(builder->runs[i]);
+    }
+    builder->run_count = 0;
+}
+
+// 쌓인 구간을 하나로 병합
+static int compact_runs(manifest_builder_t *builder) {
+    FILE *out = memory_spill_file(builder->spill_dir);
+    run_writer_t run = { out, builder->digest_len };
+    int result;
+
+    if (!out) return ERROR_FILE_WRITE;
+    result = merge_runs(builder, write_run_entry, &run);
+    if (result == SUCCESS && fflush(out) != 0) {
+        result = ERROR_FILE_WRITE;
+    }
+    if (result != SUCCESS) {
+        fclose(out);
+        return result;
+    }
+
+    close_runs(builder);
+    builder->runs[builder->run_count++] = out;
+    memory_note_spill((size_t)ftello(out));
+    return SUCCESS;
+}
+
+// 기록 버퍼가 예산 몫을 넘게 커질 참이면 1 (records 가 가득 찼을 때만 확인)
+static int should_spill(const manifest_builder_t *builder) {
+    size_t grown;
+
+    if (builder->spill_dir[0] == '\0' || builder->count == 0) {
+        return 0;
+    }
+    grown = builder->capacity * 2 * (sizeof(manifest_record_t) + builder->digest_len) +
+            path_table_memory(builder->paths);
+    if (grown > memory_budget(MEMORY_SHARE_MANIFEST)) {
+        return 1;
+    }
+    return builder->capacity >= MANIFEST_MIN_RUN && memory_over_limit();
+}
+
+// 메모리의 항목을 정렬해 구간으로 내보내고 버퍼를 비움 (할당한 크기는 유지)
+static int spill_run(manifest_builder_t *builder) {
+    uint32_t next_seq = builder->seq_base + (uint32_t)builder->count;
+    char path[MAX_PATH];
+    run_writer_t writer;
+    FILE *run;
+
+    if (builder->run_count == MANIFEST_MAX_RUNS && compact_runs(builder) != SUCCESS) {
+        return ERROR_FILE_WRITE;
+    }
+
+    run = memory_spill_file(builder->spill_dir);
+    if (!run) return ERROR_FILE_WRITE;
+    writer.file = run;
+    writer.digest_len = builder->digest_len;
+
+    sort_records(builder);
+    for (size_t i = 0; i < builder->count; i++) {
+        const manifest_record_t *record = &builder->records[i];
+
+        if (path_table_get(builder->paths, record->path, path, sizeof(path)) != SUCCESS ||
+            write_run_entry(&writer, path, record, record_digest(builder, record)) != SUCCESS) {
+            fclose(run);
+            log_error("매니페스트 구간 쓰기 실패: %s", builder->spill_dir);
+            return ERROR_FILE_WRITE;
+        }
+    }
+    if (fflush(run) != 0) {
+        fclose(run);
+        log_error("매니페스트 구간 쓰기 실패: %s", builder->spill_dir);
+        return ERROR_FILE_WRITE;
+    }
+
+    builder->runs[builder->run_count++] = run;
+    memory_note_spill((size_t)ftello(run));
+    log_debug("매니페스트 구간 내보냄: %zu개 항목 (구간 %zu개)", builder->count, builder->run_count);
+
+    builder->seq_base = next_seq;
+    builder->count = 0;
+    return path_table_reset(builder->paths);
+}
+
+// 버퍼링된 순차 쓰기 (현재 오프셋 추적)
+typedef struct {
+    FILE *file;
+    uint64_t offset;
+    int failed;
+} manifest_writer_t;
+
+static void write_bytes(manifest_writer_t *writer, const void *data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, writer->file) != len) {
+        writer->failed = 1;
+    }
+    writer->offset += len;
+}
+
+static void write_align(manifest_writer_t *writer) {
+    static const unsigned char zeros[8] = { 0 };
+    write_bytes(writer, zeros, (8 - writer->offset % 8) % 8);
+}
+
+static void write_varint(manifest_writer_t *writer, uint64_t value) {
+    unsigned char buf[10];
+    size_t len = 0;
+
+    do {
+        buf[len] = (unsigned char)(value & 0x7f);
+        value >>= 7;
+        if (value) buf[len] |= 0x80;
+        len++;
+    } while (value);
+
+    write_bytes(writer, buf, len);
+}
+
+// paths 섹션: 블록 단위 접두 압축 (restarts 는 블록마다 늘림)
+typedef struct {
+    uint64_t start;               // paths 섹션 시작 오프셋
+    uint64_t *restarts;
+    size_t restart_capacity;
+    size_t count;
+    char prev[MAX_PATH];
+} path_section_t;
+
+static void write_path(manifest_writer_t *writer, path_section_t *section, const char *path) {
+    size_t len = strlen(path);
+    size_t shared = 0;
+
+    if (section->count % MANIFEST_BLOCK_ENTRIES == 0) {
+        size_t block = section->count / MANIFEST_BLOCK_ENTRIES;
+
+        if (block == section->restart_capacity) {
+            size_t capacity = section->restart_capacity ? section->restart_capacity * 2 : 1024;
+            uint64_t *restarts = realloc(section->restarts, capacity * sizeof(uint64_t));
+
+            if (!restarts) {
+                writer->failed = 1;
+                return;
+            }
+            section->restarts = restarts;
+            section->restart_capacity = capacity;
+        }
+        section->restarts[block] = LE64(writer->offset - section->start);
+    } else {
+        while (section->prev[shared] && section->prev[shared] == path[shared]) shared++;
+    }
+
+    write_varint(writer, shared);
+    write_varint(writer, len - shared);
+    write_bytes(writer, path + shared, len - shared);
+    memcpy(section->prev + shared, path + shared, len - shared + 1);
+    section->count++;
+}
+
+#define WRITE_COLUMN(writer, records, count, field, conv, type) do { \
+    write_align(writer); \
+    for (size_t i_ = 0; i_ < (count); i_++) { \
+        type v_ = (type)conv((records)[i_].field); \
+        write_bytes(writer, &v_, sizeof(v_)); \
+    } \
+} while (0)
+
+// 메모리에 모두 있는 경우: 경로는 경로 표에서 복원, 열은 records 에서 바로
+static void write_memory_sections(manifest_builder_t *builder, manifest_writer_t *writer,
+                                  manifest_header_t *header, path_section_t *section) {
+    manifest_record_t *records = builder->records;
+    size_t count = builder->count;
+    char path[MAX_PATH];
+
+    for (size_t i = 0; i < count; i++) {
+        if (path_table_get(builder->paths, records[i].path, path, sizeof(path)) != SUCCESS) {
+            writer->failed = 1;
+            path[0] = '\0';
+        }
+        write_path(writer, section, path);
+    }
+    header->paths_len = LE64(writer->offset - section->start);
+
+    write_align(writer);
+    header->restarts_off = LE64(writer->offset);
+    write_bytes(writer, section->restarts, (section->count + MANIFEST_BLOCK_ENTRIES - 1) / MANIFEST_BLOCK_ENTRIES *
+                                           sizeof(uint64_t));
+
+    header->sizes_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, size, LE64, uint64_t);
+    header->mtimes_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, mtime, LE64, int64_t);
+    header->inodes_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, inode, LE64, uint64_t);
+    header->offsets_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, offset, LE64, uint64_t);
+    header->nsecs_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, mtime_nsec, LE32, uint32_t);
+    write_align(writer);
+    header->modes_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, mode, LE32, uint32_t);
+    write_align(writer);
+    header->origins_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, origin, LE16, uint16_t);
+    write_align(writer);
+    header->types_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, type, , uint8_t);
+    write_align(writer);
+    header->codecs_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, codec, , uint8_t);
+    write_align(writer);
+    header->flags_off = LE64(writer->offset);
+    WRITE_COLUMN(writer, records, count, flags, , uint8_t);
+
+    write_align(writer);
+    header->hashes_off = LE64(writer->offset);
+    for (size_t i = 0; i < count; i++) {
+        write_bytes(writer, record_digest(builder, &records[i]), builder->digest_len);
+    }
+}
+
+// 구간 병합: 경로는 매니페스트에 바로, 열은 열별 임시 파일에 모았다가 순서대로 이어 붙임
+enum {
+    COLUMN_SIZE, COLUMN_MTIME, COLUMN_INODE, COLUMN_OFFSET, COLUMN_NSEC, COLUMN_MODE,
+    COLUMN_ORIGIN, COLUMN_TYPE, COLUMN_CODEC, COLUMN_FLAGS, COLUMN_HASH, COLUMN_COUNT
+};
+
+typedef struct {
+    manifest_writer_t *writer;
+    path_section_t *section;
+    FILE *columns[COLUMN_COUNT];
+    size_t digest_len;
+    uint64_t total_bytes;
+    int drop_summaries;
+    int failed;
+} merge_output_t;
+
+#define PUT_COLUMN(out, column, value, type) do { \
+    type v_ = (type)(value); \
+    if (fwrite(&v_, sizeof(v_), 1, (out)->columns[column]) != 1) (out)->failed = 1; \
+} while (0)
+
+static int emit_merged(void *ctx, const char *path, const manifest_record_t *record,
+                       const unsigned char *digest) {
+    merge_output_t *out = (merge_output_t *)ctx;
+
+    write_path(out->writer, out->section, path);
+    PUT_COLUMN(out, COLUMN_SIZE, LE64(record->size), uint64_t);
+    PUT_COLUMN(out, COLUMN_MTIME, LE64(record->mtime), int64_t);
+    PUT_COLUMN(out, COLUMN_INODE, LE64(record->inode), uint64_t);
+    PUT_COLUMN(out, COLUMN_OFFSET, LE64(out->drop_summaries && record->type == 'D' ? 0 : record->offset), uint64_t);
+    PUT_COLUMN(out, COLUMN_NSEC, LE32(record->mtime_nsec), uint32_t);
+    PUT_COLUMN(out, COLUMN_MODE, LE32(record->mode), uint32_t);
+    PUT_COLUMN(out, COLUMN_ORIGIN, LE16(record->origin), uint16_t);
+    PUT_COLUMN(out, COLUMN_TYPE, record->type, uint8_t);
+    PUT_COLUMN(out, COLUMN_CODEC, record->codec, uint8_t);
+    PUT_COLUMN(out, COLUMN_FLAGS, record->flags, uint8_t);
+    if (out->digest_len > 0) {
+        static const unsigned char zeros[MAX_DIGEST_SIZE] = { 0 };
+        const unsigned char *value = (record->flags & MANIFEST_FLAG_CHECKSUM) ? digest : zeros;
+
+        if (fwrite(value, 1, out->digest_len, out->columns[COLUMN_HASH]) != out->digest_len) out->failed = 1;
+    }
+    if (record->type == 'F') out->total_bytes += record->size;
+
+    return (out->failed || out->writer->failed) ? ERROR_FILE_WRITE : SUCCESS;
+}
+
+static void copy_column(manifest_writer_t *writer, FILE *column) {
+    unsigned char buf[BUFFER_SIZE * 8];
+    size_t len;
+
+    if (fflush(column) != 0 || fseeko(column, 0, SEEK_SET) != 0) {
+        writer->failed = 1;
+        return;
+    }
+    while ((len = fread(buf, 1, sizeof(buf), column)) > 0) {
+        write_bytes(writer, buf, len);
+    }
+    if (ferror(column)) writer->failed = 1;
+}
+
+static uint64_t write_merged_sections(manifest_builder_t *builder, manifest_writer_t *writer,
+                                      manifest_header_t *header, path_section_t *section) {
+    uint64_t *offsets[COLUMN_COUNT] = {
+        &header->sizes_off, &header->mtimes_off, &header->inodes_off, &header->offsets_off,
+        &header->nsecs_off, &header->modes_off, &header->origins_off, &header->types_off,
+        &header->codecs_off, &header->flags_off, &header->hashes_off
+    };
+    merge_output_t out;
+
+    memset(&out, 0, sizeof(out));
+    out.writer = writer;
+    out.section = section;
+    out.digest_len = builder->digest_len;
+    out.drop_summaries = builder->drop_summaries;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        out.columns[c] = memory_spill_file(builder->spill_dir);
+        if (!out.columns[c]) out.failed = 1;
+    }
+
+    if (!out.failed && merge_runs(builder, emit_merged, &out) != SUCCESS) {
+        out.failed = 1;
+    }
+    header->paths_len = LE64(writer->offset - section->start);
+
+    write_align(writer);
+    header->restarts_off = LE64(writer->offset);
+    write_bytes(writer, section->restarts, (section->count + MANIFEST_BLOCK_ENTRIES - 1) / MANIFEST_BLOCK_ENTRIES *
+                                           sizeof(uint64_t));
+
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        write_align(writer);
+        *offsets[c] = LE64(writer->offset);
+        if (out.columns[c]) {
+            if (!out.failed) copy_column(writer, out.columns[c]);
+            fclose(out.columns[c]);
+        }
+    }
+    if (out.failed) writer->failed = 1;
+
+    log_info("매니페스트: 정렬 구간 %zu개 병합 (%zu개 항목)", builder->run_count, section->count);
+    return out.total_bytes;
+}
+
+// 정렬 후 <backup_path>/.backup_manifest 에 원자적으로 기록 (임시 파일 후 rename)
+int manifest_builder_write(manifest_builder_t *builder, const char *backup_path) {
+    char path[MAX_PATH];
+    char temp_path[MAX_PATH];
+    manifest_header_t header;
+    manifest_writer_t writer = { NULL, 0, 0 };
+    path_section_t *section;
+    size_t count, block_count;
+    uint8_t digest_len = (uint8_t)checksum_digest_size(builder->checksum_type);
+    uint64_t total_bytes = 0;
+
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_MANIFEST_FILE) >= sizeof(path) ||
+        (size_t)snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= sizeof(temp_path)) {
+        log_error("경로가 너무 깁니다: %s", backup_path);
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (builder->run_count > 0) {
+        // 남은 항목도 구간으로 내보내고 전부 병합
+        if (builder->count > 0 && spill_run(builder) != SUCCESS) {
+            return ERROR_FILE_WRITE;
+        }
+    } else {
+        sort_records(builder);
+        for (size_t i = 0; i < builder->count; i++) {
+            if (builder->records[i].type == 'F') total_bytes += builder->records[i].size;
+            if (builder->records[i].type == 'D' && builder->drop_summaries) builder->records[i].offset = 0;
+        }
+    }
+
+    section = calloc(1, sizeof(*section));
+    if (!section) return ERROR_MEMORY;
+
+    writer.file = fopen(temp_path, "wb");
+    if (!writer.file) {
+        log_error("매니페스트 파일 생성 실패: %s", temp_path);
+        free(section);
+        return ERROR_FILE_WRITE;
+    }
+
+    memset(&header, 0, sizeof(header));
+    write_bytes(&writer, &header, sizeof(header));
+
+    section->start = writer.offset;
+    header.paths_off = LE64(section->start);
+    if (builder->run_count > 0) {
+        total_bytes = write_merged_sections(builder, &writer, &header, section);
+    } else {
+        write_memory_sections(builder, &writer, &header, section);
+    }
+    count = section->count;
+    block_count = (count + MANIFEST_BLOCK_ENTRIES - 1) / MANIFEST_BLOCK_ENTRIES;
+    free(section->restarts);
+    free(section);
+
+    write_align(&writer);
+    uint64_t strings_off = writer.offset;
+    header.strings_off = LE64(strings_off);
+    for (size_t i = 0; i < builder->string_count; i++) {
+        uint16_t len = (uint16_t)strlen(builder->strings[i]);
+        uint16_t len_le = LE16(len);
+        write_bytes(&writer, &len_le, sizeof(len_le));
+        write_bytes(&writer, builder->strings[i], len);
+    }
+    header.strings_len = LE64(writer.offset - strings_off);
+    write_align(&writer);
+
+    memcpy(header.magic, MANIFEST_MAGIC, sizeof(header.magic));
+    header.version = LE32(MANIFEST_VERSION);
+    header.header_size = LE32((uint32_t)sizeof(header));
+    header.entry_count = LE64((uint64_t)count);
+    header.block_count = LE64((uint64_t)block_count);
+    header.file_size = LE64(writer.offset);
+    header.created = LE64((int64_t)g_stats.start_time);
+    header.total_bytes = LE64(total_bytes);
+    header.string_count = LE32((uint32_t)builder->string_count);
+    header.checksum_type = (uint8_t)builder->checksum_type;
+    header.compression = (uint8_t)builder->compression;
+    header.mode = (uint8_t)builder->mode;
+    header.digest_len = digest_len;
+
+    if (fseek(writer.file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, writer.file) != 1) {
+        writer.failed = 1;
+    }
+    if (fclose(writer.file) != 0) {
+        writer.failed = 1;
+    }
+
+    if (writer.failed || rename(temp_path, path) != 0) {
+        log_error("매니페스트 쓰기 실패: %s", path);
+        unlink(temp_path);
+        return ERROR_FILE_WRITE;
+    }
+
+    log_debug("매니페스트 기록: %s (%zu개 항목, %zu개 블록)", path, count, block_count);
+    return SUCCESS;
+}
+
+// ---- 읽기 (mmap) ----
+
+static uint64_t load_u64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return LE64(v);
+}
+
+static uint32_t load_u32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return LE32(v);
+}
+
+static uint16_t load_u16(const unsigned char *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return LE16(v);
+}
+
+#define COLUMN(index, header, field, pos, width) \
+    ((index)->map + LE64((header)->field) + (size_t)(pos) * (width))
+
+
+// mode 열 위치 (버전 1은 기록된 위치 뒤 8바이트 정렬 패딩 다음에 실제 열이 있음)
+static uint64_t modes_offset(const manifest_header_t *header) {
+    uint64_t offset = LE64(header->modes_off);
+
+    return LE32(header->version) == 1 ? (offset + 7) & ~(uint64_t)7 : offset;
+}
+
+static const manifest_header_t *manifest_header(const backup_index_t *index) {
+    return (const manifest_header_t *)index->map;
+}
+
+static int section_valid(uint64_t offset, uint64_t len, size_t map_size) {
+    return offset <= map_size && len <= map_size - offset;
+}
+
+int manifest_open(const char *backup_path, backup_index_t *index) {
+    char path[MAX_PATH];
+    struct stat st;
+    const manifest_header_t *header;
+    void *map;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", backup_path, BACKUP_MANIFEST_FILE);
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(manifest_header_t)) {
+        close(fd);
+        log_warning("매니페스트가 손상되었습니다: %s", path);
+        return ERROR_FILE_READ;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_warning("매니페스트 mmap 실패: %s", path);
+        return ERROR_FILE_READ;
+    }
+
+    header = (const manifest_header_t *)map;
+    {
+        size_t size = (size_t)st.st_size;
+        uint64_t count = LE64(header->entry_count);
+        uint64_t blocks = LE64(header->block_count);
+        int valid =
+            memcmp(header->magic, MANIFEST_MAGIC, sizeof(header->magic)) == 0 &&
+            (LE32(header->version) == MANIFEST_VERSION || LE32(header->version) == 1) &&
+            LE32(header->header_size) == sizeof(manifest_header_t) &&
+            LE64(header->file_size) == size &&
+            header->digest_len <= MAX_DIGEST_SIZE &&
+            count <= size && blocks == (count + MANIFEST_BLOCK_ENTRIES - 1) / MANIFEST_BLOCK_ENTRIES &&
+            section_valid(LE64(header->paths_off), LE64(header->paths_len), size) &&
+            section_valid(LE64(header->restarts_off), blocks * 8, size) &&
+            section_valid(LE64(header->sizes_off), count * 8, size) &&
+            section_valid(LE64(header->mtimes_off), count * 8, size) &&
+            section_valid(LE64(header->inodes_off), count * 8, size) &&
+            section_valid(LE64(header->offsets_off), count * 8, size) &&
+            section_valid(LE64(header->nsecs_off), count * 4, size) &&
+            section_valid(modes_offset(header), count * 4, size) &&
+            section_valid(LE64(header->origins_off), count * 2, size) &&
+            section_valid(LE64(header->types_off), count, size) &&
+            section_valid(LE64(header->codecs_off), count, size) &&
+            section_valid(LE64(header->flags_off), count, size) &&
+            section_valid(LE64(header->hashes_off), count * header->digest_len, size) &&
+            section_valid(LE64(header->strings_off), LE64(header->strings_len), size);
+
+        if (!valid) {
+            munmap(map, size);
+            log_warning("매니페스트 형식이 올바르지 않습니다: %s", path);
+            return ERROR_FILE_READ;
+        }
+    }
+
+    memset(index, 0, sizeof(*index));
+    index->map = (const unsigned char *)map;
+    index->map_size = (size_t)st.st_size;
+    index->count = (size_t)LE64(header->entry_count);
+    index->checksum_type = (checksum_type_t)header->checksum_type;
+    index->compression = (compression_type_t)header->compression;
+    index->mode = (backup_mode_t)header->mode;
+    manifest_string(index, 0, index->base, sizeof(index->base));
+
+    log_debug("매니페스트 열기: %s (%zu개 항목)", path, index->count);
+    return SUCCESS;
+}
+
+void manifest_close(backup_index_t *index) {
+    if (index->map) {
+        munmap((void *)index->map, index->map_size);
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+// 문자열 표의 id번째 문자열 (기준 백업/origin 이름)
+int manifest_string(const backup_index_t *index, uint32_t id, char *out, size_t size) {
+    const manifest_header_t *header = manifest_header(index);
+    const unsigned char *p = index->map + LE64(header->strings_off);
+    const unsigned char *end = p + LE64(header->strings_len);
+
+    out[0] = '\0';
+    if (id >= LE32(header->string_count)) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; p + 2 <= end; i++) {
+        uint16_t len = load_u16(p);
+
+        p += 2;
+        if (len > (size_t)(end - p)) break;
+        if (i == id) {
+            size_t copy = MIN((size_t)len, size - 1);
+            memcpy(out, p, copy);
+            out[copy] = '\0';
+            return 1;
+        }
+        p += len;
+    }
+    return 0;
+}
+
+static const unsigned char *read_varint(const unsigned char *p, const unsigned char *end, uint64_t *value) {
+    uint64_t result = 0;
+
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char byte = *p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// paths 섹션의 offset 위치 항목을 key(이전 경로)에 이어 붙여 복원, 다음 항목 위치 반환
+static const unsigned char *decode_path(const backup_index_t *index, const unsigned char *p, char *key) {
+    const manifest_header_t *header = manifest_header(index);
+    const unsigned char *end = index->map + LE64(header->paths_off) + LE64(header->paths_len);
+    uint64_t shared, suffix;
+
+    p = read_varint(p, end, &shared);
+    if (!p) return NULL;
+    p = read_varint(p, end, &suffix);
+    if (!p || shared > strlen(key) || suffix > (uint64_t)(end - p) || shared + suffix >= MAX_PATH) {
+        return NULL;
+    }
+
+    memcpy(key + shared, p, suffix);
+    key[shared + suffix] = '\0';
+    return p + suffix;
+}
+
+static const unsigned char *block_start(const backup_index_t *index, size_t block) {
+    const manifest_header_t *header = manifest_header(index);
+    uint64_t offset;
+
+    offset = load_u64(COLUMN(index, header, restarts_off, block, 8));
+    if (offset >= LE64(header->paths_len)) {
+        return NULL;
+    }
+    return index->map + LE64(header->paths_off) + offset;
+}
+
+static void fill_entry(const backup_index_t *index, size_t pos, index_entry_t *entry) {
+    const manifest_header_t *header = manifest_header(index);
+    uint16_t origin;
+    uint8_t flags;
+
+    memset(entry, 0, sizeof(*entry));
+    entry->size = (size_t)load_u64(COLUMN(index, header, sizes_off, pos, 8));
+    entry->mtime = (time_t)(int64_t)load_u64(COLUMN(index, header, mtimes_off, pos, 8));
+    entry->inode = load_u64(COLUMN(index, header, inodes_off, pos, 8));
+    entry->offset = load_u64(COLUMN(index, header, offsets_off, pos, 8));
+    entry->mtime_nsec = (long)load_u32(COLUMN(index, header, nsecs_off, pos, 4));
+    entry->file_mode = load_u32(index->map + modes_offset(header) + (size_t)pos * 4);
+    origin = load_u16(COLUMN(index, header, origins_off, pos, 2));
+    entry->type = (char)*COLUMN(index, header, types_off, pos, 1);
+    entry->codec = *COLUMN(index, header, codecs_off, pos, 1);
+    flags = *COLUMN(index, header, flags_off, pos, 1);
+
+    if (flags & MANIFEST_FLAG_CHECKSUM) {
+        const unsigned char *digest = COLUMN(index, header, hashes_off, pos, header->digest_len);
+
+        for (size_t i = 0; i < header->digest_len; i++) {
+            snprintf(entry->checksum + i * 2, 3, "%02x", digest[i]);
+        }
+    }
+
+    if (origin != 0) {
+        manifest_string(index, origin, entry->origin, sizeof(entry->origin));
+    }
+}
+
+// 이진 탐색 (블록 첫 경로) 후 블록 안에서 순차 비교; 찾으면 1
+int manifest_find(const backup_index_t *index, const char *path, index_entry_t *entry) {
+    const manifest_header_t *header = manifest_header(index);
+    size_t blocks = (size_t)LE64(header->block_count);
+    size_t lo = 0, hi = blocks;
+    char key[MAX_PATH];
+    const unsigned char *p;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        key[0] = '\0';
+        p = block_start(index, mid);
+        if (!p || !decode_path(index, p, key)) return 0;
+
+        if (strcmp(key, path) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) return 0;
+
+    size_t block = lo - 1;
+    size_t first = block * MANIFEST_BLOCK_ENTRIES;
+    size_t last = MIN(first + MANIFEST_BLOCK_ENTRIES, index->count);
+
+    key[0] = '\0';
+    p = block_start(index, block);
+    for (size_t pos = first; p && pos < last; pos++) {
+        int cmp;
+
+        p = decode_path(index, p, key);
+        if (!p) return 0;
+
+        cmp = strcmp(key, path);
+        if (cmp == 0) {
+            fill_entry(index, pos, entry);
+            return 1;
+        }
+        if (cmp > 0) break;
+    }
+    return 0;
+}
+
+// pos번째 항목 (경로는 path 버퍼에 복원, entry->path가 이를 가리킴)
+int manifest_get(const backup_index_t *index, size_t pos, index_entry_t *entry, char *path, size_t size) {
+    size_t first = pos - pos % MANIFEST_BLOCK_ENTRIES;
+    const unsigned char *p;
+    char key[MAX_PATH];
+
+    if (pos >= index->count) return 0;
+
+    key[0] = '\0';
+    p = block_start(index, pos / MANIFEST_BLOCK_ENTRIES);
+    for (size_t i = first; p && i <= pos; i++) {
+        p = decode_path(index, p, key);
+    }
+    if (!p) return 0;
+
+    fill_entry(index, pos, entry);
+    snprintf(path, size, "%s", key);
+    entry->path = path;
+    return 1;
+}
+
+// path 이상인 첫 항목 위치 (경로순 정렬이므로 접두 범위의 시작/끝 탐색에 사용)
+size_t manifest_lower_bound(const backup_index_t *index, const char *path) {
+    const manifest_header_t *header = manifest_header(index);
+    size_t blocks = (size_t)LE64(header->block_count);
+    size_t lo = 0, hi = blocks;
+    char key[MAX_PATH];
+    const unsigned char *p;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        key[0] = '\0';
+        p = block_start(index, mid);
+        if (!p || !decode_path(index, p, key)) return index->count;
+
+        if (strcmp(key, path) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) return 0;
+
+    size_t block = lo - 1;
+    size_t first = block * MANIFEST_BLOCK_ENTRIES;
+    size_t last = MIN(first + MANIFEST_BLOCK_ENTRIES, index->count);
+
+    key[0] = '\0';
+    p = block_start(index, block);
+    for (size_t pos = first; p && pos < last; pos++) {
+        p = decode_path(index, p, key);
+        if (!p) return index->count;
+        if (strcmp(key, path) >= 0) return pos;
+    }
+    return last;
+}
@@ -0,0 +1,104 @@
+#include "backup.h"
+#include <sys/resource.h>
+
+// 메모리 예산 (--memory-limit)
+//
+// 항목 수에 비례해 커지는 구조마다 예산의 일정 몫(MEMORY_SHARE_*)을 주고, 몫을 넘으면 각자
+// 디스크로 물러남: 매니페스트 기록 버퍼는 정렬 구간을 내보내 나중에 병합, 청크 색인은 더 키우지
+// 않고 표에 없는 해시를 청크 파일로 확인, 이동 감지 표는 만들지 않음. 몫은 구조가 스스로 세는
+// 크기로 판단하고, 실제 RSS 는 /proc/self/statm 으로 함께 확인 (다른 곳에서 쓴 메모리까지 포함).
+// 나머지 몫은 작업 스레드 버퍼, 디렉토리 순회, mmap 한 인덱스 페이지 몫.
+
+static size_t limit_bytes = 0;
+static unsigned spill_seq = 0;
+
+void memory_init(const backup_options_t *opts) {
+    limit_bytes = opts->memory_limit;
+    if (limit_bytes > 0) {
+        log_debug("메모리 예산: %zu bytes (현재 RSS %zu bytes)", limit_bytes, memory_rss());
+    }
+}
+
+size_t memory_limit(void) {
+    return limit_bytes;
+}
+
+// 예산의 share% (제한이 없으면 SIZE_MAX)
+size_t memory_budget(int share) {
+    if (limit_bytes == 0) {
+        return SIZE_MAX;
+    }
+    return limit_bytes / 100 * (size_t)share;
+}
+
+// 현재 RSS (읽을 수 없으면 0)
+size_t memory_rss(void) {
+    unsigned long pages = 0, resident = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+
+    if (!file) return 0;
+    if (fscanf(file, "%lu %lu", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(file);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+size_t memory_peak_rss(void) {
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+// RSS 가 예산의 90% 를 넘었으면 1 (내보낼 수 있는 구조가 먼저 물러나도록 여유를 둠)
+int memory_over_limit(void) {
+    if (limit_bytes == 0) {
+        return 0;
+    }
+    return memory_rss() >= limit_bytes / 10 * 9;
+}
+
+void memory_note_spill(size_t bytes) {
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.spill_runs++;
+    g_stats.bytes_spilled += bytes;
+    pthread_mutex_unlock(&g_stats_mutex);
+}
+
+// dir 안에 만들고 바로 지운 임시 파일 (닫거나 비정상 종료하면 사라짐)
+// /tmp 는 tmpfs 일 수 있어 메모리를 아끼는 의미가 없으므로 백업 대상 쪽 디렉토리를 사용
+FILE *memory_spill_file(const char *dir) {
+    char path[MAX_PATH];
+    unsigned seq = __atomic_fetch_add(&spill_seq, 1, __ATOMIC_RELAXED);
+    FILE *file;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/.spill.%ld.%u", dir, (long)getpid(), seq);
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        log_error("임시 파일 생성 실패: %s (%s)", path, strerror(errno));
+        return NULL;
+    }
+    unlink(path);
+
+    file = fdopen(fd, "w+b");
+    if (!file) {
+        close(fd);
+        return NULL;
+    }
+    return file;
+}
+
+// monitor_memory=1 일 때 작업 끝에 한 줄 기록
+void memory_report(void) {
+    size_t peak = memory_peak_rss();
+
+    if (limit_bytes > 0) {
+        log_info("메모리: 최대 RSS %.1f MB / 예산 %.1f MB, 디스크로 내보낸 구간 %zu개 (%zu bytes)",
+                 peak / (1024.0 * 1024.0), limit_bytes / (1024.0 * 1024.0),
+                 g_stats.spill_runs, g_stats.bytes_spilled);
+    } else {
+        log_info("메모리: 최대 RSS %.1f MB (예산 없음)", peak / (1024.0 * 1024.0));
+    }
+}
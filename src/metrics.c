@@ -0,0 +1,667 @@
+#include "backup.h"
+
+// 성능 지표 (save_statistics / --stats-file)
+// 단계별 시간은 CLOCK_MONOTONIC 나노초를 원자적으로 더한 스레드 합계 (병렬 작업이면 벽시계보다 큼).
+// 읽기/압축/쓰기는 입출력 버퍼 단위로 재므로 파일 하나에 몇 번의 clock_gettime 만 추가됨.
+// 작업이 끝나면 같은 값을 JSON 과 Prometheus textfile (node_exporter textfile 수집기용) 로 기록하고,
+// 각 파일은 임시 파일에 쓴 뒤 rename 하므로 수집기가 반쯤 쓴 파일을 읽지 않음.
+//
+// 파일 지연: metrics_file_begin/end 사이의 단계 시간을 파일 하나의 값으로 모아 단계별 히스토그램에
+// 넣고, 벽시계 전체 시간으로 가장 느린 파일 SLOW_TOP 개를 유지함. 디렉토리는 walk.c 가 하위
+// 디렉토리를 뺀 시간을 알려줌. 히스토그램은 HDR 방식 (2의 거듭제곱 구간을 LATENCY_SUB 칸으로
+// 나눔, 상대 오차 12.5% 이하). 기록은 스레드별 블록에만 하므로 원자 연산이나 잠금이 없고
+// (파일당 단계 수만큼 덧셈), 스레드가 끝나면 블록을 retired 에 합침. 보고는 작업이 끝난 뒤.
+
+#define METRICS_CODECS 3
+#define LATENCY_SUB_BITS 3
+#define LATENCY_SUB (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS 47           // 2^48 ns (약 78시간) 이상은 마지막 칸
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 2) * LATENCY_SUB)
+#define LATENCY_FILE METRIC_PHASES    // 파일 전체 (벽시계, 잠금 대기 포함)
+#define LATENCY_KINDS (METRIC_PHASES + 1)
+#define SLOW_TOP 10
+#define SLOW_SUMMARY 5
+
+typedef struct {
+    uint64_t ns;
+    uint64_t bytes;
+    uint64_t files;
+} phase_counter_t;
+
+typedef struct {
+    uint64_t files;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+} codec_counter_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+typedef struct {
+    uint64_t ns;
+    char path[MAX_PATH];
+} slow_entry_t;
+
+typedef struct {
+    slow_entry_t entries[SLOW_TOP];
+    int count;
+    uint64_t floor_ns;            // 가득 찼을 때 가장 빠른 항목 (이하면 바로 버림)
+} slow_list_t;
+
+typedef struct latency_block {
+    struct latency_block *prev;
+    struct latency_block *next;
+    latency_hist_t hist[LATENCY_KINDS];
+    slow_list_t files;
+    slow_list_t dirs;
+} latency_block_t;
+
+static const char *phase_names[LATENCY_KINDS] = {
+    "scan", "open", "read", "compress", "write", "metadata", "verify", "file"
+};
+static phase_counter_t phases[METRIC_PHASES];
+static codec_counter_t codecs[METRICS_CODECS];
+static uint64_t run_start_ns = 0;
+
+static latency_block_t retired;               // 끝난 스레드들의 합
+static latency_block_t *live_blocks = NULL;
+static pthread_mutex_t latency_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t latency_key;
+static pthread_once_t latency_once = PTHREAD_ONCE_INIT;
+static __thread latency_block_t *tls_latency = NULL;
+static __thread int file_active = 0;
+static __thread uint64_t file_start_ns;
+static __thread uint64_t file_ns[METRIC_PHASES];
+
+uint64_t metrics_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_start(void) {
+    memset(phases, 0, sizeof(phases));
+    memset(codecs, 0, sizeof(codecs));
+    pthread_mutex_lock(&latency_mutex);
+    memset(&retired, 0, sizeof(retired));
+    pthread_mutex_unlock(&latency_mutex);
+    run_start_ns = metrics_now();
+}
+
+// 이미 잰 구간 ns 를 phase 에 더함 (되돌아갈 수 있는 시도를 성공한 뒤에만 기록할 때)
+void metrics_add(metric_phase_t phase, uint64_t ns, size_t bytes) {
+    __atomic_fetch_add(&phases[phase].ns, ns, __ATOMIC_RELAXED);
+    if (file_active) {
+        file_ns[phase] += ns;
+    }
+    if (bytes) {
+        __atomic_fetch_add(&phases[phase].bytes, (uint64_t)bytes, __ATOMIC_RELAXED);
+    }
+}
+
+// *since 부터 지금까지를 phase 에 더하고 *since 를 지금으로 (다음 단계를 이어서 잴 수 있게)
+void metrics_lap(metric_phase_t phase, uint64_t *since, size_t bytes) {
+    uint64_t now = metrics_now();
+
+    metrics_add(phase, now - *since, bytes);
+    *since = now;
+}
+
+void metrics_count(metric_phase_t phase, size_t bytes, size_t files) {
+    if (bytes) {
+        __atomic_fetch_add(&phases[phase].bytes, (uint64_t)bytes, __ATOMIC_RELAXED);
+    }
+    if (files) {
+        __atomic_fetch_add(&phases[phase].files, (uint64_t)files, __ATOMIC_RELAXED);
+    }
+}
+
+// 코덱별 원본/저장 바이트 (압축률)
+void metrics_codec(compression_type_t codec, size_t bytes_in, size_t bytes_out) {
+    codec_counter_t *counter = &codecs[(unsigned)codec < METRICS_CODECS ? codec : COMPRESS_NONE];
+
+    __atomic_fetch_add(&counter->files, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&counter->bytes_in, (uint64_t)bytes_in, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&counter->bytes_out, (uint64_t)bytes_out, __ATOMIC_RELAXED);
+}
+
+// metrics_start 이후 경과 시간 (초)
+double metrics_elapsed(void) {
+    return (metrics_now() - run_start_ns) / 1e9;
+}
+
+static int latency_bucket(uint64_t ns) {
+    int msb;
+
+    if (ns < LATENCY_SUB) {
+        return (int)ns;
+    }
+    if (ns >> (LATENCY_MAX_BITS + 1)) {
+        return LATENCY_BUCKETS - 1;
+    }
+    msb = 63 - __builtin_clzll(ns);
+    return (msb - LATENCY_SUB_BITS + 1) * LATENCY_SUB + (int)((ns >> (msb - LATENCY_SUB_BITS)) & (LATENCY_SUB - 1));
+}
+
+// 칸의 하한 (칸 index 의 값은 [하한, 다음 칸 하한))
+static uint64_t latency_bucket_floor(int index) {
+    int msb;
+
+    if (index < LATENCY_SUB) {
+        return (uint64_t)index;
+    }
+    msb = index / LATENCY_SUB + LATENCY_SUB_BITS - 1;
+    return (uint64_t)(LATENCY_SUB + index % LATENCY_SUB) << (msb - LATENCY_SUB_BITS);
+}
+
+static void hist_record(latency_hist_t *hist, uint64_t ns) {
+    hist->count++;
+    hist->sum_ns += ns;
+    if (ns > hist->max_ns) hist->max_ns = ns;
+    hist->buckets[latency_bucket(ns)]++;
+}
+
+static void hist_merge(latency_hist_t *into, const latency_hist_t *from) {
+    if (from->count == 0) return;
+    into->count += from->count;
+    into->sum_ns += from->sum_ns;
+    if (from->max_ns > into->max_ns) into->max_ns = from->max_ns;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        into->buckets[i] += from->buckets[i];
+    }
+}
+
+// q 분위수 (그 값이 든 칸의 상한, 최대값을 넘지 않음)
+static uint64_t hist_quantile(const latency_hist_t *hist, double q) {
+    uint64_t target = (uint64_t)(q * hist->count + 0.5);
+    uint64_t seen = 0;
+
+    if (target == 0) target = 1;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            uint64_t upper = i + 1 < LATENCY_BUCKETS ? latency_bucket_floor(i + 1) - 1 : hist->max_ns;
+            return upper < hist->max_ns ? upper : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+// 느린 항목 목록에 넣음 (같은 경로는 더 느린 쪽만, 가득 차면 가장 빠른 항목을 밀어냄)
+static void slow_insert(slow_list_t *list, const char *path, size_t len, uint64_t ns) {
+    int slot = -1;
+
+    if (list->count == SLOW_TOP && ns <= list->floor_ns) {
+        return;
+    }
+    if (len >= MAX_PATH) {
+        len = MAX_PATH - 1;
+    }
+    for (int i = 0; i < list->count; i++) {
+        if (strncmp(list->entries[i].path, path, len) == 0 && list->entries[i].path[len] == '\0') {
+            if (ns <= list->entries[i].ns) return;
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        if (list->count < SLOW_TOP) {
+            slot = list->count++;
+        } else {
+            slot = 0;
+            for (int i = 1; i < SLOW_TOP; i++) {
+                if (list->entries[i].ns < list->entries[slot].ns) slot = i;
+            }
+        }
+        memcpy(list->entries[slot].path, path, len);
+        list->entries[slot].path[len] = '\0';
+    }
+    list->entries[slot].ns = ns;
+
+    if (list->count == SLOW_TOP) {
+        list->floor_ns = list->entries[0].ns;
+        for (int i = 1; i < SLOW_TOP; i++) {
+            if (list->entries[i].ns < list->floor_ns) list->floor_ns = list->entries[i].ns;
+        }
+    }
+}
+
+static void slow_merge(slow_list_t *into, const slow_list_t *from) {
+    for (int i = 0; i < from->count; i++) {
+        slow_insert(into, from->entries[i].path, strlen(from->entries[i].path), from->entries[i].ns);
+    }
+}
+
+static int slow_compare(const void *a, const void *b) {
+    uint64_t x = ((const slow_entry_t *)a)->ns, y = ((const slow_entry_t *)b)->ns;
+    return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+static void block_merge(latency_block_t *into, const latency_block_t *from) {
+    for (int i = 0; i < LATENCY_KINDS; i++) {
+        hist_merge(&into->hist[i], &from->hist[i]);
+    }
+    slow_merge(&into->files, &from->files);
+    slow_merge(&into->dirs, &from->dirs);
+}
+
+// 스레드가 끝날 때: 블록을 retired 에 합치고 목록에서 뺌
+static void retire_block(void *arg) {
+    latency_block_t *block = (latency_block_t *)arg;
+
+    pthread_mutex_lock(&latency_mutex);
+    block_merge(&retired, block);
+    if (block->prev) block->prev->next = block->next;
+    else live_blocks = block->next;
+    if (block->next) block->next->prev = block->prev;
+    pthread_mutex_unlock(&latency_mutex);
+    free(block);
+}
+
+static void create_latency_key(void) {
+    pthread_key_create(&latency_key, retire_block);
+}
+
+static latency_block_t *latency_block(void) {
+    if (!tls_latency) {
+        latency_block_t *block = calloc(1, sizeof(*block));
+
+        if (!block) return NULL;
+        pthread_once(&latency_once, create_latency_key);
+        pthread_setspecific(latency_key, block);
+        pthread_mutex_lock(&latency_mutex);
+        block->next = live_blocks;
+        if (live_blocks) live_blocks->prev = block;
+        live_blocks = block;
+        pthread_mutex_unlock(&latency_mutex);
+        tls_latency = block;
+    }
+    return tls_latency;
+}
+
+// 파일 하나의 처리 시작: 이후 이 스레드의 metrics_lap 을 파일 단계 시간으로도 모음
+void metrics_file_begin(void) {
+    memset(file_ns, 0, sizeof(file_ns));
+    file_start_ns = metrics_now();
+    file_active = 1;
+}
+
+// 파일 하나의 처리 끝: 거친 단계마다 히스토그램에 넣고 느린 파일 목록 갱신
+void metrics_file_end(const char *path) {
+    latency_block_t *block;
+    uint64_t total;
+
+    if (!file_active) return;
+    file_active = 0;
+    total = metrics_now() - file_start_ns;
+
+    block = latency_block();
+    if (!block) return;
+    for (int i = 0; i < METRIC_PHASES; i++) {
+        if (file_ns[i]) {
+            hist_record(&block->hist[i], file_ns[i]);
+        }
+    }
+    hist_record(&block->hist[LATENCY_FILE], total);
+    slow_insert(&block->files, path, strlen(path), total);
+}
+
+// 디렉토리에서 보낸 시간 (하위 디렉토리 제외, path 의 앞 len 바이트가 디렉토리 경로)
+void metrics_directory(const char *path, size_t len, uint64_t ns) {
+    latency_block_t *block = latency_block();
+
+    if (block) {
+        slow_insert(&block->dirs, path, len, ns);
+    }
+}
+
+// retired 와 살아 있는 스레드 블록의 합 (느린 목록은 느린 순으로 정렬, 실패하면 NULL)
+static latency_block_t *latency_collect(void) {
+    latency_block_t *total = calloc(1, sizeof(*total));
+
+    if (!total) return NULL;
+    pthread_mutex_lock(&latency_mutex);
+    block_merge(total, &retired);
+    for (latency_block_t *block = live_blocks; block; block = block->next) {
+        block_merge(total, block);
+    }
+    pthread_mutex_unlock(&latency_mutex);
+    qsort(total->files.entries, (size_t)total->files.count, sizeof(slow_entry_t), slow_compare);
+    qsort(total->dirs.entries, (size_t)total->dirs.count, sizeof(slow_entry_t), slow_compare);
+    return total;
+}
+
+// 작업 요약에 붙는 지연 분포와 느린 파일/디렉토리 (기록된 파일이 없으면 출력 없음)
+void metrics_print_latency(FILE *out) {
+    latency_block_t *total = latency_collect();
+
+    if (!total) return;
+    if (total->hist[LATENCY_FILE].count > 0) {
+        fprintf(out, "파일별 지연 (ms, p50 / p90 / p99 / 최대):\n");
+        for (int i = 0; i < LATENCY_KINDS; i++) {
+            const latency_hist_t *hist = &total->hist[i];
+
+            if (hist->count == 0) continue;
+            fprintf(out, "  %-9s %9.3f / %9.3f / %9.3f / %9.3f  (%llu개)\n", phase_names[i],
+                    hist_quantile(hist, 0.50) / 1e6, hist_quantile(hist, 0.90) / 1e6,
+                    hist_quantile(hist, 0.99) / 1e6, hist->max_ns / 1e6, (unsigned long long)hist->count);
+        }
+        fprintf(out, "가장 느린 파일:\n");
+        for (int i = 0; i < total->files.count && i < SLOW_SUMMARY; i++) {
+            fprintf(out, "  %9.3f ms  %s\n", total->files.entries[i].ns / 1e6, total->files.entries[i].path);
+        }
+    }
+    if (total->dirs.count > 0) {
+        fprintf(out, "가장 느린 디렉토리 (하위 디렉토리 제외):\n");
+        for (int i = 0; i < total->dirs.count && i < SLOW_SUMMARY; i++) {
+            fprintf(out, "  %9.3f ms  %s\n", total->dirs.entries[i].ns / 1e6, total->dirs.entries[i].path);
+        }
+    }
+    free(total);
+}
+
+static const char *codec_name(int codec) {
+    switch (codec) {
+        case COMPRESS_GZIP:
+            return "gzip";
+        case COMPRESS_ZLIB:
+            return "zlib";
+        default:
+            return "none";
+    }
+}
+
+static double codec_ratio(const codec_counter_t *counter) {
+    return counter->bytes_in > 0 ? (double)counter->bytes_out / counter->bytes_in : 0.0;
+}
+
+static void write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *p = (const unsigned char *)(text ? text : ""); *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(file, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(file, "\\u%04x", *p);
+        } else {
+            fputc(*p, file);
+        }
+    }
+    fputc('"', file);
+}
+
+typedef struct {
+    const char *command;
+    const char *source;
+    const char *dest;
+    int result;
+    double elapsed;
+    size_t log_errors;
+    size_t log_warnings;
+    size_t peak_rss;
+    latency_block_t *latency;
+} metrics_run_t;
+
+// Prometheus 히스토그램 경계: 2^k ns (HDR 칸 경계와 정확히 맞음, 약 1us ~ 69초)
+static const int prometheus_le_bits[] = {10, 13, 16, 20, 23, 26, 30, 33, 36};
+
+static void write_json_slow(FILE *file, const char *name, const slow_list_t *list) {
+    fprintf(file, "  \"%s\": [", name);
+    for (int i = 0; i < list->count; i++) {
+        fprintf(file, "%s\n    {\"path\": ", i ? "," : "");
+        write_json_string(file, list->entries[i].path);
+        fprintf(file, ", \"seconds\": %.6f}", list->entries[i].ns / 1e9);
+    }
+    fprintf(file, "%s],\n", list->count ? "\n  " : "");
+}
+
+// 단계별 파일 지연: 분위수와 0이 아닌 HDR 칸 ([하한 ns, 개수])
+static void write_json_latency(FILE *file, const latency_block_t *latency) {
+    int first = 1;
+
+    fprintf(file, "  \"latency\": {");
+    for (int i = 0; latency && i < LATENCY_KINDS; i++) {
+        const latency_hist_t *hist = &latency->hist[i];
+        int first_bucket = 1;
+
+        if (hist->count == 0) continue;
+        fprintf(file, "%s\n    \"%s\": {\"count\": %llu, \"mean_seconds\": %.9f, \"p50_seconds\": %.9f, "
+                "\"p90_seconds\": %.9f, \"p99_seconds\": %.9f, \"max_seconds\": %.9f,\n      \"buckets_ns\": [",
+                first ? "" : ",", phase_names[i], (unsigned long long)hist->count,
+                hist->sum_ns / 1e9 / hist->count, hist_quantile(hist, 0.50) / 1e9,
+                hist_quantile(hist, 0.90) / 1e9, hist_quantile(hist, 0.99) / 1e9, hist->max_ns / 1e9);
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            if (hist->buckets[b] == 0) continue;
+            fprintf(file, "%s[%llu, %llu]", first_bucket ? "" : ", ",
+                    (unsigned long long)latency_bucket_floor(b), (unsigned long long)hist->buckets[b]);
+            first_bucket = 0;
+        }
+        fprintf(file, "]}");
+        first = 0;
+    }
+    fprintf(file, "\n  },\n");
+    if (latency) {
+        write_json_slow(file, "slowest_files", &latency->files);
+        write_json_slow(file, "slowest_directories", &latency->dirs);
+    }
+}
+
+// Prometheus 레이블 값 (\\, \", 줄바꿈 이스케이프)
+static void write_prometheus_label(FILE *file, const char *text) {
+    for (const char *p = text; *p; p++) {
+        if (*p == '\\' || *p == '"') {
+            fprintf(file, "\\%c", *p);
+        } else if (*p == '\n') {
+            fputs("\\n", file);
+        } else {
+            fputc(*p, file);
+        }
+    }
+}
+
+static void write_prometheus_slow(FILE *file, const char *metric, const char *help, const slow_list_t *list) {
+    fprintf(file, "# HELP %s %s\n# TYPE %s gauge\n", metric, help, metric);
+    for (int i = 0; i < list->count; i++) {
+        fprintf(file, "%s{rank=\"%d\",path=\"", metric, i + 1);
+        write_prometheus_label(file, list->entries[i].path);
+        fprintf(file, "\"} %.6f\n", list->entries[i].ns / 1e9);
+    }
+}
+
+static void write_prometheus_latency(FILE *file, const latency_block_t *latency) {
+    if (!latency) return;
+
+    fprintf(file, "# HELP backup_file_latency_seconds 파일별 단계 지연\n"
+                  "# TYPE backup_file_latency_seconds histogram\n");
+    for (int i = 0; i < LATENCY_KINDS; i++) {
+        const latency_hist_t *hist = &latency->hist[i];
+        uint64_t cumulative = 0;
+        int b = 0;
+
+        if (hist->count == 0) continue;
+        for (size_t k = 0; k < sizeof(prometheus_le_bits) / sizeof(prometheus_le_bits[0]); k++) {
+            uint64_t le = 1ULL << prometheus_le_bits[k];
+
+            // 하한이 le 미만인 칸은 모두 le 이하 (le 는 칸 경계)
+            while (b < LATENCY_BUCKETS && latency_bucket_floor(b) < le) {
+                cumulative += hist->buckets[b++];
+            }
+            fprintf(file, "backup_file_latency_seconds_bucket{phase=\"%s\",le=\"%.9g\"} %llu\n",
+                    phase_names[i], le / 1e9, (unsigned long long)cumulative);
+        }
+        fprintf(file, "backup_file_latency_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n"
+                      "backup_file_latency_seconds_sum{phase=\"%s\"} %.9f\n"
+                      "backup_file_latency_seconds_count{phase=\"%s\"} %llu\n",
+                phase_names[i], (unsigned long long)hist->count, phase_names[i], hist->sum_ns / 1e9,
+                phase_names[i], (unsigned long long)hist->count);
+    }
+    write_prometheus_slow(file, "backup_slow_file_seconds", "가장 느린 파일 (처리 시간)", &latency->files);
+    write_prometheus_slow(file, "backup_slow_directory_seconds", "가장 느린 디렉토리 (하위 디렉토리 제외)",
+                          &latency->dirs);
+}
+
+static void write_json(FILE *file, const metrics_run_t *run) {
+    fprintf(file, "{\n  \"command\": ");
+    write_json_string(file, run->command);
+    fprintf(file, ",\n  \"source\": ");
+    write_json_string(file, run->source);
+    fprintf(file, ",\n  \"destination\": ");
+    write_json_string(file, run->dest);
+    fprintf(file, ",\n  \"status\": \"%s\",\n  \"result_code\": %d,\n",
+            run->result == SUCCESS ? "success" : "failed", run->result);
+    fprintf(file, "  \"start_time\": %lld,\n  \"end_time\": %lld,\n  \"duration_seconds\": %.6f,\n",
+            (long long)g_stats.start_time, (long long)g_stats.end_time, run->elapsed);
+
+    fprintf(file, "  \"files\": {\"processed\": %zu, \"skipped\": %zu, \"failed\": %zu, \"unchanged\": %zu, "
+            "\"linked\": %zu, \"moved\": %zu, \"directories\": %zu},\n",
+            g_stats.files_processed, g_stats.files_skipped, g_stats.files_failed, g_stats.files_unchanged,
+            g_stats.files_linked, g_stats.files_moved, g_stats.directories_processed);
+    fprintf(file, "  \"bytes\": {\"processed\": %zu, \"compressed\": %zu, \"moved\": %zu, \"spilled\": %zu},\n",
+            g_stats.bytes_processed, g_stats.bytes_compressed, g_stats.bytes_moved, g_stats.bytes_spilled);
+
+    fprintf(file, "  \"phases\": {\n");
+    for (int i = 0; i < METRIC_PHASES; i++) {
+        fprintf(file, "    \"%s\": {\"seconds\": %.6f, \"bytes\": %llu, \"files\": %llu}%s\n",
+                phase_names[i], phases[i].ns / 1e9, (unsigned long long)phases[i].bytes,
+                (unsigned long long)phases[i].files, i + 1 < METRIC_PHASES ? "," : "");
+    }
+    fprintf(file, "  },\n");
+
+    fprintf(file, "  \"codecs\": {");
+    for (int i = 0, first = 1; i < METRICS_CODECS; i++) {
+        if (codecs[i].files == 0) continue;
+        fprintf(file, "%s\n    \"%s\": {\"files\": %llu, \"bytes_in\": %llu, \"bytes_out\": %llu, \"ratio\": %.4f}",
+                first ? "" : ",", codec_name(i), (unsigned long long)codecs[i].files,
+                (unsigned long long)codecs[i].bytes_in, (unsigned long long)codecs[i].bytes_out,
+                codec_ratio(&codecs[i]));
+        first = 0;
+    }
+    fprintf(file, "\n  },\n");
+
+    write_json_latency(file, run->latency);
+
+    fprintf(file, "  \"errors\": {\"files_failed\": %zu, \"log_errors\": %zu, \"log_warnings\": %zu},\n",
+            g_stats.files_failed, run->log_errors, run->log_warnings);
+    fprintf(file, "  \"peak_rss_bytes\": %zu\n}\n", run->peak_rss);
+}
+
+static void write_prometheus(FILE *file, const metrics_run_t *run) {
+    fprintf(file, "# HELP backup_last_run_timestamp_seconds 마지막 실행이 끝난 시각\n"
+                  "# TYPE backup_last_run_timestamp_seconds gauge\n"
+                  "backup_last_run_timestamp_seconds{command=\"%s\"} %lld\n",
+            run->command, (long long)g_stats.end_time);
+    fprintf(file, "# HELP backup_last_run_success 마지막 실행 성공 여부\n"
+                  "# TYPE backup_last_run_success gauge\n"
+                  "backup_last_run_success{command=\"%s\"} %d\n",
+            run->command, run->result == SUCCESS);
+    fprintf(file, "# HELP backup_duration_seconds 실행 시간 (monotonic)\n"
+                  "# TYPE backup_duration_seconds gauge\n"
+                  "backup_duration_seconds{command=\"%s\"} %.6f\n",
+            run->command, run->elapsed);
+
+    fprintf(file, "# HELP backup_phase_seconds 단계별 시간 (스레드 합계)\n# TYPE backup_phase_seconds gauge\n");
+    for (int i = 0; i < METRIC_PHASES; i++) {
+        fprintf(file, "backup_phase_seconds{phase=\"%s\"} %.6f\n", phase_names[i], phases[i].ns / 1e9);
+    }
+    fprintf(file, "# HELP backup_phase_bytes 단계별 바이트\n# TYPE backup_phase_bytes gauge\n");
+    for (int i = 0; i < METRIC_PHASES; i++) {
+        fprintf(file, "backup_phase_bytes{phase=\"%s\"} %llu\n", phase_names[i],
+                (unsigned long long)phases[i].bytes);
+    }
+    fprintf(file, "# HELP backup_phase_files 단계별 파일 수\n# TYPE backup_phase_files gauge\n");
+    for (int i = 0; i < METRIC_PHASES; i++) {
+        fprintf(file, "backup_phase_files{phase=\"%s\"} %llu\n", phase_names[i],
+                (unsigned long long)phases[i].files);
+    }
+
+    fprintf(file, "# HELP backup_files 파일 수\n# TYPE backup_files gauge\n"
+                  "backup_files{state=\"processed\"} %zu\nbackup_files{state=\"skipped\"} %zu\n"
+                  "backup_files{state=\"failed\"} %zu\nbackup_files{state=\"unchanged\"} %zu\n"
+                  "backup_files{state=\"linked\"} %zu\nbackup_files{state=\"moved\"} %zu\n",
+            g_stats.files_processed, g_stats.files_skipped, g_stats.files_failed, g_stats.files_unchanged,
+            g_stats.files_linked, g_stats.files_moved);
+    fprintf(file, "# HELP backup_bytes 바이트 수\n# TYPE backup_bytes gauge\n"
+                  "backup_bytes{kind=\"processed\"} %zu\nbackup_bytes{kind=\"compressed\"} %zu\n",
+            g_stats.bytes_processed, g_stats.bytes_compressed);
+
+    fprintf(file, "# HELP backup_codec_bytes 코덱별 원본(in)/저장(out) 바이트\n# TYPE backup_codec_bytes gauge\n");
+    for (int i = 0; i < METRICS_CODECS; i++) {
+        if (codecs[i].files == 0) continue;
+        fprintf(file, "backup_codec_bytes{codec=\"%s\",direction=\"in\"} %llu\n"
+                      "backup_codec_bytes{codec=\"%s\",direction=\"out\"} %llu\n",
+                codec_name(i), (unsigned long long)codecs[i].bytes_in,
+                codec_name(i), (unsigned long long)codecs[i].bytes_out);
+    }
+    fprintf(file, "# HELP backup_codec_ratio 코덱별 저장/원본 비율\n# TYPE backup_codec_ratio gauge\n");
+    for (int i = 0; i < METRICS_CODECS; i++) {
+        if (codecs[i].files == 0) continue;
+        fprintf(file, "backup_codec_ratio{codec=\"%s\"} %.4f\n", codec_name(i), codec_ratio(&codecs[i]));
+    }
+
+    write_prometheus_latency(file, run->latency);
+
+    fprintf(file, "# HELP backup_errors 오류 수\n# TYPE backup_errors gauge\n"
+                  "backup_errors{kind=\"files_failed\"} %zu\nbackup_errors{kind=\"log_errors\"} %zu\n"
+                  "backup_errors{kind=\"log_warnings\"} %zu\n",
+            g_stats.files_failed, run->log_errors, run->log_warnings);
+    fprintf(file, "# HELP backup_peak_rss_bytes 최대 RSS\n# TYPE backup_peak_rss_bytes gauge\n"
+                  "backup_peak_rss_bytes %zu\n", run->peak_rss);
+}
+
+// 임시 파일에 쓰고 rename
+static int write_atomically(const char *path, void (*writer)(FILE *, const metrics_run_t *),
+                            const metrics_run_t *run) {
+    char tmp_path[MAX_PATH];
+    FILE *file;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", path, (long)getpid());
+    file = fopen(tmp_path, "w");
+    if (!file) {
+        log_error("성능 지표 파일 생성 실패: %s (%s)", path, strerror(errno));
+        return ERROR_FILE_OPEN;
+    }
+    writer(file, run);
+    if (fclose(file) != 0 || rename(tmp_path, path) != 0) {
+        log_error("성능 지표 파일 쓰기 실패: %s", path);
+        unlink(tmp_path);
+        return ERROR_FILE_WRITE;
+    }
+    return SUCCESS;
+}
+
+// path (JSON) 와 같은 위치의 .prom 에 기록
+int metrics_write(const char *path, const char *command, const char *source, const char *dest, int result) {
+    char prom_path[MAX_PATH];
+    const char *ext = strrchr(path, '.');
+    metrics_run_t run;
+    int status;
+
+    run.command = command;
+    run.source = source;
+    run.dest = dest;
+    run.result = result;
+    run.elapsed = metrics_elapsed();
+    run.peak_rss = memory_peak_rss();
+    log_counts(&run.log_errors, &run.log_warnings);
+    run.latency = latency_collect();
+
+    if (ext && strcmp(ext, ".json") == 0) {
+        snprintf(prom_path, sizeof(prom_path), "%.*s.prom", (int)(ext - path), path);
+    } else {
+        snprintf(prom_path, sizeof(prom_path), "%s.prom", path);
+    }
+
+    status = write_atomically(path, write_json, &run);
+    if (status == SUCCESS) {
+        status = write_atomically(prom_path, write_prometheus, &run);
+    }
+    if (status == SUCCESS) {
+        log_debug("성능 지표 기록: %s, %s", path, prom_path);
+    }
+    free(run.latency);
+    return status;
+}
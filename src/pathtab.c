@@ -0,0 +1,252 @@
+#include "backup.h"
+
+// 경로 문자열 표
+// 경로를 '/' 로 나눠 (상위 id, 이름) 노드로 저장하고 디렉토리 노드는 해시로 공유하므로
+// 같은 디렉토리 아래 수백만 개 경로도 디렉토리 부분은 한 번만 저장됨.
+// 마지막 구성 요소(파일 이름)는 공유하지 않고 그대로 붙임 (같은 경로를 두 번 넣으면 id 가 둘).
+//   노드 12바이트 + 이름 바이트 + NUL, 디렉토리 노드만 해시 칸 (4바이트, 부하율 1/2 이하)
+// 0번 노드는 빈 경로(루트). 스레드 안전하지 않으므로 호출자가 잠금.
+
+typedef struct {
+    uint32_t parent;
+    uint32_t name;                // names 안 위치
+    uint32_t depth;               // 루트 = 0
+} path_node_t;
+
+struct path_table {
+    path_node_t *nodes;
+    size_t count;
+    size_t capacity;
+    char *names;
+    size_t names_len;
+    size_t names_cap;
+    uint32_t *slots;              // 디렉토리 노드 id (0 = 빈 칸)
+    size_t slot_capacity;
+    size_t slot_count;
+};
+
+#define PATH_TABLE_MAX_NODES UINT32_MAX
+#define PATH_TABLE_MAX_NAMES UINT32_MAX
+
+path_table_t *path_table_create(void) {
+    path_table_t *table = calloc(1, sizeof(*table));
+
+    if (!table) return NULL;
+    if (path_table_reset(table) != SUCCESS) {
+        path_table_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+void path_table_free(path_table_t *table) {
+    if (!table) return;
+    free(table->nodes);
+    free(table->names);
+    free(table->slots);
+    free(table);
+}
+
+// 모든 경로를 버리고 빈 표로 (할당한 메모리는 재사용)
+int path_table_reset(path_table_t *table) {
+    if (!table->nodes) {
+        table->capacity = 1024;
+        table->nodes = malloc(table->capacity * sizeof(path_node_t));
+        if (!table->nodes) return ERROR_MEMORY;
+    }
+    if (!table->names) {
+        table->names_cap = 16384;
+        table->names = malloc(table->names_cap);
+        if (!table->names) return ERROR_MEMORY;
+    }
+    if (!table->slots) {
+        table->slot_capacity = 1024;
+        table->slots = malloc(table->slot_capacity * sizeof(uint32_t));
+        if (!table->slots) return ERROR_MEMORY;
+    }
+    memset(table->slots, 0, table->slot_capacity * sizeof(uint32_t));
+    table->slot_count = 0;
+
+    table->names[0] = '\0';
+    table->names_len = 1;
+    table->nodes[0].parent = 0;
+    table->nodes[0].name = 0;
+    table->nodes[0].depth = 0;
+    table->count = 1;
+    return SUCCESS;
+}
+
+size_t path_table_memory(const path_table_t *table) {
+    return table->capacity * sizeof(path_node_t) + table->names_cap + table->slot_capacity * sizeof(uint32_t);
+}
+
+static uint64_t node_hash(uint32_t parent, const char *name, size_t len) {
+    return XXH3_64bits_withSeed(name, len, parent);
+}
+
+static int append_node(path_table_t *table, uint32_t parent, const char *name, size_t len, uint32_t *id) {
+    path_node_t *node;
+
+    if (table->count >= PATH_TABLE_MAX_NODES || table->names_len + len + 1 > PATH_TABLE_MAX_NAMES) {
+        log_error("경로 표가 가득 찼습니다 (노드 %zu개, 이름 %zu bytes)", table->count, table->names_len);
+        return ERROR_MEMORY;
+    }
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity * 2;
+        path_node_t *nodes = realloc(table->nodes, capacity * sizeof(*nodes));
+
+        if (!nodes) return ERROR_MEMORY;
+        table->nodes = nodes;
+        table->capacity = capacity;
+    }
+    if (table->names_len + len + 1 > table->names_cap) {
+        size_t cap = table->names_cap * 2;
+        char *names;
+
+        while (cap < table->names_len + len + 1) cap *= 2;
+        names = realloc(table->names, cap);
+        if (!names) return ERROR_MEMORY;
+        table->names = names;
+        table->names_cap = cap;
+    }
+
+    node = &table->nodes[table->count];
+    node->parent = parent;
+    node->name = (uint32_t)table->names_len;
+    node->depth = table->nodes[parent].depth + 1;
+    memcpy(table->names + table->names_len, name, len);
+    table->names[table->names_len + len] = '\0';
+    table->names_len += len + 1;
+
+    *id = (uint32_t)table->count++;
+    return SUCCESS;
+}
+
+static int grow_slots(path_table_t *table) {
+    size_t capacity = table->slot_capacity * 2;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+
+    if (!slots) return ERROR_MEMORY;
+    for (size_t i = 0; i < table->slot_capacity; i++) {
+        uint32_t id = table->slots[i];
+        const char *name;
+        size_t pos;
+
+        if (id == 0) continue;
+        name = table->names + table->nodes[id].name;
+        pos = (size_t)node_hash(table->nodes[id].parent, name, strlen(name)) & (capacity - 1);
+        while (slots[pos] != 0) pos = (pos + 1) & (capacity - 1);
+        slots[pos] = id;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_capacity = capacity;
+    return SUCCESS;
+}
+
+// 디렉토리 구성 요소: 같은 (상위, 이름) 노드가 있으면 그 id
+static int intern_directory(path_table_t *table, uint32_t parent, const char *name, size_t len, uint32_t *id) {
+    size_t pos;
+
+    if ((table->slot_count + 1) * 2 > table->slot_capacity && grow_slots(table) != SUCCESS) {
+        return ERROR_MEMORY;
+    }
+
+    pos = (size_t)node_hash(parent, name, len) & (table->slot_capacity - 1);
+    while (table->slots[pos] != 0) {
+        const path_node_t *node = &table->nodes[table->slots[pos]];
+        const char *existing = table->names + node->name;
+
+        if (node->parent == parent && strncmp(existing, name, len) == 0 && existing[len] == '\0') {
+            *id = table->slots[pos];
+            return SUCCESS;
+        }
+        pos = (pos + 1) & (table->slot_capacity - 1);
+    }
+
+    if (append_node(table, parent, name, len, id) != SUCCESS) {
+        return ERROR_MEMORY;
+    }
+    table->slots[pos] = *id;
+    table->slot_count++;
+    return SUCCESS;
+}
+
+// 경로 추가: 디렉토리 부분은 공유, 마지막 구성 요소는 새 노드
+int path_table_add(path_table_t *table, const char *path, uint32_t *id) {
+    uint32_t parent = 0;
+    const char *p = path;
+    const char *slash;
+
+    while ((slash = strchr(p, '/')) != NULL) {
+        if (intern_directory(table, parent, p, (size_t)(slash - p), &parent) != SUCCESS) {
+            return ERROR_MEMORY;
+        }
+        p = slash + 1;
+    }
+    return append_node(table, parent, p, strlen(p), id);
+}
+
+// id 의 전체 경로를 out 에 씀 (공간이 모자라면 ERROR_INVALID_PARAMS)
+int path_table_get(const path_table_t *table, uint32_t id, char *out, size_t size) {
+    size_t len = 0;
+    size_t pos;
+
+    if (id == 0 || id >= table->count) {
+        return ERROR_INVALID_PARAMS;
+    }
+    for (uint32_t n = id; n != 0; n = table->nodes[n].parent) {
+        len += strlen(table->names + table->nodes[n].name) + (table->nodes[n].parent != 0);
+    }
+    if (len + 1 > size) {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    pos = len;
+    out[pos] = '\0';
+    for (uint32_t n = id; n != 0; n = table->nodes[n].parent) {
+        const char *name = table->names + table->nodes[n].name;
+        size_t name_len = strlen(name);
+
+        pos -= name_len;
+        memcpy(out + pos, name, name_len);
+        if (table->nodes[n].parent != 0) {
+            out[--pos] = '/';
+        }
+    }
+    return SUCCESS;
+}
+
+// 두 경로를 만들지 않고 strcmp(path(a), path(b)) 와 같은 순서로 비교
+int path_table_compare(const path_table_t *table, uint32_t a, uint32_t b) {
+    const path_node_t *nodes = table->nodes;
+    uint32_t ua = a, ub = b;
+    const unsigned char *sa, *sb;
+
+    if (a == b) return 0;
+
+    while (nodes[ua].depth > nodes[ub].depth) ua = nodes[ua].parent;
+    while (nodes[ub].depth > nodes[ua].depth) ub = nodes[ub].parent;
+    if (ua == ub) {
+        // 한쪽이 다른 쪽의 상위 디렉토리 = 접두사
+        return nodes[a].depth < nodes[b].depth ? -1 : 1;
+    }
+    while (nodes[ua].parent != nodes[ub].parent) {
+        ua = nodes[ua].parent;
+        ub = nodes[ub].parent;
+    }
+
+    // 공통 상위 바로 아래에서 갈라짐: 이름 뒤는 경로가 이어지면 '/', 끝이면 NUL
+    sa = (const unsigned char *)table->names + nodes[ua].name;
+    sb = (const unsigned char *)table->names + nodes[ub].name;
+    for (size_t i = 0;; i++) {
+        int ca = sa[i] ? sa[i] : (ua == a ? 0 : '/');
+        int cb = sb[i] ? sb[i] : (ub == b ? 0 : '/');
+
+        if (ca != cb) return ca - cb;
+        if (ca == 0 || ca == '/') {
+            // 디렉토리 노드는 공유되므로 둘 다 '/' 일 수 없음: 같은 경로를 두 번 넣은 파일 노드
+            return 0;
+        }
+    }
+}
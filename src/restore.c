@@ -2,7 +2,82 @@
 
 extern int handle_file_conflict(const char *dest, conflict_mode_t mode);
 
-int restore_file(const char *source, const char *dest, const backup_options_t *opts) {
+// 디렉토리 복원 중 사용하는 백업 인덱스 (체크섬 확인용)
+static backup_index_t active_restore_index;
+static int restore_index_loaded = 0;
+static char restore_root[MAX_PATH];
+
+// 백업 파일에 해당하는 인덱스 항목 조회 (루트 기준 상대 경로, 압축 확장자 제외)
+static int find_restore_entry(const char *source, index_entry_t *entry) {
+    size_t root_len = strlen(restore_root);
+    char rel[MAX_PATH];
+
+    if (!restore_index_loaded || active_restore_index.checksum_type == CHECKSUM_NONE) {
+        return 0;
+    }
+    if (strncmp(source, restore_root, root_len) != 0 || source[root_len] != '/') {
+        return 0;
+    }
+
+    snprintf(rel, sizeof(rel), "%s", source + root_len + 1);
+    if (active_restore_index.compression != COMPRESS_NONE) {
+        const char *ext = get_compression_extension(active_restore_index.compression);
+        size_t rel_len = strlen(rel);
+        size_t ext_len = strlen(ext);
+
+        if (rel_len > ext_len && strcmp(rel + rel_len - ext_len, ext) == 0) {
+            rel[rel_len - ext_len] = '\0';
+        }
+    }
+
+    return backup_index_lookup(&active_restore_index, rel, entry) && entry->checksum[0] != '\0';
+}
+
+// 복원 대상이 이미 있을 때 충돌 모드 적용 (0이면 건너뜀, RENAME은 path를 새 이름으로 바꿈)
+static int resolve_restore_conflict(char *path, size_t size, const backup_options_t *opts) {
+    if (!file_exists(path)) {
+        return 1;
+    }
+
+    switch (opts->conflict_mode) {
+        case CONFLICT_SKIP:
+            log_info("파일 건너뛰기: %s", path);
+            pthread_mutex_lock(&g_stats_mutex);
+            g_stats.files_skipped++;
+            pthread_mutex_unlock(&g_stats_mutex);
+            return 0;
+
+        case CONFLICT_RENAME: {
+            // 자동 이름 변경
+            int counter = 1;
+            char base_dest[MAX_PATH];
+            strncpy(base_dest, path, sizeof(base_dest) - 1);
+            base_dest[sizeof(base_dest) - 1] = '\0';
+
+            while (file_exists(path) && counter < 1000) {
+                snprintf(path, size, "%s.%d", base_dest, counter);
+                counter++;
+            }
+            break;
+        }
+
+        case CONFLICT_ASK:
+        case CONFLICT_OVERWRITE:
+            if (!handle_file_conflict(path, opts->conflict_mode)) {
+                pthread_mutex_lock(&g_stats_mutex);
+                g_stats.files_skipped++;
+                pthread_mutex_unlock(&g_stats_mutex);
+                return 0;
+            }
+            break;
+    }
+
+    return 1;
+}
+
+// 백업 디렉토리에 통째로 저장된 파일 하나 복원 (entry가 있으면 기록된 체크섬과 비교)
+static int restore_one_file(const char *source, const char *dest, const index_entry_t *entry,
+                            checksum_type_t checksum_type, const backup_options_t *opts) {
     struct stat src_stat;
     char temp_dest[MAX_PATH];
     compression_type_t comp_type;
@@ -19,38 +94,8 @@ int restore_file(const char *source, const char *dest, const backup_options_t *o
     temp_dest[sizeof(temp_dest) - 1] = '\0';
 
     // 충돌 처리
-    if (file_exists(temp_dest)) {
-        switch (opts->conflict_mode) {
-            case CONFLICT_SKIP:
-                log_info("파일 건너뛰기: %s", temp_dest);
-                pthread_mutex_lock(&g_stats_mutex);
-                g_stats.files_skipped++;
-                pthread_mutex_unlock(&g_stats_mutex);
-                return SUCCESS;
-            
-            case CONFLICT_RENAME:
-                // 자동 이름 변경
-                int counter = 1;
-                char base_dest[MAX_PATH];
-                strncpy(base_dest, dest, sizeof(base_dest) - 1);
-                base_dest[sizeof(base_dest) - 1] = '\0';
-                
-                while (file_exists(temp_dest) && counter < 1000) {
-                    snprintf(temp_dest, sizeof(temp_dest), "%s.%d", base_dest, counter);
-                    counter++;
-                }
-                break;
-            
-            case CONFLICT_ASK:
-            case CONFLICT_OVERWRITE:
-                if (!handle_file_conflict(temp_dest, opts->conflict_mode)) {
-                    pthread_mutex_lock(&g_stats_mutex);
-                    g_stats.files_skipped++;
-                    pthread_mutex_unlock(&g_stats_mutex);
-                    return SUCCESS;
-                }
-                break;
-        }
+    if (!resolve_restore_conflict(temp_dest, sizeof(temp_dest), opts)) {
+        return SUCCESS;
     }
 
     // DRY RUN 모드
@@ -68,12 +113,31 @@ int restore_file(const char *source, const char *dest, const backup_options_t *o
         printf("복원: %s -> %s\n", source, temp_dest);
     }
 
-    // 실제 복원 수행
+    // 실제 복원 수행 (인덱스에 체크섬이 있으면 쓰는 동안 함께 계산)
     int result;
+    checksum_ctx_t hash;
+    checksum_ctx_t *hash_ptr = NULL;
+
+    if (entry && checksum_type != CHECKSUM_NONE && entry->checksum[0] != '\0') {
+        checksum_init(&hash, checksum_type);
+        hash_ptr = &hash;
+    }
+
     if (comp_type != COMPRESS_NONE) {
-        result = decompress_file(source, temp_dest, comp_type);
+        result = decompress_file_ex(source, temp_dest, comp_type, hash_ptr);
     } else {
-        result = copy_file_simple(source, temp_dest);
+        result = copy_file_hashed(source, temp_dest, hash_ptr);
+    }
+
+    if (result == SUCCESS && hash_ptr) {
+        char hex[MAX_DIGEST_HEX];
+        size_t restored_size = (size_t)hash.total_len;
+
+        checksum_final_hex(&hash, hex);
+        if (restored_size != entry->size || strcmp(hex, entry->checksum) != 0) {
+            log_error("복원된 파일의 체크섬 불일치: %s (기록: %s, 실제: %s)", temp_dest, entry->checksum, hex);
+            result = ERROR_CHECKSUM;
+        }
     }
 
     if (result != SUCCESS) {
@@ -85,9 +149,12 @@ int restore_file(const char *source, const char *dest, const backup_options_t *o
     }
 
     // 메타데이터 복원
+    uint64_t t = metrics_now();
     if (opts->preserve_permissions || opts->preserve_timestamps) {
         copy_file_metadata(source, temp_dest);
     }
+    metrics_lap(METRIC_METADATA, &t, 0);
+    metrics_count(METRIC_METADATA, 0, 1);
 
     // 통계 업데이트
     pthread_mutex_lock(&g_stats_mutex);
@@ -109,6 +176,24 @@ int restore_file(const char *source, const char *dest, const backup_options_t *o
     return SUCCESS;
 }
 
+// 파일별 지연 기록 (metrics_file_begin/end)
+static int restore_stored_file(const char *source, const char *dest, const index_entry_t *entry,
+                               checksum_type_t checksum_type, const backup_options_t *opts) {
+    int result;
+
+    metrics_file_begin();
+    result = restore_one_file(source, dest, entry, checksum_type, opts);
+    metrics_file_end(source);
+    return result;
+}
+
+int restore_file(const char *source, const char *dest, const backup_options_t *opts) {
+    index_entry_t found;
+
+    return restore_stored_file(source, dest, find_restore_entry(source, &found) ? &found : NULL,
+                               active_restore_index.checksum_type, opts);
+}
+
 int restore_directory(const char *source, const char *dest, const backup_options_t *opts) {
     // 대상 디렉토리 생성
     if (!file_exists(dest)) {
@@ -130,245 +215,687 @@ int restore_directory(const char *source, const char *dest, const backup_options
     return SUCCESS;
 }
 
-int restore_directory_recursive(const char *source, const char *dest, const backup_options_t *opts) {
+// 순회 중인 디렉토리마다의 진행률 상태 (walk_data)
+typedef struct {
+    size_t total_files;
+    size_t current_file;
+} restore_frame_t;
+
+// 진행률 표시용으로 디렉토리 바로 아래 백업 파일 수와 크기 계산
+static size_t count_restore_files(const char *source) {
     DIR *dir;
     struct dirent *entry;
     char src_path[MAX_PATH];
-    char dest_path[MAX_PATH];
-    int result = SUCCESS;
     size_t total_files = 0;
     size_t total_bytes = 0;
 
-    // 먼저 전체 파일 수와 크기 계산 (진행률 표시용)
-    if (opts->progress) {
-        log_info("백업 파일 스캔 중...");
-        
-        dir = opendir(source);
-        if (dir) {
-            while ((entry = readdir(dir)) != NULL) {
-                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-                    continue;
-                }
-                
-                snprintf(src_path, sizeof(src_path), "%s/%s", source, entry->d_name);
-                
-                struct stat st;
-                if (stat(src_path, &st) == 0 && S_ISREG(st.st_mode)) {
-                    total_files++;
-                    total_bytes += st.st_size;
-                }
-            }
-            closedir(dir);
-            
-            log_info("총 %zu개 백업 파일, %zu bytes", total_files, total_bytes);
-            init_progress(total_files, total_bytes);
+    log_info("백업 파일 스캔 중...");
+
+    dir = opendir(source);
+    if (!dir) {
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        snprintf(src_path, sizeof(src_path), "%s/%s", source, entry->d_name);
+        if (stat(src_path, &st) == 0 && S_ISREG(st.st_mode)) {
+            total_files++;
+            total_bytes += st.st_size;
         }
     }
+    closedir(dir);
 
-    // 대상 디렉토리 생성
-    if (restore_directory(source, dest, opts) != SUCCESS) {
+    log_info("총 %zu개 백업 파일, %zu bytes", total_files, total_bytes);
+    init_progress(total_files, total_bytes);
+    return total_files;
+}
+
+// 현재 경로의 백업 디렉토리에 들어감: 대상 디렉토리를 만들고 항목을 읽어 스택에 올림
+static int restore_enter(dir_walk_t *walk, const backup_options_t *opts) {
+    size_t total_files = 0;
+
+    if (opts->progress) {
+        total_files = count_restore_files(walk->src.buf);
+    }
+
+    if (restore_directory(walk->src.buf, walk->dst.buf, opts) != SUCCESS) {
         return ERROR_FILE_WRITE;
     }
 
-    // 소스 디렉토리 열기
-    dir = opendir(source);
-    if (!dir) {
-        log_error("백업 디렉토리 열기 실패: %s", source);
+    if (walk_enter(walk) != SUCCESS) {
+        log_error("백업 디렉토리 열기 실패: %s", walk->src.buf);
         return ERROR_FILE_OPEN;
     }
+    ((restore_frame_t *)walk_data(walk))->total_files = total_files;
+    return SUCCESS;
+}
 
-    size_t current_file = 0;
-    
-    // 디렉토리 내용 순회
-    while ((entry = readdir(dir)) != NULL) {
-        // . 및 .. 건너뛰기
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+// 디렉토리 트리 복원 (walk.c 의 명시적 스택으로 순회)
+static int restore_tree(const char *source, const char *dest, const backup_options_t *opts) {
+    dir_walk_t walk;
+    int result;
+
+    if (walk_init(&walk, source, dest, sizeof(restore_frame_t)) != SUCCESS) {
+        return ERROR_MEMORY;
+    }
+    result = restore_enter(&walk, opts);
+    if (result != SUCCESS) {
+        walk_free(&walk);
+        return result;
+    }
+
+    while (walk.depth > 0) {
+        restore_frame_t *frame = walk_data(&walk);
+        const char *name = walk_next(&walk);
+        struct stat st;
+
+        if (!name) {
+            if (opts->progress) {
+                printf("\n"); // 진행률 출력 후 줄바꿈
+                finish_progress();
+            }
+            walk_leave(&walk);
             continue;
         }
 
-        // 전체 경로 생성
-        snprintf(src_path, sizeof(src_path), "%s/%s", source, entry->d_name);
-        
-        // 대상 경로 생성 (압축 확장자 제거)
-        char dest_name[MAX_PATH];
-        strncpy(dest_name, entry->d_name, sizeof(dest_name) - 1);
-        dest_name[sizeof(dest_name) - 1] = '\0';
-        
-        // 압축 확장자 제거
-        compression_type_t comp_type = get_compression_type(dest_name);
+        // 백업 내부 파일 건너뛰기
+        if (is_backup_internal_file(name)) {
+            continue;
+        }
+
+        // 대상 경로 (압축 확장자 제거)
+        compression_type_t comp_type = get_compression_type(name);
         if (comp_type != COMPRESS_NONE) {
             const char *ext = get_compression_extension(comp_type);
-            size_t name_len = strlen(dest_name);
+            size_t name_len = strlen(name);
             size_t ext_len = strlen(ext);
-            
-            if (name_len > ext_len && strcmp(dest_name + name_len - ext_len, ext) == 0) {
-                dest_name[name_len - ext_len] = '\0';
+
+            if (name_len > ext_len && strcmp(name + name_len - ext_len, ext) == 0) {
+                char dest_name[MAX_PATH];
+
+                snprintf(dest_name, sizeof(dest_name), "%.*s", (int)(name_len - ext_len), name);
+                walk_set_dest_name(&walk, dest_name);
             }
         }
-        
-        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest, dest_name);
 
-        struct stat st;
-        if (stat(src_path, &st) != 0) {
-            log_warning("백업 파일 정보 가져오기 실패: %s", src_path);
+        if (stat(walk.src.buf, &st) != 0) {
+            log_warning("백업 파일 정보 가져오기 실패: %s", walk.src.buf);
             continue;
         }
 
         if (S_ISDIR(st.st_mode)) {
-            // 하위 디렉토리 재귀 처리
-            log_debug("하위 디렉토리 복원: %s", src_path);
-            int restore_result = restore_directory_recursive(src_path, dest_path, opts);
+            // 하위 디렉토리는 스택에 올려 이어서 순회
+            log_debug("하위 디렉토리 복원: %s", walk.src.buf);
+            int restore_result = restore_enter(&walk, opts);
             if (restore_result != SUCCESS) {
-                log_warning("하위 디렉토리 복원 실패: %s", src_path);
+                log_warning("하위 디렉토리 복원 실패: %s", walk.src.buf);
                 result = restore_result;
             }
         } else if (S_ISREG(st.st_mode)) {
             // 일반 파일 복원
-            current_file++;
-            
-            if (opts->progress && total_files > 0) {
-                int percentage = (int)((current_file * 100) / total_files);
-                printf("복원 진행률: %zu/%zu 파일 (%d%%)\r", current_file, total_files, percentage);
+            frame->current_file++;
+
+            if (opts->progress && frame->total_files > 0) {
+                int percentage = (int)((frame->current_file * 100) / frame->total_files);
+                printf("복원 진행률: %zu/%zu 파일 (%d%%)\r", frame->current_file, frame->total_files, percentage);
                 fflush(stdout);
             }
-            
-            int restore_result = restore_file(src_path, dest_path, opts);
+
+            int restore_result = restore_file(walk.src.buf, walk.dst.buf, opts);
             if (restore_result != SUCCESS) {
-                log_warning("파일 복원 실패: %s", src_path);
+                log_warning("파일 복원 실패: %s", walk.src.buf);
                 result = restore_result;
             }
         } else {
-            log_debug("특수 파일 건너뛰기: %s", src_path);
+            log_debug("특수 파일 건너뛰기: %s", walk.src.buf);
         }
     }
 
-    closedir(dir);
+    walk_free(&walk);
+    return result;
+}
 
-    if (opts->progress) {
-        printf("\n"); // 진행률 출력 후 줄바꿈
-        finish_progress();
+// 백업 디렉토리에 파일이 없는 항목 복원 (layer = 레시피/델타가 있는 백업)
+//   'C': 레시피대로 청크를 병렬로 읽어 순서대로 재조립, 'X': 기준 파일 + 델타로 재구성
+static int restore_rebuilt_file(const char *layer, const char *rel_path, const index_entry_t *entry,
+                                const char *dest, checksum_type_t checksum_type, int threads,
+                                const backup_options_t *opts) {
+    char dest_path[MAX_PATH];
+    checksum_ctx_t hash;
+    checksum_ctx_t *hash_ptr = NULL;
+    uint64_t size = 0;
+    FILE *out;
+    int result;
+
+    snprintf(dest_path, sizeof(dest_path), "%s/%s", dest, rel_path);
+    if (!resolve_restore_conflict(dest_path, sizeof(dest_path), opts)) {
+        return SUCCESS;
+    }
+
+    if (opts->dry_run) {
+        printf("DRY RUN 복원: %s (%s) -> %s\n", rel_path, entry->type == 'X' ? "델타" : "청크", dest_path);
+        pthread_mutex_lock(&g_stats_mutex);
+        g_stats.files_processed++;
+        g_stats.bytes_processed += entry->size;
+        pthread_mutex_unlock(&g_stats_mutex);
+        return SUCCESS;
+    }
+
+    if (opts->verbose) {
+        printf("복원: %s (%s) -> %s\n", rel_path, entry->type == 'X' ? "델타" : "청크", dest_path);
+    }
+
+    out = fopen(dest_path, "wb");
+    if (!out) {
+        log_error("파일 생성 실패: %s", dest_path);
+        result = ERROR_FILE_WRITE;
+    } else {
+        if (checksum_type != CHECKSUM_NONE && entry->checksum[0] != '\0') {
+            checksum_init(&hash, checksum_type);
+            hash_ptr = &hash;
+        }
+
+        if (entry->type == 'X') {
+            result = delta_restore_file(layer, entry->offset, out, hash_ptr, &size);
+        } else {
+            result = chunk_store_restore_file(layer, entry->offset, out, hash_ptr, threads, &size);
+        }
+        if (fclose(out) != 0 && result == SUCCESS) {
+            result = ERROR_FILE_WRITE;
+        }
+    }
+
+    if (result == SUCCESS && size != entry->size) {
+        log_error("복원된 파일 크기 불일치: %s (기록: %zu, 실제: %llu)",
+                  dest_path, entry->size, (unsigned long long)size);
+        result = ERROR_CHECKSUM;
+    }
+    if (result == SUCCESS && hash_ptr) {
+        char hex[MAX_DIGEST_HEX];
+
+        checksum_final_hex(&hash, hex);
+        if (strcmp(hex, entry->checksum) != 0) {
+            log_error("복원된 파일의 체크섬 불일치: %s (기록: %s, 실제: %s)", dest_path, entry->checksum, hex);
+            result = ERROR_CHECKSUM;
+        }
+    }
+
+    if (result != SUCCESS) {
+        log_error("파일 복원 실패: %s", rel_path);
+        pthread_mutex_lock(&g_stats_mutex);
+        g_stats.files_failed++;
+        pthread_mutex_unlock(&g_stats_mutex);
+        return result;
+    }
+
+    // 백업 파일이 없으므로 메타데이터는 인덱스 항목에서 복원
+    if (opts->preserve_permissions && entry->file_mode != 0) {
+        chmod(dest_path, entry->file_mode & 07777);
+    }
+    if (opts->preserve_timestamps) {
+        struct timespec times[2];
+
+        times[0].tv_sec = entry->mtime;
+        times[0].tv_nsec = entry->mtime_nsec;
+        times[1] = times[0];
+        utimensat(AT_FDCWD, dest_path, times, 0);
+    }
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.files_processed++;
+    g_stats.bytes_processed += size;
+    g_stats.bytes_compressed += size;
+    pthread_mutex_unlock(&g_stats_mutex);
+
+    log_debug("파일 복원 완료: %s -> %s", rel_path, dest_path);
+    return SUCCESS;
+}
+
+// 인덱스의 'C'/'X' 항목 중 이 백업에 레시피/델타가 있는 파일을 모두 복원
+static int restore_rebuilt_files(const char *dest, const backup_options_t *opts) {
+    int result = SUCCESS;
+
+    for (size_t i = 0; i < active_restore_index.count; i++) {
+        index_entry_t entry;
+        char rel_path[MAX_PATH];
+
+        if (!backup_index_get(&active_restore_index, i, &entry, rel_path, sizeof(rel_path)) ||
+            (entry.type != 'C' && entry.type != 'X') || entry.origin[0] != '\0') {
+            continue;
+        }
+
+        int restore_result = restore_rebuilt_file(restore_root, rel_path, &entry, dest,
+                                                  active_restore_index.checksum_type, opts->threads, opts);
+        if (restore_result != SUCCESS) {
+            result = restore_result;
+        }
     }
 
     return result;
 }
 
-// 백업 메타데이터 읽기 함수
-int read_backup_metadata(const char *backup_path, backup_stats_t *metadata) {
-    char metadata_file[MAX_PATH];
-    snprintf(metadata_file, sizeof(metadata_file), "%s/.backup_metadata", backup_path);
+// 디렉토리 복원 진입점: 백업 루트의 인덱스를 읽어 파일별 체크섬 확인에 사용
+int restore_directory_recursive(const char *source, const char *dest, const backup_options_t *opts) {
+    int result;
+
+    snprintf(restore_root, sizeof(restore_root), "%s", source);
+    restore_index_loaded = backup_index_load(source, &active_restore_index) == SUCCESS;
+    if (restore_index_loaded && active_restore_index.checksum_type != CHECKSUM_NONE) {
+        log_info("백업 인덱스 체크섬으로 복원 검증 (%s)",
+                 get_checksum_name(active_restore_index.checksum_type));
+    }
+    if (restore_index_loaded && active_restore_index.mode != BACKUP_FULL) {
+        log_warning("%s 백업에는 기준 백업(%s) 이후 변경된 파일만 있습니다: %s (전체 트리는 체인에서 --as-of 로 복원)",
+                    get_backup_mode_name(active_restore_index.mode), active_restore_index.base, source);
+    }
+
+    result = restore_tree(source, dest, opts);
+
+    if (restore_index_loaded) {
+        int rebuilt_result = restore_rebuilt_files(dest, opts);
+        if (rebuilt_result != SUCCESS) {
+            result = rebuilt_result;
+        }
+    }
+
+    if (restore_index_loaded) {
+        backup_index_free(&active_restore_index);
+        restore_index_loaded = 0;
+    }
+
+    return result;
+}
+
+// 백업 체인 검증 (인크리멘털 백업용)
+int verify_backup_chain(const char *backup_base_path) {
+    char full_backup_path[MAX_PATH];
+    snprintf(full_backup_path, sizeof(full_backup_path), "%s/%s", backup_base_path, BACKUP_CHAIN_FULL);
     
-    FILE *file = fopen(metadata_file, "r");
-    if (!file) {
-        log_warning("백업 메타데이터 파일이 없습니다: %s", metadata_file);
+    if (!file_exists(full_backup_path)) {
+        log_error("전체 백업이 없습니다. 인크리멘털 백업을 수행하려면 먼저 전체 백업을 생성하세요.");
         return ERROR_FILE_NOT_FOUND;
     }
     
-    if (fread(metadata, sizeof(backup_stats_t), 1, file) != 1) {
-        log_error("백업 메타데이터 읽기 실패: %s", metadata_file);
-        fclose(file);
-        return ERROR_FILE_READ;
+    log_debug("백업 체인 검증 완료");
+    return SUCCESS;
+}
+
+// 체인 안 백업 이름의 정렬 키 (full = "", incr-/diff-<시각> = 시각, 그 밖은 NULL)
+static const char *chain_backup_key(const char *name) {
+    if (strcmp(name, BACKUP_CHAIN_FULL) == 0) {
+        return "";
     }
-    
-    fclose(file);
-    log_debug("백업 메타데이터 읽기 완료: %s", metadata_file);
+    if (strncmp(name, "incr-", 5) == 0 || strncmp(name, "diff-", 5) == 0) {
+        return name + 5;
+    }
+    return NULL;
+}
+
+// 체인에서 가장 최근 백업 이름 (full, incr-<시각>, diff-<시각> 중 시각이 가장 늦은 것)
+int find_latest_backup(const char *backup_base_path, char *name, size_t size) {
+    DIR *dir;
+    struct dirent *entry;
+    char path[MAX_PATH];
+    char latest[BACKUP_NAME_MAX] = "";
+    const char *latest_key = NULL;
+    char latest_key_buf[BACKUP_NAME_MAX] = "";
+
+    dir = opendir(backup_base_path);
+    if (!dir) {
+        log_error("백업 체인 디렉토리 열기 실패: %s", backup_base_path);
+        return ERROR_FILE_OPEN;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        const char *key = chain_backup_key(entry->d_name);
+
+        if (!key) {
+            continue;
+        }
+
+        if (strlen(entry->d_name) >= sizeof(latest)) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", backup_base_path, entry->d_name);
+        if (!is_directory(path)) {
+            continue;
+        }
+
+        if (!latest_key || strcmp(key, latest_key) > 0) {
+            snprintf(latest, sizeof(latest), "%s", entry->d_name);
+            snprintf(latest_key_buf, sizeof(latest_key_buf), "%s", key);
+            latest_key = latest_key_buf;
+        }
+    }
+    closedir(dir);
+
+    if (!latest_key) {
+        log_error("백업 체인에 백업이 없습니다: %s", backup_base_path);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    snprintf(name, size, "%s", latest);
     return SUCCESS;
 }
 
-// 백업 메타데이터 쓰기 함수
-int write_backup_metadata(const char *backup_path, const backup_stats_t *metadata) {
-    char metadata_file[MAX_PATH];
-    snprintf(metadata_file, sizeof(metadata_file), "%s/.backup_metadata", backup_path);
-    
-    FILE *file = fopen(metadata_file, "w");
-    if (!file) {
-        log_error("백업 메타데이터 파일 생성 실패: %s", metadata_file);
-        return ERROR_FILE_WRITE;
+// 시점 지정 (백업 이름, 또는 "2026-10-19", "2026-10-19 14:30", "20261019-143000" 같은 시각)을
+// 체인 이름 키 형식(YYYYMMDD-HHMMSS)으로 바꿈. 생략한 시/분/초는 그 구간의 끝으로 채움
+static int parse_as_of(const char *as_of, char *limit, size_t size) {
+    char digits[15];
+    size_t count = 0;
+
+    for (const char *p = as_of; *p && count < sizeof(digits) - 1; p++) {
+        if (isdigit((unsigned char)*p)) {
+            digits[count++] = *p;
+        }
     }
-    
-    if (fwrite(metadata, sizeof(backup_stats_t), 1, file) != 1) {
-        log_error("백업 메타데이터 쓰기 실패: %s", metadata_file);
-        fclose(file);
-        return ERROR_FILE_WRITE;
+    if (count < 8 || size < 16) {
+        return 0;
     }
-    
-    fclose(file);
-    log_debug("백업 메타데이터 쓰기 완료: %s", metadata_file);
+    while (count < 14) {
+        digits[count++] = '9';
+    }
+    digits[count] = '\0';
+
+    snprintf(limit, size, "%.8s-%.6s", digits, digits + 8);
+    return 1;
+}
+
+// 체인에서 as_of 시점의 백업 이름: 같은 이름의 백업이 있으면 그것, 아니면 시각이 as_of 이하인 마지막 백업
+int find_backup_as_of(const char *chain, const char *as_of, char *name, size_t size) {
+    DIR *dir;
+    struct dirent *entry;
+    char path[MAX_PATH];
+    char limit[16];
+    char best[BACKUP_NAME_MAX] = "";
+    const char *best_key = NULL;
+
+    snprintf(path, sizeof(path), "%s/%s", chain, as_of);
+    if (chain_backup_key(as_of) && is_directory(path)) {
+        snprintf(name, size, "%s", as_of);
+        return SUCCESS;
+    }
+
+    if (!parse_as_of(as_of, limit, sizeof(limit))) {
+        log_error("시점 형식이 잘못되었습니다: %s (예: 2026-10-19, \"2026-10-19 14:30\", incr-20261019-143000)", as_of);
+        return ERROR_INVALID_PARAMS;
+    }
+
+    dir = opendir(chain);
+    if (!dir) {
+        log_error("백업 체인 디렉토리 열기 실패: %s", chain);
+        return ERROR_FILE_OPEN;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        const char *key = chain_backup_key(entry->d_name);
+
+        // 같은 초의 "-01" 같은 번호는 시각 비교에서 빼고, 같은 시각끼리는 번호가 큰 쪽이 나중
+        if (!key || strlen(entry->d_name) >= sizeof(best) || strncmp(key, limit, 15) > 0) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", chain, entry->d_name);
+        if (!is_directory(path)) {
+            continue;
+        }
+
+        // 전체 백업 이름에는 시각이 없으므로 인덱스를 쓴 시각과 비교
+        if (key[0] == '\0') {
+            char index_path[MAX_PATH + 32];
+            char created[16];
+            struct stat st;
+
+            snprintf(index_path, sizeof(index_path), "%s/%s", path, BACKUP_INDEX_FILE);
+            if (stat(index_path, &st) == 0) {
+                strftime(created, sizeof(created), "%Y%m%d-%H%M%S", localtime(&st.st_mtime));
+                if (strcmp(created, limit) > 0) {
+                    continue;
+                }
+            }
+        }
+
+        if (!best_key || strcmp(key, best_key) > 0) {
+            snprintf(best, sizeof(best), "%s", entry->d_name);
+            best_key = chain_backup_key(best);
+        }
+    }
+    closedir(dir);
+
+    if (!best_key) {
+        log_error("백업 체인에 %s 이전 백업이 없습니다: %s", as_of, chain);
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    snprintf(name, size, "%s", best);
     return SUCCESS;
 }
 
-// 백업 인덱스 생성 함수
-int create_backup_index(const char *backup_path) {
-    char index_file[MAX_PATH];
-    snprintf(index_file, sizeof(index_file), "%s/.backup_index", backup_path);
-    
-    FILE *file = fopen(index_file, "w");
-    if (!file) {
-        log_error("백업 인덱스 파일 생성 실패: %s", index_file);
+// 시점 복원: 항목을 배치로 모아 각 파일을 데이터가 있는 백업(레이어)에서 바로 병렬로 복원
+#define AS_OF_BATCH_SIZE 1024
+
+typedef struct {
+    char *rel;
+    index_entry_t entry;
+    int result;
+} layer_job_t;
+
+typedef struct {
+    layer_job_t *jobs;
+    const char *chain;
+    const char *name;             // 시점 백업 이름 (origin이 비어 있는 항목의 레이어)
+    const char *dest;
+    checksum_type_t checksum_type;
+    int file_threads;             // 파일 하나 안에서의 병렬 (청크 읽기)
+    const backup_options_t *opts;
+} layer_batch_t;
+
+static void restore_layer_job(void *ctx, size_t index) {
+    layer_batch_t *batch = ctx;
+    layer_job_t *job = &batch->jobs[index];
+    const char *holder = job->entry.origin[0] ? job->entry.origin : batch->name;
+    char layer[MAX_PATH];
+
+    if ((size_t)snprintf(layer, sizeof(layer), "%s/%s", batch->chain, holder) >= sizeof(layer)) {
+        log_error("경로가 너무 깁니다: %s/%s", batch->chain, holder);
+        job->result = ERROR_INVALID_PARAMS;
+        return;
+    }
+
+    if (job->entry.type == 'F') {
+        char source[MAX_PATH], dest_path[MAX_PATH];
+
+        if ((size_t)snprintf(source, sizeof(source), "%s/%s%s", layer, job->rel,
+                             job->entry.codec != COMPRESS_NONE ? get_compression_extension((compression_type_t)job->entry.codec) : "") >= sizeof(source) ||
+            (size_t)snprintf(dest_path, sizeof(dest_path), "%s/%s", batch->dest, job->rel) >= sizeof(dest_path)) {
+            log_error("경로가 너무 깁니다: %s", job->rel);
+            job->result = ERROR_INVALID_PARAMS;
+            return;
+        }
+        job->result = restore_stored_file(source, dest_path, &job->entry, batch->checksum_type, batch->opts);
+    } else {
+        job->result = restore_rebuilt_file(layer, job->rel, &job->entry, batch->dest, batch->checksum_type,
+                                           batch->file_threads, batch->opts);
+    }
+}
+
+static int flush_layer_batch(layer_batch_t *batch, size_t count, int threads) {
+    int result = SUCCESS;
+
+    parallel_for(restore_layer_job, batch, count, threads);
+    for (size_t i = 0; i < count; i++) {
+        if (batch->jobs[i].result != SUCCESS) {
+            log_warning("파일 복원 실패: %s", batch->jobs[i].rel);
+            result = batch->jobs[i].result;
+        }
+        free(batch->jobs[i].rel);
+    }
+    return result;
+}
+
+// 복원할 경로의 상위 디렉토리 생성 (인덱스가 경로순이라 직전 경로의 상위와 같으면 건너뜀)
+static int ensure_parent_directory(const char *dest, const char *rel, char *last_parent, size_t size) {
+    char parent[MAX_PATH];
+    const char *slash = strrchr(rel, '/');
+
+    if (slash) {
+        snprintf(parent, sizeof(parent), "%s/%.*s", dest, (int)(slash - rel), rel);
+    } else {
+        snprintf(parent, sizeof(parent), "%s", dest);
+    }
+    if (strcmp(parent, last_parent) == 0) {
+        return SUCCESS;
+    }
+    snprintf(last_parent, size, "%s", parent);
+    if (!file_exists(parent) && create_directory_recursive(parent) != SUCCESS) {
+        log_error("디렉토리 생성 실패: %s", parent);
         return ERROR_FILE_WRITE;
     }
-    
-    // 백업 인덱스 헤더 작성
-    fprintf(file, "# Backup Index File\n");
-    fprintf(file, "# Generated: %s", ctime(&g_stats.start_time));
-    fprintf(file, "# Format: <type>|<path>|<size>|<mtime>|<checksum>\n");
-    
-    fclose(file);
-    log_debug("백업 인덱스 생성 완료: %s", index_file);
     return SUCCESS;
 }
 
-// 인크리멘털/차등 백업을 위한 변경 감지
-int detect_file_changes(const char *source_path, const char *backup_path, 
-                       backup_mode_t mode, int *needs_backup) {
-    struct stat src_stat, backup_stat;
-    char backup_file[MAX_PATH];
-    
-    *needs_backup = 1; // 기본적으로 백업 필요
-    
-    if (stat(source_path, &src_stat) != 0) {
+// 체인 복원 진입점: as_of 시점 백업의 인덱스 하나로 전체 트리를 구성
+// (증분/차등 인덱스는 변경 없는 파일도 origin과 함께 모두 기록하므로 레이어를 차례로 겹칠 필요가 없음)
+int restore_backup_as_of(const char *chain, const char *as_of, const char *dest, const backup_options_t *opts) {
+    char name[BACKUP_NAME_MAX];
+    char backup_path[MAX_PATH];
+    char last_parent[MAX_PATH] = "";
+    backup_index_t index;
+    layer_batch_t batch;
+    size_t count = 0;
+    int threads = opts->threads > 0 ? opts->threads : 1;
+    int result;
+
+    result = find_backup_as_of(chain, as_of, name, sizeof(name));
+    if (result != SUCCESS) {
+        return result;
+    }
+
+    snprintf(backup_path, sizeof(backup_path), "%s/%s", chain, name);
+    if (backup_index_load(backup_path, &index) != SUCCESS) {
+        log_error("백업 인덱스가 없어 시점 복원을 할 수 없습니다: %s", backup_path);
         return ERROR_FILE_NOT_FOUND;
     }
-    
-    // 백업 파일 경로 생성
-    const char *filename = strrchr(source_path, '/');
-    filename = filename ? filename + 1 : source_path;
-    snprintf(backup_file, sizeof(backup_file), "%s/%s", backup_path, filename);
-    
-    // 백업 파일이 존재하지 않으면 백업 필요
-    if (stat(backup_file, &backup_stat) != 0) {
-        *needs_backup = 1;
-        return SUCCESS;
+    log_info("시점 복원: %s 기준 %s (%zu개 항목)", as_of, backup_path, index.count);
+
+    // 묻는 충돌 모드는 터미널 입력이 필요하므로 한 파일씩
+    if (opts->conflict_mode == CONFLICT_ASK) {
+        threads = 1;
     }
-    
-    switch (mode) {
-        case BACKUP_FULL:
-            *needs_backup = 1; // 항상 백업
-            break;
-            
-        case BACKUP_INCREMENTAL:
-        case BACKUP_DIFFERENTIAL:
-            // 수정 시간 비교
-            if (src_stat.st_mtime > backup_stat.st_mtime) {
-                *needs_backup = 1;
-            } else {
-                *needs_backup = 0;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.jobs = malloc(AS_OF_BATCH_SIZE * sizeof(layer_job_t));
+    if (!batch.jobs) {
+        backup_index_free(&index);
+        return ERROR_MEMORY;
+    }
+    batch.chain = chain;
+    batch.name = name;
+    batch.dest = dest;
+    batch.checksum_type = index.checksum_type;
+    batch.file_threads = threads > 1 ? 1 : opts->threads;
+    batch.opts = opts;
+
+    if (!opts->dry_run && !file_exists(dest) && create_directory_recursive(dest) != SUCCESS) {
+        log_error("디렉토리 생성 실패: %s", dest);
+        free(batch.jobs);
+        backup_index_free(&index);
+        return ERROR_FILE_WRITE;
+    }
+
+    for (size_t pos = 0; pos < index.count; pos++) {
+        index_entry_t entry;
+        char rel[MAX_PATH];
+        layer_job_t *job;
+
+        if (!backup_index_get(&index, pos, &entry, rel, sizeof(rel))) {
+            continue;
+        }
+
+        if (entry.type == 'D') {
+            char dir_path[MAX_PATH];
+
+            if ((size_t)snprintf(dir_path, sizeof(dir_path), "%s/%s", dest, rel) >= sizeof(dir_path)) {
+                log_error("경로가 너무 깁니다: %s/%s", dest, rel);
+                result = ERROR_INVALID_PARAMS;
+                continue;
+            }
+            if (!opts->dry_run && !file_exists(dir_path) && create_directory_recursive(dir_path) != SUCCESS) {
+                log_error("디렉토리 생성 실패: %s", dir_path);
+                result = ERROR_FILE_WRITE;
             }
+            pthread_mutex_lock(&g_stats_mutex);
+            g_stats.directories_processed++;
+            pthread_mutex_unlock(&g_stats_mutex);
+            continue;
+        }
+        if (entry.type != 'F' && entry.type != 'C' && entry.type != 'X') {
+            continue;
+        }
+        if (!opts->dry_run && ensure_parent_directory(dest, rel, last_parent, sizeof(last_parent)) != SUCCESS) {
+            result = ERROR_FILE_WRITE;
+            continue;
+        }
+
+        job = &batch.jobs[count];
+        job->rel = strdup(rel);
+        if (!job->rel) {
+            result = ERROR_MEMORY;
             break;
+        }
+        job->entry = entry;
+        job->entry.path = job->rel;
+        job->result = SUCCESS;
+
+        if (++count == AS_OF_BATCH_SIZE) {
+            int batch_result = flush_layer_batch(&batch, count, threads);
+            if (batch_result != SUCCESS) {
+                result = batch_result;
+            }
+            count = 0;
+        }
     }
-    
-    return SUCCESS;
-}
 
-// 백업 체인 검증 (인크리멘털 백업용)
-int verify_backup_chain(const char *backup_base_path) {
-    char full_backup_path[MAX_PATH];
-    snprintf(full_backup_path, sizeof(full_backup_path), "%s/full", backup_base_path);
-    
-    if (!file_exists(full_backup_path)) {
-        log_error("전체 백업이 없습니다. 인크리멘털 백업을 수행하려면 먼저 전체 백업을 생성하세요.");
-        return ERROR_FILE_NOT_FOUND;
+    if (count > 0) {
+        int batch_result = flush_layer_batch(&batch, count, threads);
+        if (batch_result != SUCCESS) {
+            result = batch_result;
+        }
     }
-    
-    log_debug("백업 체인 검증 완료");
-    return SUCCESS;
-}
\ No newline at end of file
+    free(batch.jobs);
+
+    // 디렉토리 메타데이터는 안의 파일을 모두 쓴 뒤에 (깊은 곳부터)
+    if (!opts->dry_run && (opts->preserve_permissions || opts->preserve_timestamps)) {
+        for (size_t pos = index.count; pos-- > 0;) {
+            index_entry_t entry;
+            char rel[MAX_PATH];
+            char dir_path[MAX_PATH];
+
+            // 경로가 너무 긴 디렉토리는 만들 때 이미 오류로 보고함
+            if (!backup_index_get(&index, pos, &entry, rel, sizeof(rel)) || entry.type != 'D' ||
+                (size_t)snprintf(dir_path, sizeof(dir_path), "%s/%s", dest, rel) >= sizeof(dir_path)) {
+                continue;
+            }
+            if (opts->preserve_permissions && entry.file_mode != 0) {
+                chmod(dir_path, entry.file_mode & 07777);
+            }
+            if (opts->preserve_timestamps) {
+                struct timespec times[2];
+
+                times[0].tv_sec = entry.mtime;
+                times[0].tv_nsec = entry.mtime_nsec;
+                times[1] = times[0];
+                utimensat(AT_FDCWD, dir_path, times, 0);
+            }
+        }
+    }
+
+    backup_index_free(&index);
+    return result;
+}
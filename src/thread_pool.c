@@ -0,0 +1,237 @@
+#include "backup.h"
+
+// 고정 크기 워커 스레드 풀
+// 작업은 FIFO 큐에 쌓이고, 각 워커가 handler(source, dest, ctx)를 호출합니다.
+// 큐 항목은 경로 표(pathtab.c) id 두 개(8바이트)이고 경로는 워커가 꺼낼 때 만듭니다.
+// 큐가 WORK_QUEUE_LIMIT 개를 넘으면 생산자는 큐가 빌 때까지 기다린 뒤 경로 표를 비우므로,
+// 작업 수와 관계없이 메모리는 큐 한도만큼만 씁니다.
+#define WORK_QUEUE_LIMIT 65536
+
+int init_thread_pool(thread_pool_t *pool, int thread_count, work_handler_t handler, void *ctx) {
+    if (!pool || !handler) return ERROR_INVALID_PARAMS;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->handler = handler;
+    pool->handler_ctx = ctx;
+
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > MAX_THREADS) thread_count = MAX_THREADS;
+
+    pool->threads = calloc(thread_count, sizeof(pthread_t));
+    pool->paths = path_table_create();
+    if (!pool->threads || !pool->paths) {
+        free(pool->threads);
+        path_table_free(pool->paths);
+        return ERROR_MEMORY;
+    }
+
+    pthread_mutex_init(&pool->queue_mutex, NULL);
+    pthread_cond_init(&pool->queue_cond, NULL);
+    pthread_cond_init(&pool->space_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_thread, pool) != 0) {
+            log_error("워커 스레드 생성 실패 (%d/%d)", i + 1, thread_count);
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    if (pool->thread_count == 0) {
+        destroy_thread_pool(pool);
+        return ERROR_THREAD;
+    }
+
+    log_debug("스레드 풀 초기화: %d개 워커", pool->thread_count);
+    return SUCCESS;
+}
+
+static int grow_queue(thread_pool_t *pool) {
+    size_t capacity = pool->queue_capacity ? pool->queue_capacity * 2 : 1024;
+    work_item_t *queue = malloc(capacity * sizeof(work_item_t));
+
+    if (!queue) return ERROR_MEMORY;
+    for (size_t i = 0; i < pool->queue_count; i++) {
+        queue[i] = pool->queue[(pool->queue_head + i) & (pool->queue_capacity - 1)];
+    }
+    free(pool->queue);
+    pool->queue = queue;
+    pool->queue_head = 0;
+    pool->queue_capacity = capacity;
+    return SUCCESS;
+}
+
+int add_work_item(thread_pool_t *pool, const char *source, const char *dest) {
+    work_item_t item;
+    int result = SUCCESS;
+
+    if (!pool || !source || !dest) return ERROR_INVALID_PARAMS;
+    if (strlen(source) >= MAX_PATH || strlen(dest) >= MAX_PATH) {
+        log_error("경로가 너무 깁니다: %s", source);
+        return ERROR_INVALID_PARAMS;
+    }
+
+    pthread_mutex_lock(&pool->queue_mutex);
+    while (pool->queue_count >= WORK_QUEUE_LIMIT) {
+        pthread_cond_wait(&pool->space_cond, &pool->queue_mutex);
+    }
+    // 큐가 비었으면 남은 경로를 참조하는 작업이 없으므로 경로 표를 비움
+    if (pool->queue_count == 0) {
+        path_table_reset(pool->paths);
+    }
+
+    if ((pool->queue_count == pool->queue_capacity && grow_queue(pool) != SUCCESS) ||
+        path_table_add(pool->paths, source, &item.source) != SUCCESS ||
+        path_table_add(pool->paths, dest, &item.dest) != SUCCESS) {
+        result = ERROR_MEMORY;
+    } else {
+        pool->queue[(pool->queue_head + pool->queue_count) & (pool->queue_capacity - 1)] = item;
+        pool->queue_count++;
+        pool->pending++;
+        pthread_cond_signal(&pool->queue_cond);
+    }
+    pthread_mutex_unlock(&pool->queue_mutex);
+
+    return result;
+}
+
+void *worker_thread(void *arg) {
+    thread_pool_t *pool = (thread_pool_t *)arg;
+    char source[MAX_PATH];
+    char dest[MAX_PATH];
+
+    for (;;) {
+        work_item_t item;
+
+        pthread_mutex_lock(&pool->queue_mutex);
+        while (pool->queue_count == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->queue_cond, &pool->queue_mutex);
+        }
+
+        if (pool->queue_count == 0) {
+            pthread_mutex_unlock(&pool->queue_mutex);
+            break; // 종료 요청이고 남은 작업 없음
+        }
+
+        // 경로는 잠금 안에서 꺼내 둠 (생산자가 큐가 빈 뒤 경로 표를 비움)
+        item = pool->queue[pool->queue_head];
+        pool->queue_head = (pool->queue_head + 1) & (pool->queue_capacity - 1);
+        pool->queue_count--;
+        path_table_get(pool->paths, item.source, source, sizeof(source));
+        path_table_get(pool->paths, item.dest, dest, sizeof(dest));
+        if (pool->queue_count == 0) {
+            pthread_cond_broadcast(&pool->space_cond);
+        }
+        pthread_mutex_unlock(&pool->queue_mutex);
+
+        int result = pool->handler(source, dest, pool->handler_ctx);
+
+        pthread_mutex_lock(&pool->queue_mutex);
+        if (result != SUCCESS) {
+            pool->failures++;
+        }
+        pool->pending--;
+        if (pool->pending == 0) {
+            pthread_cond_broadcast(&pool->done_cond);
+        }
+        pthread_mutex_unlock(&pool->queue_mutex);
+    }
+
+    return NULL;
+}
+
+// 큐에 넣은 작업이 모두 끝날 때까지 대기하고 실패 수를 반환
+size_t wait_thread_pool(thread_pool_t *pool) {
+    size_t failures;
+
+    if (!pool) return 0;
+
+    pthread_mutex_lock(&pool->queue_mutex);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->queue_mutex);
+    }
+    failures = pool->failures;
+    pthread_mutex_unlock(&pool->queue_mutex);
+
+    return failures;
+}
+
+void destroy_thread_pool(thread_pool_t *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->queue_mutex);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->queue_cond);
+    pthread_mutex_unlock(&pool->queue_mutex);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    // 처리되지 않은 작업 정리
+    free(pool->queue);
+    pool->queue = NULL;
+    pool->queue_count = pool->queue_capacity = 0;
+    path_table_free(pool->paths);
+    pool->paths = NULL;
+
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->thread_count = 0;
+
+    pthread_mutex_destroy(&pool->queue_mutex);
+    pthread_cond_destroy(&pool->queue_cond);
+    pthread_cond_destroy(&pool->space_cond);
+    pthread_cond_destroy(&pool->done_cond);
+}
+
+// ---- 인덱스 단위 병렬 실행 ----
+// 경로 단위 작업 큐와 달리, 메모리에 올린 블록/청크 배열을 여러 스레드가 나눠 처리할 때 사용
+
+typedef struct {
+    parallel_fn_t fn;
+    void *ctx;
+    size_t count;
+    size_t next;
+} parallel_job_t;
+
+static void *parallel_worker(void *arg) {
+    parallel_job_t *job = (parallel_job_t *)arg;
+    size_t index;
+
+    while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count) {
+        job->fn(job->ctx, index);
+    }
+    return NULL;
+}
+
+// fn(ctx, 0..count-1)을 threads개 스레드로 나눠 실행하고 모두 끝날 때까지 대기 (호출 스레드도 참여)
+void parallel_for(parallel_fn_t fn, void *ctx, size_t count, int threads) {
+    parallel_job_t job = { fn, ctx, count, 0 };
+    pthread_t tids[MAX_THREADS];
+    int started = 0;
+
+    threads = (int)MIN((size_t)MAX(threads, 1), count);
+    for (int i = 1; i < threads && i < MAX_THREADS; i++) {
+        if (pthread_create(&tids[started], NULL, parallel_worker, &job) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    parallel_worker(&job);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+}
+
+// 요청 스레드 수를 CPU 코어 수와 MAX_THREADS 로 제한
+int parallel_thread_count(int threads) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (threads < 1) threads = 1;
+    if (cores > 0 && threads > cores) threads = (int)cores;
+    return MIN(threads, MAX_THREADS);
+}
@@ -0,0 +1,206 @@
+#include "backup.h"
+
+// 재귀 없는 디렉토리 순회
+// 열린 디렉토리마다 항목 이름을 한 번에 읽어 names 스택(arena)에 쌓고, 경로는 버퍼 하나에
+// 구성 요소를 붙였다 잘라내며 만듦. 메모리는 현재 경로 길이와 그 위 디렉토리들에 남은 항목 이름만큼,
+// 열린 디렉토리 핸들은 항상 하나 이하 (깊은 트리에서도 스택이나 fd 가 모자라지 않음)
+//
+//   walk_init(&walk, src, dst, sizeof(frame)); walk_enter(&walk);
+//   while (walk.depth > 0) {
+//       if (!walk_next(&walk)) { /* 디렉토리 끝 (경로 = 그 디렉토리) */ walk_leave(&walk); continue; }
+//       /* walk.src.buf, walk.dst.buf = 항목 경로 */ ... 디렉토리면 walk_enter(&walk);
+//   }
+//   walk_free(&walk);
+// walk_data 가 돌려준 포인터는 다음 walk_enter 에서 옮겨질 수 있음
+
+static int path_buf_reserve(path_buf_t *path, size_t len) {
+    if (len + 1 > path->cap) {
+        size_t cap = path->cap ? path->cap : 256;
+        char *buf;
+
+        while (cap < len + 1) cap *= 2;
+        buf = realloc(path->buf, cap);
+        if (!buf) return ERROR_MEMORY;
+        path->buf = buf;
+        path->cap = cap;
+    }
+    return SUCCESS;
+}
+
+static int path_buf_set(path_buf_t *path, const char *text) {
+    size_t len = strlen(text);
+
+    if (path_buf_reserve(path, len) != SUCCESS) return ERROR_MEMORY;
+    memcpy(path->buf, text, len + 1);
+    path->len = len;
+    return SUCCESS;
+}
+
+// len 위치에서 잘라 "/name" 을 붙임
+static int path_buf_append(path_buf_t *path, size_t len, const char *name) {
+    size_t name_len = strlen(name);
+
+    if (path_buf_reserve(path, len + 1 + name_len) != SUCCESS) return ERROR_MEMORY;
+    path->buf[len] = '/';
+    memcpy(path->buf + len + 1, name, name_len + 1);
+    path->len = len + 1 + name_len;
+    return SUCCESS;
+}
+
+static void path_buf_truncate(path_buf_t *path, size_t len) {
+    if (path->buf) {
+        path->buf[len] = '\0';
+        path->len = len;
+    }
+}
+
+int walk_init(dir_walk_t *walk, const char *src, const char *dst, size_t data_size) {
+    memset(walk, 0, sizeof(*walk));
+    walk->data_size = data_size;
+    walk->root_len = strlen(src);
+    if (path_buf_set(&walk->src, src) != SUCCESS || (dst && path_buf_set(&walk->dst, dst) != SUCCESS)) {
+        walk_free(walk);
+        return ERROR_MEMORY;
+    }
+    return SUCCESS;
+}
+
+void walk_free(dir_walk_t *walk) {
+    free(walk->src.buf);
+    free(walk->dst.buf);
+    free(walk->names);
+    free(walk->frames);
+    free(walk->data);
+    memset(walk, 0, sizeof(*walk));
+}
+
+static int names_append(dir_walk_t *walk, unsigned char type, const char *name) {
+    size_t len = strlen(name) + 2; // 종류 1바이트 + 이름 + NUL
+
+    if (walk->names_len + len > walk->names_cap) {
+        size_t cap = walk->names_cap ? walk->names_cap : 4096;
+        char *names;
+
+        while (cap < walk->names_len + len) cap *= 2;
+        names = realloc(walk->names, cap);
+        if (!names) return ERROR_MEMORY;
+        walk->names = names;
+        walk->names_cap = cap;
+    }
+    walk->names[walk->names_len] = (char)type;
+    memcpy(walk->names + walk->names_len + 1, name, len - 1);
+    walk->names_len += len;
+    return SUCCESS;
+}
+
+int walk_enter(dir_walk_t *walk) {
+    struct dirent *entry;
+    walk_frame_t *frame;
+    size_t start = walk->names_len;
+    size_t entries = 0;
+    uint64_t started = metrics_now();
+    uint64_t t = started;
+    DIR *dir;
+
+    if (walk->depth == walk->frame_cap) {
+        size_t cap = walk->frame_cap ? walk->frame_cap * 2 : 16;
+        walk_frame_t *frames = realloc(walk->frames, cap * sizeof(*frames));
+        unsigned char *data;
+
+        if (!frames) return ERROR_MEMORY;
+        walk->frames = frames;
+        if (walk->data_size) {
+            data = realloc(walk->data, cap * walk->data_size);
+            if (!data) return ERROR_MEMORY;
+            walk->data = data;
+        }
+        walk->frame_cap = cap;
+    }
+
+    dir = opendir(walk->src.buf);
+    if (!dir) {
+        return ERROR_FILE_OPEN;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (names_append(walk, entry->d_type, entry->d_name) != SUCCESS) {
+            closedir(dir);
+            walk->names_len = start;
+            return ERROR_MEMORY;
+        }
+        entries++;
+    }
+    closedir(dir);
+    metrics_lap(METRIC_SCAN, &t, 0);
+    metrics_count(METRIC_SCAN, 0, entries);
+
+    frame = &walk->frames[walk->depth];
+    frame->names = start;
+    frame->next = start;
+    frame->src_len = walk->src.len;
+    frame->dst_len = walk->dst.len;
+    frame->started = started;
+    frame->children = 0;
+    if (walk->data_size) {
+        memset(walk->data + walk->depth * walk->data_size, 0, walk->data_size);
+    }
+    walk->depth++;
+    return SUCCESS;
+}
+
+const char *walk_next(dir_walk_t *walk) {
+    walk_frame_t *frame = &walk->frames[walk->depth - 1];
+    const char *name;
+
+    path_buf_truncate(&walk->src, frame->src_len);
+    path_buf_truncate(&walk->dst, frame->dst_len);
+
+    while (frame->next < walk->names_len) {
+        walk->d_type = (unsigned char)walk->names[frame->next];
+        name = walk->names + frame->next + 1;
+        frame->next += strlen(name) + 2;
+
+        if (path_buf_append(&walk->src, frame->src_len, name) != SUCCESS ||
+            (walk->dst.buf && path_buf_append(&walk->dst, frame->dst_len, name) != SUCCESS)) {
+            log_error("경로 버퍼 할당 실패: %s", name);
+            path_buf_truncate(&walk->src, frame->src_len);
+            path_buf_truncate(&walk->dst, frame->dst_len);
+            continue;
+        }
+        return walk->src.buf + frame->src_len + 1;
+    }
+    return NULL;
+}
+
+int walk_set_dest_name(dir_walk_t *walk, const char *name) {
+    return path_buf_append(&walk->dst, walk->frames[walk->depth - 1].dst_len, name);
+}
+
+// 디렉토리에서 보낸 시간은 하위 디렉토리 몫을 빼고 metrics 에 알리고, 전체는 상위에 더함
+void walk_leave(dir_walk_t *walk) {
+    walk_frame_t *frame = &walk->frames[--walk->depth];
+    uint64_t elapsed = metrics_now() - frame->started;
+
+    walk->names_len = frame->names;
+    metrics_directory(walk->src.buf, frame->src_len, elapsed - frame->children);
+    if (walk->depth > 0) {
+        walk->frames[walk->depth - 1].children += elapsed;
+    }
+}
+
+void *walk_data(dir_walk_t *walk) {
+    return walk->data + (walk->depth - 1) * walk->data_size;
+}
+
+const char *walk_name(const dir_walk_t *walk) {
+    return walk->src.buf + walk->frames[walk->depth - 1].src_len + 1;
+}
+
+const char *walk_rel(const dir_walk_t *walk) {
+    if (walk->src.len <= walk->root_len) {
+        return "";
+    }
+    return walk->src.buf + walk->root_len + (walk->src.buf[walk->root_len] == '/');
+}
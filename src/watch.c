@@ -0,0 +1,376 @@
+#include "backup.h"
+#include <poll.h>
+#include <sys/inotify.h>
+
+// 변경 감시 모드 (backup watch)
+//
+// 소스 트리의 모든 디렉토리에 inotify 감시를 걸고, 이벤트가 난 디렉토리(와 그 상위)를 중복 없이
+// 변경 집합에 모읍니다. 주기마다 집합을 떼어 내 증분 백업을 실행하면 백업 워커는 집합에 없는
+// 하위 트리를 기준 백업에서 stat 없이 이어받고(backup.c), 바뀐 디렉토리만 실제로 걷습니다.
+// 이벤트 큐가 넘치거나(IN_Q_OVERFLOW) 감시를 다 걸지 못했거나 백업이 실패하면 다음 주기는
+// 전체를 다시 검사합니다. 시작할 때도 감시 전의 변경을 놓치지 않도록 한 번 전체를 검사합니다.
+// 새로 생기거나 옮겨 온 디렉토리는 그 자리에서 감시를 추가합니다 (같은 inode면 같은 wd의 경로만 갱신).
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | \
+                    IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR)
+#define WATCH_EVENT_BUFFER (64 * 1024)
+
+// 경로 집합 (open addressing, 문자열 복사본 소유)
+struct path_set {
+    char **slots;
+    size_t capacity;
+    size_t count;
+};
+
+typedef struct {
+    int fd;
+    const char *source;
+    char source_abs[MAX_PATH];    // 디렉토리 제외 패턴 (/proc 등) 비교용 절대 경로
+    const backup_options_t *opts;
+    char **paths;                 // wd → 소스 기준 상대 경로 ("" = 소스 루트)
+    size_t path_count;
+    size_t directories;
+    path_set_t *dirty;
+    int rescan;                   // 다음 주기에 전체 검사
+    int incomplete;               // 감시 한도 등으로 일부 디렉토리를 감시하지 못함
+} watcher_t;
+
+static path_set_t *path_set_create(void) {
+    path_set_t *set = calloc(1, sizeof(*set));
+
+    if (!set) return NULL;
+    set->capacity = 64;
+    set->slots = calloc(set->capacity, sizeof(char *));
+    if (!set->slots) {
+        free(set);
+        return NULL;
+    }
+    return set;
+}
+
+static void path_set_free(path_set_t *set) {
+    if (!set) return;
+
+    for (size_t i = 0; i < set->capacity; i++) {
+        free(set->slots[i]);
+    }
+    free(set->slots);
+    free(set);
+}
+
+static size_t path_set_slot(char **slots, size_t capacity, const char *path) {
+    size_t slot = (size_t)XXH3_64bits(path, strlen(path)) & (capacity - 1);
+
+    while (slots[slot] && strcmp(slots[slot], path) != 0) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return slot;
+}
+
+int path_set_contains(const path_set_t *set, const char *path) {
+    return set && set->slots[path_set_slot(set->slots, set->capacity, path)] != NULL;
+}
+
+// 추가 (이미 있으면 그대로), 메모리 부족이면 ERROR_MEMORY
+static int path_set_add(path_set_t *set, const char *path) {
+    size_t slot;
+
+    if (set->count * 2 >= set->capacity) {
+        size_t capacity = set->capacity * 2;
+        char **slots = calloc(capacity, sizeof(char *));
+
+        if (!slots) return ERROR_MEMORY;
+        for (size_t i = 0; i < set->capacity; i++) {
+            if (set->slots[i]) {
+                slots[path_set_slot(slots, capacity, set->slots[i])] = set->slots[i];
+            }
+        }
+        free(set->slots);
+        set->slots = slots;
+        set->capacity = capacity;
+    }
+
+    slot = path_set_slot(set->slots, set->capacity, path);
+    if (set->slots[slot]) return SUCCESS;
+
+    set->slots[slot] = strdup(path);
+    if (!set->slots[slot]) return ERROR_MEMORY;
+    set->count++;
+    return SUCCESS;
+}
+
+// 디렉토리와 모든 상위 디렉토리를 변경 집합에 추가 (백업은 상위를 걸어야 이 디렉토리에 도달)
+static void mark_dirty(watcher_t *watcher, const char *rel) {
+    char path[MAX_PATH];
+    char *slash;
+
+    snprintf(path, sizeof(path), "%s", rel);
+    for (;;) {
+        if (path_set_add(watcher->dirty, path) != SUCCESS) {
+            watcher->rescan = 1;
+            return;
+        }
+        if (path[0] == '\0') return;
+        slash = strrchr(path, '/');
+        if (slash) {
+            *slash = '\0';
+        } else {
+            path[0] = '\0';
+        }
+    }
+}
+
+static void set_watch_path(watcher_t *watcher, int wd, const char *rel) {
+    if ((size_t)wd >= watcher->path_count) {
+        size_t count = watcher->path_count ? watcher->path_count : 1024;
+        char **grown;
+
+        while (count <= (size_t)wd) count *= 2;
+        grown = realloc(watcher->paths, count * sizeof(char *));
+        if (!grown) {
+            watcher->rescan = 1;
+            return;
+        }
+        memset(grown + watcher->path_count, 0, (count - watcher->path_count) * sizeof(char *));
+        watcher->paths = grown;
+        watcher->path_count = count;
+    }
+
+    if (!watcher->paths[wd]) {
+        watcher->directories++;
+    }
+    free(watcher->paths[wd]);
+    watcher->paths[wd] = strdup(rel);
+}
+
+// 디렉토리 하나에 감시 추가 (감시했으면 1)
+static int add_watch(watcher_t *watcher, const char *path, const char *rel) {
+    int wd = inotify_add_watch(watcher->fd, path, WATCH_MASK);
+
+    if (wd < 0) {
+        if (errno == ENOSPC && !watcher->incomplete) {
+            log_warning("inotify 감시 한도에 도달해 매 주기 전체를 검사합니다 (fs.inotify.max_user_watches)");
+        } else if (errno != ENOENT && errno != ENOTDIR) {
+            log_warning("감시 추가 실패: %s (%s)", path, strerror(errno));
+        }
+        if (errno != ENOENT && errno != ENOTDIR) {
+            watcher->incomplete = 1;
+        }
+        return 0;
+    }
+    set_watch_path(watcher, wd, rel);
+    return 1;
+}
+
+// rel 디렉토리와 그 아래 모든 디렉토리에 감시 추가 (walk.c 로 재귀 없이 순회)
+static void add_watch_tree(watcher_t *watcher, const char *rel) {
+    char path[MAX_PATH];
+    dir_walk_t walk;
+
+    if (rel[0]) {
+        snprintf(path, sizeof(path), "%s/%s", watcher->source, rel);
+    } else {
+        snprintf(path, sizeof(path), "%s", watcher->source);
+    }
+
+    if (!add_watch(watcher, path, rel)) {
+        return;
+    }
+    if (walk_init(&walk, path, NULL, 0) != SUCCESS || walk_enter(&walk) != SUCCESS) {
+        walk_free(&walk);
+        return;
+    }
+
+    while (walk.depth > 0) {
+        char child[MAX_PATH];
+        const char *name = walk_next(&walk);
+        struct stat st;
+
+        if (!name) {
+            walk_leave(&walk);
+            continue;
+        }
+        if (walk.d_type != DT_DIR && walk.d_type != DT_UNKNOWN && walk.d_type != DT_LNK) {
+            continue;
+        }
+
+        snprintf(child, sizeof(child), rel[0] ? "%s/%s" : "%s%s", rel, walk_rel(&walk));
+        // 백업 워커와 같은 기준 (stat, 제외 패턴, 제외 디렉토리; 제외 파일은 주기마다 백업이 다시 읽음)
+        if (stat(walk.src.buf, &st) == 0 && S_ISDIR(st.st_mode) && !is_excluded_path(walk.src.buf, watcher->opts) &&
+            !is_excluded_directory(watcher->source_abs, child, name, watcher->opts) &&
+            add_watch(watcher, walk.src.buf, child)) {
+            walk_enter(&walk);
+        }
+    }
+    walk_free(&walk);
+}
+
+static void handle_event(watcher_t *watcher, const struct inotify_event *event) {
+    const char *rel;
+
+    if (event->mask & IN_Q_OVERFLOW) {
+        if (!watcher->rescan) {
+            log_warning("변경 이벤트 큐가 넘쳐 다음 백업에서 전체를 다시 검사합니다");
+        }
+        watcher->rescan = 1;
+        return;
+    }
+
+    if (event->wd < 0 || (size_t)event->wd >= watcher->path_count || !watcher->paths[event->wd]) {
+        return;
+    }
+    rel = watcher->paths[event->wd];
+
+    if (event->mask & IN_IGNORED) {
+        free(watcher->paths[event->wd]);
+        watcher->paths[event->wd] = NULL;
+        watcher->directories--;
+        return;
+    }
+
+    log_debug("변경 이벤트: %s/%s (0x%x)", rel, event->len > 0 ? event->name : "", event->mask);
+    mark_dirty(watcher, rel);
+
+    if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)) && event->len > 0) {
+        char child[MAX_PATH];
+
+        snprintf(child, sizeof(child), rel[0] ? "%s/%s" : "%s%s", rel, event->name);
+        add_watch_tree(watcher, child);
+    }
+}
+
+static void drain_events(watcher_t *watcher) {
+    char buffer[WATCH_EVENT_BUFFER] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+
+    while ((len = read(watcher->fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+
+            handle_event(watcher, event);
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+// 한 주기: 변경 집합을 떼어 내 증분 백업 (체인에 전체 백업이 없으면 먼저 전체 백업)
+static int run_watch_backup(watcher_t *watcher, const char *chain, const backup_options_t *opts) {
+    char full_path[MAX_PATH];
+    backup_options_t run_opts = *opts;
+    path_set_t *dirty = watcher->dirty;
+    int rescan = watcher->rescan || watcher->incomplete;
+    int result;
+
+    // 백업 중에 들어오는 이벤트는 다음 주기의 집합으로
+    watcher->dirty = path_set_create();
+    if (!watcher->dirty) {
+        watcher->dirty = dirty;
+        return ERROR_MEMORY;
+    }
+    if (watcher->rescan) {
+        // 넘친 동안 생긴 디렉토리도 감시 (이미 감시 중인 디렉토리는 경로만 갱신)
+        watcher->rescan = 0;
+        add_watch_tree(watcher, "");
+    }
+
+    pthread_mutex_lock(&g_stats_mutex);
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats.start_time = time(NULL);
+    pthread_mutex_unlock(&g_stats_mutex);
+
+    snprintf(full_path, sizeof(full_path), "%s/%s", chain, BACKUP_CHAIN_FULL);
+    if (!file_exists(full_path)) {
+        log_info("체인에 전체 백업이 없어 먼저 전체 백업합니다: %s", full_path);
+        run_opts.mode = BACKUP_FULL;
+        result = backup_directory_recursive(watcher->source, full_path, &run_opts);
+    } else {
+        if (rescan) {
+            log_info("전체 다시 검사: %s", watcher->source);
+        } else {
+            log_info("변경된 디렉토리 %zu개 백업", dirty->count);
+            backup_set_dirty_set(dirty);
+        }
+        result = backup_directory_recursive(watcher->source, chain, &run_opts);
+        backup_set_dirty_set(NULL);
+    }
+    path_set_free(dirty);
+
+    if (result != SUCCESS) {
+        log_warning("감시 백업 실패 (%d), 다음 주기에 전체를 다시 검사합니다", result);
+        watcher->rescan = 1;
+    }
+    return result;
+}
+
+// 소스를 감시하며 interval 초마다 변경분을 chain에 증분(또는 차등) 백업, SIGINT/SIGTERM 까지 실행
+int watch_directory(const char *source, const char *chain, const backup_options_t *opts) {
+    watcher_t watcher;
+    backup_options_t run_opts = *opts;
+    int interval = opts->watch_interval > 0 ? opts->watch_interval : WATCH_DEFAULT_INTERVAL;
+    time_t next_run;
+    int result = SUCCESS;
+
+    if (run_opts.mode == BACKUP_FULL) {
+        run_opts.mode = BACKUP_INCREMENTAL;
+    }
+
+    memset(&watcher, 0, sizeof(watcher));
+    watcher.source = source;
+    if (!realpath(source, watcher.source_abs)) {
+        snprintf(watcher.source_abs, sizeof(watcher.source_abs), "%s", source);
+    }
+    watcher.opts = &run_opts;
+    watcher.dirty = path_set_create();
+    watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher.fd < 0 || !watcher.dirty) {
+        log_error("변경 감시를 시작할 수 없습니다: %s", strerror(errno));
+        if (watcher.fd >= 0) close(watcher.fd);
+        path_set_free(watcher.dirty);
+        return ERROR_GENERAL;
+    }
+
+    add_watch_tree(&watcher, "");
+    log_info("변경 감시 시작: %s -> %s (디렉토리 %zu개, %d초 간격)", source, chain, watcher.directories, interval);
+
+    // 감시를 걸기 전의 변경을 반영하도록 첫 주기는 전체 검사
+    watcher.rescan = 1;
+    next_run = time(NULL);
+
+    while (!g_progress.cancel_requested) {
+        struct pollfd pfd = { .fd = watcher.fd, .events = POLLIN };
+        time_t now = time(NULL);
+        int ready;
+
+        if (now >= next_run) {
+            drain_events(&watcher);
+            if (watcher.rescan || watcher.dirty->count > 0) {
+                result = run_watch_backup(&watcher, chain, &run_opts);
+            }
+            next_run = time(NULL) + interval;
+            continue;
+        }
+
+        ready = poll(&pfd, 1, (int)(next_run - now) * 1000);
+        if (ready < 0 && errno != EINTR) {
+            log_error("변경 이벤트 대기 실패: %s", strerror(errno));
+            result = ERROR_GENERAL;
+            break;
+        }
+        if (ready > 0) {
+            drain_events(&watcher);
+        }
+    }
+
+    if (watcher.dirty->count > 0) {
+        log_info("백업하지 않은 변경 디렉토리 %zu개 (다음 감시 시작 시 전체 검사로 반영)", watcher.dirty->count);
+    }
+    log_info("변경 감시 종료: %s", source);
+
+    close(watcher.fd);
+    for (size_t i = 0; i < watcher.path_count; i++) {
+        free(watcher.paths[i]);
+    }
+    free(watcher.paths);
+    path_set_free(watcher.dirty);
+    return result;
+}